@@ -0,0 +1,56 @@
+#include "stdafx.h"
+
+#pragma region Includes
+//Include{s}
+#include "AccelerationStructurePool.h"
+#pragma endregion
+
+#pragma region Constructors and Destructors
+AccelerationStructurePool::AccelerationStructurePool(ComPtr<ID3D12Device5> device, UINT64 pageSize, const wchar_t* name) :
+	m_suballocator(pageSize)
+{
+	m_device = device;
+	m_name = name;
+}
+#pragma endregion
+
+#pragma region Allocation Methods
+AccelerationStructureAllocation AccelerationStructurePool::Allocate(UINT64 size)
+{
+	AccelerationStructureAllocation allocation;
+	allocation.block = m_suballocator.Allocate(size, D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BYTE_ALIGNMENT);
+
+	if (!allocation.IsValid())
+	{
+		return allocation;
+	}
+
+	// The suballocator only grows one heap at a time, back it with a page.
+	while (m_pages.size() < m_suballocator.GetHeapCount())
+	{
+		UINT pageIndex = static_cast<UINT>(m_pages.size());
+
+		CD3DX12_HEAP_PROPERTIES heapProperties(D3D12_HEAP_TYPE_DEFAULT);
+		CD3DX12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(m_suballocator.GetHeapSize(pageIndex),
+			D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+
+		ComPtr<ID3D12Resource> page;
+		ThrowIfFailed(m_device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &bufferDesc,
+			D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE, nullptr, IID_PPV_ARGS(&page)));
+
+		std::wstring pageName = m_name + L" Page " + std::to_wstring(pageIndex);
+		page->SetName(pageName.c_str());
+
+		m_pages.push_back(page);
+	}
+
+	allocation.address = m_pages[allocation.block.heapIndex]->GetGPUVirtualAddress() + allocation.block.offset;
+
+	return allocation;
+}
+
+void AccelerationStructurePool::Free(const AccelerationStructureAllocation& allocation)
+{
+	m_suballocator.Free(allocation.block);
+}
+#pragma endregion
@@ -0,0 +1,66 @@
+#pragma once
+
+#pragma region Includes
+//Include{s}
+#include "HeapSuballocator.h"
+#include "DXRApp.h"
+#pragma endregion
+
+/// <summary>
+/// A slice of one of the pool's pages holding an acceleration structure.
+/// </summary>
+struct AccelerationStructureAllocation
+{
+	HeapAllocation block;
+	D3D12_GPU_VIRTUAL_ADDRESS address = 0;
+
+	bool IsValid() const { return block.IsValid(); }
+};
+
+/// <summary>
+/// The AccelerationStructurePool class. Packs acceleration structures into a few big default heap buffers ("pages")
+/// instead of a committed resource each. Placed resources would need 64KB alignment, which is more than most of our BLASes,
+/// so structures are suballocated by GPU address at the 256 byte alignment DXR asks for. The pages stay in the
+/// acceleration structure state for their whole life.
+/// </summary>
+class AccelerationStructurePool
+{
+public:
+#pragma region Constructors and Destructors
+	/// <summary>
+	/// Initializes a new instance of the AccelerationStructurePool class.
+	/// </summary>
+	/// <param name="device">The device the pages are created on.</param>
+	/// <param name="pageSize">The size of each page in bytes, bigger structures get a page of their own.</param>
+	/// <param name="name">The debug name given to the pages.</param>
+	AccelerationStructurePool(ComPtr<ID3D12Device5> device, UINT64 pageSize, const wchar_t* name);
+#pragma endregion
+
+#pragma region Allocation Methods
+	/// <summary>
+	/// Finds room for an acceleration structure, creating a page if none of the current ones can fit it.
+	/// </summary>
+	/// <param name="size">The size of the structure in bytes.</param>
+	/// <returns>The slice, its address is what goes in the build and instance descriptors.</returns>
+	AccelerationStructureAllocation Allocate(UINT64 size);
+
+	/// <summary>
+	/// Gives a slice back. The GPU has to be done with it, retire it through the frame pacer if it might not be.
+	/// </summary>
+	void Free(const AccelerationStructureAllocation& allocation);
+#pragma endregion
+
+#pragma region Getters
+	UINT GetPageCount() const { return static_cast<UINT>(m_pages.size()); }
+	ID3D12Resource* GetPage(UINT pageIndex) const { return m_pages[pageIndex].Get(); }
+	const HeapSuballocator& GetSuballocator() const { return m_suballocator; }
+#pragma endregion
+
+private:
+#pragma region Private Variables
+	ComPtr<ID3D12Device5> m_device;
+	std::wstring m_name;
+	HeapSuballocator m_suballocator;
+	std::vector<ComPtr<ID3D12Resource>> m_pages; // One per suballocator heap, same index
+#pragma endregion
+};
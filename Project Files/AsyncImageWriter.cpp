@@ -0,0 +1,111 @@
+#pragma region Includes
+//Include{s}
+#include "AsyncImageWriter.h"
+#include <chrono>
+#include <stdexcept>
+#pragma endregion
+
+#pragma region Constructors and Destructors
+AsyncImageWriter::AsyncImageWriter(ImageEncodeFunction encoder, size_t maxQueued)
+{
+	if (encoder == nullptr)
+	{
+		throw std::logic_error("AsyncImageWriter needs an encoder");
+	}
+
+	m_encoder = encoder;
+	m_maxQueued = maxQueued > 0 ? maxQueued : 1;
+	m_worker = std::thread(&AsyncImageWriter::WorkerLoop, this);
+}
+
+AsyncImageWriter::~AsyncImageWriter()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+
+	m_workAvailable.notify_all();
+	m_worker.join();
+}
+#pragma endregion
+
+#pragma region Writer Methods
+void AsyncImageWriter::Submit(ImageWriteJob&& job)
+{
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_workDone.wait(lock, [this] { return m_jobs.size() < m_maxQueued; });
+		m_jobs.push_back(std::move(job));
+	}
+
+	m_workAvailable.notify_one();
+}
+
+void AsyncImageWriter::Flush()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_workDone.wait(lock, [this] { return m_jobs.empty() && !m_busy; });
+}
+
+std::vector<ImageWriteResult> AsyncImageWriter::TakeResults()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	std::vector<ImageWriteResult> results;
+	results.swap(m_results);
+	return results;
+}
+
+size_t AsyncImageWriter::GetQueuedCount() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_jobs.size() + (m_busy ? 1 : 0);
+}
+#pragma endregion
+
+#pragma region Private Methods
+void AsyncImageWriter::WorkerLoop()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	for (;;)
+	{
+		// Stopping still drains the queue, nothing submitted gets thrown away.
+		m_workAvailable.wait(lock, [this] { return m_stopping || !m_jobs.empty(); });
+		if (m_jobs.empty())
+		{
+			return;
+		}
+
+		ImageWriteJob job = std::move(m_jobs.front());
+		m_jobs.pop_front();
+		m_busy = true;
+		lock.unlock();
+
+		// There's room in the queue again now, so let a waiting Submit in while this one encodes.
+		m_workDone.notify_all();
+
+		ImageWriteResult result;
+		result.frame = job.frame;
+		result.path = job.path;
+		result.renderMs = job.renderMs;
+
+		auto encodeStart = std::chrono::steady_clock::now();
+		try
+		{
+			result.succeeded = m_encoder(job.path, job.width, job.height, job.pixels.data());
+		}
+		catch (...)
+		{
+			result.succeeded = false;
+		}
+		result.encodeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - encodeStart).count();
+
+		lock.lock();
+		m_results.push_back(result);
+		m_busy = false;
+		m_workDone.notify_all();
+	}
+}
+#pragma endregion
@@ -0,0 +1,111 @@
+#pragma once
+
+#pragma region Includes
+//Include{s}
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#pragma endregion
+
+// No Windows headers, the encoder is handed in so the queue and the thread don't care what the file format is.
+
+#pragma region Data Structures
+/// <summary>
+/// Writes one image. Pixels are tightly packed RGBA8, top row first.
+/// </summary>
+typedef bool (*ImageEncodeFunction)(const std::string& path, uint32_t width, uint32_t height, const uint8_t* pixels);
+
+/// <summary>
+/// One image waiting to be written.
+/// </summary>
+struct ImageWriteJob
+{
+	uint64_t frame = 0;
+	std::string path;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	std::vector<uint8_t> pixels;
+	double renderMs = 0.0; // Just carried through, so the timings come out together
+};
+
+/// <summary>
+/// How one image went.
+/// </summary>
+struct ImageWriteResult
+{
+	uint64_t frame = 0;
+	std::string path;
+	double renderMs = 0.0;
+	double encodeMs = 0.0;
+	bool succeeded = false;
+};
+#pragma endregion
+
+/// <summary>
+/// The AsyncImageWriter class. Encodes images on its own thread so the next frame can render while the last one is written.
+/// The queue is bounded, so if encoding can't keep up Submit waits instead of piling frames up in memory.
+/// </summary>
+class AsyncImageWriter
+{
+public:
+#pragma region Constructors and Destructors
+	/// <summary>
+	/// Initializes a new instance of the AsyncImageWriter class and starts its thread.
+	/// </summary>
+	/// <param name="encoder">Writes each image.</param>
+	/// <param name="maxQueued">How many images can wait before Submit blocks.</param>
+	AsyncImageWriter(ImageEncodeFunction encoder, size_t maxQueued = 4);
+
+	/// <summary>
+	/// Writes whatever's left, then stops the thread.
+	/// </summary>
+	~AsyncImageWriter();
+
+	AsyncImageWriter(const AsyncImageWriter&) = delete;
+	AsyncImageWriter& operator=(const AsyncImageWriter&) = delete;
+#pragma endregion
+
+#pragma region Writer Methods
+	/// <summary>
+	/// Queues an image, taking its pixels. Waits if the queue is full.
+	/// </summary>
+	void Submit(ImageWriteJob&& job);
+
+	/// <summary>
+	/// Waits until every queued image has been written.
+	/// </summary>
+	void Flush();
+
+	/// <summary>
+	/// Hands back the results written since the last call, in the order they were submitted.
+	/// </summary>
+	std::vector<ImageWriteResult> TakeResults();
+
+	size_t GetQueuedCount() const;
+#pragma endregion
+
+private:
+#pragma region Private Methods
+	void WorkerLoop();
+#pragma endregion
+
+#pragma region Private Variables
+	ImageEncodeFunction m_encoder;
+	size_t m_maxQueued;
+
+	mutable std::mutex m_mutex;
+	std::condition_variable m_workAvailable; // The worker waits on this for jobs
+	std::condition_variable m_workDone; // Submit and Flush wait on this for space or an empty queue
+	std::deque<ImageWriteJob> m_jobs;
+	std::vector<ImageWriteResult> m_results;
+	bool m_busy = false;
+	bool m_stopping = false;
+
+	std::thread m_worker; // Last, so everything above exists before it starts
+#pragma endregion
+};
@@ -0,0 +1,118 @@
+#pragma region Includes
+//Include{s}
+#include "BenchmarkRecorder.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#pragma endregion
+
+#pragma region Recording Methods
+void BenchmarkRecorder::Start(const std::string& name, size_t frameCount, size_t warmupFrames)
+{
+	m_name = name;
+	m_frames.clear();
+	m_frames.reserve(frameCount);
+	m_frameCount = frameCount;
+	m_warmupRemaining = warmupFrames;
+	m_running = frameCount > 0;
+}
+
+void BenchmarkRecorder::Stop()
+{
+	m_running = false;
+}
+
+bool BenchmarkRecorder::AddFrame(uint64_t frame, double frameMs, uint64_t rays)
+{
+	if (!m_running)
+	{
+		return false;
+	}
+
+	if (m_warmupRemaining > 0)
+	{
+		m_warmupRemaining--;
+		return false;
+	}
+
+	BenchmarkFrame sample;
+	sample.frame = frame;
+	sample.frameMs = frameMs;
+	sample.rays = rays;
+	m_frames.push_back(sample);
+
+	if (m_frames.size() >= m_frameCount)
+	{
+		m_running = false;
+		return true;
+	}
+
+	return false;
+}
+#pragma endregion
+
+#pragma region Output Methods
+BenchmarkSummary BenchmarkRecorder::Summarise(const std::vector<BenchmarkFrame>& frames)
+{
+	BenchmarkSummary summary;
+	summary.frames = frames.size();
+
+	if (frames.empty())
+	{
+		return summary;
+	}
+
+	std::vector<double> times;
+	times.reserve(frames.size());
+
+	double totalMs = 0.0;
+	uint64_t totalRays = 0;
+	for (const BenchmarkFrame& frame : frames)
+	{
+		times.push_back(frame.frameMs);
+		totalMs += frame.frameMs;
+		totalRays += frame.rays;
+	}
+
+	std::sort(times.begin(), times.end());
+
+	// Nearest rank, the smallest time that at least p of the frames are at or under.
+	auto percentile = [&times](double p)
+	{
+		size_t rank = static_cast<size_t>(std::ceil(p * times.size()));
+		return times[rank > 0 ? rank - 1 : 0];
+	};
+
+	summary.minMs = times.front();
+	summary.maxMs = times.back();
+	summary.avgMs = totalMs / times.size();
+	summary.p95Ms = percentile(0.95);
+	summary.p99Ms = percentile(0.99);
+	summary.raysPerSecond = totalMs > 0.0 ? totalRays / (totalMs / 1000.0) : 0.0;
+
+	return summary;
+}
+
+bool BenchmarkRecorder::WriteCsv(const std::string& path) const
+{
+	std::ofstream file(path, std::ios::trunc);
+	if (!file)
+	{
+		return false;
+	}
+
+	BenchmarkSummary summary = GetSummary();
+
+	file << "name,frames,min_ms,avg_ms,p95_ms,p99_ms,max_ms,rays_per_second\n";
+	file << m_name << ',' << summary.frames << ',' << summary.minMs << ',' << summary.avgMs << ',' << summary.p95Ms << ','
+		<< summary.p99Ms << ',' << summary.maxMs << ',' << summary.raysPerSecond << "\n\n";
+
+	file << "frame,frame_ms,rays\n";
+	for (const BenchmarkFrame& frame : m_frames)
+	{
+		file << frame.frame << ',' << frame.frameMs << ',' << frame.rays << '\n';
+	}
+
+	return static_cast<bool>(file);
+}
+#pragma endregion
@@ -0,0 +1,95 @@
+#pragma once
+
+#pragma region Includes
+//Include{s}
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#pragma endregion
+
+// No Windows headers, the runtime feeds it frame times and ray counts and it does the sums and the CSV.
+
+#pragma region Data Structures
+/// <summary>
+/// One measured benchmark frame.
+/// </summary>
+struct BenchmarkFrame
+{
+	uint64_t frame = 0;
+	double frameMs = 0.0;
+	uint64_t rays = 0; // Primary, shadow and reflection rays that came back this frame
+};
+
+/// <summary>
+/// The frame time spread and ray rate over a whole run.
+/// </summary>
+struct BenchmarkSummary
+{
+	size_t frames = 0;
+	double minMs = 0.0;
+	double avgMs = 0.0;
+	double p95Ms = 0.0;
+	double p99Ms = 0.0;
+	double maxMs = 0.0;
+	double raysPerSecond = 0.0;
+};
+#pragma endregion
+
+/// <summary>
+/// The BenchmarkRecorder class. Records a fixed number of frames after a warmup and summarises them.
+/// </summary>
+class BenchmarkRecorder
+{
+public:
+#pragma region Recording Methods
+	/// <summary>
+	/// Starts a run, throwing away the last one.
+	/// </summary>
+	/// <param name="name">What the run is called, goes in the CSV.</param>
+	/// <param name="frameCount">How many frames are measured.</param>
+	/// <param name="warmupFrames">How many frames are skipped first, so pipeline creation and the first uploads don't count.</param>
+	void Start(const std::string& name, size_t frameCount, size_t warmupFrames);
+
+	/// <summary>
+	/// Stops a run early, keeping what was measured.
+	/// </summary>
+	void Stop();
+
+	/// <summary>
+	/// Adds a frame, warmup frames are counted but not kept.
+	/// </summary>
+	/// <returns>True on the frame that finishes the run.</returns>
+	bool AddFrame(uint64_t frame, double frameMs, uint64_t rays);
+
+	bool IsRunning() const { return m_running; }
+	bool IsWarmingUp() const { return m_running && m_warmupRemaining > 0; }
+#pragma endregion
+
+#pragma region Output Methods
+	/// <summary>
+	/// Works out the spread of a set of frames. Percentiles are nearest rank, so they're always a real frame time.
+	/// </summary>
+	static BenchmarkSummary Summarise(const std::vector<BenchmarkFrame>& frames);
+
+	/// <summary>
+	/// Writes the summary as a header and one row, then every frame, as CSV.
+	/// </summary>
+	/// <returns>False if the file couldn't be written.</returns>
+	bool WriteCsv(const std::string& path) const;
+
+	BenchmarkSummary GetSummary() const { return Summarise(m_frames); }
+	const std::vector<BenchmarkFrame>& GetFrames() const { return m_frames; }
+	const std::string& GetName() const { return m_name; }
+	size_t GetFrameCount() const { return m_frameCount; }
+#pragma endregion
+
+private:
+#pragma region Private Variables
+	std::string m_name;
+	std::vector<BenchmarkFrame> m_frames;
+	size_t m_frameCount = 0;
+	size_t m_warmupRemaining = 0;
+	bool m_running = false;
+#pragma endregion
+};
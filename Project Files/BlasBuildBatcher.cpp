@@ -0,0 +1,61 @@
+#pragma region Includes
+//Include{s}
+#include "BlasBuildBatcher.h"
+#include <stdexcept>
+#pragma endregion
+
+#pragma region Constructors and Destructors
+BlasBuildBatcher::BlasBuildBatcher(uint64_t scratchBudget, uint64_t scratchAlignment)
+{
+	if (scratchAlignment == 0 || (scratchAlignment & (scratchAlignment - 1)) != 0)
+	{
+		throw std::logic_error("BLAS scratch alignment has to be a power of two");
+	}
+
+	m_scratchBudget = scratchBudget;
+	m_scratchAlignment = scratchAlignment;
+}
+#pragma endregion
+
+#pragma region Batching Methods
+std::vector<BlasBuildBatch> BlasBuildBatcher::Plan(const std::vector<uint64_t>& scratchSizes) const
+{
+	std::vector<BlasBuildBatch> batches;
+
+	for (size_t i = 0; i < scratchSizes.size(); i++)
+	{
+		uint64_t offset = batches.empty() ? 0 : (batches.back().scratchBytes + m_scratchAlignment - 1) & ~(m_scratchAlignment - 1);
+
+		// Start a new batch if this one would go over budget. A build that's over budget by itself ends up alone in its batch.
+		if (batches.empty() || offset + scratchSizes[i] > m_scratchBudget)
+		{
+			batches.push_back(BlasBuildBatch());
+			offset = 0;
+		}
+
+		BlasBatchBuild build;
+		build.index = i;
+		build.scratchOffset = offset;
+
+		batches.back().builds.push_back(build);
+		batches.back().scratchBytes = offset + scratchSizes[i];
+	}
+
+	return batches;
+}
+
+uint64_t BlasBuildBatcher::GetScratchBytes(const std::vector<BlasBuildBatch>& batches)
+{
+	uint64_t largest = 0;
+
+	for (const BlasBuildBatch& batch : batches)
+	{
+		if (batch.scratchBytes > largest)
+		{
+			largest = batch.scratchBytes;
+		}
+	}
+
+	return largest;
+}
+#pragma endregion
@@ -0,0 +1,68 @@
+#pragma once
+
+#pragma region Includes
+//Include{s}
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#pragma endregion
+
+// No Windows headers, this only works out which builds go together and where their scratch goes.
+
+#pragma region Data Structures
+/// <summary>
+/// One build in a batch and its slice of the scratch arena.
+/// </summary>
+struct BlasBatchBuild
+{
+	size_t index = 0; // Which build, in the order the scratch sizes were given
+	uint64_t scratchOffset = 0;
+};
+
+/// <summary>
+/// Builds that get recorded back to back with no barriers between them, so none of them can share scratch.
+/// </summary>
+struct BlasBuildBatch
+{
+	std::vector<BlasBatchBuild> builds;
+	uint64_t scratchBytes = 0; // How much of the arena the batch uses
+};
+#pragma endregion
+
+/// <summary>
+/// The BlasBuildBatcher class. Splits a list of BLAS builds into batches that can all run at once on the GPU.
+/// Builds in a batch each get their own slice of the scratch arena, so there's nothing to wait for between them.
+/// Once a batch would go over the scratch budget a new one starts, and the barrier between batches makes it safe to reuse the arena from the start.
+/// </summary>
+class BlasBuildBatcher
+{
+public:
+#pragma region Constructors and Destructors
+	/// <summary>
+	/// Initializes a new instance of the BlasBuildBatcher class.
+	/// </summary>
+	/// <param name="scratchBudget">The most scratch a batch may use. A build bigger than this still goes through, in a batch of its own.</param>
+	/// <param name="scratchAlignment">The alignment of each scratch slice, has to be a power of two.</param>
+	BlasBuildBatcher(uint64_t scratchBudget, uint64_t scratchAlignment);
+#pragma endregion
+
+#pragma region Batching Methods
+	/// <summary>
+	/// Works out the batches, keeping the builds in the order given.
+	/// </summary>
+	/// <param name="scratchSizes">The scratch each build needs.</param>
+	/// <returns>The batches, in the order they should be recorded.</returns>
+	std::vector<BlasBuildBatch> Plan(const std::vector<uint64_t>& scratchSizes) const;
+
+	/// <summary>
+	/// Gets how big the scratch arena has to be for a plan, which is the biggest batch.
+	/// </summary>
+	static uint64_t GetScratchBytes(const std::vector<BlasBuildBatch>& batches);
+#pragma endregion
+
+private:
+#pragma region Private Variables
+	uint64_t m_scratchBudget;
+	uint64_t m_scratchAlignment;
+#pragma endregion
+};
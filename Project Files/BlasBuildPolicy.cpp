@@ -0,0 +1,195 @@
+#pragma region Includes
+//Include{s}
+#include "BlasBuildPolicy.h"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#pragma endregion
+
+#pragma region Policy Methods
+BlasBuildPolicy DefaultBlasPolicySelector::SelectPolicy(const BlasMeshDescription& mesh) const
+{
+	BlasBuildPolicy policy;
+
+	if (mesh.deforming)
+	{
+		policy.preferFastBuild = true;
+		policy.allowUpdate = true;
+	}
+	else
+	{
+		policy.preferFastTrace = true;
+		policy.allowCompaction = true;
+	}
+
+	return policy;
+}
+#pragma endregion
+
+#pragma region Accounting Methods
+size_t BlasMemoryReport::AddBuild(const std::string& name, const BlasBuildPolicy& policy, uint64_t scratchBytes, uint64_t reservedBytes)
+{
+	BlasMemoryEntry entry;
+	entry.name = name;
+	entry.policy = policy;
+	entry.scratchBytes = scratchBytes;
+	entry.reservedBytes = reservedBytes;
+	entry.finalBytes = reservedBytes;
+	m_entries.push_back(entry);
+
+	return m_entries.size() - 1;
+}
+
+void BlasMemoryReport::SetCompactedSize(size_t index, uint64_t compactedBytes)
+{
+	if (index >= m_entries.size())
+	{
+		throw std::logic_error("Compacted size for a BLAS that isn't in the report");
+	}
+
+	// The compacted size can't be bigger than what was reserved, if it is something's gone badly wrong with the readback.
+	if (compactedBytes > m_entries[index].reservedBytes)
+	{
+		throw std::logic_error("BLAS compacted size is bigger than its uncompacted size");
+	}
+
+	m_entries[index].finalBytes = compactedBytes;
+}
+#pragma endregion
+
+#pragma region Trace Methods
+bool BlasMemoryReport::WriteCsv(const std::string& path) const
+{
+	std::ofstream file(path, std::ios::trunc);
+	if (!file)
+	{
+		return false;
+	}
+
+	file << "name,fast_trace,fast_build,update,compact,scratch_bytes,reserved_bytes,final_bytes\n";
+	for (const BlasMemoryEntry& entry : m_entries)
+	{
+		file << entry.name << ',' << (entry.policy.preferFastTrace ? 1 : 0) << ',' << (entry.policy.preferFastBuild ? 1 : 0) << ','
+			<< (entry.policy.allowUpdate ? 1 : 0) << ',' << (entry.policy.allowCompaction ? 1 : 0) << ',' << entry.scratchBytes << ','
+			<< entry.reservedBytes << ',' << entry.finalBytes << '\n';
+	}
+
+	return static_cast<bool>(file);
+}
+
+bool BlasMemoryReport::ReadCsv(const std::string& path)
+{
+	std::ifstream file(path);
+	if (!file)
+	{
+		return false;
+	}
+
+	m_entries.clear();
+
+	std::string line;
+	while (std::getline(file, line))
+	{
+		if (line.empty() || line[0] == '#' || line.compare(0, 5, "name,") == 0)
+		{
+			continue;
+		}
+
+		std::istringstream stream(line);
+		std::string fields[8];
+		int fieldCount = 0;
+		while (fieldCount < 8 && std::getline(stream, fields[fieldCount], ','))
+		{
+			fieldCount++;
+		}
+
+		if (fieldCount < 8)
+		{
+			continue;
+		}
+
+		BlasMemoryEntry entry;
+		entry.name = fields[0];
+		entry.policy.preferFastTrace = fields[1] == "1";
+		entry.policy.preferFastBuild = fields[2] == "1";
+		entry.policy.allowUpdate = fields[3] == "1";
+		entry.policy.allowCompaction = fields[4] == "1";
+		entry.scratchBytes = std::strtoull(fields[5].c_str(), nullptr, 10);
+		entry.reservedBytes = std::strtoull(fields[6].c_str(), nullptr, 10);
+		entry.finalBytes = std::strtoull(fields[7].c_str(), nullptr, 10);
+		m_entries.push_back(entry);
+	}
+
+	return !m_entries.empty();
+}
+#pragma endregion
+
+#pragma region Getters
+uint64_t BlasMemoryReport::GetReservedBytes() const
+{
+	uint64_t total = 0;
+
+	for (const BlasMemoryEntry& entry : m_entries)
+	{
+		total += entry.reservedBytes;
+	}
+
+	return total;
+}
+
+uint64_t BlasMemoryReport::GetFinalBytes() const
+{
+	uint64_t total = 0;
+
+	for (const BlasMemoryEntry& entry : m_entries)
+	{
+		total += entry.finalBytes;
+	}
+
+	return total;
+}
+
+uint64_t BlasMemoryReport::GetLargestScratchBytes() const
+{
+	uint64_t largest = 0;
+
+	for (const BlasMemoryEntry& entry : m_entries)
+	{
+		if (entry.scratchBytes > largest)
+		{
+			largest = entry.scratchBytes;
+		}
+	}
+
+	return largest;
+}
+
+std::string BlasMemoryReport::Format() const
+{
+	std::string report = "BLAS Memory Report\n";
+	char line[256];
+
+	for (const BlasMemoryEntry& entry : m_entries)
+	{
+		std::string flags;
+		flags += entry.policy.preferFastTrace ? "FastTrace " : "";
+		flags += entry.policy.preferFastBuild ? "FastBuild " : "";
+		flags += entry.policy.allowUpdate ? "Update " : "";
+		flags += entry.policy.allowCompaction ? "Compact " : "";
+
+		snprintf(line, sizeof(line), "  %-24s %-28s scratch %8.1f KB, reserved %8.1f KB, final %8.1f KB\n",
+			entry.name.c_str(), flags.c_str(), entry.scratchBytes / 1024.0, entry.reservedBytes / 1024.0, entry.finalBytes / 1024.0);
+		report += line;
+	}
+
+	uint64_t reservedBytes = GetReservedBytes();
+	snprintf(line, sizeof(line), "  Total: reserved %.1f KB, final %.1f KB, saved %.1f KB (%.1f%%), largest scratch %.1f KB\n",
+		reservedBytes / 1024.0, GetFinalBytes() / 1024.0, GetSavedBytes() / 1024.0,
+		reservedBytes > 0 ? 100.0 * GetSavedBytes() / reservedBytes : 0.0, GetLargestScratchBytes() / 1024.0);
+	report += line;
+
+	return report;
+}
+#pragma endregion
@@ -0,0 +1,124 @@
+#pragma once
+
+#pragma region Includes
+//Include{s}
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#pragma endregion
+
+// No Windows headers, the D3D12 build flags are worked out from the policy in DXRSetup, so this can all be driven headless.
+
+#pragma region Data Structures
+/// <summary>
+/// What the policy gets to look at when picking how a mesh's BLAS is built.
+/// </summary>
+struct BlasMeshDescription
+{
+	std::string name;
+	uint32_t vertexCount = 0;
+	uint32_t indexCount = 0;
+	bool deforming = false; // The vertices change after load, so the BLAS gets refitted rather than rebuilt
+};
+
+/// <summary>
+/// How a BLAS is built, maps one to one onto the D3D12 build flags.
+/// </summary>
+struct BlasBuildPolicy
+{
+	bool preferFastTrace = false;
+	bool preferFastBuild = false;
+	bool allowUpdate = false;
+	bool allowCompaction = false;
+};
+
+/// <summary>
+/// One BLAS's line in the memory report.
+/// </summary>
+struct BlasMemoryEntry
+{
+	std::string name;
+	BlasBuildPolicy policy;
+	uint64_t scratchBytes = 0;
+	uint64_t reservedBytes = 0; // The worst case size the prebuild info asked for
+	uint64_t finalBytes = 0; // What it ended up taking, the compacted size if it was compacted
+};
+#pragma endregion
+
+/// <summary>
+/// Picks a build policy per mesh. Swap it out to try a different policy, or to fake one in a test.
+/// </summary>
+class IBlasPolicySelector
+{
+public:
+	virtual ~IBlasPolicySelector() {}
+
+	/// <summary>
+	/// Picks how a mesh's BLAS should be built.
+	/// </summary>
+	virtual BlasBuildPolicy SelectPolicy(const BlasMeshDescription& mesh) const = 0;
+};
+
+/// <summary>
+/// The DefaultBlasPolicySelector class. Static meshes are built once and traced every frame, so they get fast trace and compaction.
+/// Deforming meshes get fast build and allow update, since they'll be refitted, and compacting a BLAS that's going to be updated doesn't pay.
+/// </summary>
+class DefaultBlasPolicySelector : public IBlasPolicySelector
+{
+public:
+	BlasBuildPolicy SelectPolicy(const BlasMeshDescription& mesh) const override;
+};
+
+/// <summary>
+/// The BlasMemoryReport class. Keeps track of what every BLAS reserved and what it ended up using after compaction.
+/// </summary>
+class BlasMemoryReport
+{
+public:
+#pragma region Accounting Methods
+	/// <summary>
+	/// Adds a BLAS to the report, its final size starts off as the reserved size.
+	/// </summary>
+	/// <returns>The BLAS's index in the report.</returns>
+	size_t AddBuild(const std::string& name, const BlasBuildPolicy& policy, uint64_t scratchBytes, uint64_t reservedBytes);
+
+	/// <summary>
+	/// Records the size a BLAS was compacted down to.
+	/// </summary>
+	void SetCompactedSize(size_t index, uint64_t compactedBytes);
+
+	void Clear() { m_entries.clear(); }
+#pragma endregion
+
+#pragma region Trace Methods
+	/// <summary>
+	/// Writes every BLAS out, one per line, so a real run's sizes can be replayed through the pool allocator without a GPU.
+	/// </summary>
+	bool WriteCsv(const std::string& path) const;
+
+	/// <summary>
+	/// Reads back what WriteCsv wrote, replacing whatever's in the report. Lines starting with # are skipped.
+	/// </summary>
+	/// <returns>False if there isn't a file or it has no BLASes in it.</returns>
+	bool ReadCsv(const std::string& path);
+#pragma endregion
+
+#pragma region Getters
+	const std::vector<BlasMemoryEntry>& GetEntries() const { return m_entries; }
+	uint64_t GetReservedBytes() const;
+	uint64_t GetFinalBytes() const;
+	uint64_t GetSavedBytes() const { return GetReservedBytes() - GetFinalBytes(); }
+	uint64_t GetLargestScratchBytes() const;
+
+	/// <summary>
+	/// Formats the report as a plain text table, one line per BLAS followed by the totals.
+	/// </summary>
+	std::string Format() const;
+#pragma endregion
+
+private:
+#pragma region Private Variables
+	std::vector<BlasMemoryEntry> m_entries;
+#pragma endregion
+};
@@ -6,6 +6,7 @@
 #include <windows.h>
 #include <windowsx.h>
 #include  <vector>
+#include "CameraSpline.h"
 using namespace DirectX;
 #pragma endregion
 
@@ -191,36 +192,16 @@ public:
 #pragma endregion
 
 #pragma region Spline Animation
-	/// <summary>
-	/// The Catmull-Rom spline function.
-	/// </summary>
-	/// <param name="p0">The initial velocity.</param>
-	/// <param name="p1">The first point.</param>
-	/// <param name="p2">The second point.</param>
-	/// <param name="p3">The final velocity</param>
-	/// <param name="t">The time.</param>
-	/// <returns>The updated position at the time specified</returns>
-	XMVECTOR CatmullRom(XMVECTOR p0, XMVECTOR p1, XMVECTOR p2, XMVECTOR p3, float t)
-	{
-		float t2 = t * t;
-		float t3 = t2 * t;
-		return 0.5f * (
-			(2.0f * p1) +
-			(-p0 + p2) * t +
-			(2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t2 +
-			(-p0 + 3.0f * p1 - 3.0f * p2 + p3) * t3
-			);
-	}
-
 	float m_splineTransition = 0.0f;
 
 	/// <summary>
-	/// Animates the camera along a Catmull-Rom spline.
+	/// Animates the camera along a spline at a constant speed.
 	/// </summary>
 	/// <param name="deltaTime">The change in time.</param>
-	/// <param name="controlPoints">The points along the spline.</param>
+	/// <param name="spline">The path to follow.</param>
 	/// <param name="duration">The length of the spline animation.</param>
-	void CameraSplineAnimation(float deltaTime, std::vector<XMVECTOR> controlPoints, float duration)
+	/// <param name="faceAlongPath">Whether the camera turns to look down the path, or keeps looking where it was.</param>
+	void CameraSplineAnimation(float deltaTime, const CameraSpline& spline, float duration, bool faceAlongPath)
 	{
 		m_splineTransition += deltaTime / duration;
 
@@ -229,60 +210,21 @@ public:
 			m_splineTransition = 0.0f;
 		}
 
-		float smoothTransition;
-
-		// Blatant Theft from the lecture slides
-		if (m_splineTransition < 0.5f)
+		if (!spline.IsValid())
 		{
-			smoothTransition = 2.0f * m_splineTransition * m_splineTransition;
+			return;
 		}
-		else
-		{
-			smoothTransition = 1.0f - (pow(-2.0f * m_splineTransition + 2.0f, 2) / 2.0f);
-		}
-
-		int sections = controlPoints.size() - 3; // Why 3 and not 2, I have no clue
 
-		// Super fucked way to find the which part of the spline we are on
-		float currentSplinePosition = smoothTransition * static_cast<float>(sections);
-		int sectionIndex = static_cast<int>(floor(currentSplinePosition));
+		// The transition is a fraction of the path's length now, so the speed doesn't change with how far apart the points are.
+		SplineSample sample = spline.Evaluate(m_splineTransition);
+		position = XMFLOAT3(sample.position.x, sample.position.y, sample.position.z);
 
-		// Uhh, don't go out of bounds forehead
-		if (sectionIndex >= sections)
+		// The spline hands back a rotation minimising frame, so the up doesn't twist about on corners.
+		if (faceAlongPath)
 		{
-			sectionIndex = sections - 1;
+			lookDir = XMFLOAT3(sample.forward.x, sample.forward.y, sample.forward.z);
+			up = XMFLOAT3(sample.up.x, sample.up.y, sample.up.z);
 		}
-
-		float currentSectionTime = currentSplinePosition - static_cast<float>(sectionIndex);
-
-		XMVECTOR intialVelocity = controlPoints[sectionIndex];
-		XMVECTOR p1 = controlPoints[sectionIndex + 1];
-		XMVECTOR p2 = controlPoints[sectionIndex + 2];
-		XMVECTOR endingVelocity = controlPoints[sectionIndex + 3];
-
-		XMVECTOR newCameraPosition = CatmullRom(intialVelocity, p1, p2, endingVelocity, currentSectionTime);
-
-		SetPosition(newCameraPosition);
-
-		// No clue how do reconstruct the view matrix without it crashing
-
-		/*XMVECTOR futureCameraPosition = CatmullRom(intialVelocity, p1, p2, endingVelocity, currentSectionTime + deltaTime);
-
-		XMVECTOR splineForward = XMVector3Normalize(futureCameraPosition - newCameraPosition);
-
-		// Define a world-up vector (assumes Y-up world)
-		XMVECTOR splineUp = XMVectorSet(0, 1, 0, 0);
-
-		// Compute right vector using cross product (ensuring perpendicularity)
-		XMVECTOR splineRight = XMVector3Normalize(XMVector3Cross(splineUp, splineForward));
-
-		// Recompute up vector to ensure it remains perpendicular
-		splineUp = XMVector3Normalize(XMVector3Cross(splineForward, splineRight));
-
-		// Construct view matrix
-		XMMATRIX splineViewMatrix = XMMatrixLookToLH(newCameraPosition, splineForward, splineUp);
-
-		XMStoreFloat4x4(&viewMatrix, splineViewMatrix); */
 	}
 #pragma endregion
 
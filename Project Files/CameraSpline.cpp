@@ -0,0 +1,322 @@
+#pragma region Includes
+//Include{s}
+#include "CameraSpline.h"
+#include <algorithm>
+#include <cmath>
+#pragma endregion
+
+#pragma region Vector Helpers
+namespace
+{
+	const float kEpsilon = 1e-12f;
+
+	// 5 point Gauss-Legendre, which is exact for the arc length of anything up to a 9th order polynomial and plenty for the
+	// square root of one between two table entries.
+	const float kGaussNodes[5] = { -0.9061798459f, -0.5384693101f, 0.0f, 0.5384693101f, 0.9061798459f };
+	const float kGaussWeights[5] = { 0.2369268851f, 0.4786286705f, 0.5688888889f, 0.4786286705f, 0.2369268851f };
+
+	// Newton steps after the table lookup. One already gets a step to within float precision of the one before it.
+	const int kNewtonSteps = 1;
+
+	SplineVec3 Add(const SplineVec3& a, const SplineVec3& b) { return SplineVec3(a.x + b.x, a.y + b.y, a.z + b.z); }
+	SplineVec3 Sub(const SplineVec3& a, const SplineVec3& b) { return SplineVec3(a.x - b.x, a.y - b.y, a.z - b.z); }
+	SplineVec3 Scale(const SplineVec3& a, float s) { return SplineVec3(a.x * s, a.y * s, a.z * s); }
+	float Dot(const SplineVec3& a, const SplineVec3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+	SplineVec3 Lerp(const SplineVec3& a, const SplineVec3& b, float t) { return Add(a, Scale(Sub(b, a), t)); }
+
+	SplineVec3 Cross(const SplineVec3& a, const SplineVec3& b)
+	{
+		return SplineVec3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+	}
+
+	// Hands back the fallback when there's nothing to normalize.
+	SplineVec3 Normalize(const SplineVec3& a, const SplineVec3& fallback)
+	{
+		float lengthSquared = Dot(a, a);
+		return lengthSquared > kEpsilon ? Scale(a, 1.0f / std::sqrt(lengthSquared)) : fallback;
+	}
+
+	// Reflects a vector in the plane with the given normal, c being the normal's squared length.
+	SplineVec3 Reflect(const SplineVec3& v, const SplineVec3& normal, float c)
+	{
+		return Sub(v, Scale(normal, 2.0f * Dot(normal, v) / c));
+	}
+
+	// An up that's square to the forward, world up if it can be.
+	SplineVec3 UpFor(const SplineVec3& forward, const SplineVec3& hint)
+	{
+		SplineVec3 up = Sub(hint, Scale(forward, Dot(hint, forward)));
+		if (Dot(up, up) > 1e-6f)
+		{
+			return Normalize(up, hint);
+		}
+
+		// Going straight up or down, so anything square to it will do.
+		SplineVec3 other = std::fabs(forward.x) < 0.9f ? SplineVec3(1.0f, 0.0f, 0.0f) : SplineVec3(0.0f, 0.0f, 1.0f);
+		return Normalize(Cross(forward, other), SplineVec3(0.0f, 1.0f, 0.0f));
+	}
+}
+#pragma endregion
+
+#pragma region Constructors and Destructors
+CameraSpline::CameraSpline(const std::vector<SplineVec3>& controlPoints, uint32_t samplesPerSection)
+{
+	m_samplesPerSection = samplesPerSection > 0 ? samplesPerSection : 1;
+	SetControlPoints(controlPoints);
+}
+#pragma endregion
+
+#pragma region Spline Methods
+void CameraSpline::SetControlPoints(const std::vector<SplineVec3>& controlPoints)
+{
+	m_controlPoints = controlPoints;
+	Build();
+}
+
+SplineSample CameraSpline::EvaluateAtDistance(float distance) const
+{
+	SplineSample sample;
+	sample.forward = SplineVec3(0.0f, 0.0f, 1.0f);
+	sample.up = SplineVec3(0.0f, 1.0f, 0.0f);
+
+	if (!IsValid())
+	{
+		if (!m_controlPoints.empty())
+		{
+			sample.position = m_controlPoints.front();
+		}
+		return sample;
+	}
+
+	float length = GetLength();
+	distance = distance < 0.0f ? 0.0f : (distance > length ? length : distance);
+
+	// The table entry at or before this distance, then how far on towards the next one.
+	size_t entry = static_cast<size_t>(std::upper_bound(m_distances.begin(), m_distances.end(), distance) - m_distances.begin());
+	entry = entry > 0 ? entry - 1 : 0;
+	if (entry + 1 >= m_distances.size())
+	{
+		entry = m_distances.size() - 2;
+	}
+
+	// Everything from here is in the entry's own section, so the parameter keeps its precision however long the path is.
+	size_t section = std::min(entry / m_samplesPerSection, GetSectionCount() - 1);
+	float firstT = static_cast<float>(entry - section * m_samplesPerSection) / m_samplesPerSection;
+	float lastT = static_cast<float>(entry + 1 - section * m_samplesPerSection) / m_samplesPerSection;
+
+	float span = m_distances[entry + 1] - m_distances[entry];
+	float fraction = span > 0.0f ? (distance - m_distances[entry]) / span : 0.0f;
+	float t = firstT + (lastT - firstT) * fraction;
+
+	// Interpolating the parameter is only right if the speed's constant between entries, so Newton on the real arc length
+	// takes it the rest of the way. The speed is the derivative of the distance, and it can't leave the entry.
+	for (int step = 0; step < kNewtonSteps; step++)
+	{
+		SplineVec3 tangent = TangentAt(section, t);
+		float speed = std::sqrt(Dot(tangent, tangent));
+		if (speed <= kEpsilon)
+		{
+			break;
+		}
+
+		float error = m_distances[entry] + ArcLength(section, firstT, t) - distance;
+		t -= error / speed;
+		t = t < firstT ? firstT : (t > lastT ? lastT : t);
+	}
+	fraction = (t - firstT) / (lastT - firstT);
+
+	// Position and forward come straight off the curve, only the up is blended from the table.
+	sample.position = PositionAt(section, t);
+	sample.forward = Normalize(TangentAt(section, t), sample.forward);
+	sample.up = UpFor(sample.forward, Normalize(Lerp(m_normals[entry], m_normals[entry + 1], fraction), m_normals[entry]));
+
+	return sample;
+}
+
+SplineSample CameraSpline::Evaluate(float progress) const
+{
+	return EvaluateAtDistance(progress * GetLength());
+}
+
+SplineVec3 CameraSpline::CatmullRom(const SplineVec3& p0, const SplineVec3& p1, const SplineVec3& p2, const SplineVec3& p3, float t)
+{
+	float t2 = t * t;
+	float t3 = t2 * t;
+
+	SplineVec3 result = Scale(p1, 2.0f);
+	result = Add(result, Scale(Sub(p2, p0), t));
+	result = Add(result, Scale(Add(Sub(Scale(p0, 2.0f), Scale(p1, 5.0f)), Sub(Scale(p2, 4.0f), p3)), t2));
+	result = Add(result, Scale(Add(Sub(Scale(p1, 3.0f), p0), Sub(p3, Scale(p2, 3.0f))), t3));
+	return Scale(result, 0.5f);
+}
+#pragma endregion
+
+#pragma region Private Methods
+void CameraSpline::Build()
+{
+	m_distances.clear();
+	m_normals.clear();
+
+	size_t sections = GetSectionCount();
+	if (sections == 0)
+	{
+		return;
+	}
+
+	size_t entries = sections * m_samplesPerSection + 1;
+	m_distances.reserve(entries);
+	m_normals.reserve(entries);
+
+	SplineVec3 previousPosition;
+	SplineVec3 previousTangent(0.0f, 0.0f, 1.0f);
+	SplineVec3 previousNormal(0.0f, 1.0f, 0.0f);
+	float distance = 0.0f;
+
+	for (size_t entry = 0; entry < entries; entry++)
+	{
+		float parameter = static_cast<float>(entry) / m_samplesPerSection;
+		SplineVec3 position = PositionAt(parameter);
+		SplineVec3 tangent = Normalize(TangentAt(parameter), previousTangent);
+		SplineVec3 normal;
+
+		if (entry == 0)
+		{
+			normal = UpFor(tangent, SplineVec3(0.0f, 1.0f, 0.0f));
+		}
+		else
+		{
+			SplineVec3 step = Sub(position, previousPosition);
+			float stepLengthSquared = Dot(step, step);
+
+			// The length along the curve rather than the chord, so it matches what EvaluateAtDistance's Newton steps measure.
+			size_t section = std::min((entry - 1) / m_samplesPerSection, sections - 1);
+			float firstT = static_cast<float>(entry - 1 - section * m_samplesPerSection) / m_samplesPerSection;
+			distance += ArcLength(section, firstT, firstT + 1.0f / m_samplesPerSection);
+
+			// Double reflection (Wang et al.), reflect the last frame across the chord then again to line the tangents up.
+			// It keeps the up from twisting around the path the way a Frenet frame does.
+			normal = previousNormal;
+			if (stepLengthSquared > kEpsilon)
+			{
+				SplineVec3 reflectedNormal = Reflect(previousNormal, step, stepLengthSquared);
+				SplineVec3 reflectedTangent = Reflect(previousTangent, step, stepLengthSquared);
+				SplineVec3 tangentStep = Sub(tangent, reflectedTangent);
+				float tangentStepSquared = Dot(tangentStep, tangentStep);
+
+				normal = tangentStepSquared > kEpsilon ? Reflect(reflectedNormal, tangentStep, tangentStepSquared) : reflectedNormal;
+			}
+			normal = UpFor(tangent, normal);
+		}
+
+		m_distances.push_back(distance);
+		m_normals.push_back(normal);
+
+		previousPosition = position;
+		previousTangent = tangent;
+		previousNormal = normal;
+	}
+}
+
+SplineVec3 CameraSpline::PositionAt(float parameter) const
+{
+	size_t section;
+	float t;
+	SplitParameter(parameter, section, t);
+	return PositionAt(section, t);
+}
+
+SplineVec3 CameraSpline::PositionAt(size_t section, float t) const
+{
+	return CatmullRom(m_controlPoints[section], m_controlPoints[section + 1], m_controlPoints[section + 2], m_controlPoints[section + 3], t);
+}
+
+SplineVec3 CameraSpline::TangentAt(float parameter) const
+{
+	size_t section;
+	float t;
+	SplitParameter(parameter, section, t);
+	return TangentAt(section, t);
+}
+
+SplineVec3 CameraSpline::TangentAt(size_t section, float t) const
+{
+	const SplineVec3& p0 = m_controlPoints[section];
+	const SplineVec3& p1 = m_controlPoints[section + 1];
+	const SplineVec3& p2 = m_controlPoints[section + 2];
+	const SplineVec3& p3 = m_controlPoints[section + 3];
+
+	// The derivative of CatmullRom with respect to t.
+	SplineVec3 result = Sub(p2, p0);
+	result = Add(result, Scale(Add(Sub(Scale(p0, 2.0f), Scale(p1, 5.0f)), Sub(Scale(p2, 4.0f), p3)), 2.0f * t));
+	result = Add(result, Scale(Add(Sub(Scale(p1, 3.0f), p0), Sub(p3, Scale(p2, 3.0f))), 3.0f * t * t));
+	return Scale(result, 0.5f);
+}
+
+float CameraSpline::ArcLength(size_t section, float from, float to) const
+{
+	float halfWidth = (to - from) * 0.5f;
+	float middle = (to + from) * 0.5f;
+
+	float length = 0.0f;
+	for (int node = 0; node < 5; node++)
+	{
+		SplineVec3 tangent = TangentAt(section, middle + halfWidth * kGaussNodes[node]);
+		length += kGaussWeights[node] * std::sqrt(Dot(tangent, tangent));
+	}
+	return length * halfWidth;
+}
+
+void CameraSpline::SplitParameter(float parameter, size_t& section, float& t) const
+{
+	size_t sections = GetSectionCount();
+	float clamped = parameter < 0.0f ? 0.0f : parameter;
+
+	section = static_cast<size_t>(clamped);
+	if (section >= sections)
+	{
+		section = sections - 1;
+	}
+
+	t = clamped - static_cast<float>(section);
+	t = t > 1.0f ? 1.0f : t;
+}
+#pragma endregion
+
+#pragma region Camera Path Library
+CameraSpline& CameraPathLibrary::AddPath(const std::string& name, const std::vector<SplineVec3>& controlPoints)
+{
+	CameraSpline& path = m_paths[name];
+	path.SetControlPoints(controlPoints);
+	return path;
+}
+
+bool CameraPathLibrary::RemovePath(const std::string& name)
+{
+	return m_paths.erase(name) > 0;
+}
+
+CameraSpline* CameraPathLibrary::FindPath(const std::string& name)
+{
+	auto path = m_paths.find(name);
+	return path != m_paths.end() ? &path->second : nullptr;
+}
+
+const CameraSpline* CameraPathLibrary::FindPath(const std::string& name) const
+{
+	auto path = m_paths.find(name);
+	return path != m_paths.end() ? &path->second : nullptr;
+}
+
+std::vector<std::string> CameraPathLibrary::GetNames() const
+{
+	std::vector<std::string> names;
+	names.reserve(m_paths.size());
+
+	for (const auto& path : m_paths)
+	{
+		names.push_back(path.first);
+	}
+
+	return names;
+}
+#pragma endregion
@@ -0,0 +1,138 @@
+#pragma once
+
+#pragma region Includes
+//Include{s}
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#pragma endregion
+
+// No Windows headers (or DirectXMath), the spline only needs a handful of vector sums so it carries its own.
+
+#pragma region Data Structures
+/// <summary>
+/// A plain 3 float vector, laid out the same as an XMFLOAT3.
+/// </summary>
+struct SplineVec3
+{
+	float x = 0.0f;
+	float y = 0.0f;
+	float z = 0.0f;
+
+	SplineVec3() {}
+	SplineVec3(float xIn, float yIn, float zIn) : x(xIn), y(yIn), z(zIn) {}
+};
+
+/// <summary>
+/// Where the spline is at some distance along it, and which way it's facing.
+/// </summary>
+struct SplineSample
+{
+	SplineVec3 position;
+	SplineVec3 forward; // Unit tangent
+	SplineVec3 up; // Unit rotation minimising normal, so the camera doesn't roll about for no reason
+};
+#pragma endregion
+
+/// <summary>
+/// The CameraSpline class. A Catmull-Rom spline played back at constant speed through an arc length lookup table, with a
+/// couple of Newton steps on the real arc length after the lookup so it's constant between the entries too.
+/// The first and last control points only shape the ends, same as the old camera spline, so it needs at least 4.
+/// </summary>
+class CameraSpline
+{
+public:
+#pragma region Constructors and Destructors
+	CameraSpline() {}
+
+	/// <summary>
+	/// Initializes a new instance of the CameraSpline class and builds its table.
+	/// </summary>
+	/// <param name="controlPoints">The control points, including the two end ones.</param>
+	/// <param name="samplesPerSection">How many table entries each section gets, more is a closer first guess for the Newton steps.</param>
+	CameraSpline(const std::vector<SplineVec3>& controlPoints, uint32_t samplesPerSection = 32);
+#pragma endregion
+
+#pragma region Spline Methods
+	/// <summary>
+	/// Swaps the control points and rebuilds the table.
+	/// </summary>
+	void SetControlPoints(const std::vector<SplineVec3>& controlPoints);
+
+	/// <summary>
+	/// Gets the spline at a distance along it, binary searching the table so it's O(log n) in the number of points, then
+	/// refining the parameter with Newton steps.
+	/// </summary>
+	/// <param name="distance">How far along, clamped to the length.</param>
+	SplineSample EvaluateAtDistance(float distance) const;
+
+	/// <summary>
+	/// Gets the spline at a fraction of its length, so equal steps in progress are equal distances.
+	/// </summary>
+	/// <param name="progress">0 is the start, 1 is the end.</param>
+	SplineSample Evaluate(float progress) const;
+
+	/// <summary>
+	/// The Catmull-Rom spline function.
+	/// </summary>
+	static SplineVec3 CatmullRom(const SplineVec3& p0, const SplineVec3& p1, const SplineVec3& p2, const SplineVec3& p3, float t);
+#pragma endregion
+
+#pragma region Getters
+	const std::vector<SplineVec3>& GetControlPoints() const { return m_controlPoints; }
+	size_t GetSectionCount() const { return m_controlPoints.size() >= 4 ? m_controlPoints.size() - 3 : 0; }
+	size_t GetTableSize() const { return m_distances.size(); }
+	float GetLength() const { return m_distances.empty() ? 0.0f : m_distances.back(); }
+	bool IsValid() const { return GetSectionCount() > 0; }
+#pragma endregion
+
+private:
+#pragma region Private Methods
+	void Build();
+	SplineVec3 PositionAt(float parameter) const;
+	SplineVec3 TangentAt(float parameter) const;
+	SplineVec3 PositionAt(size_t section, float t) const;
+	SplineVec3 TangentAt(size_t section, float t) const;
+
+	/// <summary>
+	/// The length along one section between two values of t, by Gauss-Legendre quadrature of the speed. Only accurate over
+	/// about a table entry's worth.
+	/// </summary>
+	float ArcLength(size_t section, float from, float to) const;
+	void SplitParameter(float parameter, size_t& section, float& t) const;
+#pragma endregion
+
+#pragma region Private Variables
+	std::vector<SplineVec3> m_controlPoints;
+	uint32_t m_samplesPerSection = 32;
+
+	// The table, one entry per sample, samplesPerSection to a section.
+	std::vector<float> m_distances;
+	std::vector<SplineVec3> m_normals;
+#pragma endregion
+};
+
+/// <summary>
+/// The CameraPathLibrary class. The camera paths by name.
+/// </summary>
+class CameraPathLibrary
+{
+public:
+	/// <summary>
+	/// Adds a path, or replaces the one with the same name.
+	/// </summary>
+	CameraSpline& AddPath(const std::string& name, const std::vector<SplineVec3>& controlPoints);
+
+	bool RemovePath(const std::string& name);
+
+	CameraSpline* FindPath(const std::string& name);
+	const CameraSpline* FindPath(const std::string& name) const;
+
+	std::vector<std::string> GetNames() const;
+	size_t GetPathCount() const { return m_paths.size(); }
+
+private:
+	std::map<std::string, CameraSpline> m_paths;
+};
@@ -15,6 +15,7 @@ struct STriVertex
 struct HitInfo {
   float4 colorAndDistance;
     int recursiveDepth;
+    float2 cone; // The ray cone's width where the ray starts and how fast it spreads, for picking mesh LODs
 };
 
 // Attributes output by the raytracing when hitting a surface,
@@ -29,3 +30,51 @@ struct ShadowHitInfo
     bool isHit;
 };
 #pragma endregion
+
+#pragma region Instance Masks
+// Which kinds of ray can hit an object, passed as TraceRay's InstanceInclusionMask.
+// IMPORTANT - the C++ version of these is 'InstanceMask' found in the common.h file
+#define INSTANCE_MASK_CAMERA 1
+#define INSTANCE_MASK_SHADOW 2
+#define INSTANCE_MASK_REFLECTION 4
+#define INSTANCE_MASK_SHADOW_LOD1 8
+#define INSTANCE_MASK_SHADOW_LOD2 16
+#define INSTANCE_MASK_REFLECTION_LOD1 32
+#define INSTANCE_MASK_REFLECTION_LOD2 64
+#pragma endregion
+
+#pragma region Mesh LOD
+// Where shadow and reflection rays move on to a coarser LOD band, as the width of their cone in world units.
+// IMPORTANT - the C++ version of these is 'kBandWidths' found in the MeshLod.cpp file
+#define LOD_BAND_1_WIDTH 0.05
+#define LOD_BAND_2_WIDTH 0.2
+
+// Picks the mask for a ray from how wide its cone is where it starts, bandMasks being the band 0, 1 and 2 bits for its type.
+uint LodInstanceMask(uint3 bandMasks, float coneWidth)
+{
+    return coneWidth >= LOD_BAND_2_WIDTH ? bandMasks.z : (coneWidth >= LOD_BAND_1_WIDTH ? bandMasks.y : bandMasks.x);
+}
+#pragma endregion
+
+#pragma region Ray Counters
+// Byte offsets of each ray type's count in the counter buffer.
+// IMPORTANT - the C++ version of these is 'RayCounterType' found in the RayCounters.h file
+#define RAY_COUNTER_PRIMARY 0
+#define RAY_COUNTER_SHADOW 4
+#define RAY_COUNTER_REFLECTION 8
+#define RAY_COUNTER_MISS 12
+
+// Rays traced this frame, cleared before every dispatch and read back on the CPU a couple of frames later.
+RWByteAddressBuffer g_rayCounters : register(u1);
+
+// Adds to one of the counters. The wave adds its counts up first, so it's one atomic per wave rather than one per ray.
+void CountRays(uint counter, uint count)
+{
+    uint waveCount = WaveActiveSum(count);
+
+    if (WaveIsFirstLane() && waveCount > 0)
+    {
+        g_rayCounters.InterlockedAdd(counter, waveCount);
+    }
+}
+#pragma endregion
@@ -0,0 +1,276 @@
+#pragma region Includes
+//Include{s}
+#include "CpuProfiler.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#pragma endregion
+
+#pragma region Constructors and Destructors
+CpuProfiler& CpuProfiler::Get()
+{
+	static CpuProfiler profiler;
+	return profiler;
+}
+
+CpuProfiler::CpuProfiler() : m_frameIndex(0), m_enabled(true)
+{
+	m_epochNs = 0;
+	m_epochNs = NowNs();
+}
+#pragma endregion
+
+#pragma region Recording Methods
+uint64_t CpuProfiler::NowNs() const
+{
+	auto now = std::chrono::steady_clock::now().time_since_epoch();
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count()) - m_epochNs;
+}
+
+uint32_t CpuProfiler::PushScope()
+{
+	return GetThreadRing()->depth++;
+}
+
+void CpuProfiler::PopScope(const char* name, uint64_t startNs, uint64_t frame, uint32_t depth)
+{
+	uint64_t endNs = NowNs();
+
+	ThreadRing* ring = GetThreadRing();
+	ring->depth = depth;
+
+	CpuProfileEvent event;
+	event.name = name;
+	event.startNs = startNs;
+	event.endNs = endNs;
+	event.frame = frame;
+	event.depth = depth;
+	event.threadIndex = ring->threadIndex;
+
+	PushEvent(ring, event);
+}
+
+uint32_t CpuProfiler::AddTrack(const std::string& name)
+{
+	return CreateRing(name)->threadIndex;
+}
+
+void CpuProfiler::RecordEvent(uint32_t track, const CpuProfileEvent& event)
+{
+	ThreadRing* ring = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(m_ringsMutex);
+		if (track >= m_rings.size())
+		{
+			return;
+		}
+		ring = m_rings[track].get();
+	}
+
+	CpuProfileEvent trackEvent = event;
+	trackEvent.threadIndex = track;
+
+	PushEvent(ring, trackEvent);
+}
+#pragma endregion
+
+#pragma region Query Methods
+std::vector<CpuProfileEvent> CpuProfiler::GetFrameEvents(uint64_t frame) const
+{
+	return CollectEvents(true, frame);
+}
+
+std::vector<CpuProfileEvent> CpuProfiler::GetAllEvents() const
+{
+	return CollectEvents(false, 0);
+}
+
+std::vector<std::string> CpuProfiler::GetTrackNames() const
+{
+	std::lock_guard<std::mutex> lock(m_ringsMutex);
+
+	std::vector<std::string> names;
+	for (auto& ring : m_rings)
+	{
+		names.push_back(ring->name);
+	}
+
+	return names;
+}
+
+void CpuProfiler::Clear()
+{
+	std::lock_guard<std::mutex> ringsLock(m_ringsMutex);
+
+	for (auto& ring : m_rings)
+	{
+		std::lock_guard<std::mutex> lock(ring->mutex);
+		ring->next = 0;
+		ring->count = 0;
+	}
+}
+
+double CpuProfiler::MeasureScopeCostNs(uint32_t iterations)
+{
+	if (iterations == 0)
+	{
+		return 0.0;
+	}
+
+	// Warm the ring up first so making it isn't part of the measurement.
+	{
+		CpuProfileScope warmUp("Profiler Warm Up");
+	}
+
+	uint64_t startNs = NowNs();
+	for (uint32_t i = 0; i < iterations; i++)
+	{
+		CpuProfileScope scope("Profiler Calibration");
+	}
+	uint64_t endNs = NowNs();
+
+	Clear();
+
+	return static_cast<double>(endNs - startNs) / iterations;
+}
+#pragma endregion
+
+#pragma region Export Methods
+std::string CpuProfiler::ExportChromeTrace(const std::vector<CpuProfileEvent>& events, const std::vector<std::string>& threadNames)
+{
+	std::string json = "{\"traceEvents\":[";
+	char line[512];
+	bool first = true;
+
+	for (size_t i = 0; i < threadNames.size(); i++)
+	{
+		snprintf(line, sizeof(line), "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%zu,\"args\":{\"name\":\"%s\"}}",
+			first ? "" : ",", i, threadNames[i].c_str());
+		json += line;
+		first = false;
+	}
+
+	for (const CpuProfileEvent& event : events)
+	{
+		snprintf(line, sizeof(line), "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%llu}}",
+			first ? "" : ",", event.name, event.threadIndex, event.startNs / 1000.0, (event.endNs - event.startNs) / 1000.0,
+			static_cast<unsigned long long>(event.frame));
+		json += line;
+		first = false;
+	}
+
+	json += "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+	return json;
+}
+
+bool CpuProfiler::WriteChromeTrace(const std::string& path) const
+{
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file)
+	{
+		return false;
+	}
+
+	std::string json = ExportChromeTrace(GetAllEvents(), GetTrackNames());
+	file.write(json.data(), json.size());
+
+	return static_cast<bool>(file);
+}
+#pragma endregion
+
+#pragma region Private Methods
+CpuProfiler::ThreadRing* CpuProfiler::GetThreadRing()
+{
+	// Only the first scope on each thread takes the lock.
+	thread_local ThreadRing* threadRing = nullptr;
+
+	if (threadRing == nullptr)
+	{
+		threadRing = CreateRing("");
+	}
+
+	return threadRing;
+}
+
+CpuProfiler::ThreadRing* CpuProfiler::CreateRing(const std::string& name)
+{
+	std::unique_ptr<ThreadRing> ring(new ThreadRing());
+	ring->events.resize(kRingCapacity);
+
+	std::lock_guard<std::mutex> lock(m_ringsMutex);
+	ring->threadIndex = static_cast<uint32_t>(m_rings.size());
+	ring->name = name.empty() ? "CPU Thread " + std::to_string(ring->threadIndex) : name;
+	m_rings.push_back(std::move(ring));
+
+	return m_rings.back().get();
+}
+
+void CpuProfiler::PushEvent(ThreadRing* ring, const CpuProfileEvent& event)
+{
+	std::lock_guard<std::mutex> lock(ring->mutex);
+
+	ring->events[ring->next] = event;
+	ring->next = (ring->next + 1) % ring->events.size();
+	ring->count = std::min(ring->count + 1, ring->events.size());
+}
+
+std::vector<CpuProfileEvent> CpuProfiler::CollectEvents(bool filterByFrame, uint64_t frame) const
+{
+	std::vector<CpuProfileEvent> events;
+
+	std::lock_guard<std::mutex> ringsLock(m_ringsMutex);
+
+	for (auto& ring : m_rings)
+	{
+		std::lock_guard<std::mutex> lock(ring->mutex);
+
+		size_t capacity = ring->events.size();
+		size_t oldest = (ring->next + capacity - ring->count) % capacity;
+
+		for (size_t i = 0; i < ring->count; i++)
+		{
+			const CpuProfileEvent& event = ring->events[(oldest + i) % capacity];
+
+			if (!filterByFrame || event.frame == frame)
+			{
+				events.push_back(event);
+			}
+		}
+	}
+
+	// Parents start before (or with) their children, so this also puts them first.
+	std::stable_sort(events.begin(), events.end(), [](const CpuProfileEvent& a, const CpuProfileEvent& b)
+		{
+			return a.startNs < b.startNs || (a.startNs == b.startNs && a.depth < b.depth);
+		});
+
+	return events;
+}
+#pragma endregion
+
+#pragma region Scope Methods
+CpuProfileScope::CpuProfileScope(const char* name)
+{
+	CpuProfiler& profiler = CpuProfiler::Get();
+
+	m_name = name;
+	m_active = profiler.IsEnabled();
+
+	if (m_active)
+	{
+		m_depth = profiler.PushScope();
+		m_frame = profiler.GetFrameIndex();
+		m_startNs = profiler.NowNs();
+	}
+}
+
+CpuProfileScope::~CpuProfileScope()
+{
+	if (m_active)
+	{
+		CpuProfiler::Get().PopScope(m_name, m_startNs, m_frame, m_depth);
+	}
+}
+#pragma endregion
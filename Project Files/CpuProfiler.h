@@ -0,0 +1,209 @@
+#pragma once
+
+#pragma region Includes
+//Include{s}
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#pragma endregion
+
+// No Windows headers, steady_clock is QueryPerformanceCounter underneath on MSVC anyway.
+
+#pragma region Data Structures
+/// <summary>
+/// One finished scope.
+/// </summary>
+struct CpuProfileEvent
+{
+	const char* name = nullptr; // Has to be a string literal (or live as long), it isn't copied
+	uint64_t startNs = 0; // Since the profiler started
+	uint64_t endNs = 0;
+	uint64_t frame = 0;
+	uint32_t depth = 0; // How many scopes it's nested in on its thread
+	uint32_t threadIndex = 0; // Small number per thread, in the order they first recorded something
+};
+#pragma endregion
+
+/// <summary>
+/// The CpuProfiler class. Collects scoped timings into a ring buffer per thread, so recording only ever touches
+/// the thread's own ring. Frames are just a counter that BeginFrame bumps, every scope remembers which frame it started in.
+/// </summary>
+class CpuProfiler
+{
+public:
+#pragma region Constructors and Destructors
+	/// <summary>
+	/// Gets the profiler, the scopes need to get at it from anywhere.
+	/// </summary>
+	static CpuProfiler& Get();
+#pragma endregion
+
+#pragma region Frame Methods
+	/// <summary>
+	/// Starts a new frame, scopes opened from now on belong to it.
+	/// </summary>
+	void BeginFrame() { m_frameIndex++; }
+
+	uint64_t GetFrameIndex() const { return m_frameIndex; }
+
+	void SetEnabled(bool enabled) { m_enabled = enabled; }
+	bool IsEnabled() const { return m_enabled; }
+#pragma endregion
+
+#pragma region Recording Methods
+	/// <summary>
+	/// Gets the time in nanoseconds since the profiler started.
+	/// </summary>
+	uint64_t NowNs() const;
+
+	/// <summary>
+	/// Converts a steady_clock time (in nanoseconds since its epoch) to profiler time. On MSVC that's QueryPerformanceCounter
+	/// converted to nanoseconds, which is what lines other clocks up with the profiler's.
+	/// </summary>
+	uint64_t FromSteadyClockNs(uint64_t steadyNs) const { return steadyNs - m_epochNs; }
+
+	/// <summary>
+	/// Opens a scope on the calling thread, use CpuProfileScope rather than calling this directly.
+	/// </summary>
+	/// <returns>The scope's depth.</returns>
+	uint32_t PushScope();
+
+	/// <summary>
+	/// Closes a scope on the calling thread and records it.
+	/// </summary>
+	void PopScope(const char* name, uint64_t startNs, uint64_t frame, uint32_t depth);
+
+	/// <summary>
+	/// Adds a track that no thread records into, for timings that come from somewhere else (the GPU, say).
+	/// </summary>
+	/// <param name="name">The track's name in the trace.</param>
+	/// <returns>The track's index, events recorded into it get it as their threadIndex.</returns>
+	uint32_t AddTrack(const std::string& name);
+
+	/// <summary>
+	/// Records a finished event straight into a track made with AddTrack.
+	/// </summary>
+	void RecordEvent(uint32_t track, const CpuProfileEvent& event);
+#pragma endregion
+
+#pragma region Query Methods
+	/// <summary>
+	/// Gets every scope still in the rings that started in the given frame, sorted by start time.
+	/// </summary>
+	std::vector<CpuProfileEvent> GetFrameEvents(uint64_t frame) const;
+
+	/// <summary>
+	/// Gets every scope still in the rings, sorted by start time.
+	/// </summary>
+	std::vector<CpuProfileEvent> GetAllEvents() const;
+
+	/// <summary>
+	/// Gets the name of every track, indexed by threadIndex.
+	/// </summary>
+	std::vector<std::string> GetTrackNames() const;
+
+	/// <summary>
+	/// Empties every ring.
+	/// </summary>
+	void Clear();
+
+	/// <summary>
+	/// Times a lot of empty scopes to find out what one costs. Clears the rings afterwards, so do it before recording anything worth keeping.
+	/// </summary>
+	/// <param name="iterations">How many scopes to time.</param>
+	/// <returns>The cost of one scope in nanoseconds.</returns>
+	double MeasureScopeCostNs(uint32_t iterations);
+#pragma endregion
+
+#pragma region Export Methods
+	/// <summary>
+	/// Formats events as Chrome trace JSON, the kind chrome://tracing and Perfetto load. Complete ("X") events in microseconds.
+	/// </summary>
+	/// <param name="events">The events to export.</param>
+	/// <param name="threadNames">Optional names for the tracks, indexed by threadIndex.</param>
+	static std::string ExportChromeTrace(const std::vector<CpuProfileEvent>& events, const std::vector<std::string>& threadNames = {});
+
+	/// <summary>
+	/// Writes everything in the rings to a Chrome trace file, one track per thread (and per AddTrack).
+	/// </summary>
+	/// <returns>False if the file couldn't be written.</returns>
+	bool WriteChromeTrace(const std::string& path) const;
+#pragma endregion
+
+private:
+#pragma region Private Types
+	struct ThreadRing
+	{
+		std::mutex mutex; // Only ever contended when something's reading the ring
+		std::vector<CpuProfileEvent> events;
+		size_t next = 0;
+		size_t count = 0;
+		uint32_t depth = 0; // Only touched by the owning thread
+		uint32_t threadIndex = 0;
+		std::string name;
+	};
+#pragma endregion
+
+#pragma region Private Methods
+	CpuProfiler();
+
+	/// <summary>
+	/// Gets the calling thread's ring, making one the first time round.
+	/// </summary>
+	ThreadRing* GetThreadRing();
+
+	/// <summary>
+	/// Makes a new ring and gives it the next index. Thread rings pass an empty name and get named after their index.
+	/// </summary>
+	ThreadRing* CreateRing(const std::string& name);
+
+	/// <summary>
+	/// Writes an event into a ring, overwriting the oldest once it's full.
+	/// </summary>
+	static void PushEvent(ThreadRing* ring, const CpuProfileEvent& event);
+
+	/// <summary>
+	/// Copies the events out of every ring that pass the filter.
+	/// </summary>
+	std::vector<CpuProfileEvent> CollectEvents(bool filterByFrame, uint64_t frame) const;
+#pragma endregion
+
+#pragma region Private Variables
+	static const size_t kRingCapacity = 16384;
+
+	mutable std::mutex m_ringsMutex;
+	std::vector<std::unique_ptr<ThreadRing>> m_rings; // Never shrinks, the threads hang on to their pointer
+	std::atomic<uint64_t> m_frameIndex;
+	std::atomic<bool> m_enabled;
+	uint64_t m_epochNs;
+#pragma endregion
+};
+
+/// <summary>
+/// The CpuProfileScope class. Times everything between its construction and destruction.
+/// </summary>
+class CpuProfileScope
+{
+public:
+	CpuProfileScope(const char* name);
+	~CpuProfileScope();
+
+	CpuProfileScope(const CpuProfileScope&) = delete;
+	CpuProfileScope& operator=(const CpuProfileScope&) = delete;
+
+private:
+	const char* m_name;
+	uint64_t m_startNs;
+	uint64_t m_frame;
+	uint32_t m_depth;
+	bool m_active;
+};
+
+// Times the rest of the enclosing block.
+#define PROFILE_CPU_SCOPE_JOIN2(a, b) a##b
+#define PROFILE_CPU_SCOPE_JOIN(a, b) PROFILE_CPU_SCOPE_JOIN2(a, b)
+#define PROFILE_CPU_SCOPE(name) CpuProfileScope PROFILE_CPU_SCOPE_JOIN(cpuProfileScope, __LINE__)(name)
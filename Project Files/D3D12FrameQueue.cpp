@@ -0,0 +1,36 @@
+#include "stdafx.h"
+
+#pragma region Includes
+//Include{s}
+#include "D3D12FrameQueue.h"
+#pragma endregion
+
+#pragma region Constructors and Destructors
+D3D12FrameQueue::D3D12FrameQueue(ComPtr<ID3D12CommandQueue> commandQueue, ComPtr<ID3D12Fence> fence, HANDLE fenceEvent)
+{
+	m_commandQueue = commandQueue;
+	m_fence = fence;
+	m_fenceEvent = fenceEvent;
+}
+#pragma endregion
+
+#pragma region Queue Methods
+void D3D12FrameQueue::Signal(uint64_t value)
+{
+	ThrowIfFailed(m_commandQueue->Signal(m_fence.Get(), value));
+}
+
+uint64_t D3D12FrameQueue::GetCompletedValue()
+{
+	return m_fence->GetCompletedValue();
+}
+
+void D3D12FrameQueue::WaitForValue(uint64_t value)
+{
+	if (m_fence->GetCompletedValue() < value)
+	{
+		ThrowIfFailed(m_fence->SetEventOnCompletion(value, m_fenceEvent));
+		WaitForSingleObject(m_fenceEvent, INFINITE);
+	}
+}
+#pragma endregion
@@ -0,0 +1,37 @@
+#pragma once
+
+#pragma region Includes
+//Include{s}
+#include "FramePacer.h"
+#include "DXRApp.h"
+#pragma endregion
+
+/// <summary>
+/// The D3D12FrameQueue class. Plugs a real command queue and fence into the frame pacer.
+/// </summary>
+class D3D12FrameQueue : public IFrameQueue
+{
+public:
+#pragma region Constructors and Destructors
+	/// <summary>
+	/// Initializes a new instance of the D3D12FrameQueue class.
+	/// </summary>
+	/// <param name="commandQueue">The queue the frames are submitted on.</param>
+	/// <param name="fence">The fence to signal, it should start at 0.</param>
+	/// <param name="fenceEvent">An auto reset event used to wait on the fence.</param>
+	D3D12FrameQueue(ComPtr<ID3D12CommandQueue> commandQueue, ComPtr<ID3D12Fence> fence, HANDLE fenceEvent);
+#pragma endregion
+
+#pragma region Queue Methods
+	void Signal(uint64_t value) override;
+	uint64_t GetCompletedValue() override;
+	void WaitForValue(uint64_t value) override;
+#pragma endregion
+
+private:
+#pragma region Private Variables
+	ComPtr<ID3D12CommandQueue> m_commandQueue;
+	ComPtr<ID3D12Fence> m_fence;
+	HANDLE m_fenceEvent;
+#pragma endregion
+};
@@ -0,0 +1,144 @@
+#include "stdafx.h"
+
+#pragma region Includes
+//Include{s}
+#include "D3D12GpuTimer.h"
+#include "CpuProfiler.h"
+#pragma endregion
+
+#pragma region Constructors and Destructors
+D3D12GpuTimer::D3D12GpuTimer(ComPtr<ID3D12Device5> device, ComPtr<ID3D12CommandQueue> commandQueue, IFrameQueue* frameQueue,
+	uint32_t frameSlots, uint32_t maxScopesPerFrame)
+	: m_tracker(frameQueue, frameSlots, maxScopesPerFrame, 64)
+{
+	m_commandQueue = commandQueue;
+
+	D3D12_QUERY_HEAP_DESC queryHeapDesc = {};
+	queryHeapDesc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+	queryHeapDesc.Count = m_tracker.GetQueryCount();
+	ThrowIfFailed(device->CreateQueryHeap(&queryHeapDesc, IID_PPV_ARGS(&m_queryHeap)));
+	m_queryHeap->SetName(L"GPU Timestamp Queries");
+
+	// Every slot resolves into its own part of the buffer, so reading one frame never races the GPU writing the next.
+	CD3DX12_HEAP_PROPERTIES readbackHeap(D3D12_HEAP_TYPE_READBACK);
+	CD3DX12_RESOURCE_DESC readbackDesc = CD3DX12_RESOURCE_DESC::Buffer(sizeof(uint64_t) * m_tracker.GetQueryCount());
+	ThrowIfFailed(device->CreateCommittedResource(&readbackHeap, D3D12_HEAP_FLAG_NONE, &readbackDesc,
+		D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&m_readback)));
+	m_readback->SetName(L"GPU Timestamp Readback");
+
+	ThrowIfFailed(m_commandQueue->GetTimestampFrequency(&m_frequency));
+	Calibrate();
+
+	m_track = CpuProfiler::Get().AddTrack("GPU");
+}
+#pragma endregion
+
+#pragma region Frame Methods
+void D3D12GpuTimer::BeginFrame(uint32_t slot, uint64_t frame)
+{
+	if (++m_framesSinceCalibration >= kCalibrationInterval)
+	{
+		Calibrate();
+	}
+
+	// The pacer has already waited for this slot, so this picks up its last frame along with anything else that's finished.
+	// It's the only collect, anything a second one picked up would never make it to the profiler.
+	std::vector<GpuFrameResult> resolved = m_tracker.BeginFrame(slot, frame, this);
+
+	CpuProfiler& profiler = CpuProfiler::Get();
+	for (const GpuFrameResult& result : resolved)
+	{
+		for (const GpuScopeResult& scope : result.scopes)
+		{
+			CpuProfileEvent event;
+			event.name = scope.name;
+			event.startNs = ToProfilerNs(scope.startTicks);
+			event.endNs = ToProfilerNs(scope.endTicks);
+			event.frame = result.frame;
+			event.depth = scope.depth;
+
+			profiler.RecordEvent(m_track, event);
+		}
+	}
+}
+
+uint32_t D3D12GpuTimer::BeginScope(ID3D12GraphicsCommandList* commandList, const char* name)
+{
+	uint32_t scope = m_tracker.BeginScope(name);
+
+	if (scope != GpuTimestampTracker::kInvalidScope)
+	{
+		commandList->EndQuery(m_queryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, m_tracker.GetBeginQuery(scope));
+	}
+
+	return scope;
+}
+
+void D3D12GpuTimer::EndScope(ID3D12GraphicsCommandList* commandList, uint32_t scope)
+{
+	if (scope != GpuTimestampTracker::kInvalidScope)
+	{
+		commandList->EndQuery(m_queryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, m_tracker.GetEndQuery(scope));
+	}
+
+	m_tracker.EndScope(scope);
+}
+
+void D3D12GpuTimer::ResolveFrame(ID3D12GraphicsCommandList* commandList)
+{
+	uint32_t firstQuery;
+	uint32_t queryCount;
+	m_tracker.GetResolveRange(firstQuery, queryCount);
+
+	if (queryCount > 0)
+	{
+		commandList->ResolveQueryData(m_queryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, firstQuery, queryCount,
+			m_readback.Get(), sizeof(uint64_t) * firstQuery);
+	}
+}
+
+void D3D12GpuTimer::EndFrame(uint64_t fenceValue)
+{
+	m_tracker.EndFrame(fenceValue);
+}
+#pragma endregion
+
+#pragma region Reader Methods
+void D3D12GpuTimer::ReadTimestamps(uint32_t firstQuery, uint32_t queryCount, uint64_t* timestamps)
+{
+	// Only map the range being read, and tell it nothing was written.
+	D3D12_RANGE readRange = { sizeof(uint64_t) * firstQuery, sizeof(uint64_t) * (firstQuery + queryCount) };
+	D3D12_RANGE writtenRange = { 0, 0 };
+
+	uint8_t* pData;
+	ThrowIfFailed(m_readback->Map(0, &readRange, reinterpret_cast<void**>(&pData)));
+	memcpy(timestamps, pData + readRange.Begin, sizeof(uint64_t) * queryCount);
+	m_readback->Unmap(0, &writtenRange);
+}
+#pragma endregion
+
+#pragma region Private Methods
+void D3D12GpuTimer::Calibrate()
+{
+	UINT64 gpuTimestamp;
+	UINT64 cpuTimestamp;
+	ThrowIfFailed(m_commandQueue->GetClockCalibration(&gpuTimestamp, &cpuTimestamp));
+
+	// The CPU side is a QueryPerformanceCounter value, which is the same clock steady_clock reads on MSVC.
+	LARGE_INTEGER qpcFrequency;
+	QueryPerformanceFrequency(&qpcFrequency);
+	uint64_t qpcFrequencyValue = static_cast<uint64_t>(qpcFrequency.QuadPart);
+	uint64_t steadyNs = (cpuTimestamp / qpcFrequencyValue) * 1000000000ull + (cpuTimestamp % qpcFrequencyValue) * 1000000000ull / qpcFrequencyValue;
+
+	m_calibrationTicks = gpuTimestamp;
+	m_calibrationNs = CpuProfiler::Get().FromSteadyClockNs(steadyNs);
+	m_framesSinceCalibration = 0;
+}
+
+uint64_t D3D12GpuTimer::ToProfilerNs(uint64_t ticks) const
+{
+	int64_t offsetTicks = static_cast<int64_t>(ticks - m_calibrationTicks);
+	double offsetNs = static_cast<double>(offsetTicks) * 1000000000.0 / m_frequency;
+	return static_cast<uint64_t>(static_cast<int64_t>(m_calibrationNs) + static_cast<int64_t>(offsetNs));
+}
+#pragma endregion
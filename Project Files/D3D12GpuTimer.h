@@ -0,0 +1,98 @@
+#pragma once
+
+#pragma region Includes
+//Include{s}
+#include "GpuTimestampTracker.h"
+#include "DXRApp.h"
+#pragma endregion
+
+/// <summary>
+/// The D3D12GpuTimer class. Owns the timestamp query heap and the readback buffer the queries get resolved into,
+/// and passes finished frames on to the CPU profiler on their own track so they line up with the CPU scopes.
+/// </summary>
+class D3D12GpuTimer : public IGpuTimestampReader
+{
+public:
+#pragma region Constructors and Destructors
+	/// <summary>
+	/// Initializes a new instance of the D3D12GpuTimer class.
+	/// </summary>
+	/// <param name="device">The device to make the query heap and readback buffer on.</param>
+	/// <param name="commandQueue">The direct queue the timestamps are written on, its clock is what gets calibrated.</param>
+	/// <param name="frameQueue">The queue the frame pacer signals, not owned.</param>
+	/// <param name="frameSlots">How many frames can be in flight.</param>
+	/// <param name="maxScopesPerFrame">How many scopes one frame can time.</param>
+	D3D12GpuTimer(ComPtr<ID3D12Device5> device, ComPtr<ID3D12CommandQueue> commandQueue, IFrameQueue* frameQueue,
+		uint32_t frameSlots, uint32_t maxScopesPerFrame);
+#pragma endregion
+
+#pragma region Frame Methods
+	/// <summary>
+	/// Starts a frame, call it once the frame pacer has the slot. Hands anything the GPU has finished to the CPU profiler.
+	/// </summary>
+	void BeginFrame(uint32_t slot, uint64_t frame);
+
+	/// <summary>
+	/// Writes the start timestamp of a scope.
+	/// </summary>
+	/// <returns>The scope to end, it might be invalid if the frame ran out of queries but it can still be ended.</returns>
+	uint32_t BeginScope(ID3D12GraphicsCommandList* commandList, const char* name);
+
+	/// <summary>
+	/// Writes the end timestamp of a scope.
+	/// </summary>
+	void EndScope(ID3D12GraphicsCommandList* commandList, uint32_t scope);
+
+	/// <summary>
+	/// Resolves the frame's queries into the readback buffer, record it last thing before the command list is closed.
+	/// </summary>
+	void ResolveFrame(ID3D12GraphicsCommandList* commandList);
+
+	/// <summary>
+	/// Ends the frame, once it's been submitted and signalled.
+	/// </summary>
+	/// <param name="fenceValue">The fence value the frame pacer signalled.</param>
+	void EndFrame(uint64_t fenceValue);
+#pragma endregion
+
+#pragma region Reader Methods
+	void ReadTimestamps(uint32_t firstQuery, uint32_t queryCount, uint64_t* timestamps) override;
+#pragma endregion
+
+#pragma region Getters
+	const GpuTimestampTracker& GetTracker() const { return m_tracker; }
+	uint32_t GetTrack() const { return m_track; }
+
+	/// <summary>
+	/// Gets the length of a scope in milliseconds.
+	/// </summary>
+	double GetMilliseconds(const GpuScopeResult& scope) const { return (scope.endTicks - scope.startTicks) * 1000.0 / m_frequency; }
+#pragma endregion
+
+private:
+#pragma region Private Methods
+	/// <summary>
+	/// Samples the GPU and CPU clocks together, so GPU ticks can be turned into profiler time.
+	/// </summary>
+	void Calibrate();
+
+	/// <summary>
+	/// Converts GPU ticks to CPU profiler nanoseconds using the last calibration.
+	/// </summary>
+	uint64_t ToProfilerNs(uint64_t ticks) const;
+#pragma endregion
+
+#pragma region Private Variables
+	static const uint32_t kCalibrationInterval = 120; // Frames between calibrations, the clocks drift a bit
+
+	ComPtr<ID3D12CommandQueue> m_commandQueue;
+	ComPtr<ID3D12QueryHeap> m_queryHeap;
+	ComPtr<ID3D12Resource> m_readback;
+	GpuTimestampTracker m_tracker;
+	uint64_t m_frequency = 1;
+	uint64_t m_calibrationTicks = 0;
+	uint64_t m_calibrationNs = 0;
+	uint32_t m_framesSinceCalibration = 0;
+	uint32_t m_track;
+#pragma endregion
+};
@@ -37,19 +37,41 @@ DXRApp::DXRApp(UINT width, UINT height,
 #pragma region Main Application Methods
 void DXRApp::OnInit()
 {
+	// Runs with no window have to build the same scene every time, or the goldens and the tile workers wouldn't match.
+	if (IsHeadless())
+	{
+		srand(0);
+	}
+
 	m_DXSetup->initialise();
+
+	if (GetWorkerPort() > 0)
+	{
+		m_DXRuntime->StartTileWorker();
+	}
+	else if (GetOfflineFrames() > 0)
+	{
+		m_DXRuntime->StartOfflineRender();
+	}
+	else if (!GetGoldenDirectory().empty())
+	{
+		m_DXRuntime->StartGoldenTests();
+	}
 }
 
 // Update frame-based values.
 void DXRApp::OnUpdate()
 {
+	// Update comes first in the loop, so this is where a profiler frame starts.
+	CpuProfiler::Get().BeginFrame();
+
 	m_DXRuntime->Update();
 }
 
 void DXRApp::OnDestroy() {
 	// Ensure that the GPU is no longer referencing resources that are about to be
 	// cleaned up by the destructor.
-	WaitForPreviousFrame();
+	WaitForGpuIdle();
 
 	CloseHandle(m_DXRContext->m_fenceEvent);
 }
@@ -61,21 +83,12 @@ void DXRApp::OnRender() {
 	m_DXRuntime->Render();
 }
 
-void DXRApp::WaitForPreviousFrame() {
-	// WAITING FOR THE FRAME TO COMPLETE BEFORE CONTINUING IS NOT BEST PRACTICE.
-	// This is code implemented as such for simplicity. The
-	// D3D12HelloFrameBuffering sample illustrates how to use fences for efficient
-	// resource usage and to maximize GPU utilization.
-	// Signal and increment the fence value.
-	const UINT64 fence = m_DXRContext->m_fenceValue;
-	ThrowIfFailed(m_DXRContext->m_commandQueue->Signal(m_DXRContext->m_fence.Get(), fence));
-	m_DXRContext->m_fenceValue++;
-
-	// Wait until the previous frame is finished.
-	if (m_DXRContext->m_fence->GetCompletedValue() < fence) {
-		ThrowIfFailed(m_DXRContext->m_fence->SetEventOnCompletion(fence, m_DXRContext->m_fenceEvent));
-		WaitForSingleObject(m_DXRContext->m_fenceEvent, INFINITE);
-	}
+void DXRApp::WaitForGpuIdle() {
+	// Also runs anything the frame pacer was holding on to, and empties the upload ring, since nothing can be using them anymore.
+	// Anything recorded into the command list has to have been executed first, or its uploads go with it.
+	uint64_t fenceValue = m_DXRContext->m_framePacer->Flush();
+	m_DXRContext->m_uploadRingAllocator->FinishFrame(fenceValue);
+	m_DXRContext->m_uploadRingAllocator->Reclaim(fenceValue);
 
 	m_DXRContext->m_frameIndex = m_DXRContext->m_swapChain->GetCurrentBackBufferIndex();
 }
@@ -98,5 +111,21 @@ void DXRApp::OnMouseMoveDelta(POINTS Delta)
 
 void DXRApp::OnMouseMove(int x, int y)
 {
+	m_DXRuntime->OnMouseMove(x, y);
+}
+
+void DXRApp::OnMouseLook(bool looking)
+{
+	m_DXRuntime->OnMouseLook(looking);
+}
+
+void DXRApp::OnMouseLeave()
+{
+	m_DXRuntime->OnMouseLeave();
+}
+
+void DXRApp::OnMouseClick(int x, int y)
+{
+	m_DXRuntime->OnMouseClick(x, y);
 }
 #pragma endregion
\ No newline at end of file
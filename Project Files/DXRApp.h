@@ -17,6 +17,8 @@
 #include "DXSample.h"
 #include <dxcapi.h>
 #include <vector>
+#include "TransformBatch.h"
+#include "ScenePicker.h"
 class DrawableGameObject;
 using namespace DirectX;
 using namespace std;
@@ -24,6 +26,28 @@ class DXRContext;
 class DXRSetup;
 class DXRRuntime;
 typedef std::vector<DrawableGameObject*> vecDrawables;
+
+/// <summary>
+/// A transform with no mesh of its own, the objects in it are parented to it so they can be moved together.
+/// </summary>
+struct SceneGroup
+{
+	std::string name;
+	UINT transformIndex;
+};
+
+/// <summary>
+/// One TLAS instance. An object has one for its full mesh, followed by one for each of its LOD levels, all at the
+/// object's transform and using its hit group. Their masks decide which rays see which level.
+/// </summary>
+struct SceneInstance
+{
+	D3D12_GPU_VIRTUAL_ADDRESS blas;
+	UINT transformIndex;
+	UINT object; // Which object it's a level of, which is also its hit group
+	UINT lod; // 0 for the full mesh
+	UINT meshIndex; // Its MeshInfo, which is the InstanceID the hit shaders see
+};
 #define FRAME_COUNT 2
 
 // Note that while ComPtr is used to manage the lifetime of resources on the
@@ -110,6 +134,24 @@ public:
 	/// <param name="y">The y-coordinate of the mouse.</param>
 	void OnMouseMove(int x, int y);
 
+	/// <summary>
+	/// Handles the right button starting or stopping mouse look.
+	/// </summary>
+	/// <param name="looking">True when mouse look starts.</param>
+	void OnMouseLook(bool looking);
+
+	/// <summary>
+	/// Handles the mouse leaving the window.
+	/// </summary>
+	void OnMouseLeave();
+
+	/// <summary>
+	/// Handles left clicks.
+	/// </summary>
+	/// <param name="x">The x-coordinate of the mouse, in the window.</param>
+	/// <param name="y">The y-coordinate of the mouse, in the window.</param>
+	void OnMouseClick(int x, int y);
+
 #pragma endregion
 
 #pragma endregion
@@ -123,9 +165,10 @@ public:
 private:
 
 	/// <summary>
-	/// Waits for the GPU to finish processing the previous frame.
+	/// Waits for the GPU to finish everything submitted so far. Frames don't need this anymore, the frame pacer
+	/// only waits on the slot it's about to reuse, it's for setup and shutdown.
 	/// </summary>
-	void WaitForPreviousFrame();
+	void WaitForGpuIdle();
 
 #pragma endregion
 
@@ -134,8 +177,12 @@ private:
 	DXRRuntime* m_DXRuntime;
 	DXRSetup* m_DXSetup;
 
-	std::vector<std::pair<ComPtr<ID3D12Resource>, DirectX::XMMATRIX>> m_instances;
+	std::vector<SceneInstance> m_instances; // Every object's full mesh and LOD levels, each object's next to each other
+	std::vector<UINT> m_instanceMasks; // Each instance's TLAS mask this frame, 0 when culling has left it out
 
 	vecDrawables m_drawableObjects;
+	std::vector<SceneGroup> m_sceneGroups;
+	TransformBatch m_transforms; // Every object's and group's transform
+	ScenePicker m_picker; // A CPU copy of the BLASes and TLAS for the mouse, its instances are in the same order as the objects
 #pragma endregion
 };
\ No newline at end of file
@@ -13,5 +13,7 @@ DXRContext::DXRContext(UINT width, UINT height) : m_frameIndex(0), m_viewport(0.
 	m_scissorRect(0, 0, static_cast<LONG>(width), static_cast<LONG>(height)),
 	m_rtvDescriptorSize(0)
 {
+	m_renderTile.width = width;
+	m_renderTile.height = height;
 }
 #pragma endregion
\ No newline at end of file
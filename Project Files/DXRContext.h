@@ -2,11 +2,26 @@
 
 #pragma region Includes
 //Include{s}
+#include <map>
 #include "Camera.h"
 #include "DXRApp.h"
 #include "nv_helpers_dx12/TopLevelASGenerator.h"
 #include "nv_helpers_dx12/ShaderBindingTableGenerator.h"
 #include "common.h"
+#include "ShaderCache.h"
+#include "MeshLodCache.h"
+#include "FramePacer.h"
+#include "D3D12FrameQueue.h"
+#include "UploadRingAllocator.h"
+#include "AccelerationStructurePool.h"
+#include "BlasBuildPolicy.h"
+#include "ResourceTracker.h"
+#include "CpuProfiler.h"
+#include "D3D12GpuTimer.h"
+#include "RayCounters.h"
+#include "OfflineRenderer.h"
+#include "TileNetwork.h"
+#include "GoldenImageTests.h"
 #pragma endregion
 
 class DXRContext
@@ -22,7 +37,7 @@ public:
 #pragma endregion
 
 #pragma region Camera
-	// Camera buffer
+	// Camera buffer, lives on the default heap and gets this frame's constants copied in from the upload ring
 	Camera* m_pCamera;
 	ComPtr< ID3D12Resource > m_cameraBuffer;
 	uint32_t m_cameraBufferSize = 256;
@@ -32,6 +47,23 @@ public:
 	// Lighting buffer
 	ComPtr< ID3D12Resource > m_lightingBuffer;
 	uint32_t m_lightingBufferSize = 256;
+	LightParams m_lightingData; // CPU copy, the UI only touches it now and then but every frame uploads it
+#pragma endregion
+
+#pragma region Geometry Pools
+	// Every object's vertices and indices packed into one default heap buffer each, so the hit shaders can reach any mesh.
+	ComPtr< ID3D12Resource > m_vertexPool;
+	ComPtr< ID3D12Resource > m_indexPool;
+	ComPtr< ID3D12Resource > m_meshInfoBuffer; // One MeshInfo per object then one per LOD level, indexed by InstanceID()
+	std::vector<MeshInfo> m_meshInfos; // CPU copy of it, each mesh gets its own BLAS
+	UINT m_vertexPoolCount = 0;
+	UINT m_indexPoolCount = 0;
+	MeshLodCache* m_meshLodCache = nullptr; // simplified meshes on disk, so each one is only simplified the once
+#pragma endregion
+
+#pragma region Materials
+	// One MaterialBuffer per object, indexed by the mesh's materialIndex
+	ComPtr< ID3D12Resource > m_materialTable;
 #pragma endregion
 
 #pragma region ImGui
@@ -45,7 +77,7 @@ public:
 	ComPtr<IDXGISwapChain3> m_swapChain;
 	ComPtr<ID3D12Device5> m_device;
 	ComPtr<ID3D12Resource> m_renderTargets[FRAME_COUNT];
-	ComPtr<ID3D12CommandAllocator> m_commandAllocator;
+	ComPtr<ID3D12CommandAllocator> m_commandAllocators[FRAME_COUNT]; // One per frame in flight, an allocator can't be reset while the GPU is using it
 	ComPtr<ID3D12CommandQueue> m_commandQueue;
 	ComPtr<ID3D12RootSignature> m_rootSignature;
 	ComPtr<ID3D12DescriptorHeap> m_rtvHeap;
@@ -55,23 +87,95 @@ public:
 
 #pragma region Synchronization
 	// Synchronization objects.
-	UINT m_frameIndex;
+	UINT m_frameIndex; // The swap chain's back buffer, not the same thing as the frame pacer's slot
 	HANDLE m_fenceEvent;
 	ComPtr<ID3D12Fence> m_fence;
-	UINT64 m_fenceValue;
+	D3D12FrameQueue* m_frameQueue = nullptr;
+	FramePacer* m_framePacer = nullptr; // Decides when the CPU has to wait for the GPU, and when old resources can go
+#pragma endregion
+
+#pragma region Upload Ring
+	// One persistently mapped upload buffer for everything transient: per frame constants and the staging copies
+	// for textures and geometry. Chunks go back to the ring once the fence of the frame that used them completes.
+	ComPtr<ID3D12Resource> m_uploadRing;
+	uint8_t* m_uploadRingData = nullptr;
+	UploadRingAllocator* m_uploadRingAllocator = nullptr;
+	UINT64 m_uploadRingSize = 4 * 1024 * 1024;
+	UINT64 m_uploadFallbacks = 0; // Uploads that didn't fit and got their own buffer instead
+	UINT64 m_uploadFallbackBytes = 0;
+
+	// This frame's chunks of the ring, CopyFrameConstants copies them into the default heap buffers
+	UploadAllocation m_cameraUpload;
+	UploadAllocation m_lightingUpload;
+	UploadAllocation m_materialUpload;
+#pragma endregion
+
+#pragma region Frame Resources
+	// The TLAS helper maps the instance descriptors every frame, so each frame in flight gets its own
+	ComPtr<ID3D12Resource> m_frameInstanceDescs[FRAME_COUNT];
+
+	/// <summary>
+	/// Gets the frame pacer's current slot.
+	/// </summary>
+	UINT GetFrameSlot() const { return m_framePacer ? m_framePacer->GetFrameIndex() : 0; }
 #pragma endregion
 
 #pragma region Acceleration Structures
-	ComPtr<ID3D12Resource> m_bottomLevelAS; // Storage for the bottom Level AS
+	// Every BLAS lives in the pool, one slice per object in the same order as the drawables
+	AccelerationStructurePool* m_blasPool = nullptr;
+	UINT64 m_blasPageSize = 4 * 1024 * 1024;
+	std::vector<AccelerationStructureAllocation> m_bottomLevelAS;
+
+	// One scratch arena shared by every BLAS build, each build in a batch gets a slice of it and the next batch reuses it
+	ComPtr<ID3D12Resource> m_blasScratch;
+	UINT64 m_blasScratchSize = 0;
+	UINT64 m_blasScratchBudget = 32 * 1024 * 1024; // Past this a new batch starts, a single bigger build still gets what it needs
+	UINT m_blasBuildBatches = 0;
+
+	// Picks how each mesh's BLAS is built, and what each one reserved and ended up using
+	IBlasPolicySelector* m_blasPolicySelector = nullptr;
+	BlasMemoryReport m_blasReport;
 
 	nv_helpers_dx12::TopLevelASGenerator m_topLevelASGenerator;
 	AccelerationStructureBuffers m_topLevelASBuffers;
 #pragma endregion
 
+#pragma region Resource Accounting
+	// Every long lived GPU allocation, tagged by category and owner. The ids are for the ones that get replaced.
+	ResourceTracker m_resourceTracker;
+	uint64_t m_blasScratchTrackingId = 0;
+	std::vector<uint64_t> m_tlasTrackingIds;
+	uint64_t m_sbtTrackingId = 0;
+#pragma endregion
+
+#pragma region Profiling
+	// What one CPU profiler scope costs, measured at startup so the performance window can show the overhead
+	double m_cpuScopeCostNs = 0.0;
+
+	// Timestamp queries around the big GPU jobs each frame, read back a couple of frames later without waiting
+	D3D12GpuTimer* m_gpuTimer = nullptr;
+	OfflineRenderer* m_offlineRenderer = nullptr; // Only made for -render runs
+	TileCoordinator* m_tileCoordinator = nullptr; // Only made for -render runs with -distribute
+	TileWorker* m_tileWorker = nullptr; // Only made when this process is a -worker
+	GoldenImageTests* m_goldenTests = nullptr; // Only made for -golden runs
+
+	// Rays traced per type, counted by the shaders. Each frame slot copies its counts into its own part of the readback buffer,
+	// which gets read once the pacer hands the slot back, so nothing waits on it
+	ComPtr<ID3D12Resource> m_rayCounters;
+	ComPtr<ID3D12Resource> m_rayCounterZeros; // Copied over the counters before every dispatch
+	ComPtr<ID3D12Resource> m_rayCounterReadback;
+	bool m_rayCountsPending[FRAME_COUNT] = {};
+	uint64_t m_rayCountFrames[FRAME_COUNT] = {};
+	float m_rayCountSeconds[FRAME_COUNT] = {};
+	RayRateTracker m_rayRates;
+#pragma endregion
+
 #pragma region Shader Libraries
 	ComPtr<IDxcBlob> m_rayGenLibrary; // ray gen shader
 	ComPtr<IDxcBlob> m_hitLibrary; // hit shader
 	ComPtr<IDxcBlob> m_missLibrary; // miss shader
+	ShaderCache* m_shaderCache = nullptr; // compiled DXIL on disk, so we don't pay for DXC every launch
+	std::map<UINT, ComPtr<IDxcBlob>> m_hitPermutationLibraries; // specialised hit shader variants, keyed by feature mask
 #pragma endregion
 
 #pragma region Root Signatures
@@ -91,6 +195,7 @@ public:
 
 #pragma region Output Resources
 	ComPtr<ID3D12Resource> m_outputResource; // where the colours are written (before being copied to a render target)
+	TileRect m_renderTile; // the part of the output DispatchRays covers, the whole thing unless a tile worker is rendering
 	ComPtr<ID3D12DescriptorHeap> m_srvUavHeap; // the main heap used by the shaders, which will give access to the raytracing output and the top-level acceleration structure
 #pragma endregion
 
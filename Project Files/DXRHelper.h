@@ -10,6 +10,7 @@
 #include <d3d12.h>
 #include "DXSampleHelper.h"
 #include <dxcapi.h>
+#include "ShaderCache.h"
 
 #include <vector>
 
@@ -57,13 +58,17 @@ static const D3D12_HEAP_PROPERTIES kDefaultHeapProps = {
     D3D12_HEAP_TYPE_DEFAULT, D3D12_CPU_PAGE_PROPERTY_UNKNOWN, D3D12_MEMORY_POOL_UNKNOWN, 0, 0};
 
 //--------------------------------------------------------------------------------------------------
-// Compile a HLSL file into a DXIL library
+// Compile a HLSL file into a DXIL library. If a cache is given, the DXIL is looked up by the hash
+// of the source (and its includes), the target, the defines and the compiler version, and only
+// compiled on a miss
 //
-IDxcBlob* CompileShaderLibrary(LPCWSTR fileName)
+IDxcBlob* CompileShaderLibrary(LPCWSTR fileName, ShaderCache* cache = nullptr,
+                               const std::vector<std::wstring>& defines = {})
 {
   static IDxcCompiler* pCompiler = nullptr;
   static IDxcLibrary* pLibrary = nullptr;
   static IDxcIncludeHandler* dxcIncludeHandler;
+  static std::string compilerVersion;
 
   HRESULT hr;
 
@@ -73,54 +78,119 @@ IDxcBlob* CompileShaderLibrary(LPCWSTR fileName)
     ThrowIfFailed(DxcCreateInstance(CLSID_DxcCompiler, __uuidof(IDxcCompiler), (void **)&pCompiler));
     ThrowIfFailed(DxcCreateInstance(CLSID_DxcLibrary, __uuidof(IDxcLibrary), (void **)&pLibrary));
     ThrowIfFailed(pLibrary->CreateIncludeHandler(&dxcIncludeHandler));
+
+    // The compiler version is part of the cache key, so a DXC update invalidates the cache
+    compilerVersion = "dxc";
+    IDxcVersionInfo* pVersionInfo;
+    if (SUCCEEDED(pCompiler->QueryInterface(__uuidof(IDxcVersionInfo), (void**)&pVersionInfo)))
+    {
+      UINT32 major = 0, minor = 0;
+      pVersionInfo->GetVersion(&major, &minor);
+      compilerVersion += " " + std::to_string(major) + "." + std::to_string(minor);
+      pVersionInfo->Release();
+    }
   }
-  // Open and read the file
-  std::ifstream shaderFile(fileName);
-  if (shaderFile.good() == false)
+
+  // Split NAME=VALUE defines for DXC. The strings must outlive the Compile call
+  std::vector<std::wstring> defineNames;
+  std::vector<std::wstring> defineValues;
+  for (const std::wstring& define : defines)
   {
-    throw std::logic_error("Cannot find shader file");
+    size_t equals = define.find(L'=');
+    defineNames.push_back(define.substr(0, equals));
+    defineValues.push_back(equals == std::wstring::npos ? L"1" : define.substr(equals + 1));
   }
-  std::stringstream strStream;
-  strStream << shaderFile.rdbuf();
-  std::string sShader = strStream.str();
-
-  // Create blob from the string
-  IDxcBlobEncoding* pTextBlob;
-  ThrowIfFailed(pLibrary->CreateBlobWithEncodingFromPinned(
-      (LPBYTE)sShader.c_str(), (uint32_t)sShader.size(), 0, &pTextBlob));
-
-  // Compile
-  IDxcOperationResult* pResult;
-  ThrowIfFailed(pCompiler->Compile(pTextBlob, fileName, L"", L"lib_6_3", nullptr, 0, nullptr, 0,
-                                   dxcIncludeHandler, &pResult));
-
-  // Verify the result
-  HRESULT resultCode;
-  ThrowIfFailed(pResult->GetStatus(&resultCode));
-  if (FAILED(resultCode))
+  std::vector<DxcDefine> dxcDefines;
+  for (size_t i = 0; i < defines.size(); i++)
   {
-    IDxcBlobEncoding* pError;
-    hr = pResult->GetErrorBuffer(&pError);
-    if (FAILED(hr))
+    dxcDefines.push_back({defineNames[i].c_str(), defineValues[i].c_str()});
+  }
+
+  auto compile = [&](const std::string& sShader) -> IDxcBlob* {
+    // Create blob from the string
+    IDxcBlobEncoding* pTextBlob;
+    ThrowIfFailed(pLibrary->CreateBlobWithEncodingFromPinned(
+        (LPBYTE)sShader.c_str(), (uint32_t)sShader.size(), 0, &pTextBlob));
+
+    // Compile
+    IDxcOperationResult* pResult;
+    ThrowIfFailed(pCompiler->Compile(pTextBlob, fileName, L"", L"lib_6_3", nullptr, 0,
+                                     dxcDefines.data(), (UINT32)dxcDefines.size(),
+                                     dxcIncludeHandler, &pResult));
+
+    // Verify the result
+    HRESULT resultCode;
+    ThrowIfFailed(pResult->GetStatus(&resultCode));
+    if (FAILED(resultCode))
     {
-      throw std::logic_error("Failed to get shader compiler error");
+      IDxcBlobEncoding* pError;
+      hr = pResult->GetErrorBuffer(&pError);
+      if (FAILED(hr))
+      {
+        throw std::logic_error("Failed to get shader compiler error");
+      }
+
+      // Convert error blob to a string
+      std::vector<char> infoLog(pError->GetBufferSize() + 1);
+      memcpy(infoLog.data(), pError->GetBufferPointer(), pError->GetBufferSize());
+      infoLog[pError->GetBufferSize()] = 0;
+
+      std::string errorMsg = "Shader Compiler Error:\n";
+      errorMsg.append(infoLog.data());
+
+      MessageBoxA(nullptr, errorMsg.c_str(), "Error!", MB_OK);
+      throw std::logic_error("Failed compile shader");
     }
 
-    // Convert error blob to a string
-    std::vector<char> infoLog(pError->GetBufferSize() + 1);
-    memcpy(infoLog.data(), pError->GetBufferPointer(), pError->GetBufferSize());
-    infoLog[pError->GetBufferSize()] = 0;
+    IDxcBlob* pBlob;
+    ThrowIfFailed(pResult->GetResult(&pBlob));
+    return pBlob;
+  };
 
-    std::string errorMsg = "Shader Compiler Error:\n";
-    errorMsg.append(infoLog.data());
+  // Shader file names are plain ASCII, so narrowing is fine here
+  std::wstring wideName(fileName);
+  std::string sFileName(wideName.begin(), wideName.end());
 
-    MessageBoxA(nullptr, errorMsg.c_str(), "Error!", MB_OK);
-    throw std::logic_error("Failed compile shader");
+  if (!cache)
+  {
+    // Open and read the file
+    std::ifstream shaderFile(fileName);
+    if (shaderFile.good() == false)
+    {
+      throw std::logic_error("Cannot find shader file");
+    }
+    std::stringstream strStream;
+    strStream << shaderFile.rdbuf();
+    return compile(strStream.str());
+  }
+
+  std::vector<std::string> arguments = {"-T lib_6_3"};
+  for (const std::wstring& define : defines)
+  {
+    arguments.push_back("-D " + std::string(define.begin(), define.end()));
   }
 
-  IDxcBlob* pBlob;
-  ThrowIfFailed(pResult->GetResult(&pBlob));
-  return pBlob;
+  std::vector<uint8_t> dxil = cache->GetOrCompile(
+      sFileName, arguments, compilerVersion,
+      [&](const std::string&, const std::string& source) {
+        IDxcBlob* pBlob = compile(source);
+        const uint8_t* pData = static_cast<const uint8_t*>(pBlob->GetBufferPointer());
+        std::vector<uint8_t> bytes(pData, pData + pBlob->GetBufferSize());
+        pBlob->Release();
+        return bytes;
+      });
+
+  // Wrap the cached bytes back up in a blob so the pipeline generator can't tell the difference
+  IDxcBlobEncoding* pCachedBlob;
+  ThrowIfFailed(pLibrary->CreateBlobWithEncodingOnHeapCopy(dxil.data(), (uint32_t)dxil.size(), 0,
+                                                           &pCachedBlob));
+
+  const ShaderCacheRecord& record = cache->GetLastRecord();
+  std::string report = "Shader cache " + std::string(record.hit ? "hit" : "miss") + ": " +
+                       sFileName + " " + record.arguments + " (" + std::to_string(record.milliseconds) + " ms)\n";
+  OutputDebugStringA(report.c_str());
+
+  return pCachedBlob;
 }
 
 //--------------------------------------------------------------------------------------------------
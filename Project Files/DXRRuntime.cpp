@@ -21,12 +21,27 @@ DXRRuntime::DXRRuntime(DXRApp* app)
 	m_device = m_app->GetContext()->m_device;
 	wstring windowName = m_app->GetTitle();
 	m_windowName.assign(windowName.begin(), windowName.end());
+
+	m_cameraPaths.AddPath(m_currentCameraPath, {
+		SplineVec3(0.0f, 0.0f, 0.0f), // Initial velocity
+		SplineVec3(0.0f, 0.0f, 5.0f),
+		SplineVec3(1.0f, 0.0f, 5.0f),
+		SplineVec3(0.0f, 0.0f, 0.0f) // Final velocity
+	});
 }
 #pragma endregion
 
 #pragma region Render / Update Methods
 void DXRRuntime::Render()
 {
+	PROFILE_CPU_SCOPE("Render");
+
+	// A tile coordinator, or a worker waiting on tiles, has nothing to draw.
+	if (m_skipFrame)
+	{
+		return;
+	}
+
 	DXRContext* context = m_app->GetContext();
 
 	// Draw all the UI elements.
@@ -43,58 +58,411 @@ void DXRRuntime::Render()
 	context->m_commandQueue->ExecuteCommandLists(_countof(ppCommandLists), ppCommandLists);
 
 	// Present the frame.
-	ThrowIfFailed(context->m_swapChain->Present(1, 0));
+	{
+		PROFILE_CPU_SCOPE("Present");
+		// No vsync while benchmarking, otherwise every frame time is just the refresh rate.
+		UINT syncInterval = m_benchmark.IsRunning() || context->m_offlineRenderer != nullptr || context->m_tileWorker != nullptr ||
+			context->m_goldenTests != nullptr ? 0 : 1;
+		ThrowIfFailed(context->m_swapChain->Present(syncInterval, 0));
+	}
 
-	m_app->WaitForPreviousFrame();
+	// No waiting here anymore, the frame pacer signals the frame and the next Update only
+	// blocks if the GPU is still on the slot it wants to reuse.
+	uint64_t fenceValue = context->m_framePacer->EndFrame();
+	context->m_uploadRingAllocator->FinishFrame(fenceValue);
+	context->m_gpuTimer->EndFrame(fenceValue);
+	context->m_frameIndex = context->m_swapChain->GetCurrentBackBufferIndex();
 }
 
 void DXRRuntime::Update()
 {
+	PROFILE_CPU_SCOPE("Update");
+
 	DXRContext* context = m_app->GetContext();
 
-	//Static initializes this value only once
-	static ULONGLONG frameStart = GetTickCount64();
-	static float deltaTime = 0.0f;
+	m_skipFrame = UpdateTileNetwork();
+	if (m_skipFrame)
+	{
+		return;
+	}
 
-	// Calculate the time since the last frame.
-	ULONGLONG frameNow = GetTickCount64();
-	deltaTime = (frameNow - frameStart) / 1000.0f;
-	m_totalTime += deltaTime;
-	m_currentDeltaTime = deltaTime;
-	frameStart = frameNow;
+	// Claim a frame slot before anything gets written into the upload ring, then take back
+	// whatever the frames the GPU has finished were using.
+	{
+		PROFILE_CPU_SCOPE("Wait For Frame Slot");
+		context->m_framePacer->BeginFrame();
+	}
+	context->m_gpuTimer->BeginFrame(context->GetFrameSlot(), CpuProfiler::Get().GetFrameIndex());
+	m_app->m_DXSetup->CollectRayCounters();
+	if (context->m_offlineRenderer != nullptr)
+	{
+		context->m_offlineRenderer->CollectFrame(context->GetFrameSlot());
+		if (context->m_offlineRenderer->IsFinished())
+		{
+			FinishOfflineRender();
+		}
+	}
+	if (context->m_tileWorker != nullptr)
+	{
+		// Send back whatever tile this slot did last time, then this frame renders the next one.
+		context->m_tileWorker->CollectFrame(context->GetFrameSlot());
+		context->m_tileWorker->TakeJob(m_tileJob);
+		context->m_renderTile = m_tileJob.rect;
+	}
+	if (context->m_goldenTests != nullptr)
+	{
+		context->m_goldenTests->CollectFrame(context->GetFrameSlot());
+		if (context->m_goldenTests->IsFinished())
+		{
+			FinishGoldenTests();
+		}
+	}
+	context->m_uploadRingAllocator->Reclaim(context->m_framePacer->GetCompletedValue());
+	m_app->m_DXSetup->AllocateFrameConstants();
 
-	// Update all the key inputs.
-	KeyInputs(context);
+	// Sample the high resolution clock and work out how many simulation steps this frame gets.
+	m_frameClock.Tick();
+	m_currentDeltaTime = static_cast<float>(m_frameClock.GetRealDeltaSeconds());
+	m_totalTime = static_cast<float>(m_frameClock.GetRealTime());
 
-	// Use the camera splines to animate the camera.
-	if (m_playCameraSplineAnimation)
+	if (m_benchmark.IsRunning())
 	{
-		context->m_pCamera->CameraSplineAnimation(deltaTime, m_controlPoints, m_totalSplineAnimation);
+		// The ray counts come back a couple of frames late, so each frame gets whatever arrived since the last one.
+		const RayRateTracker& rayRates = context->m_rayRates;
+		uint64_t raysSeen = rayRates.GetLifetimeCount(RAY_COUNTER_PRIMARY) + rayRates.GetLifetimeCount(RAY_COUNTER_SHADOW) +
+			rayRates.GetLifetimeCount(RAY_COUNTER_REFLECTION);
+
+		if (m_benchmark.AddFrame(m_frameClock.GetFrameCount(), m_frameClock.GetRealDeltaSeconds() * 1000.0, raysSeen - m_benchmarkRaysSeen))
+		{
+			FinishBenchmark();
+		}
+
+		m_benchmarkRaysSeen = raysSeen;
+	}
+	else if (context->m_offlineRenderer == nullptr && context->m_tileWorker == nullptr && context->m_goldenTests == nullptr)
+	{
+		// Update all the key inputs, the fly camera always moves on real time so it feels the same in every clock mode.
+		// Not while benchmarking or rendering offline though, a stray key press would change the path.
+		KeyInputs(context);
+	}
+
+	bool interpolate = m_frameClock.GetMode() == FRAME_CLOCK_INTERPOLATED;
+	float stepDelta = static_cast<float>(m_frameClock.GetSimulationDeltaSeconds());
+	uint32_t steps = m_frameClock.GetSimulationSteps();
+
+	if (!m_playCameraSplineAnimation)
+	{
+		m_splineStateValid = false;
+	}
+
+	const CameraSpline* cameraPath = m_cameraPaths.FindPath(m_currentCameraPath);
+	float splineDelta = stepDelta;
+
+	// Offline renders put the camera exactly where its frame is on the path, rather than adding up steps and drifting off the end.
+	if (context->m_offlineRenderer != nullptr)
+	{
+		uint32_t spans = max(context->m_offlineRenderer->GetFrameCount(), 2u) - 1;
+		context->m_pCamera->m_splineTransition = min(static_cast<float>(context->m_offlineRenderer->GetFramesRecorded()) / spans, 1.0f);
+		splineDelta = 0.0f;
+	}
+	else if (context->m_tileWorker != nullptr)
+	{
+		uint32_t spans = max(m_tileJob.frameCount, 2u) - 1;
+		context->m_pCamera->m_splineTransition = min(static_cast<float>(m_tileJob.frame) / spans, 1.0f);
+		splineDelta = 0.0f;
+	}
+	else if (context->m_goldenTests != nullptr)
+	{
+		context->m_pCamera->m_splineTransition = context->m_goldenTests->GetCurrentTransition();
+		splineDelta = 0.0f;
+	}
+
+	// A frame's tiles are rendered in different processes at different times, so workers keep the objects still or the tiles
+	// wouldn't line up. Golden images have to be the same however long the poses before them took, so they do too.
+	float objectDelta = context->m_tileWorker != nullptr || context->m_goldenTests != nullptr ? 0.0f : stepDelta;
+
+	// Run the simulation, which is the camera spline and the objects.
+	for (uint32_t step = 0; step < steps; ++step)
+	{
+		if (m_playCameraSplineAnimation && cameraPath != nullptr)
+		{
+			m_previousSplinePosition = m_splineStateValid ? m_currentSplinePosition : context->m_pCamera->GetPosition();
+			context->m_pCamera->CameraSplineAnimation(splineDelta, *cameraPath, m_totalSplineAnimation, m_faceAlongCameraPath);
+			m_currentSplinePosition = context->m_pCamera->GetPosition();
+			m_splineStateValid = true;
+		}
+
+		m_app->m_transforms.Step(objectDelta);
+	}
+
+	// Materials only follow the UI, so once a frame is plenty, even on a frame that landed between steps.
+	for (DrawableGameObject* object : m_app->m_drawableObjects)
+	{
+		object->update();
+	}
+
+	// Render somewhere between the last two simulated states, or just the newest one.
+	float alpha = static_cast<float>(m_frameClock.GetInterpolationAlpha());
+
+	if (interpolate && m_splineStateValid)
+	{
+		XMVECTOR previousPosition = XMLoadFloat3(&m_previousSplinePosition);
+		XMVECTOR currentPosition = XMLoadFloat3(&m_currentSplinePosition);
+		context->m_pCamera->SetPosition(XMVectorLerp(previousPosition, currentPosition, alpha));
+	}
+
+	// Only rebuilds the matrices of objects that were edited or are turning, the TLAS copies them straight into its descriptors.
+	m_app->m_transforms.UpdateWorld(interpolate ? alpha : 1.0f);
+
+	// The picker's boxes only need refitting if something actually moved.
+	if (m_app->m_transforms.GetUpdatedCount() > 0)
+	{
+		m_app->m_picker.Update(m_app->m_transforms);
 	}
 
 	// Update the camera position and rotation.
 	m_app->m_DXSetup->UpdateCamera(m_rayXWidth, m_rayYWidth);
 
-	// Update all drawable objects.
-	for (size_t i = 0; i < m_app->m_drawableObjects.size(); ++i)
+	// Needs the camera where it'll be rendered from, and the picker's boxes where the objects are.
+	UpdateInstanceCulling();
+
+	// A pick is a microsecond or so, cheap enough to keep the hover right while things move under a still mouse.
+	UpdateHover();
+
+	// Push every object's material into the material table in one go.
+	m_app->m_DXSetup->UpdateMaterialBuffers();
+
+	// If a material or light toggle changed which hit shader variant an object needs, swap it over.
+	m_app->m_DXSetup->UpdateHitPermutations();
+}
+
+void DXRRuntime::StartBenchmark()
+{
+	DXRContext* context = m_app->GetContext();
+
+	// Same start every run, the spline decides where the camera goes and the clock steps it the same amount every frame.
+	m_preBenchmarkClockMode = m_frameClock.GetMode();
+	m_preBenchmarkSpline = m_playCameraSplineAnimation;
+
+	context->m_pCamera->Reset();
+	context->m_pCamera->m_splineTransition = 0.0f;
+	m_playCameraSplineAnimation = true;
+	m_splineStateValid = false;
+	m_frameClock.SetMode(FRAME_CLOCK_BENCHMARK);
+
+	const RayRateTracker& rayRates = context->m_rayRates;
+	m_benchmarkRaysSeen = rayRates.GetLifetimeCount(RAY_COUNTER_PRIMARY) + rayRates.GetLifetimeCount(RAY_COUNTER_SHADOW) +
+		rayRates.GetLifetimeCount(RAY_COUNTER_REFLECTION);
+
+	m_benchmark.Start(m_currentCameraPath, static_cast<size_t>(m_benchmarkFrames), static_cast<size_t>(m_benchmarkWarmupFrames));
+	m_benchmarkStatus = "Running...";
+}
+
+void DXRRuntime::FinishBenchmark()
+{
+	m_benchmark.Stop();
+	m_frameClock.SetMode(m_preBenchmarkClockMode);
+	m_playCameraSplineAnimation = m_preBenchmarkSpline;
+
+	BenchmarkSummary summary = m_benchmark.GetSummary();
+	char status[256];
+	snprintf(status, sizeof(status), "%zu frames: min %.3f, avg %.3f, p95 %.3f, p99 %.3f ms, %.2f M rays/s", summary.frames,
+		summary.minMs, summary.avgMs, summary.p95Ms, summary.p99Ms, summary.raysPerSecond / 1000000.0);
+	m_benchmarkStatus = status;
+
+	if (!m_benchmark.WriteCsv("Benchmark.csv"))
+	{
+		m_benchmarkStatus += " (couldn't write Benchmark.csv)";
+	}
+}
+
+void DXRRuntime::StartOfflineRender()
+{
+	DXRContext* context = m_app->GetContext();
+
+	PrepareOfflineCamera();
+
+	wstring wideOutput = m_app->GetOfflineOutput();
+	string outputPrefix(wideOutput.begin(), wideOutput.end());
+
+	if (m_app->GetDistributeWorkers() > 0)
+	{
+		// The workers work out where the camera is for themselves, they just need to know which path it's on.
+		wstring workerArgs = L"-path \"" + wstring(m_currentCameraPath.begin(), m_currentCameraPath.end()) + L"\"";
+		context->m_tileCoordinator = new TileCoordinator(m_app->GetDistributeWorkers(), m_app->GetOfflineFrames(), m_app->GetWidth(),
+			m_app->GetHeight(), m_app->GetTileSize(), workerArgs, outputPrefix);
+		return;
+	}
+
+	context->m_offlineRenderer = new OfflineRenderer(m_device, context->m_outputResource, FRAME_COUNT, m_app->GetOfflineFrames(), outputPrefix);
+}
+
+void DXRRuntime::StartTileWorker()
+{
+	DXRContext* context = m_app->GetContext();
+
+	PrepareOfflineCamera();
+
+	context->m_tileWorker = new TileWorker(m_device, context->m_outputResource, FRAME_COUNT, static_cast<uint16_t>(m_app->GetWorkerPort()),
+		m_app->GetWorkerId());
+}
+
+void DXRRuntime::StartGoldenTests()
+{
+	DXRContext* context = m_app->GetContext();
+
+	PrepareOfflineCamera();
+
+	wstring wideDirectory = m_app->GetGoldenDirectory();
+	context->m_goldenTests = new GoldenImageTests(m_device, context->m_outputResource, FRAME_COUNT, string(wideDirectory.begin(), wideDirectory.end()),
+		m_app->GetUpdateGoldens());
+}
+
+void DXRRuntime::FinishGoldenTests()
+{
+	DXRContext* context = m_app->GetContext();
+
+	bool passed = context->m_goldenTests->Finish("GoldenResults.csv");
+
+	delete context->m_goldenTests;
+	context->m_goldenTests = nullptr;
+
+	// The exit code's what a build script would look at.
+	PostQuitMessage(passed ? 0 : 1);
+}
+
+void DXRRuntime::PrepareOfflineCamera()
+{
+	DXRContext* context = m_app->GetContext();
+
+	wstring widePath = m_app->GetOfflinePath();
+	string pathName(widePath.begin(), widePath.end());
+	if (!pathName.empty())
 	{
-		m_app->m_drawableObjects[i]->update(deltaTime);
-		m_app->m_DXSetup->UpdateMaterialBuffers();
-		m_app->m_instances[i].second = m_app->m_drawableObjects[i]->getTransform();
+		if (m_cameraPaths.FindPath(pathName) != nullptr)
+		{
+			m_currentCameraPath = pathName;
+		}
+		else
+		{
+			OutputDebugStringA(("No camera path called " + pathName + ", rendering " + m_currentCameraPath + " instead\n").c_str());
+		}
 	}
+
+	// One fixed step a frame, so anything the objects are doing comes out the same every run too.
+	m_frameClock.SetMode(FRAME_CLOCK_BENCHMARK);
+	context->m_pCamera->Reset();
+	m_playCameraSplineAnimation = true;
+	m_faceAlongCameraPath = true;
+	m_splineStateValid = false;
+}
+
+void DXRRuntime::FinishOfflineRender()
+{
+	DXRContext* context = m_app->GetContext();
+	bool succeeded = true;
+
+	if (context->m_tileCoordinator != nullptr)
+	{
+		if (!context->m_tileCoordinator->Finish("OfflineRender.csv") || context->m_tileCoordinator->HasFailed())
+		{
+			OutputDebugStringA("Distributed render: the workers were all lost, or some frames or the timings couldn't be written\n");
+			succeeded = false;
+		}
+
+		// Deleting it tells the workers to stop and waits for them.
+		delete context->m_tileCoordinator;
+		context->m_tileCoordinator = nullptr;
+	}
+	else
+	{
+		if (!context->m_offlineRenderer->Finish("OfflineRender.csv"))
+		{
+			OutputDebugStringA("Offline render: some frames or the timings couldn't be written\n");
+			succeeded = false;
+		}
+
+		delete context->m_offlineRenderer;
+		context->m_offlineRenderer = nullptr;
+	}
+
+	// Same as the golden tests, a script running -render needs to know it didn't get all its frames.
+	PostQuitMessage(succeeded ? 0 : 1);
+}
+
+bool DXRRuntime::UpdateTileNetwork()
+{
+	DXRContext* context = m_app->GetContext();
+
+	if (context->m_tileCoordinator != nullptr)
+	{
+		if (context->m_tileCoordinator->Pump() || context->m_tileCoordinator->HasFailed())
+		{
+			FinishOfflineRender();
+		}
+		else
+		{
+			// Nothing gets rendered here, so don't spin a core the workers could be using.
+			Sleep(1);
+		}
+		return true;
+	}
+
+	TileWorker* worker = context->m_tileWorker;
+	if (worker == nullptr)
+	{
+		return false;
+	}
+
+	worker->Poll();
+	if (worker->HasJob() && !worker->IsShutdown())
+	{
+		return false;
+	}
+
+	// Out of tiles, so the ones still sat in frame slots have to go back now, the coordinator won't send more until they do.
+	if (worker->HasPendingCaptures())
+	{
+		m_app->WaitForGpuIdle();
+		for (uint32_t slot = 0; slot < FRAME_COUNT; slot++)
+		{
+			worker->CollectFrame(slot);
+		}
+	}
+
+	if (worker->IsShutdown())
+	{
+		delete context->m_tileWorker;
+		context->m_tileWorker = nullptr;
+		PostQuitMessage(0);
+	}
+	else
+	{
+		Sleep(1);
+	}
+
+	return true;
 }
 
 void DXRRuntime::PopulateCommandList() {
+	PROFILE_CPU_SCOPE("PopulateCommandList");
+
 	DXRContext* context = m_app->GetContext();
 	// Command list allocators can only be reset when the associated
 	// command lists have finished execution on the GPU; apps should use
-	// fences to determine GPU execution progress.
-	ThrowIfFailed(context->m_commandAllocator->Reset());
+	// fences to determine GPU execution progress. BeginFrame already waited
+	// for this slot's last frame, so its allocator is free.
+	ID3D12CommandAllocator* commandAllocator = context->m_commandAllocators[context->GetFrameSlot()].Get();
+	ThrowIfFailed(commandAllocator->Reset());
 
 	// However, when ExecuteCommandList() is called on a particular command
 	// list, that command list can then be reset at any time and must be before
 	// re-recording.
-	ThrowIfFailed(context->m_commandList->Reset(context->m_commandAllocator.Get(), nullptr));
+	ThrowIfFailed(context->m_commandList->Reset(commandAllocator, nullptr));
+
+	// Everything the GPU does this frame goes inside this one, the big jobs get their own scopes inside it.
+	D3D12GpuTimer* gpuTimer = context->m_gpuTimer;
+	uint32_t gpuFrameScope = gpuTimer->BeginScope(context->m_commandList.Get(), "GPU Frame");
 
 	// Set necessary state.
 	context->m_commandList->SetGraphicsRootSignature(context->m_rootSignature.Get());
@@ -119,6 +487,9 @@ void DXRRuntime::PopulateCommandList() {
 	context->m_commandList->SetDescriptorHeaps(static_cast<UINT>(heaps.size()),
 		heaps.data());
 
+	// Get this frame's camera, light and materials into the buffers the shaders read.
+	m_app->m_DXSetup->CopyFrameConstants();
+
 	// On the last frame, the raytracing output was used as a copy source, to
 	// copy its contents into the render target. Now we need to transition it to
 	// a UAV so that the shaders can write in it.
@@ -163,22 +534,30 @@ void DXRRuntime::PopulateCommandList() {
 	desc.HitGroupTable.StrideInBytes = context->m_sbtHelper.GetHitGroupEntrySize();
 
 	// Dimensions of the image to render, identical to a kernel launch dimension
-	desc.Width = m_app->GetWidth();
-	desc.Height = m_app->GetHeight();
+	// Normally the whole image, a tile worker only does its tile.
+	desc.Width = context->m_renderTile.width;
+	desc.Height = context->m_renderTile.height;
 	desc.Depth = 1;
 
-	m_app->m_DXSetup->CreateTopLevelAS(m_app->m_instances, true);
+	uint32_t gpuScope = gpuTimer->BeginScope(context->m_commandList.Get(), "CreateTopLevelAS");
+	m_app->m_DXSetup->CreateTopLevelAS(m_app->m_instances, m_app->m_instanceMasks, m_app->m_transforms, true);
+	gpuTimer->EndScope(context->m_commandList.Get(), gpuScope);
 
 	// Bind the raytracing pipeline
 	context->m_commandList->SetPipelineState1(context->m_rtStateObject.Get());
 	// Dispatch the rays and write to the raytracing output
+	m_app->m_DXSetup->ClearRayCounters();
+	gpuScope = gpuTimer->BeginScope(context->m_commandList.Get(), "DispatchRays");
 	context->m_commandList->DispatchRays(&desc);
+	gpuTimer->EndScope(context->m_commandList.Get(), gpuScope);
+	m_app->m_DXSetup->ReadBackRayCounters(m_currentDeltaTime);
 
 	// The raytracing output needs to be copied to the actual render target used
 	// for display. For this, we need to transition the raytracing output from a
 	// UAV to a copy source, and the render target buffer to a copy destination.
 	// We can then do the actual copy, before transitioning the render target
 	// buffer into a render target, that will be then used to display the image
+	gpuScope = gpuTimer->BeginScope(context->m_commandList.Get(), "CopyResource");
 	transition = CD3DX12_RESOURCE_BARRIER::Transition(
 		context->m_outputResource.Get(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
 		D3D12_RESOURCE_STATE_COPY_SOURCE);
@@ -197,9 +576,29 @@ void DXRRuntime::PopulateCommandList() {
 		D3D12_RESOURCE_STATE_RENDER_TARGET);
 	context->m_commandList->ResourceBarrier(1, &transition);
 
-	context->m_commandList->SetDescriptorHeaps(1, context->m_IMGUIDescHeap.GetAddressOf());
-	ImGui::Render();
-	ImGui_ImplDX12_RenderDrawData(ImGui::GetDrawData(), context->m_commandList.Get());
+	// The output's a copy source at this point, so an offline render grabs the frame from it here.
+	if (context->m_offlineRenderer != nullptr)
+	{
+		context->m_offlineRenderer->RecordCapture(context->m_commandList.Get(), context->GetFrameSlot(), m_frameClock.GetRealDeltaSeconds() * 1000.0);
+	}
+	if (context->m_tileWorker != nullptr)
+	{
+		context->m_tileWorker->RecordCapture(context->m_commandList.Get(), context->GetFrameSlot(), m_tileJob, m_frameClock.GetRealDeltaSeconds() * 1000.0);
+	}
+	if (context->m_goldenTests != nullptr)
+	{
+		context->m_goldenTests->RecordFrame(context->m_commandList.Get(), context->GetFrameSlot(), m_frameClock.GetRealDeltaSeconds() * 1000.0);
+	}
+	gpuTimer->EndScope(context->m_commandList.Get(), gpuScope);
+
+	{
+		PROFILE_CPU_SCOPE("ImGui Render");
+		gpuScope = gpuTimer->BeginScope(context->m_commandList.Get(), "ImGui Render");
+		context->m_commandList->SetDescriptorHeaps(1, context->m_IMGUIDescHeap.GetAddressOf());
+		ImGui::Render();
+		ImGui_ImplDX12_RenderDrawData(ImGui::GetDrawData(), context->m_commandList.Get());
+		gpuTimer->EndScope(context->m_commandList.Get(), gpuScope);
+	}
 
 	// Indicate that the back buffer will now be used to present.
 	context->m_commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(
@@ -207,13 +606,17 @@ void DXRRuntime::PopulateCommandList() {
 		D3D12_RESOURCE_STATE_RENDER_TARGET,
 		D3D12_RESOURCE_STATE_PRESENT));
 
+	// The resolve has to be the last thing in the list, after every timestamp it copies.
+	gpuTimer->EndScope(context->m_commandList.Get(), gpuFrameScope);
+	gpuTimer->ResolveFrame(context->m_commandList.Get());
+
 	ThrowIfFailed(context->m_commandList->Close());
 }
 
 void DXRRuntime::DynamicWindowTitle()
 {
-	// Calculate the number of rays per second
-	int raysPerSecond = ((m_app->GetWidth() / m_rayXWidth) * (m_app->GetHeight() / m_rayYWidth) * ImGui::GetIO().Framerate);
+	// Rays per second as counted by the shaders, every type of ray included.
+	unsigned long long raysPerSecond = static_cast<unsigned long long>(m_app->GetContext()->m_rayRates.GetTotalRaysPerSecond());
 
 	static std::time_t date;
 
@@ -256,6 +659,8 @@ void DXRRuntime::OnKeyDown(UINT8 key)
 
 void DXRRuntime::KeyInputs(DXRContext* context)
 {
+	PROFILE_CPU_SCOPE("KeyInputs");
+
 	// Handle the key inputs for the camera and other controls.
 
 	if (inputs['W'] == true) context->m_pCamera->MoveForward(m_cameraMoveSpeed * m_currentDeltaTime);
@@ -275,12 +680,170 @@ void DXRRuntime::KeyInputs(DXRContext* context)
 	if (inputs['R'] == true) context->m_pCamera->Reset();
 	if (inputs[VK_ESCAPE] == true) PostQuitMessage(0);
 	if (inputs[VK_TAB] == true) m_selectedObject = nullptr;
+	if (inputs[VK_TAB] == true) m_selectedGroup = -1;
+}
+
+void DXRRuntime::OnMouseMove(int x, int y)
+{
+	m_mouseX = x;
+	m_mouseY = y;
+	UpdateHover();
+}
+
+void DXRRuntime::OnMouseLook(bool looking)
+{
+	if (looking)
+	{
+		OnMouseLeave();
+	}
+}
+
+void DXRRuntime::OnMouseLeave()
+{
+	m_mouseX = -1;
+	m_mouseY = -1;
+	UpdateHover();
+}
+
+void DXRRuntime::OnMouseClick(int x, int y)
+{
+	// Clicks on the UI are the UI's.
+	if (ImGui::GetIO().WantCaptureMouse)
+	{
+		return;
+	}
+
+	PickHit hit;
+	if (PickObject(x, y, hit))
+	{
+		m_selectedObject = m_app->m_drawableObjects[hit.instance];
+		m_selectedGroup = -1;
+	}
+	else
+	{
+		m_selectedObject = nullptr;
+	}
+}
+
+bool DXRRuntime::PickObject(int x, int y, PickHit& hit)
+{
+	XMMATRIX invView;
+	XMMATRIX invProj;
+	m_app->m_DXSetup->GetInverseCameraMatrices(invView, invProj);
+
+	// Through the middle of the pixel, the shader's mul(viewI, v) is XMVector4Transform(v, invView) over here.
+	float dx = ((x + 0.5f) / m_app->GetWidth()) * 2.0f - 1.0f;
+	float dy = ((y + 0.5f) / m_app->GetHeight()) * 2.0f - 1.0f;
+	XMVECTOR origin = XMVector4Transform(XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f), invView);
+	XMVECTOR target = XMVector4Transform(XMVectorSet(dx, -dy, 1.0f, 1.0f), invProj);
+	XMVECTOR direction = XMVector3Normalize(XMVector4Transform(XMVectorSetW(target, 0.0f), invView));
+
+	XMFLOAT3 rayOrigin;
+	XMFLOAT3 rayDirection;
+	XMStoreFloat3(&rayOrigin, origin);
+	XMStoreFloat3(&rayDirection, direction);
+
+	return m_app->m_picker.Pick(RayVec3(rayOrigin.x, rayOrigin.y, rayOrigin.z), RayVec3(rayDirection.x, rayDirection.y, rayDirection.z), hit,
+		INSTANCE_MASK_CAMERA);
+}
+
+void DXRRuntime::UpdateHover()
+{
+	m_hoveredObject = nullptr;
+
+	// Nothing gets hovered through a window, or while the mouse is off looking around.
+	if (m_mouseX < 0 || ImGui::GetIO().WantCaptureMouse)
+	{
+		return;
+	}
+
+	if (PickObject(m_mouseX, m_mouseY, m_hoveredHit))
+	{
+		m_hoveredObject = m_app->m_drawableObjects[m_hoveredHit.instance];
+	}
+}
+
+void DXRRuntime::UpdateInstanceCulling()
+{
+	PROFILE_CPU_SCOPE("UpdateInstanceCulling");
+
+	if (m_instanceCulling)
+	{
+		CullVolume volume;
+		m_app->m_DXSetup->GetCameraCullVolume(volume);
+		volume.maxDistance = m_cullDistance;
+		m_app->m_picker.Cull(volume, m_cullResults);
+	}
+
+	// Each band's bit for shadow and reflection rays, band 0 being the narrow cones that always see the full mesh.
+	const UINT shadowBands[MeshLod::kBandCount] = { INSTANCE_MASK_SHADOW, INSTANCE_MASK_SHADOW_LOD1, INSTANCE_MASK_SHADOW_LOD2 };
+	const UINT reflectionBands[MeshLod::kBandCount] = { INSTANCE_MASK_REFLECTION, INSTANCE_MASK_REFLECTION_LOD1, INSTANCE_MASK_REFLECTION_LOD2 };
+
+	UINT objectMask = INSTANCE_MASK_NONE;
+	uint32_t bandLevels[MeshLod::kBandCount] = {};
+	m_builtInstanceCount = 0;
+
+	for (size_t i = 0; i < m_app->m_instances.size(); i++)
+	{
+		const SceneInstance& instance = m_app->m_instances[i];
+		DrawableGameObject* object = m_app->m_drawableObjects[instance.object];
+
+		// An object's full mesh comes before its levels, so everything about the object is worked out there.
+		if (instance.lod == 0)
+		{
+			objectMask = object->m_instanceMask;
+
+			// Shadow and reflection rays can start anywhere, so the frustum only matters to the camera's.
+			if (m_instanceCulling)
+			{
+				if ((m_cullResults[instance.object] & ScenePicker::kInRange) == 0)
+				{
+					objectMask = INSTANCE_MASK_NONE;
+				}
+				else if ((m_cullResults[instance.object] & ScenePicker::kInFrustum) == 0)
+				{
+					objectMask &= ~INSTANCE_MASK_CAMERA;
+				}
+			}
+
+			// The picker gets the same mask, so the mouse can only pick what the camera can see.
+			m_app->m_picker.SetInstanceMask(instance.object, static_cast<uint8_t>(objectMask));
+
+			// The error's in object space, so it grows with the biggest of the world matrix's column lengths.
+			const float* world = m_app->m_transforms.GetWorld(instance.transformIndex);
+			float worldScale = 0.0f;
+			for (int column = 0; column < 3; column++)
+			{
+				worldScale = max(worldScale, sqrtf(world[column] * world[column] + world[4 + column] * world[4 + column] + world[8 + column] * world[8 + column]));
+			}
+
+			for (uint32_t band = 0; band < MeshLod::kBandCount; band++)
+			{
+				bandLevels[band] = m_meshLods ? MeshLod::SelectLevel(object->m_lodLevels, band, worldScale, m_lodErrorScale) : 0;
+			}
+		}
+
+		UINT mask = instance.lod == 0 ? objectMask & INSTANCE_MASK_CAMERA : INSTANCE_MASK_NONE;
+		for (uint32_t band = 0; band < MeshLod::kBandCount; band++)
+		{
+			if (bandLevels[band] == instance.lod)
+			{
+				mask |= (objectMask & INSTANCE_MASK_SHADOW) ? shadowBands[band] : INSTANCE_MASK_NONE;
+				mask |= (objectMask & INSTANCE_MASK_REFLECTION) ? reflectionBands[band] : INSTANCE_MASK_NONE;
+			}
+		}
+
+		m_app->m_instanceMasks[i] = mask;
+		m_builtInstanceCount += mask != INSTANCE_MASK_NONE ? 1 : 0;
+	}
 }
 #pragma endregion
 
 #pragma region IMGUI Methods
 void DXRRuntime::DrawIMGUI()
 {
+	PROFILE_CPU_SCOPE("ImGui");
+
 	// Start the Dear ImGui frame
 	ImGui_ImplDX12_NewFrame();
 	ImGui_ImplWin32_NewFrame();
@@ -293,6 +856,7 @@ void DXRRuntime::DrawIMGUI()
 		DrawPerformanceWindow();
 		DrawObjectSelectionWindow();
 		DrawObjectMovementWindow();
+		DrawGroupMovementWindow();
 		DrawCameraStatsWindow();
 		DrawObjectMaterialWindow();
 		DrawCameraSplineWindow();
@@ -304,6 +868,14 @@ void DXRRuntime::DrawIMGUI()
 	}
 
 	DrawHideAllWindows();
+
+	// Label whatever's under the mouse, next to the cursor.
+	if (m_hoveredObject != nullptr)
+	{
+		char label[256];
+		snprintf(label, sizeof(label), "%s (triangle %u, %.2f away)", m_hoveredObject->getObjectName().c_str(), m_hoveredHit.triangle, m_hoveredHit.t);
+		ImGui::GetForegroundDrawList()->AddText(ImVec2(m_mouseX + 16.0f, m_mouseY + 8.0f), IM_COL32(255, 255, 0, 255), label);
+	}
 }
 
 // Most of the UI is pretty self-explanatory, so I won't comment on it.
@@ -332,22 +904,303 @@ void DXRRuntime::DrawPerformanceWindow()
 	ImGui::PlotLines("FPS History", fpsHistory, std::size(fpsHistory), fpsIndex, "FPS",
 		0, 100, ImVec2(300, 100));
 	ImGui::Separator();
+
+	// Ray counts from the shaders, averaged over the last second or so of frames that have come back.
+	const RayRateTracker& rayRates = m_app->GetContext()->m_rayRates;
+	RayCounterSample latestRays = rayRates.GetLatest();
+	ImGui::Text("Rays Per Second: %.2f M", rayRates.GetTotalRaysPerSecond() / 1000000.0);
+	for (int type = 0; type < RAY_COUNTER_COUNT; type++)
+	{
+		ImGui::Text("  %s: %.2f M/s, %llu last frame", RayRateTracker::GetCounterName(static_cast<RayCounterType>(type)),
+			rayRates.GetRaysPerSecond(static_cast<RayCounterType>(type)) / 1000000.0, static_cast<unsigned long long>(latestRays.counts[type]));
+	}
+	ImGui::Separator();
+
+	// Instance culling, the objects nothing can see this frame are left out of the TLAS build.
+	ImGui::Checkbox("Instance Culling", &m_instanceCulling);
+	ImGui::SliderFloat("Cull Distance", &m_cullDistance, 1.0f, 1000.0f);
+	ImGui::Text("TLAS Instances: %u of %zu", m_builtInstanceCount, m_app->m_instances.size());
+
+	// Mesh LODs, the scale is how much of a cone's width the simplified mesh is allowed to be out by.
+	ImGui::Checkbox("Mesh LODs", &m_meshLods);
+	ImGui::SliderFloat("LOD Error Scale", &m_lodErrorScale, 0.1f, 4.0f);
+	MeshLodCache* meshLodCache = m_app->GetContext()->m_meshLodCache;
+	if (meshLodCache != nullptr)
+	{
+		const MeshLodCacheStats& stats = meshLodCache->GetStats();
+		ImGui::Text("Mesh Cache: %u hits, %u misses", stats.hits, stats.misses);
+		ImGui::Text("Optimise + Simplify Time: %.3f ms, Cache Load Time: %.3f ms", stats.totalBuildMilliseconds, stats.totalLoadMilliseconds);
+	}
+	ImGui::Separator();
+
+	// GPU timings, these come back a frame or two late since nothing waits for them.
+	D3D12GpuTimer* gpuTimer = m_app->GetContext()->m_gpuTimer;
+	const std::deque<GpuFrameResult>& gpuHistory = gpuTimer->GetTracker().GetHistory();
+	if (!gpuHistory.empty())
+	{
+		ImGui::Text("GPU Timings (frame %llu):", static_cast<unsigned long long>(gpuHistory.back().frame));
+		for (const GpuScopeResult& scope : gpuHistory.back().scopes)
+		{
+			ImGui::Text("  %*s%s: %.3f ms", static_cast<int>(scope.depth * 2), "", scope.name, gpuTimer->GetMilliseconds(scope));
+		}
+	}
+	ImGui::Text("GPU Frames Resolved: %llu, Dropped: %llu", static_cast<unsigned long long>(gpuTimer->GetTracker().GetStats().framesResolved),
+		static_cast<unsigned long long>(gpuTimer->GetTracker().GetStats().framesDropped));
+	ImGui::Separator();
+
+	// CPU profiler, the flame view is the newest frame the GPU timings are back for, so both line up.
+	// The overhead is what the CPU scopes it recorded cost against the frame time.
+	CpuProfiler& profiler = CpuProfiler::Get();
+	bool profilerEnabled = profiler.IsEnabled();
+	if (ImGui::Checkbox("CPU Profiler", &profilerEnabled))
+	{
+		profiler.SetEnabled(profilerEnabled);
+	}
+
+	if (profilerEnabled && profiler.GetFrameIndex() > 0)
+	{
+		uint64_t flameFrame = gpuHistory.empty() ? profiler.GetFrameIndex() - 1 : gpuHistory.back().frame;
+		std::vector<CpuProfileEvent> frameEvents = profiler.GetFrameEvents(flameFrame);
+
+		size_t cpuScopes = 0;
+		for (const CpuProfileEvent& event : frameEvents)
+		{
+			cpuScopes += event.threadIndex != gpuTimer->GetTrack() ? 1 : 0;
+		}
+
+		double overheadMs = cpuScopes * m_app->GetContext()->m_cpuScopeCostNs / 1000000.0;
+		ImGui::Text("Profiler Overhead: %.3f%% (%zu scopes at %.0f ns)", 100.0 * overheadMs / (1000.0 / currentFPS),
+			cpuScopes, m_app->GetContext()->m_cpuScopeCostNs);
+
+		DrawCpuFlameGraph(frameEvents);
+
+		if (ImGui::Button("Export Chrome Trace"))
+		{
+			profiler.WriteChromeTrace("ProfilerTrace.json");
+		}
+	}
+	ImGui::Separator();
+
+	// Frame pacing report, stalls are the frames where the CPU caught up with the GPU and had to wait.
+	FramePacer* framePacer = m_app->GetContext()->m_framePacer;
+	const FramePacerStats& pacerStats = framePacer->GetStats();
+	ImGui::Text("Frames In Flight: %u, Frame Slot: %u", framePacer->GetFramesInFlight(), framePacer->GetFrameIndex());
+	ImGui::Text("CPU Stalls: %llu of %llu frames, Flushes: %llu", static_cast<unsigned long long>(pacerStats.stalls),
+		static_cast<unsigned long long>(pacerStats.framesSubmitted), static_cast<unsigned long long>(pacerStats.flushes));
+	ImGui::Text("Retired Resources: %llu released, %zu pending", static_cast<unsigned long long>(pacerStats.retired), framePacer->GetPendingRetirements());
+	ImGui::Separator();
+
+	// Upload ring report, wasted bytes are the alignment padding and the bits skipped when it wraps.
+	DXRContext* context = m_app->GetContext();
+	const UploadRingStats& ringStats = context->m_uploadRingAllocator->GetStats();
+	ImGui::Text("Upload Ring: %.1f KB in use of %.1f KB, peak %.1f KB", context->m_uploadRingAllocator->GetBytesInUse() / 1024.0,
+		context->m_uploadRingAllocator->GetCapacity() / 1024.0, ringStats.peakBytesInUse / 1024.0);
+	ImGui::Text("Upload Ring Waste: %.2f%% of %.1f KB allocated", ringStats.bytesAllocated > 0 ? 100.0 * ringStats.bytesWasted / ringStats.bytesAllocated : 0.0,
+		ringStats.bytesAllocated / 1024.0);
+	ImGui::Text("Upload Ring Wraps: %llu, most skipped at once %.1f KB", static_cast<unsigned long long>(ringStats.wraps), ringStats.largestWrapWaste / 1024.0);
+	ImGui::Text("Upload Fallbacks: %llu (%.1f KB)", static_cast<unsigned long long>(context->m_uploadFallbacks), context->m_uploadFallbackBytes / 1024.0);
+	ImGui::Separator();
+
+	// BLAS memory report, saved is what compaction gave back compared to the worst case sizes the builds reserved.
+	if (context->m_blasPool != nullptr)
+	{
+		const HeapSuballocator& blasHeaps = context->m_blasPool->GetSuballocator();
+		ImGui::Text("BLAS Pool: %.1f KB used of %.1f KB in %u pages, %.0f%% fragmented", blasHeaps.GetStats().bytesAllocated / 1024.0,
+			blasHeaps.GetStats().bytesReserved / 1024.0, context->m_blasPool->GetPageCount(), 100.0 * blasHeaps.GetFragmentation());
+		ImGui::Text("BLAS Compaction: %.1f KB -> %.1f KB, saved %.1f KB", context->m_blasReport.GetReservedBytes() / 1024.0,
+			context->m_blasReport.GetFinalBytes() / 1024.0, context->m_blasReport.GetSavedBytes() / 1024.0);
+		ImGui::Text("BLAS Scratch Arena: %.1f KB, %u build batches", context->m_blasScratchSize / 1024.0, context->m_blasBuildBatches);
+
+		if (ImGui::TreeNode("BLAS Per Mesh"))
+		{
+			for (const BlasMemoryEntry& entry : context->m_blasReport.GetEntries())
+			{
+				ImGui::Text("%s: %.1f KB -> %.1f KB, %s", entry.name.c_str(), entry.reservedBytes / 1024.0, entry.finalBytes / 1024.0,
+					entry.policy.allowUpdate ? "fast build, refittable" : "fast trace, compacted");
+			}
+			ImGui::TreePop();
+		}
+		ImGui::Separator();
+	}
+
+	// Resource accounting, every long lived GPU allocation by category and by the object it belongs to.
+	const ResourceTracker& tracker = context->m_resourceTracker;
+	ImGui::Text("Tracked GPU Memory: %.1f KB in %zu allocations", tracker.GetTotalBytes() / 1024.0, tracker.GetResources().size());
+
+	if (ImGui::TreeNode("Memory By Category"))
+	{
+		for (int category = 0; category < RESOURCE_CATEGORY_COUNT; category++)
+		{
+			ImGui::Text("%s: %.1f KB", ResourceTracker::GetCategoryName(static_cast<ResourceCategory>(category)),
+				tracker.GetCategoryBytes(static_cast<ResourceCategory>(category)) / 1024.0);
+		}
+		ImGui::TreePop();
+	}
+
+	if (ImGui::TreeNode("Memory By Object"))
+	{
+		for (const string& owner : tracker.GetOwners())
+		{
+			if (ImGui::TreeNode(owner.c_str(), "%s: %.1f KB", owner.c_str(), tracker.GetOwnerBytes(owner) / 1024.0))
+			{
+				for (int category = 0; category < RESOURCE_CATEGORY_COUNT; category++)
+				{
+					uint64_t bytes = tracker.GetOwnerCategoryBytes(owner, static_cast<ResourceCategory>(category));
+					if (bytes > 0)
+					{
+						ImGui::Text("%s: %.1f KB", ResourceTracker::GetCategoryName(static_cast<ResourceCategory>(category)), bytes / 1024.0);
+					}
+				}
+				ImGui::TreePop();
+			}
+		}
+		ImGui::TreePop();
+	}
+
+	if (ImGui::Button("Dump Resources To JSON"))
+	{
+		tracker.WriteJson("ResourceReport.json");
+	}
+	ImGui::Separator();
+
+	// Shader cache report, a miss means DXC actually had to do some work.
+	ShaderCache* shaderCache = m_app->GetContext()->m_shaderCache;
+	if (shaderCache != nullptr)
+	{
+		const ShaderCacheStats& stats = shaderCache->GetStats();
+		ImGui::Text("Shader Cache: %u hits, %u misses", stats.hits, stats.misses);
+		ImGui::Text("Shader Compile Time: %.3f ms, Cache Load Time: %.3f ms", stats.totalCompileMilliseconds, stats.totalLoadMilliseconds);
+
+		for (const ShaderCacheRecord& record : shaderCache->GetRecords())
+		{
+			ImGui::Text("  %s %s: %s (%.3f ms)", record.fileName.c_str(), record.arguments.c_str(), record.hit ? "hit" : "compiled",
+				record.milliseconds);
+		}
+		ImGui::Separator();
+	}
+
+	// Hit shader variant report, how many of the possible variants this scene actually needs.
+	std::map<UINT, int> variantUsage;
+	for (DrawableGameObject* dgo : m_app->m_drawableObjects)
+	{
+		variantUsage[dgo->m_hitShaderFeatures]++;
+	}
+
+	ImGui::Checkbox("Use Hit Shader Variants", &m_app->m_DXSetup->m_useHitPermutations);
+	ImGui::Text("Hit Shader Variants: %zu needed of %u possible, %zu compiled", variantUsage.size(), HIT_FEATURE_ALL + 1,
+		m_app->GetContext()->m_hitPermutationLibraries.size());
+
+	for (auto& variant : variantUsage)
+	{
+		// R = reflection, O = tri outline, T = texture, S = shadows
+		string featureNames;
+		featureNames += (variant.first & HIT_FEATURE_REFLECTION) ? "R" : "-";
+		featureNames += (variant.first & HIT_FEATURE_TRI_OUTLINE) ? "O" : "-";
+		featureNames += (variant.first & HIT_FEATURE_TEXTURE) ? "T" : "-";
+		featureNames += (variant.first & HIT_FEATURE_SHADOWS) ? "S" : "-";
+		ImGui::Text("  Variant %2u [%s]: %i object(s)", variant.first, featureNames.c_str(), variant.second);
+	}
+	ImGui::Separator();
 	ImGui::End();
 }
 
+void DXRRuntime::DrawCpuFlameGraph(const std::vector<CpuProfileEvent>& events)
+{
+	if (events.empty())
+	{
+		ImGui::Text("No scopes recorded yet");
+		return;
+	}
+
+	const float graphWidth = 300.0f;
+	const float rowHeight = 18.0f;
+
+	// The frame is whatever the scopes covered, so the outermost ones fill the width.
+	// Each track (thread, or the GPU) gets as many rows as it nests deep, stacked in track order.
+	uint64_t frameStart = events.front().startNs;
+	uint64_t frameEnd = 0;
+	std::map<uint32_t, uint32_t> trackDepths;
+	for (const CpuProfileEvent& event : events)
+	{
+		frameStart = min(frameStart, event.startNs);
+		frameEnd = max(frameEnd, event.endNs);
+		trackDepths[event.threadIndex] = max(trackDepths[event.threadIndex], event.depth + 1);
+	}
+	double frameSpan = static_cast<double>(max(frameEnd - frameStart, 1ull));
+
+	std::map<uint32_t, uint32_t> trackRows;
+	uint32_t totalRows = 0;
+	for (auto& track : trackDepths)
+	{
+		trackRows[track.first] = totalRows;
+		totalRows += track.second;
+	}
+
+	ImDrawList* drawList = ImGui::GetWindowDrawList();
+	ImVec2 origin = ImGui::GetCursorScreenPos();
+	ImVec2 mouse = ImGui::GetIO().MousePos;
+	const CpuProfileEvent* hovered = nullptr;
+
+	for (const CpuProfileEvent& event : events)
+	{
+		float x0 = origin.x + static_cast<float>((event.startNs - frameStart) / frameSpan) * graphWidth;
+		float x1 = origin.x + static_cast<float>((event.endNs - frameStart) / frameSpan) * graphWidth;
+		float y0 = origin.y + (trackRows[event.threadIndex] + event.depth) * rowHeight;
+		float y1 = y0 + rowHeight - 1.0f;
+		x1 = max(x1, x0 + 1.0f);
+
+		// Deeper scopes get warmer, so nesting is easy to follow. Each track starts from its own hue.
+		ImU32 colour = ImColor::HSV(0.6f - 0.12f * (event.depth % 5) + 0.3f * (event.threadIndex % 2), 0.6f, 0.8f);
+		drawList->AddRectFilled(ImVec2(x0, y0), ImVec2(x1, y1), colour);
+
+		if (x1 - x0 > 40.0f)
+		{
+			drawList->PushClipRect(ImVec2(x0, y0), ImVec2(x1, y1), true);
+			drawList->AddText(ImVec2(x0 + 2.0f, y0 + 2.0f), IM_COL32(255, 255, 255, 255), event.name);
+			drawList->PopClipRect();
+		}
+
+		if (mouse.x >= x0 && mouse.x < x1 && mouse.y >= y0 && mouse.y < y1)
+		{
+			hovered = &event;
+		}
+	}
+
+	ImGui::Dummy(ImVec2(graphWidth, totalRows * rowHeight));
+
+	if (hovered != nullptr)
+	{
+		ImGui::SetTooltip("%s: %.3f ms", hovered->name, (hovered->endNs - hovered->startNs) / 1000000.0);
+	}
+}
+
 void DXRRuntime::DrawObjectSelectionWindow()
 {
 	ImGui::SetNextWindowPos(ImVec2(10, 80), ImGuiCond_FirstUseEver);
 	ImGui::Begin("Object Selection", nullptr, ImGuiWindowFlags_AlwaysAutoResize);
 
-	ImGui::Text("Choose an object to select!");
+	ImGui::Text("Choose an object to select, or click on it!");
 	ImGui::Separator();
 
 	for (DrawableGameObject* dgo : m_app->m_drawableObjects)
 	{
 		bool isSelected = (m_selectedObject == dgo);
 
-		if (ImGui::Selectable(dgo->getObjectName().c_str(), isSelected))
+		// The one under the mouse stands out, so it's easy to tell which is which.
+		bool isHovered = (m_hoveredObject == dgo);
+		if (isHovered)
+		{
+			ImGui::PushStyleColor(ImGuiCol_Text, IM_COL32(255, 255, 0, 255));
+		}
+
+		bool clicked = ImGui::Selectable(dgo->getObjectName().c_str(), isSelected);
+
+		if (isHovered)
+		{
+			ImGui::PopStyleColor();
+		}
+
+		if (clicked)
 		{
 			if (isSelected)
 			{
@@ -356,6 +1209,28 @@ void DXRRuntime::DrawObjectSelectionWindow()
 			else
 			{
 				m_selectedObject = dgo;
+				m_selectedGroup = -1;
+			}
+		}
+	}
+
+	ImGui::Separator();
+	ImGui::Text("Or a group, to move everything in it:");
+
+	for (int i = 0; i < m_app->m_sceneGroups.size(); i++)
+	{
+		bool isSelected = (m_selectedGroup == i);
+
+		if (ImGui::Selectable(m_app->m_sceneGroups[i].name.c_str(), isSelected))
+		{
+			if (isSelected)
+			{
+				m_selectedGroup = -1;
+			}
+			else
+			{
+				m_selectedGroup = i;
+				m_selectedObject = nullptr;
 			}
 		}
 	}
@@ -397,19 +1272,103 @@ void DXRRuntime::DrawObjectMovementWindow()
 
 		ImGui::Text("Auto Rotate:");
 
-		ImGui::SliderFloat("Rotation Speed", &m_selectedObject->m_autoRotationSpeed, 0.0f, 360.0f);
+		float rotationSpeed = m_selectedObject->getAutoRotationSpeed();
+		if (ImGui::SliderFloat("Rotation Speed", &rotationSpeed, 0.0f, 360.0f))
+		{
+			m_selectedObject->setAutoRotationSpeed(rotationSpeed);
+		}
+
+		const char* autoRotateLabels[] = { "Auto Rotate (X+)", "Auto Rotate (Y+)", "Auto Rotate (Z+)" };
+		for (int axis = 0; axis < 3; axis++)
+		{
+			bool autoRotate = m_selectedObject->getAutoRotate(axis);
+			if (ImGui::Checkbox(autoRotateLabels[axis], &autoRotate))
+			{
+				m_selectedObject->setAutoRotate(axis, autoRotate);
+			}
+		}
+
+		ImGui::Separator();
+
+		if (ImGui::Button("Reset Transform"))
+		{
+			m_selectedObject->resetTransform();
+		}
+
+		ImGui::End();
+	}
+}
+
+void DXRRuntime::DrawGroupMovementWindow()
+{
+	if (m_selectedGroup != -1)
+	{
+		const SceneGroup& group = m_app->m_sceneGroups[m_selectedGroup];
+		TransformBatch& transforms = m_app->m_transforms;
+
+		ImGui::SetNextWindowPos(ImVec2(10, 280), ImGuiCond_FirstUseEver);
+		ImGui::Begin("Group Movement Window", nullptr, ImGuiWindowFlags_AlwaysAutoResize);
+
+		ImGui::Text("Manipulate the selected group:");
+		ImGui::Text("Selected Group: %s", group.name.c_str());
+
+		// Everything parented to the group, the objects' own transforms are relative to it.
+		for (DrawableGameObject* dgo : m_app->m_drawableObjects)
+		{
+			if (transforms.GetParent(dgo->getTransformIndex()) == group.transformIndex)
+			{
+				ImGui::BulletText("%s", dgo->getObjectName().c_str());
+			}
+		}
+		ImGui::Separator();
+
+		TransformVec3 position = transforms.GetPosition(group.transformIndex);
+		if (ImGui::DragFloat3("Position", &position.x, 0.005f))
+		{
+			transforms.SetPosition(group.transformIndex, position);
+		}
+
+		TransformVec3 rotation = transforms.GetRotation(group.transformIndex);
+		if (ImGui::DragFloat3("Rotation", &rotation.x, 0.5f, -361, 361))
+		{
+			transforms.SetRotation(group.transformIndex, rotation);
+		}
 
-		ImGui::Checkbox("Auto Rotate (X+)", &m_selectedObject->m_autoRotateX);
+		TransformVec3 scale = transforms.GetScale(group.transformIndex);
+		if (ImGui::DragFloat3("Scale", &scale.x, 0.01f, -INFINITY, INFINITY))
+		{
+			transforms.SetScale(group.transformIndex, scale);
+		}
 
-		ImGui::Checkbox("Auto Rotate (Y+)", &m_selectedObject->m_autoRotateY);
+		ImGui::Text("(Drag the box or enter a number)");
+		ImGui::Separator();
+
+		ImGui::Text("Auto Rotate:");
+
+		float rotationSpeed = transforms.GetAutoRotationSpeed(group.transformIndex);
+		if (ImGui::SliderFloat("Rotation Speed", &rotationSpeed, 0.0f, 360.0f))
+		{
+			transforms.SetAutoRotationSpeed(group.transformIndex, rotationSpeed);
+		}
 
-		ImGui::Checkbox("Auto Rotate (Z+)", &m_selectedObject->m_autoRotateZ);
+		const char* autoRotateLabels[] = { "Auto Rotate (X+)", "Auto Rotate (Y+)", "Auto Rotate (Z+)" };
+		for (int axis = 0; axis < 3; axis++)
+		{
+			bool autoRotate = transforms.GetAutoRotate(group.transformIndex, axis);
+			if (ImGui::Checkbox(autoRotateLabels[axis], &autoRotate))
+			{
+				transforms.SetAutoRotate(group.transformIndex, axis, autoRotate);
+			}
+		}
 
 		ImGui::Separator();
 
+		// Groups start at the origin, so that's where they go back to.
 		if (ImGui::Button("Reset Transform"))
 		{
-			m_selectedObject->resetTransform();
+			transforms.SetPosition(group.transformIndex, TransformVec3(0.0f, 0.0f, 0.0f));
+			transforms.SetRotation(group.transformIndex, TransformVec3(0.0f, 0.0f, 0.0f));
+			transforms.SetScale(group.transformIndex, TransformVec3(1.0f, 1.0f, 1.0f));
 		}
 
 		ImGui::End();
@@ -478,6 +1437,36 @@ void DXRRuntime::DrawObjectMaterialWindow()
 		ImGui::SliderFloat("Roughness", &m_selectedObject->m_materialBufferData.roughness, 0.0f, 0.2f);
 		ImGui::Separator();
 
+		ImGui::Text("Choose which rays can hit the object:");
+		ImGui::CheckboxFlags("Visible To Camera", &m_selectedObject->m_instanceMask, INSTANCE_MASK_CAMERA);
+		ImGui::CheckboxFlags("Casts Shadows", &m_selectedObject->m_instanceMask, INSTANCE_MASK_SHADOW);
+		ImGui::CheckboxFlags("Visible In Reflections", &m_selectedObject->m_instanceMask, INSTANCE_MASK_REFLECTION);
+		ImGui::Separator();
+
+		// The levels wide shadow and reflection cones can see instead of the full mesh.
+		if (!m_selectedObject->m_lodLevels.empty())
+		{
+			ImGui::Text("LOD 0: %u triangles", m_selectedObject->getIndexCount() / 3);
+			for (size_t level = 0; level < m_selectedObject->m_lodLevels.size(); level++)
+			{
+				const MeshLodLevel& lod = m_selectedObject->m_lodLevels[level];
+				ImGui::Text("LOD %zu: %zu triangles, error %.4f", level + 1, lod.indices.size() / 3, lod.error);
+			}
+			ImGui::Separator();
+		}
+
+		// What the mesh optimiser did for it, against a 16 entry FIFO and 64 byte lines.
+		if (m_selectedObject->m_optimisedLocality.acmr > 0.0f)
+		{
+			const MeshLocality& loaded = m_selectedObject->m_loadedLocality;
+			const MeshLocality& optimised = m_selectedObject->m_optimisedLocality;
+			ImGui::Text("ACMR: %.3f -> %.3f", loaded.acmr, optimised.acmr);
+			ImGui::Text("ATVR: %.3f -> %.3f", loaded.atvr, optimised.atvr);
+			ImGui::Text("Overfetch: %.3f -> %.3f", loaded.overfetch, optimised.overfetch);
+			ImGui::Text("Bytes / Triangle: %.1f -> %.1f", loaded.bytesPerTriangle, optimised.bytesPerTriangle);
+			ImGui::Separator();
+		}
+
 		ImGui::End();
 	}
 }
@@ -488,38 +1477,112 @@ void DXRRuntime::DrawCameraSplineWindow()
 	ImGui::Begin("Camera Spline Animation", nullptr, ImGuiWindowFlags_AlwaysAutoResize);
 
 	ImGui::Checkbox("Start / Stop Camera Animation", &m_playCameraSplineAnimation);
+	ImGui::Checkbox("Face Along Path", &m_faceAlongCameraPath);
+	ImGui::Separator();
+
+	// Named paths, each one keeps its own arc length table so switching between them is free.
+	if (ImGui::BeginCombo("Camera Path", m_currentCameraPath.c_str()))
+	{
+		for (const string& name : m_cameraPaths.GetNames())
+		{
+			if (ImGui::Selectable(name.c_str(), name == m_currentCameraPath))
+			{
+				m_currentCameraPath = name;
+				m_splineStateValid = false;
+			}
+		}
+		ImGui::EndCombo();
+	}
+
+	CameraSpline* cameraPath = m_cameraPaths.FindPath(m_currentCameraPath);
+
+	if (ImGui::Button("New Path") && cameraPath != nullptr)
+	{
+		string name = "Path " + to_string(m_cameraPaths.GetPathCount());
+		while (m_cameraPaths.FindPath(name) != nullptr) name += "+";
+
+		cameraPath = &m_cameraPaths.AddPath(name, cameraPath->GetControlPoints());
+		m_currentCameraPath = name;
+	}
+	ImGui::SameLine();
+	if (ImGui::Button("Delete Path") && m_cameraPaths.GetPathCount() > 1)
+	{
+		m_cameraPaths.RemovePath(m_currentCameraPath);
+		m_currentCameraPath = m_cameraPaths.GetNames().front();
+		m_splineStateValid = false;
+		cameraPath = m_cameraPaths.FindPath(m_currentCameraPath);
+	}
+
+	ImGui::Text("Length: %.2f, %zu sections, %zu table entries", cameraPath->GetLength(), cameraPath->GetSectionCount(), cameraPath->GetTableSize());
 	ImGui::Separator();
 	ImGui::SliderFloat("Animation Duration", &m_totalSplineAnimation, 1.0f, 10.0f);
 	ImGui::SliderFloat("Current Animation Time", &m_app->GetContext()->m_pCamera->m_splineTransition, 0.0f, 0.98f);
 	ImGui::Separator();
+
+	// Edit a copy and only hand it back when something changed, since that rebuilds the table.
+	std::vector<SplineVec3> controlPoints = cameraPath->GetControlPoints();
+	bool pointsChanged = false;
+
 	if (ImGui::Button("Add Point"))
 	{
-		if (m_controlPoints.size() < 10) m_controlPoints.push_back(XMVectorSet(0.0f, 0.0f, 0.0f, 0.0f));
+		if (controlPoints.size() < 64)
+		{
+			controlPoints.push_back(controlPoints.back());
+			pointsChanged = true;
+		}
 	}
 
 	if (ImGui::Button("Remove Point"))
 	{
-		if (m_controlPoints.size() > 4) m_controlPoints.erase(m_controlPoints.end() - 1);
+		if (controlPoints.size() > 4)
+		{
+			controlPoints.erase(controlPoints.end() - 1);
+			pointsChanged = true;
+		}
 	}
 
 	// Okay, IMGUI is pretty cool
-	for (size_t i = 0; i < m_controlPoints.size(); i++)
+	for (size_t i = 0; i < controlPoints.size(); i++)
 	{
-		XMFLOAT3 point;
-		XMStoreFloat3(&point, m_controlPoints[i]);
-
 		string pointName = "Spline Point " + to_string(i);
 
 		if (i == 0) pointName = "Initial Velocity";
 
-		if (i == m_controlPoints.size() - 1) pointName = "Final Velocity";
+		if (i == controlPoints.size() - 1) pointName = "Final Velocity";
 
-		if (ImGui::DragFloat3(pointName.c_str(), reinterpret_cast<float*>(&point), 0.1f))
+		if (ImGui::DragFloat3(pointName.c_str(), &controlPoints[i].x, 0.1f))
 		{
-			m_controlPoints[i] = XMLoadFloat3(&point);
+			pointsChanged = true;
 		}
 	}
+
+	if (pointsChanged)
+	{
+		cameraPath->SetControlPoints(controlPoints);
+	}
 	ImGui::Text("(Drag the box or enter a number)");
+	ImGui::Separator();
+
+	// Benchmark, plays the spline from the start with fixed steps and vsync off, then writes Benchmark.csv.
+	ImGui::SliderInt("Benchmark Frames", &m_benchmarkFrames, 60, 5000);
+	ImGui::SliderInt("Warmup Frames", &m_benchmarkWarmupFrames, 0, 300);
+	if (!m_benchmark.IsRunning())
+	{
+		if (ImGui::Button("Run Benchmark"))
+		{
+			StartBenchmark();
+		}
+	}
+	else
+	{
+		ImGui::Text("%s %zu / %zu", m_benchmark.IsWarmingUp() ? "Warming up..." : "Measuring...", m_benchmark.GetFrames().size(),
+			m_benchmark.GetFrameCount());
+		if (ImGui::Button("Stop Benchmark"))
+		{
+			FinishBenchmark();
+		}
+	}
+	ImGui::TextWrapped("%s", m_benchmarkStatus.c_str());
 
 	ImGui::End();
 }
@@ -687,7 +1750,7 @@ void DXRRuntime::DrawTextureWindow()
 								m_selectedObject->m_textureFile = m_app->m_DXSetup->m_textures[i].first;
 								m_selectedObject->m_heapTextureNumber = m_app->m_DXSetup->m_textures[i].second;
 								m_selectedObject->m_texture = true;
-								m_app->m_DXSetup->UpdateShaderBindingTable();
+								// No SBT rebuild needed, the new texture index goes through the material table on the next update.
 							}
 						}
 					}
@@ -699,7 +1762,6 @@ void DXRRuntime::DrawTextureWindow()
 					m_selectedObject->m_textureFile = L"NULL";
 					m_selectedObject->m_heapTextureNumber = -1;
 					m_selectedObject->m_texture = false;
-					m_app->m_DXSetup->UpdateShaderBindingTable();
 				}
 			}
 		}
@@ -744,6 +1806,8 @@ void DXRRuntime::DrawSamplerWindow()
 			{
 				m_app->m_DXSetup->m_samplerType = static_cast<SamplerType>(i);
 				m_app->m_DXSetup->UpdateRaytracingPipeline();
+				// New state object means new shader identifiers, so the SBT has to be written again.
+				m_app->m_DXSetup->UpdateShaderBindingTable();
 			}
 		}
 		ImGui::EndCombo();
@@ -764,6 +1828,26 @@ void DXRRuntime::DrawVersionWindow()
 	ImGui::Text("ImGUI version: (%s)", IMGUI_VERSION);
 	ImGui::Text("Application Runtime (%f)", m_totalTime);
 
+	// Frame clock, the frame time is off the high resolution clock so it's good well under a millisecond.
+	int clockMode = m_frameClock.GetMode();
+	if (ImGui::Combo("Clock Mode", &clockMode, [](void*, int index)
+		{
+			return FrameClock::GetModeName(static_cast<FrameClockMode>(index));
+		}, nullptr, FRAME_CLOCK_MODE_COUNT))
+	{
+		m_frameClock.SetMode(static_cast<FrameClockMode>(clockMode));
+	}
+
+	float fixedStepHz = static_cast<float>(1.0 / m_frameClock.GetFixedStep());
+	if (ImGui::SliderFloat("Simulation Rate (Hz)", &fixedStepHz, 10.0f, 240.0f, "%.0f"))
+	{
+		m_frameClock.SetFixedStep(1.0 / fixedStepHz);
+	}
+
+	ImGui::Text("Frame Time: %.3f ms", m_frameClock.GetRealDeltaSeconds() * 1000.0);
+	ImGui::Text("Simulation Time: %.3f s (%u steps this frame)", m_frameClock.GetSimulationTime(), m_frameClock.GetSimulationSteps());
+	ImGui::Text("Dropped Steps: %llu", static_cast<unsigned long long>(m_frameClock.GetDroppedSteps()));
+
 	ImGui::End();
 }
 
@@ -5,6 +5,10 @@
 #include <map>
 #include <unordered_map>
 #include "DXRApp.h"
+#include "CpuProfiler.h"
+#include "FrameClock.h"
+#include "BenchmarkRecorder.h"
+#include "TileProtocol.h"
 #pragma endregion
 
 /// <summary>
@@ -20,15 +24,36 @@ private:
 	string m_windowName;
 	float m_currentDeltaTime;
 	float m_totalTime = 0.0f;
+	FrameClock m_frameClock;
+	XMFLOAT3 m_previousSplinePosition = {};
+	XMFLOAT3 m_currentSplinePosition = {};
+	bool m_splineStateValid = false;
+	BenchmarkRecorder m_benchmark;
+	int m_benchmarkFrames = 600;
+	int m_benchmarkWarmupFrames = 30;
+	uint64_t m_benchmarkRaysSeen = 0;
+	FrameClockMode m_preBenchmarkClockMode = FRAME_CLOCK_VARIABLE;
+	bool m_preBenchmarkSpline = false;
+	string m_benchmarkStatus;
+	bool m_skipFrame = false; // Nothing to render this time round, a tile coordinator or a worker waiting on tiles
+	TileMessage m_tileJob; // The tile a worker's rendering this frame
 	DrawableGameObject* m_selectedObject = nullptr;
+	int m_selectedGroup = -1; // Which of the scene groups is selected, -1 for none. Only one of this or the object is ever set
+	DrawableGameObject* m_hoveredObject = nullptr; // Whatever's under the mouse
+	PickHit m_hoveredHit;
+	int m_mouseX = -1; // In the window, -1 until the mouse has been over it
+	int m_mouseY = -1;
+	bool m_instanceCulling = true; // Leave instances that can't be seen out of the TLAS
+	float m_cullDistance = 1000.0f; // Nothing further from the camera than this goes in the TLAS, same as the far plane
+	std::vector<uint8_t> m_cullResults; // What the last cull said about each instance, kept so it isn't allocated every frame
+	UINT m_builtInstanceCount = 0; // How many instances went into this frame's TLAS
+	bool m_meshLods = true; // Let wide shadow and reflection cones see the coarser LOD levels
+	float m_lodErrorScale = 1.0f; // How much LOD error a cone can hide, as a fraction of its width
 	bool m_playCameraSplineAnimation = false;
 	float m_totalSplineAnimation = 3.0f;
-	std::vector<XMVECTOR> m_controlPoints = {
-		XMVectorSet(0.0f, 0.0f, 0.0f, 0.0f),  // Initial velocity
-		XMVectorSet(0.0f,  0.0f, 5.0f, 0.0f),
-		XMVectorSet(1.0f,  0.0f, 5.0f, 0.0f),
-		XMVectorSet(0.0f, 0.0f, 0.0f, 0.0f)   // Final velocity
-	};
+	bool m_faceAlongCameraPath = false;
+	CameraPathLibrary m_cameraPaths;
+	string m_currentCameraPath = "Default";
 	float m_rayXWidth = 1;
 	float m_rayYWidth = 1;
 	float m_cameraMoveSpeed = 2.0f;
@@ -42,6 +67,55 @@ private:
 	/// </summary>
 	void PopulateCommandList();
 
+	/// <summary>
+	/// Starts the camera spline benchmark, from the start of the spline in the benchmark clock mode.
+	/// </summary>
+	void StartBenchmark();
+
+	/// <summary>
+	/// Ends the benchmark, puts the clock and spline back how they were and writes Benchmark.csv.
+	/// </summary>
+	void FinishBenchmark();
+
+public:
+	/// <summary>
+	/// Starts a -render run, the camera follows the path from one end to the other over the frames and each one is written out.
+	/// With -distribute the frames are split into tiles and rendered by worker processes instead.
+	/// </summary>
+	void StartOfflineRender();
+
+	/// <summary>
+	/// Connects to a tile coordinator and renders the tiles it sends, until it says to stop.
+	/// </summary>
+	void StartTileWorker();
+
+	/// <summary>
+	/// Starts a -golden run, renders each test pose and compares it against its golden image.
+	/// </summary>
+	void StartGoldenTests();
+
+private:
+	/// <summary>
+	/// Picks the -path camera path and puts the camera and clock in the same place every offline run starts from.
+	/// </summary>
+	void PrepareOfflineCamera();
+
+	/// <summary>
+	/// Waits for the last images, writes the timings and quits.
+	/// </summary>
+	void FinishOfflineRender();
+
+	/// <summary>
+	/// Runs the coordinator, or a worker that has no tile yet, for a frame.
+	/// </summary>
+	/// <returns>True if there's nothing to render this frame.</returns>
+	bool UpdateTileNetwork();
+
+	/// <summary>
+	/// Writes the golden results and quits, with a non zero exit code if anything failed.
+	/// </summary>
+	void FinishGoldenTests();
+
 public:
 
 	/// <summary>
@@ -90,6 +164,53 @@ public:
 	// I dont know why I pass the pointer to the context here, I was a young boy okay.
 	void KeyInputs(DXRContext* context);
 
+	/// <summary>
+	/// Handles the mouse moving over the window, works out what's under it for the hover label.
+	/// </summary>
+	/// <param name="x">The x-coordinate of the mouse, in the window.</param>
+	/// <param name="y">The y-coordinate of the mouse, in the window.</param>
+	void OnMouseMove(int x, int y);
+
+	/// <summary>
+	/// Handles the right button starting or stopping mouse look. The cursor's hidden and pinned to the middle while looking,
+	/// so nothing's under it and the hover goes until it moves again.
+	/// </summary>
+	/// <param name="looking">True when mouse look starts.</param>
+	void OnMouseLook(bool looking);
+
+	/// <summary>
+	/// Handles the mouse leaving the window, there's nothing under it to hover over.
+	/// </summary>
+	void OnMouseLeave();
+
+	/// <summary>
+	/// Handles left clicks, selects whatever's under the mouse or deselects if it's nothing.
+	/// </summary>
+	/// <param name="x">The x-coordinate of the mouse, in the window.</param>
+	/// <param name="y">The y-coordinate of the mouse, in the window.</param>
+	void OnMouseClick(int x, int y);
+
+	/// <summary>
+	/// Casts a ray from the camera through a pixel, the same way RayGen.hlsl does, against the CPU copy of the scene.
+	/// </summary>
+	/// <param name="x">The pixel's x-coordinate.</param>
+	/// <param name="y">The pixel's y-coordinate.</param>
+	/// <param name="hit">The object (its index in m_drawableObjects), triangle, barycentrics and distance.</param>
+	/// <returns>False if there's nothing there.</returns>
+	bool PickObject(int x, int y, PickHit& hit);
+
+	/// <summary>
+	/// Picks under the mouse again, for when the objects or the camera have moved and the mouse hasn't.
+	/// </summary>
+	void UpdateHover();
+
+	/// <summary>
+	/// Works out this frame's TLAS mask for each instance from its object's mask. Instances out of range are left out, and ones
+	/// out of the frustum lose the camera bit, which leaves them out as well if nothing else could see them. Each of an
+	/// object's shadow and reflection bands goes to the LOD level it should see, and only the full mesh keeps the camera bit.
+	/// </summary>
+	void UpdateInstanceCulling();
+
 #pragma endregion
 
 #pragma region IMGUI Methods
@@ -111,6 +232,12 @@ public:
 	/// </summary>
 	void DrawPerformanceWindow();
 
+	/// <summary>
+	/// Draws a flame view of one frame's profiler scopes, the CPU threads and the GPU each on their own rows.
+	/// </summary>
+	/// <param name="events">The frame's scopes, sorted by start time.</param>
+	void DrawCpuFlameGraph(const std::vector<CpuProfileEvent>& events);
+
 	/// <summary>
 	/// Draws the object selection window.
 	/// </summary>
@@ -121,6 +248,11 @@ public:
 	/// </summary>
 	void DrawObjectMovementWindow();
 
+	/// <summary>
+	/// Draws the group movement window.
+	/// </summary>
+	void DrawGroupMovementWindow();
+
 	/// <summary>
 	/// Draws the camera statistics window.
 	/// </summary>
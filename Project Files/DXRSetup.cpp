@@ -34,6 +34,12 @@ void DXRSetup::initialise()
 	// Check the raytracing capabilities of the device
 	CheckRaytracingSupport();
 
+	// Optimise the loaded meshes and simplify the big ones (or load what they came out as last time), their LOD levels go in the pools too.
+	BuildMeshCache();
+
+	// Pack all the meshes into the global vertex / index pools, the BLAS builds and the hit shaders both read from these.
+	CreateGeometryPools();
+
 	// Setup the acceleration structures (AS) for raytracing. When setting up
 	// geometry, each bottom-level AS has its own transform matrix.
 	CreateAccelerationStructures();
@@ -55,6 +61,7 @@ void DXRSetup::initialise()
 	CreateCamera();
 	CreateLightingBuffer();
 	CreateMaterialBuffers();
+	CreateRayCounterBuffers();
 
 	// Create the buffer containing the raytracing result (always output in a
 	// UAV), and create the heap referencing the resources used by the raytracing,
@@ -65,6 +72,18 @@ void DXRSetup::initialise()
 	// are invoked for each instance in the  AS
 	CreateShaderBindingTable();
 
+	// Everything's been allocated by now, so dump the accounting if it was asked for, and every BLAS's sizes for the kernel
+	// benchmark to replay. It's meant for scripts, so there's nothing to stay open for afterwards.
+	if (m_app->GetDumpResources())
+	{
+		m_app->GetContext()->m_resourceTracker.WriteJson("ResourceReport.json");
+		m_app->GetContext()->m_blasReport.WriteCsv("BlasTrace.csv");
+		PostQuitMessage(0);
+	}
+
+	// Time the profiler against itself before the first frame, so the overhead it reports is measured rather than guessed.
+	m_app->GetContext()->m_cpuScopeCostNs = CpuProfiler::Get().MeasureScopeCostNs(10000);
+
 	SetupIMGUI();
 }
 
@@ -206,8 +225,33 @@ void DXRSetup::LoadPipeline()
 		}
 	}
 
-	ThrowIfFailed(m_device->CreateCommandAllocator(
-		D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&context->m_commandAllocator)));
+	// One allocator per frame in flight, so recording the next frame doesn't have to wait for the last one.
+	for (UINT n = 0; n < FrameCount; n++) {
+		ThrowIfFailed(m_device->CreateCommandAllocator(
+			D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&context->m_commandAllocators[n])));
+	}
+
+	// Create synchronization objects, they're needed before the first upload.
+	{
+		ThrowIfFailed(m_device->CreateFence(0, D3D12_FENCE_FLAG_NONE,
+			IID_PPV_ARGS(&context->m_fence)));
+
+		// Create an event handle to use for frame synchronization.
+		context->m_fenceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+		if (context->m_fenceEvent == nullptr) {
+			ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
+		}
+
+		// The frame pacer owns the fence values from here on.
+		context->m_frameQueue = new D3D12FrameQueue(context->m_commandQueue, context->m_fence, context->m_fenceEvent);
+		context->m_framePacer = new FramePacer(context->m_frameQueue, FrameCount);
+
+		// Timestamps ride on the same fence, a frame's results are read once the pacer's fence says it's done.
+		context->m_gpuTimer = new D3D12GpuTimer(m_device, context->m_commandQueue, context->m_frameQueue, FrameCount, 16);
+	}
+
+	// Textures and meshes are staged through the upload ring, so it has to exist before the assets are loaded.
+	CreateUploadRing();
 }
 #pragma endregion
 
@@ -224,27 +268,30 @@ void DXRSetup::CreateCamera()
 	// Init the camera with the default values
 	context->m_pCamera = new Camera(XMFLOAT3(0, 0, 5), XMFLOAT3(0, 0, -1.0f), XMFLOAT3(0, 1, 0));
 
+	// The constants now come in through the upload ring, see CopyFrameConstants.
 	context->m_cameraBuffer = nv_helpers_dx12::CreateBuffer(
 		m_device.Get(), context->m_cameraBufferSize, D3D12_RESOURCE_FLAG_NONE,
-		D3D12_RESOURCE_STATE_GENERIC_READ, nv_helpers_dx12::kUploadHeapProps);
+		D3D12_RESOURCE_STATE_COMMON, nv_helpers_dx12::kDefaultHeapProps);
 }
 
 void DXRSetup::UpdateCamera(float rX, float rY)
 {
-	DXRContext* context = m_app->GetContext();
-
-	XMMATRIX view = context->m_pCamera->GetViewMatrix();
+	PROFILE_CPU_SCOPE("UpdateCamera");
 
-	XMMATRIX perspective = XMMatrixPerspectiveFovLH(m_fovAngleY, m_app->GetAspectRatio(), 0.1f, 1000.0f);
+	DXRContext* context = m_app->GetContext();
 
-	XMMATRIX invView = XMMatrixInverse(nullptr, view);
-	XMMATRIX invProj = XMMatrixInverse(nullptr, perspective);
+	XMMATRIX invView;
+	XMMATRIX invProj;
+	GetInverseCameraMatrices(invView, invProj);
 
 	CameraBuffer cb;
 	cb.invView = invView;
 	cb.invProj = invProj;
 	cb.rX = rX;
 	cb.rY = rY;
+	cb.tileOffset = XMFLOAT2(static_cast<float>(context->m_renderTile.x), static_cast<float>(context->m_renderTile.y));
+	cb.frameSize = XMFLOAT2(static_cast<float>(m_app->GetWidth()), static_cast<float>(m_app->GetHeight()));
+	cb.pixelSpreadAngle = atanf(2.0f * tanf(m_fovAngleY * 0.5f) / cb.frameSize.y); // Akenine-Moller et al.'s ray cones
 	cb.transBackgroundMode = 0;
 
 	if (m_transBackgroundMode)
@@ -252,11 +299,40 @@ void DXRSetup::UpdateCamera(float rX, float rY)
 		cb.transBackgroundMode = 1;
 	}
 
-	// Map and update the constant buffer
-	uint8_t* pData = nullptr;
-	ThrowIfFailed(context->m_cameraBuffer->Map(0, nullptr, reinterpret_cast<void**>(&pData)));
-	memcpy(pData, &cb, sizeof(CameraBuffer));
-	context->m_cameraBuffer->Unmap(0, nullptr);
+	// Write this frame's chunk of the upload ring, the GPU may still be reading the last frame's
+	memcpy(context->m_cameraUpload.cpuAddress, &cb, sizeof(CameraBuffer));
+}
+
+void DXRSetup::GetInverseCameraMatrices(XMMATRIX& invView, XMMATRIX& invProj)
+{
+	DXRContext* context = m_app->GetContext();
+
+	XMMATRIX view = context->m_pCamera->GetViewMatrix();
+
+	XMMATRIX perspective = XMMatrixPerspectiveFovLH(m_fovAngleY, m_app->GetAspectRatio(), 0.1f, 1000.0f);
+
+	invView = XMMatrixInverse(nullptr, view);
+	invProj = XMMatrixInverse(nullptr, perspective);
+}
+
+void DXRSetup::GetCameraCullVolume(CullVolume& volume)
+{
+	DXRContext* context = m_app->GetContext();
+
+	XMMATRIX view = context->m_pCamera->GetViewMatrix();
+
+	XMMATRIX perspective = XMMatrixPerspectiveFovLH(m_fovAngleY, m_app->GetAspectRatio(), 0.1f, 1000.0f);
+
+	// Clip space x is the position dotted with the first column and it's on screen while -w <= x <= w, so the planes are sums
+	// of the columns. The near and far ones are left off, the rays start at the eye and carry on past the far plane.
+	XMMATRIX columns = XMMatrixTranspose(view * perspective);
+	XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(volume.planes[0]), XMVectorAdd(columns.r[3], columns.r[0]));
+	XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(volume.planes[1]), XMVectorSubtract(columns.r[3], columns.r[0]));
+	XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(volume.planes[2]), XMVectorAdd(columns.r[3], columns.r[1]));
+	XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(volume.planes[3]), XMVectorSubtract(columns.r[3], columns.r[1]));
+
+	XMFLOAT3 eye = context->m_pCamera->GetPosition();
+	volume.eye = RayVec3(eye.x, eye.y, eye.z);
 }
 
 void DXRSetup::CreateLightingBuffer()
@@ -265,7 +341,7 @@ void DXRSetup::CreateLightingBuffer()
 
 	context->m_lightingBuffer = nv_helpers_dx12::CreateBuffer(
 		m_device.Get(), context->m_lightingBufferSize, D3D12_RESOURCE_FLAG_NONE,
-		D3D12_RESOURCE_STATE_GENERIC_READ, nv_helpers_dx12::kUploadHeapProps);
+		D3D12_RESOURCE_STATE_COMMON, nv_helpers_dx12::kDefaultHeapProps);
 
 	LightParams cb;
 	cb.lightPosition = m_originalLightPosition;
@@ -286,11 +362,7 @@ void DXRSetup::CreateLightingBuffer()
 
 	cb.shawdowRayCount = m_originalShadowRayCount;
 
-	uint8_t* pData;
-
-	ThrowIfFailed(context->m_lightingBuffer->Map(0, nullptr, (void**)&pData));
-	memcpy(pData, &cb, sizeof(LightParams));
-	context->m_lightingBuffer->Unmap(0, nullptr);
+	context->m_lightingData = cb;
 }
 
 void DXRSetup::UpdateLightingBuffer(XMFLOAT4 lightPosition, XMFLOAT4 lightAmbientColor, XMFLOAT4 lightDiffuseColor, XMFLOAT4 lightSpecularColor, float lightSpecularPower, float pointLightRange, UINT shadowRayCount)
@@ -316,41 +388,171 @@ void DXRSetup::UpdateLightingBuffer(XMFLOAT4 lightPosition, XMFLOAT4 lightAmbien
 
 	cb.shawdowRayCount = shadowRayCount;
 
-	uint8_t* pData;
-
-	ThrowIfFailed(context->m_lightingBuffer->Map(0, nullptr, (void**)&pData));
-	memcpy(pData, &cb, sizeof(LightParams));
-	context->m_lightingBuffer->Unmap(0, nullptr);
+	// Just the CPU copy, it goes into every frame's slice from here on.
+	context->m_lightingData = cb;
 }
 
-// The material buffers are looped for each object in the scene.
+// All the materials live in one table, the hit shaders pick their entry with InstanceID().
 
 void DXRSetup::CreateMaterialBuffers()
 {
-	for (auto& object : m_app->m_drawableObjects)
-	{
-		object->m_materialBuffer = nv_helpers_dx12::CreateBuffer(
-			m_device.Get(), object->m_materialBufferSize, D3D12_RESOURCE_FLAG_NONE,
-			D3D12_RESOURCE_STATE_GENERIC_READ, nv_helpers_dx12::kUploadHeapProps);
+	DXRContext* context = m_app->GetContext();
+
+	context->m_materialTable = nv_helpers_dx12::CreateBuffer(
+		m_device.Get(), sizeof(MaterialBuffer) * m_app->m_drawableObjects.size(), D3D12_RESOURCE_FLAG_NONE,
+		D3D12_RESOURCE_STATE_COMMON, nv_helpers_dx12::kDefaultHeapProps);
+}
 
-		uint8_t* pData;
+void DXRSetup::UpdateMaterialBuffers()
+{
+	PROFILE_CPU_SCOPE("UpdateMaterialBuffers");
+
+	DXRContext* context = m_app->GetContext();
 
-		ThrowIfFailed(object->m_materialBuffer->Map(0, nullptr, (void**)&pData));
-		memcpy(pData, &object->m_materialBufferData, sizeof(MaterialBuffer));
-		object->m_materialBuffer->Unmap(0, nullptr);
+	// The upload ring is mapped for good, so this is just one memcpy per object into this frame's chunk.
+	uint8_t* pData = context->m_materialUpload.cpuAddress;
+	for (size_t i = 0; i < m_app->m_drawableObjects.size(); i++)
+	{
+		memcpy(pData + i * sizeof(MaterialBuffer), &m_app->m_drawableObjects[i]->m_materialBufferData, sizeof(MaterialBuffer));
 	}
 }
 
-void DXRSetup::UpdateMaterialBuffers()
+void DXRSetup::CreateUploadRing()
 {
-	for (auto& object : m_app->m_drawableObjects)
+	DXRContext* context = m_app->GetContext();
+
+	context->m_uploadRing = nv_helpers_dx12::CreateBuffer(
+		m_device.Get(), context->m_uploadRingSize, D3D12_RESOURCE_FLAG_NONE,
+		D3D12_RESOURCE_STATE_GENERIC_READ, nv_helpers_dx12::kUploadHeapProps);
+
+	// Upload heaps are fine to leave mapped, the allocator makes sure we never write a chunk the GPU is reading.
+	ThrowIfFailed(context->m_uploadRing->Map(0, nullptr, reinterpret_cast<void**>(&context->m_uploadRingData)));
+
+	context->m_uploadRingAllocator = new UploadRingAllocator(context->m_uploadRingSize);
+}
+
+UploadAllocation DXRSetup::AllocateUpload(UINT64 size, UINT64 alignment)
+{
+	DXRContext* context = m_app->GetContext();
+
+	UploadAllocation allocation;
+
+	if (context->m_uploadRingAllocator->Allocate(size, alignment, allocation.offset))
 	{
-		uint8_t* pData;
+		allocation.resource = context->m_uploadRing.Get();
+		allocation.cpuAddress = context->m_uploadRingData + allocation.offset;
+		return allocation;
+	}
+
+	// The ring's full (or it's just a massive upload), so give it a buffer of its own and let the frame pacer
+	// release it once the GPU is done with it. If this keeps happening, make m_uploadRingSize bigger.
+	ComPtr<ID3D12Resource> buffer = nv_helpers_dx12::CreateBuffer(
+		m_device.Get(), size, D3D12_RESOURCE_FLAG_NONE,
+		D3D12_RESOURCE_STATE_GENERIC_READ, nv_helpers_dx12::kUploadHeapProps);
+
+	ThrowIfFailed(buffer->Map(0, nullptr, reinterpret_cast<void**>(&allocation.cpuAddress)));
+	allocation.resource = buffer.Get();
+	allocation.offset = 0;
+
+	context->m_framePacer->Retire([buffer]() {});
+	context->m_uploadFallbacks++;
+	context->m_uploadFallbackBytes += size;
+
+	return allocation;
+}
+
+void DXRSetup::AllocateFrameConstants()
+{
+	DXRContext* context = m_app->GetContext();
+
+	const UINT64 alignment = D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT;
+
+	context->m_cameraUpload = AllocateUpload(context->m_cameraBufferSize, alignment);
+	context->m_lightingUpload = AllocateUpload(context->m_lightingBufferSize, alignment);
+	context->m_materialUpload = AllocateUpload(sizeof(MaterialBuffer) * m_app->m_drawableObjects.size(), alignment);
+
+	// The light only changes when the UI pokes it, but every frame gets its own copy.
+	memcpy(context->m_lightingUpload.cpuAddress, &context->m_lightingData, sizeof(LightParams));
+}
+
+void DXRSetup::CopyFrameConstants()
+{
+	DXRContext* context = m_app->GetContext();
+
+	UINT64 materialTableSize = sizeof(MaterialBuffer) * m_app->m_drawableObjects.size();
+
+	// Buffers decay back to COMMON after every ExecuteCommandLists, and get promoted to COPY_DEST
+	// by the copy itself, so there's no barrier needed on the way in.
+	context->m_commandList->CopyBufferRegion(context->m_cameraBuffer.Get(), 0, context->m_cameraUpload.resource,
+		context->m_cameraUpload.offset, context->m_cameraBufferSize);
+	context->m_commandList->CopyBufferRegion(context->m_lightingBuffer.Get(), 0, context->m_lightingUpload.resource,
+		context->m_lightingUpload.offset, context->m_lightingBufferSize);
+	context->m_commandList->CopyBufferRegion(context->m_materialTable.Get(), 0, context->m_materialUpload.resource,
+		context->m_materialUpload.offset, materialTableSize);
+
+	const D3D12_RESOURCE_STATES readState = D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
+	CD3DX12_RESOURCE_BARRIER barriers[] = {
+		CD3DX12_RESOURCE_BARRIER::Transition(context->m_cameraBuffer.Get(), D3D12_RESOURCE_STATE_COPY_DEST, readState),
+		CD3DX12_RESOURCE_BARRIER::Transition(context->m_lightingBuffer.Get(), D3D12_RESOURCE_STATE_COPY_DEST, readState),
+		CD3DX12_RESOURCE_BARRIER::Transition(context->m_materialTable.Get(), D3D12_RESOURCE_STATE_COPY_DEST, readState)
+	};
+	context->m_commandList->ResourceBarrier(_countof(barriers), barriers);
+}
+#pragma endregion
+
+#pragma region Ray Counter Methods
+void DXRSetup::ClearRayCounters()
+{
+	DXRContext* context = m_app->GetContext();
+
+	// Same as the frame constants, the counters start the frame in COMMON and the copy promotes them.
+	context->m_commandList->CopyBufferRegion(context->m_rayCounters.Get(), 0, context->m_rayCounterZeros.Get(), 0,
+		sizeof(uint32_t) * RAY_COUNTER_COUNT);
+
+	context->m_commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(
+		context->m_rayCounters.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_UNORDERED_ACCESS));
+}
+
+void DXRSetup::ReadBackRayCounters(float frameSeconds)
+{
+	DXRContext* context = m_app->GetContext();
+	UINT slot = context->GetFrameSlot();
+	const UINT64 counterBytes = sizeof(uint32_t) * RAY_COUNTER_COUNT;
+
+	context->m_commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(
+		context->m_rayCounters.Get(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_SOURCE));
 
-		ThrowIfFailed(object->m_materialBuffer->Map(0, nullptr, (void**)&pData));
-		memcpy(pData, &object->m_materialBufferData, sizeof(MaterialBuffer));
-		object->m_materialBuffer->Unmap(0, nullptr);
+	context->m_commandList->CopyBufferRegion(context->m_rayCounterReadback.Get(), slot * counterBytes,
+		context->m_rayCounters.Get(), 0, counterBytes);
+
+	context->m_rayCountsPending[slot] = true;
+	context->m_rayCountFrames[slot] = CpuProfiler::Get().GetFrameIndex();
+	context->m_rayCountSeconds[slot] = frameSeconds;
+}
+
+void DXRSetup::CollectRayCounters()
+{
+	DXRContext* context = m_app->GetContext();
+	UINT slot = context->GetFrameSlot();
+	const UINT64 counterBytes = sizeof(uint32_t) * RAY_COUNTER_COUNT;
+
+	// BeginFrame has already waited for whatever last used this slot, so its counts are sitting there.
+	if (!context->m_rayCountsPending[slot])
+	{
+		return;
 	}
+
+	D3D12_RANGE readRange = { slot * counterBytes, (slot + 1) * counterBytes };
+	D3D12_RANGE writtenRange = { 0, 0 };
+
+	uint8_t* pData;
+	uint32_t counts[RAY_COUNTER_COUNT];
+	ThrowIfFailed(context->m_rayCounterReadback->Map(0, &readRange, reinterpret_cast<void**>(&pData)));
+	memcpy(counts, pData + readRange.Begin, counterBytes);
+	context->m_rayCounterReadback->Unmap(0, &writtenRange);
+
+	context->m_rayRates.AddFrame(context->m_rayCountFrames[slot], context->m_rayCountSeconds[slot], counts);
+	context->m_rayCountsPending[slot] = false;
 }
 #pragma endregion
 
@@ -391,18 +593,19 @@ void DXRSetup::LoadAssets()
 
 	// Create the command list.
 	ThrowIfFailed(m_device->CreateCommandList(
-		0, D3D12_COMMAND_LIST_TYPE_DIRECT, context->m_commandAllocator.Get(),
+		0, D3D12_COMMAND_LIST_TYPE_DIRECT, context->m_commandAllocators[0].Get(),
 		nullptr, IID_PPV_ARGS(&context->m_commandList)));
 
 	//////////////////////////////////////////////////////////
 	///// Every Object in the scene is created here //////////
-	DrawableGameObject* cubeFloor = new DrawableGameObject(
+	DrawableGameObject* cubeFloor = new DrawableGameObject(&m_app->m_transforms,
 		XMFLOAT3(0.0f, -1.1f, 0.0f),
 		XMFLOAT3(0, 0, 0),
 		XMFLOAT3(5.0f, 0.1f, 5.0f),
 		"Cube Floor");
 
 	cubeFloor->m_reflection = true;
+	cubeFloor->m_instanceMask = INSTANCE_MASK_CAMERA | INSTANCE_MASK_REFLECTION; // Everything's above it, so it has nothing to shadow
 	cubeFloor->m_materialBufferData.shininess = 0.3f;
 	cubeFloor->m_materialBufferData.roughness = 0.01f;
 	cubeFloor->initCubeMesh(m_device);
@@ -410,7 +613,7 @@ void DXRSetup::LoadAssets()
 	//////////////////////////////////////////////////////
 
 	//////////////////////////////////////////////////////
-	DrawableGameObject* cube1 = new DrawableGameObject(
+	DrawableGameObject* cube1 = new DrawableGameObject(&m_app->m_transforms,
 		XMFLOAT3(0.0f, 0.0f, -1.2f),
 		XMFLOAT3(0, 0, 0),
 		XMFLOAT3(0.25f, 0.25f, 0.25f),
@@ -420,13 +623,13 @@ void DXRSetup::LoadAssets()
 	cube1->m_materialBufferData.shininess = 0.8f;
 
 	cube1->initCubeMesh(m_device);
-	cube1->m_autoRotateX = true;
-	cube1->m_autoRotateY = true;
+	cube1->setAutoRotate(0, true);
+	cube1->setAutoRotate(1, true);
 	m_app->m_drawableObjects.push_back(cube1);
 	//////////////////////////////////////////////////////
 
 	//////////////////////////////////////////////////////
-	DrawableGameObject* pPlane = new DrawableGameObject(
+	DrawableGameObject* pPlane = new DrawableGameObject(&m_app->m_transforms,
 		XMFLOAT3(0.0f, -1.5f, 0.0f),
 		XMFLOAT3(-90.0f, 0.0f, 0.0f),
 		XMFLOAT3(20.0f, 20.0f, 1.0f),
@@ -439,7 +642,7 @@ void DXRSetup::LoadAssets()
 	//////////////////////////////////////////////////////
 
 	//////////////////////////////////////////////////////
-	DrawableGameObject* pPlaneCopy = new DrawableGameObject(
+	DrawableGameObject* pPlaneCopy = new DrawableGameObject(&m_app->m_transforms,
 		XMFLOAT3(0.0f, 0.0f, -0.3f),
 		XMFLOAT3(0.0f, 0.0f, 0.0f),
 		XMFLOAT3(1.0f, 1.0f, 1.0f),
@@ -451,22 +654,22 @@ void DXRSetup::LoadAssets()
 	pPlaneCopy->m_reflection = true;
 	pPlaneCopy->m_triOutline = false;
 
-	pPlaneCopy->m_autoRotateY = true;
+	pPlaneCopy->setAutoRotate(1, true);
 
 	pPlaneCopy->initPlaneMesh(m_device);
 	m_app->m_drawableObjects.push_back(pPlaneCopy);
 	//////////////////////////////////////////////////////
 
 	//////////////////////////////////////////////////////
-	DrawableGameObject* pDonut = new DrawableGameObject(
+	DrawableGameObject* pDonut = new DrawableGameObject(&m_app->m_transforms,
 		XMFLOAT3(0.8f, -0.775f, 0.0f),
 		XMFLOAT3(45, 0, 0),
 		XMFLOAT3(0.15f, 0.15f, 0.15f),
 		"Donut 1");
 
 	pDonut->m_materialBufferData.triThickness = 0.05f;
-	pDonut->m_autoRotateY = true;
-	pDonut->m_autoRotateZ = true;
+	pDonut->setAutoRotate(1, true);
+	pDonut->setAutoRotate(2, true);
 
 	pDonut->m_materialBufferData.objectColour = XMFLOAT4(1.0f, 0.0f, 0.0f, 1.0f);
 
@@ -475,7 +678,7 @@ void DXRSetup::LoadAssets()
 	//////////////////////////////////////////////////////
 
 	//////////////////////////////////////////////////////
-	DrawableGameObject* pBall = new DrawableGameObject(
+	DrawableGameObject* pBall = new DrawableGameObject(&m_app->m_transforms,
 		XMFLOAT3(-0.8f, -0.8f, 0.0f),
 		XMFLOAT3(0, 0, 0),
 		XMFLOAT3(0.15f, 0.15f, 0.15f),
@@ -489,7 +692,7 @@ void DXRSetup::LoadAssets()
 	//////////////////////////////////////////////////////
 
 	//////////////////////////////////////////////////////
-	DrawableGameObject* pMirror1 = new DrawableGameObject(
+	DrawableGameObject* pMirror1 = new DrawableGameObject(&m_app->m_transforms,
 		XMFLOAT3(5.0f, 1.8f, 0.0f),
 		XMFLOAT3(0, 0, 0),
 		XMFLOAT3(0.05f, 3.0f, 5.0f),
@@ -504,7 +707,7 @@ void DXRSetup::LoadAssets()
 	//////////////////////////////////////////////////////
 
 	//////////////////////////////////////////////////////
-	DrawableGameObject* pMirror2 = new DrawableGameObject(
+	DrawableGameObject* pMirror2 = new DrawableGameObject(&m_app->m_transforms,
 		XMFLOAT3(-5.0f, 1.8f, 0.0f),
 		XMFLOAT3(0, 0, 0),
 		XMFLOAT3(0.05f, 3.0f, 5.0f),
@@ -519,7 +722,7 @@ void DXRSetup::LoadAssets()
 	//////////////////////////////////////////////////////
 
 	//////////////////////////////////////////////////////
-	DrawableGameObject* pMirror3 = new DrawableGameObject(
+	DrawableGameObject* pMirror3 = new DrawableGameObject(&m_app->m_transforms,
 		XMFLOAT3(0.04f, 1.8f, -5.0f),
 		XMFLOAT3(0, 90, 0),
 		XMFLOAT3(0.05f, 3.0f, 5.0f),
@@ -535,7 +738,7 @@ void DXRSetup::LoadAssets()
 	//////////////////////////////////////////////////////
 
 	//////////////////////////////////////////////////////
-	DrawableGameObject* pImageBillboard = new DrawableGameObject(
+	DrawableGameObject* pImageBillboard = new DrawableGameObject(&m_app->m_transforms,
 		XMFLOAT3(2.0f, 0.0f, -0.3f),
 		XMFLOAT3(0.0f, 180.0f, 0.0f),
 		XMFLOAT3(1.0f, 1.0f, 1.0f),
@@ -549,7 +752,7 @@ void DXRSetup::LoadAssets()
 	//////////////////////////////////////////////////////
 
 	//////////////////////////////////////////////////////
-	DrawableGameObject* pImageBillboard2 = new DrawableGameObject(
+	DrawableGameObject* pImageBillboard2 = new DrawableGameObject(&m_app->m_transforms,
 		XMFLOAT3(-2.0f, 0.0f, -0.3f),
 		XMFLOAT3(0.0f, 180.0f, 0.0f),
 		XMFLOAT3(1.0f, 1.0f, 1.0f),
@@ -563,7 +766,7 @@ void DXRSetup::LoadAssets()
 	//////////////////////////////////////////////////////
 
 	//////////////////////////////////////////////////////
-	DrawableGameObject* pText = new DrawableGameObject(
+	DrawableGameObject* pText = new DrawableGameObject(&m_app->m_transforms,
 		XMFLOAT3(2.745f, 1.575f, -3.0f),
 		XMFLOAT3(-90, 20.0f, 180.0f),
 		XMFLOAT3(0.2, -0.2f, 0.2f),
@@ -581,7 +784,7 @@ void DXRSetup::LoadAssets()
 	//////////////////////////////////////////////////////
 
 	//////////////////////////////////////////////////////
-	DrawableGameObject* pText2 = new DrawableGameObject(
+	DrawableGameObject* pText2 = new DrawableGameObject(&m_app->m_transforms,
 		XMFLOAT3(2.745f, 1.32f, -3.0f),
 		XMFLOAT3(-90, 20.0f, 180.0f),
 		XMFLOAT3(0.2, -0.2f, 0.2f),
@@ -599,7 +802,7 @@ void DXRSetup::LoadAssets()
 	//////////////////////////////////////////////////////
 
 	//////////////////////////////////////////////////////
-	DrawableGameObject* pBetterThanText = new DrawableGameObject(
+	DrawableGameObject* pBetterThanText = new DrawableGameObject(&m_app->m_transforms,
 		XMFLOAT3(2.745f, 1.0f, -3.0f),
 		XMFLOAT3(-90, 14.5f, 180.0f),
 		XMFLOAT3(0.28, -0.1f, 0.31f),
@@ -633,27 +836,31 @@ void DXRSetup::LoadAssets()
 	m_app->m_drawableObjects.push_back(pBetterThanText);
 	//////////////////////////////////////////////////////
 
+	// The things that belong together, so they can be moved as one.
+	CreateSceneGroup("Mirrors", { pMirror1, pMirror2, pMirror3 });
+	CreateSceneGroup("Text", { pText, pText2, pBetterThanText });
+
 	// Load all the textures into the GPU
 	LoadTextures();
 
-	// Create synchronization objects and wait until assets have been uploaded to
-	// the GPU.
-	{
-		ThrowIfFailed(m_device->CreateFence(0, D3D12_FENCE_FLAG_NONE,
-			IID_PPV_ARGS(&context->m_fence)));
-		context->m_fenceValue = 1;
+	// The texture copies are still sitting in the command list, they get executed (and waited on)
+	// along with the acceleration structure builds in CreateAccelerationStructures.
+}
 
-		// Create an event handle to use for frame synchronization.
-		context->m_fenceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
-		if (context->m_fenceEvent == nullptr) {
-			ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
-		}
+void DXRSetup::CreateSceneGroup(const string& name, const vecDrawables& members)
+{
+	SceneGroup group;
+	group.name = name;
 
-		// Wait for the command list to execute; we are reusing the same command
-		// list in our main loop but for now, we just want to wait for setup to
-		// complete before continuing.
-		m_app->WaitForPreviousFrame();
+	// An identity transform, so parenting to it doesn't move anything.
+	group.transformIndex = m_app->m_transforms.Add(TransformVec3(0.0f, 0.0f, 0.0f), TransformVec3(0.0f, 0.0f, 0.0f), TransformVec3(1.0f, 1.0f, 1.0f));
+
+	for (DrawableGameObject* member : members)
+	{
+		m_app->m_transforms.SetParent(member->getTransformIndex(), group.transformIndex);
 	}
+
+	m_app->m_sceneGroups.push_back(group);
 }
 
 // I have two kinds of textures, static and dynamic.
@@ -664,8 +871,8 @@ void DXRSetup::LoadTextures()
 {
 	DXRContext* context = m_app->GetContext();
 
-	// Copy data to the intermediate upload heap and then schedule a copy
-	// from the upload heap to the Texture2D.
+	// Copy data to the upload ring and then schedule a copy
+	// from the ring to the Texture2D.
 
 	TextureLoader tl;
 
@@ -697,18 +904,12 @@ void DXRSetup::LoadTextures()
 			IID_PPV_ARGS(&texture.textureResource)
 		));
 
-		// CREATE AN UPLOAD HEAP
-		const UINT64 uploadBufferSize = GetRequiredIntermediateSize(texture.textureResource.Get(), 0, 1);
+		context->m_resourceTracker.Track(RESOURCE_TEXTURE, "Scene", string(staticTexture.begin(), staticTexture.end()),
+			GetAllocationSize(texture.textureResource.Get()));
 
-		// Create the upload heap buffer.
-		ThrowIfFailed(m_device->CreateCommittedResource(
-			&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-			D3D12_HEAP_FLAG_NONE,
-			&CD3DX12_RESOURCE_DESC::Buffer(uploadBufferSize),
-			D3D12_RESOURCE_STATE_GENERIC_READ,
-			nullptr,
-			IID_PPV_ARGS(&texture.textureUploadHeap)
-		));
+		// GRAB SOME OF THE UPLOAD RING, it's handed back once the setup flush is done
+		const UINT64 uploadBufferSize = GetRequiredIntermediateSize(texture.textureResource.Get(), 0, 1);
+		UploadAllocation upload = AllocateUpload(uploadBufferSize, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
 
 		// SCHEDULE A COPY FROM THE UPLOAD HEAP TO THE DEFAULT HEAP TEXTURE
 		D3D12_SUBRESOURCE_DATA textureData = {};
@@ -718,8 +919,8 @@ void DXRSetup::LoadTextures()
 
 		UpdateSubresources(context->m_commandList.Get(),
 			texture.textureResource.Get(),
-			texture.textureUploadHeap.Get(),
-			0, 0, 1,
+			upload.resource,
+			upload.offset, 0, 1,
 			&textureData);
 
 		context->m_commandList->ResourceBarrier(1,
@@ -760,18 +961,12 @@ void DXRSetup::LoadTextures()
 			IID_PPV_ARGS(&object->m_textureResource)
 		));
 
-		// CREATE AN UPLOAD HEAP
-		const UINT64 uploadBufferSize = GetRequiredIntermediateSize(object->m_textureResource.Get(), 0, 1);
+		context->m_resourceTracker.Track(RESOURCE_TEXTURE, object->getObjectName(),
+			string(object->m_textureFile.begin(), object->m_textureFile.end()), GetAllocationSize(object->m_textureResource.Get()));
 
-		// Create the upload heap buffer.
-		ThrowIfFailed(m_device->CreateCommittedResource(
-			&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-			D3D12_HEAP_FLAG_NONE,
-			&CD3DX12_RESOURCE_DESC::Buffer(uploadBufferSize),
-			D3D12_RESOURCE_STATE_GENERIC_READ,
-			nullptr,
-			IID_PPV_ARGS(&object->m_textureUploadHeap)
-		));
+		// GRAB SOME OF THE UPLOAD RING, it's handed back once the setup flush is done
+		const UINT64 uploadBufferSize = GetRequiredIntermediateSize(object->m_textureResource.Get(), 0, 1);
+		UploadAllocation upload = AllocateUpload(uploadBufferSize, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
 
 		// SCHEDULE A COPY FROM THE UPLOAD HEAP TO THE DEFAULT HEAP TEXTURE
 		D3D12_SUBRESOURCE_DATA textureData = {};
@@ -781,8 +976,8 @@ void DXRSetup::LoadTextures()
 
 		UpdateSubresources(context->m_commandList.Get(),
 			object->m_textureResource.Get(),
-			object->m_textureUploadHeap.Get(),
-			0, 0, 1,
+			upload.resource,
+			upload.offset, 0, 1,
 			&textureData);
 
 		context->m_commandList->ResourceBarrier(1,
@@ -795,191 +990,682 @@ void DXRSetup::LoadTextures()
 
 //-----------------------------------------------------------------------------
 //
-// Combine the BLAS and TLAS builds to construct the entire acceleration
-// structure required to raytrace the scene
+// The OBJ loader gives every face corner its own vertex, in the order the
+// faces come in. Every loaded mesh gets welded and reordered for the vertex
+// cache and the fetches, and the ones big enough to be worth it get a chain of
+// coarser levels for the shadow and reflection rays. Both are slow, so they're
+// kept in the mesh cache and only built the first time a mesh is seen
 //
-void DXRSetup::CreateAccelerationStructures()
+void DXRSetup::BuildMeshCache()
 {
 	DXRContext* context = m_app->GetContext();
 
-	for (int i = 0; i < m_app->m_drawableObjects.size(); i++)
+	if (!context->m_meshLodCache)
 	{
-		AccelerationStructureBuffers Buffers =
-			CreateBottomLevelAS({ {m_app->m_drawableObjects[i]->getVertexBuffer().Get(), m_app->m_drawableObjects[i]->getVertexCount()} },
-				{ {m_app->m_drawableObjects[i]->getIndexBuffer().Get(), m_app->m_drawableObjects[i]->getIndexCount()} });
-
-		m_app->m_instances.push_back(std::make_pair(Buffers.pResult, m_app->m_drawableObjects[i]->getTransform()));
+		CreateDirectoryA(m_meshLodCacheDirectory.c_str(), nullptr); // Fails harmlessly if it already exists
+		context->m_meshLodCache = new MeshLodCache(m_meshLodCacheDirectory);
 	}
 
-	CreateTopLevelAS(m_app->m_instances, false);
+	float loadedAcmr = 0.0f;
+	float optimisedAcmr = 0.0f;
+	UINT optimisedCount = 0;
 
-	// Flush the command list and wait for it to finish
-	context->m_commandList->Close();
-	ID3D12CommandList* ppCommandLists[] = { context->m_commandList.Get() };
-	context->m_commandQueue->ExecuteCommandLists(1, ppCommandLists);
-	context->m_fenceValue++;
-	context->m_commandQueue->Signal(context->m_fence.Get(), context->m_fenceValue);
+	for (auto& object : m_app->m_drawableObjects)
+	{
+		object->m_lodLevels.clear();
 
-	context->m_fence->SetEventOnCompletion(context->m_fenceValue, context->m_fenceEvent);
-	WaitForSingleObject(context->m_fenceEvent, INFINITE);
+		// The built in meshes are only a handful of triangles, and already share their vertices.
+		if (!object->m_objMesh)
+		{
+			continue;
+		}
 
-	// Once the command list is finished executing, reset it to be reused for
-	// rendering
-	ThrowIfFailed(
-		context->m_commandList->Reset(context->m_commandAllocator.Get(), nullptr));
+		TriangleMesh mesh;
+		for (const SimpleVertex& vertex : object->getVertices())
+		{
+			mesh.positions.push_back(RayVec3(vertex.Pos.x, vertex.Pos.y, vertex.Pos.z));
+		}
+		mesh.indices.assign(object->getIndices().begin(), object->getIndices().end());
+
+		// A deforming mesh would move out from under its LODs, but reordering it is fine.
+		bool withLods = !object->m_deformingMesh && mesh.GetTriangleCount() >= MeshLod::kMinTriangles;
+
+		CachedMesh cached;
+		context->m_meshLodCache->GetOrBuild(mesh, object->getVertices().data(), sizeof(SimpleVertex), withLods, cached);
+
+		object->m_loadedLocality = MeshOptimiser::Analyse(mesh.indices, mesh.positions.size(), sizeof(SimpleVertex));
+		object->reorderMesh(cached.vertexOrder, cached.indices);
+		object->m_optimisedLocality = MeshOptimiser::Analyse(cached.indices, cached.vertexOrder.size(), sizeof(SimpleVertex));
+		object->m_lodLevels.swap(cached.levels);
+
+		char message[320];
+		snprintf(message, sizeof(message), "Mesh %s: %zu -> %u vertices, ACMR %.3f -> %.3f, ATVR %.3f -> %.3f, overfetch %.3f -> %.3f, %.1f -> %.1f bytes/triangle\n",
+			object->getObjectName().c_str(), mesh.positions.size(), object->getVertexCount(),
+			object->m_loadedLocality.acmr, object->m_optimisedLocality.acmr,
+			object->m_loadedLocality.atvr, object->m_optimisedLocality.atvr,
+			object->m_loadedLocality.overfetch, object->m_optimisedLocality.overfetch,
+			object->m_loadedLocality.bytesPerTriangle, object->m_optimisedLocality.bytesPerTriangle);
+		OutputDebugStringA(message);
+
+		loadedAcmr += object->m_loadedLocality.acmr;
+		optimisedAcmr += object->m_optimisedLocality.acmr;
+		optimisedCount++;
+	}
 
-	// Store the AS buffers. The rest of the buffers will be released once we exit
-	// the function
-//	context->m_bottomLevelAS = objBallBuffer.pResult;
+	const MeshLodCacheStats& stats = context->m_meshLodCache->GetStats();
+	char message[160];
+	snprintf(message, sizeof(message), "Mesh cache: %u cached, %u built in %.1f ms, mean ACMR %.3f -> %.3f\n", stats.hits, stats.misses,
+		stats.totalBuildMilliseconds, optimisedCount ? loadedAcmr / optimisedCount : 0.0f, optimisedCount ? optimisedAcmr / optimisedCount : 0.0f);
+	OutputDebugStringA(message);
 }
 
 //-----------------------------------------------------------------------------
 //
-// Create a bottom-level acceleration structure based on a list of vertex
-// buffers in GPU memory along with their vertex count. The build is then done
-// in 3 steps: gathering the geometry, computing the sizes of the required
-// buffers, and building the actual AS
+// Copy every object's vertex and index buffer into one big default heap pool
+// each. The hit shaders then only need the pools plus a per instance offset
+// table, so every object can share the same hit group arguments. LOD levels
+// only add indices, they point at their object's vertices
 //
-AccelerationStructureBuffers DXRSetup::CreateBottomLevelAS(std::vector<std::pair<ComPtr<ID3D12Resource>, uint32_t>> vVertexBuffers,
-	std::vector<std::pair<ComPtr<ID3D12Resource>, uint32_t>> vIndexBuffers)
+void DXRSetup::CreateGeometryPools()
 {
 	DXRContext* context = m_app->GetContext();
-	nv_helpers_dx12::BottomLevelASGenerator bottomLevelAS;
 
-	// Adding all vertex buffers and not transforming their position.
-	for (size_t i = 0; i < vVertexBuffers.size(); i++) {
-		if (i < vIndexBuffers.size() && vIndexBuffers[i].second > 0)
+	// Work out where each object goes in the pools.
+	std::vector<MeshInfo>& meshInfos = context->m_meshInfos;
+	meshInfos.clear();
+	UINT vertexCount = 0;
+	UINT indexCount = 0;
+
+	for (size_t i = 0; i < m_app->m_drawableObjects.size(); i++)
+	{
+		DrawableGameObject* object = m_app->m_drawableObjects[i];
+
+		MeshInfo meshInfo;
+		meshInfo.vertexOffset = vertexCount;
+		meshInfo.indexOffset = indexCount;
+		meshInfo.vertexCount = object->getVertexCount();
+		meshInfo.indexCount = object->getIndexCount();
+		meshInfo.materialIndex = static_cast<UINT>(i);
+		meshInfos.push_back(meshInfo);
+
+		object->m_vertexPoolOffset = vertexCount;
+		object->m_indexPoolOffset = indexCount;
+
+		// This is where what OBJLoader (or the built in meshes) produced ends up on the GPU.
+		context->m_resourceTracker.Track(RESOURCE_VERTICES, object->getObjectName(), "Vertex Pool Slice",
+			static_cast<uint64_t>(meshInfo.vertexCount) * sizeof(Vertex));
+		context->m_resourceTracker.Track(RESOURCE_INDICES, object->getObjectName(), "Index Pool Slice",
+			static_cast<uint64_t>(meshInfo.indexCount) * sizeof(UINT));
+
+		vertexCount += meshInfo.vertexCount;
+		indexCount += meshInfo.indexCount;
+	}
+
+	// The LOD levels go after every object, so an object's own MeshInfo is still at its index.
+	for (size_t i = 0; i < m_app->m_drawableObjects.size(); i++)
+	{
+		DrawableGameObject* object = m_app->m_drawableObjects[i];
+		object->m_lodMeshStart = static_cast<UINT>(meshInfos.size());
+
+		for (const MeshLodLevel& level : object->m_lodLevels)
 		{
-			bottomLevelAS.AddVertexBuffer(vVertexBuffers[i].first.Get(), 0,
-				vVertexBuffers[i].second, sizeof(Vertex),
-				vIndexBuffers[i].first.Get(), 0,
-				vIndexBuffers[i].second, nullptr, 0, true);
+			MeshInfo meshInfo = meshInfos[i];
+			meshInfo.indexOffset = indexCount;
+			meshInfo.indexCount = static_cast<UINT>(level.indices.size());
+			meshInfos.push_back(meshInfo);
+
+			context->m_resourceTracker.Track(RESOURCE_INDICES, object->getObjectName(), "LOD Index Pool Slice",
+				static_cast<uint64_t>(meshInfo.indexCount) * sizeof(UINT));
+
+			indexCount += meshInfo.indexCount;
 		}
-		else
+	}
+
+	if (vertexCount == 0 || indexCount == 0)
+	{
+		throw std::logic_error("Can't build the geometry pools without any geometry");
+	}
+
+	context->m_vertexPoolCount = vertexCount;
+	context->m_indexPoolCount = indexCount;
+
+	context->m_vertexPool = nv_helpers_dx12::CreateBuffer(
+		m_device.Get(), static_cast<UINT64>(vertexCount) * sizeof(Vertex), D3D12_RESOURCE_FLAG_NONE,
+		D3D12_RESOURCE_STATE_COPY_DEST, nv_helpers_dx12::kDefaultHeapProps);
+
+	context->m_indexPool = nv_helpers_dx12::CreateBuffer(
+		m_device.Get(), static_cast<UINT64>(indexCount) * sizeof(UINT), D3D12_RESOURCE_FLAG_NONE,
+		D3D12_RESOURCE_STATE_COPY_DEST, nv_helpers_dx12::kDefaultHeapProps);
+
+	context->m_meshInfoBuffer = nv_helpers_dx12::CreateBuffer(
+		m_device.Get(), sizeof(MeshInfo) * meshInfos.size(), D3D12_RESOURCE_FLAG_NONE,
+		D3D12_RESOURCE_STATE_COPY_DEST, nv_helpers_dx12::kDefaultHeapProps);
+
+	// The meshes are copied straight out of the objects' CPU data into the upload ring, then one copy per pool.
+	static_assert(sizeof(SimpleVertex) == sizeof(Vertex), "The loaders' vertices have to match the pool layout");
+
+	const UINT64 vertexPoolSize = static_cast<UINT64>(vertexCount) * sizeof(Vertex);
+	const UINT64 indexPoolSize = static_cast<UINT64>(indexCount) * sizeof(UINT);
+	const UINT64 meshInfoSize = sizeof(MeshInfo) * meshInfos.size();
+
+	UploadAllocation vertexUpload = AllocateUpload(vertexPoolSize, sizeof(float));
+	UploadAllocation indexUpload = AllocateUpload(indexPoolSize, sizeof(UINT));
+	UploadAllocation meshInfoUpload = AllocateUpload(meshInfoSize, sizeof(UINT));
+
+	for (auto& object : m_app->m_drawableObjects)
+	{
+		memcpy(vertexUpload.cpuAddress + static_cast<UINT64>(object->m_vertexPoolOffset) * sizeof(Vertex),
+			object->getVertices().data(), object->getVertices().size() * sizeof(Vertex));
+
+		memcpy(indexUpload.cpuAddress + static_cast<UINT64>(object->m_indexPoolOffset) * sizeof(UINT),
+			object->getIndices().data(), object->getIndices().size() * sizeof(UINT));
+
+		for (size_t level = 0; level < object->m_lodLevels.size(); level++)
 		{
-			bottomLevelAS.AddVertexBuffer(vVertexBuffers[i].first.Get(), 0, vVertexBuffers[i].second,
-				sizeof(Vertex), 0, 0);
+			const std::vector<uint32_t>& levelIndices = object->m_lodLevels[level].indices;
+			memcpy(indexUpload.cpuAddress + static_cast<UINT64>(meshInfos[object->m_lodMeshStart + level].indexOffset) * sizeof(UINT),
+				levelIndices.data(), levelIndices.size() * sizeof(UINT));
 		}
 	}
 
-	// The AS build requires some scratch space to store temporary information.
-	// The amount of scratch memory is dependent on the scene complexity.
-	UINT64 scratchSizeInBytes = 0;
-	// The final AS also needs to be stored in addition to the existing vertex
-	// buffers. It size is also dependent on the scene complexity.
-	UINT64 resultSizeInBytes = 0;
-
-	bottomLevelAS.ComputeASBufferSizes(m_device.Get(), false, &scratchSizeInBytes,
-		&resultSizeInBytes);
-
-	// Once the sizes are obtained, the application is responsible for allocating
-	// the necessary buffers. Since the entire generation will be done on the GPU,
-	// we can directly allocate those on the default heap
-	AccelerationStructureBuffers buffers;
-	buffers.pScratch = nv_helpers_dx12::CreateBuffer(
-		m_device.Get(), scratchSizeInBytes,
-		D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COMMON,
-		nv_helpers_dx12::kDefaultHeapProps);
-	buffers.pResult = nv_helpers_dx12::CreateBuffer(
-		m_device.Get(), resultSizeInBytes,
-		D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS,
-		D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE,
-		nv_helpers_dx12::kDefaultHeapProps);
-
-	// Build the acceleration structure. Note that this call integrates a barrier
-	// on the generated AS, so that it can be used to compute a top-level AS right
-	// after this method.
-	bottomLevelAS.Generate(context->m_commandList.Get(), buffers.pScratch.Get(),
-		buffers.pResult.Get(), false, nullptr);
-
-	return buffers;
+	memcpy(meshInfoUpload.cpuAddress, meshInfos.data(), meshInfoSize);
+
+	context->m_commandList->CopyBufferRegion(context->m_vertexPool.Get(), 0, vertexUpload.resource, vertexUpload.offset, vertexPoolSize);
+	context->m_commandList->CopyBufferRegion(context->m_indexPool.Get(), 0, indexUpload.resource, indexUpload.offset, indexPoolSize);
+	context->m_commandList->CopyBufferRegion(context->m_meshInfoBuffer.Get(), 0, meshInfoUpload.resource, meshInfoUpload.offset, meshInfoSize);
+
+	// The BLAS builds and the hit shaders both read from the pools.
+	CD3DX12_RESOURCE_BARRIER barriers[] = {
+		CD3DX12_RESOURCE_BARRIER::Transition(context->m_vertexPool.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE),
+		CD3DX12_RESOURCE_BARRIER::Transition(context->m_indexPool.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE),
+		CD3DX12_RESOURCE_BARRIER::Transition(context->m_meshInfoBuffer.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE)
+	};
+	context->m_commandList->ResourceBarrier(_countof(barriers), barriers);
 }
 
 //-----------------------------------------------------------------------------
-// Create the main acceleration structure that holds all instances of the scene.
-// Similarly to the bottom-level AS generation, it is done in 3 steps: gathering
-// the instances, computing the memory requirements for the AS, and building the
-// AS itself
 //
-void DXRSetup::CreateTopLevelAS(
-	const std::vector<std::pair<ComPtr<ID3D12Resource>, DirectX::XMMATRIX>>
-	& instances, bool update // pair of bottom level AS and matrix of the instance
-) {
+// Combine the BLAS and TLAS builds to construct the entire acceleration
+// structure required to raytrace the scene. Each mesh's BLAS is built the way its
+// policy says. The ones that get compacted are built into a throwaway pool, then
+// copied into the real pool at their compacted size before the TLAS is built on
+// top of them. Every LOD level is a mesh of its own, with its own BLAS
+//
+void DXRSetup::CreateAccelerationStructures()
+{
 	DXRContext* context = m_app->GetContext();
+	size_t objectCount = m_app->m_drawableObjects.size();
+	size_t meshCount = context->m_meshInfos.size();
 
-	context->m_topLevelASGenerator.RemoveAllInstances();
+	// Which object and level each mesh is, in the same order as the mesh table.
+	std::vector<SceneInstance> meshInstances(meshCount);
+	for (size_t i = 0; i < objectCount; i++)
+	{
+		DrawableGameObject* object = m_app->m_drawableObjects[i];
 
-	// Gather all the instances into the builder helper
-	for (int i = 0; i < instances.size(); i++)
+		for (UINT lod = 0; lod <= object->m_lodLevels.size(); lod++)
+		{
+			UINT meshIndex = lod == 0 ? static_cast<UINT>(i) : object->m_lodMeshStart + lod - 1;
+			meshInstances[meshIndex].transformIndex = object->getTransformIndex();
+			meshInstances[meshIndex].object = static_cast<UINT>(i);
+			meshInstances[meshIndex].lod = lod;
+			meshInstances[meshIndex].meshIndex = meshIndex;
+		}
+	}
+
+	if (context->m_blasPool == nullptr)
 	{
-		context->m_topLevelASGenerator.AddInstance(
-			instances[i].first.Get(),
-			instances[i].second,
-			static_cast<UINT>(i),
-			static_cast<UINT>(i * 2)
-		);
+		context->m_blasPool = new AccelerationStructurePool(m_device, context->m_blasPageSize, L"BLAS Pool");
 	}
 
-	if (!update)
+	if (context->m_blasPolicySelector == nullptr)
 	{
-		// As for the bottom-level AS, the building the AS requires some scratch space
-		// to store temporary data in addition to the actual AS. In the case of the
-		// top-level AS, the instance descriptors also need to be stored in GPU
-		// memory. This call outputs the memory requirements for each (scratch,
-		// results, instance descriptors) so that the application can allocate the
-		// corresponding memory
-		UINT64 scratchSize, resultSize, instanceDescsSize;
+		context->m_blasPolicySelector = new DefaultBlasPolicySelector();
+	}
 
-		context->m_topLevelASGenerator.ComputeASBufferSizes(m_device.Get(), true, &scratchSize,
-			&resultSize, &instanceDescsSize);
+	// Pick each mesh's policy and size everything up front, so the builds can be batched over one scratch arena.
+	std::vector<nv_helpers_dx12::BottomLevelASGenerator> generators(meshCount);
+	std::vector<UINT64> resultSizes(meshCount);
+	context->m_blasReport.Clear();
 
-		// Create the scratch and result buffers. Since the build is all done on GPU,
-		// those can be allocated on the default heap
-		context->m_topLevelASBuffers.pScratch = nv_helpers_dx12::CreateBuffer(
-			m_device.Get(), scratchSize, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS,
-			D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
-			nv_helpers_dx12::kDefaultHeapProps);
-		context->m_topLevelASBuffers.pResult = nv_helpers_dx12::CreateBuffer(
-			m_device.Get(), resultSize, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS,
-			D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE,
-			nv_helpers_dx12::kDefaultHeapProps);
+	for (size_t i = 0; i < meshCount; i++)
+	{
+		DrawableGameObject* object = m_app->m_drawableObjects[meshInstances[i].object];
+		const MeshInfo& meshInfo = context->m_meshInfos[i];
 
-		// The buffer describing the instances: ID, shader binding information,
-		// matrices ... Those will be copied into the buffer by the helper through
-		// mapping, so the buffer has to be allocated on the upload heap.
-		context->m_topLevelASBuffers.pInstanceDesc = nv_helpers_dx12::CreateBuffer(
-			m_device.Get(), instanceDescsSize, D3D12_RESOURCE_FLAG_NONE,
-			D3D12_RESOURCE_STATE_GENERIC_READ, nv_helpers_dx12::kUploadHeapProps);
-	}
-	// After all the buffers are allocated, or if only an update is required, we
-	// can build the acceleration structure. Note that in the case of the update
-	// we also pass the existing AS as the 'previous' AS, so that it can be
-	// refitted in place.
-	context->m_topLevelASGenerator.Generate(context->m_commandList.Get(),
-		context->m_topLevelASBuffers.pScratch.Get(),
-		context->m_topLevelASBuffers.pResult.Get(),
-		context->m_topLevelASBuffers.pInstanceDesc.Get());
-}
-#pragma endregion
+		BlasMeshDescription mesh;
+		mesh.name = object->getObjectName();
+		if (meshInstances[i].lod > 0)
+		{
+			mesh.name += " LOD " + std::to_string(meshInstances[i].lod);
+		}
+		mesh.vertexCount = meshInfo.vertexCount;
+		mesh.indexCount = meshInfo.indexCount;
+		mesh.deforming = object->m_deformingMesh;
 
-#pragma region Shader Signature Methods
-//-----------------------------------------------------------------------------
-// The ray generation shader needs to access 2 resources: the raytracing output
-// and the top-level acceleration structure
-//
+		BlasBuildPolicy policy = context->m_blasPolicySelector->SelectPolicy(mesh);
 
-ComPtr<ID3D12RootSignature> DXRSetup::CreateRayGenSignature() {
-	nv_helpers_dx12::RootSignatureGenerator rsc;
-	rsc.AddHeapRangesParameter(
-		{ {0 /*u0*/, 1 /*1 descriptor */, 0 /*use the implicit register space 0*/,
-		  D3D12_DESCRIPTOR_RANGE_TYPE_UAV /* UAV representing the output buffer*/,
-		  0 /*heap slot where the UAV is defined*/},
-		 {0 /*t0*/, 1, 0,
-		  D3D12_DESCRIPTOR_RANGE_TYPE_SRV /*Top-level acceleration structure*/,
-		  1},{0 /*b0*/, 1, 0, D3D12_DESCRIPTOR_RANGE_TYPE_CBV /*Camera parameters*/, 2} });
+		UINT64 scratchSize = 0;
+		PrepareBottomLevelAS(meshInfo, policy, generators[i], &scratchSize, &resultSizes[i]);
 
-	return rsc.Generate(m_device.Get(), true);
-}
+		context->m_blasReport.AddBuild(mesh.name, policy, scratchSize, resultSizes[i]);
+	}
+
+	// Each build writes its compacted size in here, 8 bytes apiece, and it gets copied back to the CPU.
+	UINT64 compactedSizesBytes = max(static_cast<UINT64>(meshCount), 1ull) * sizeof(D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_COMPACTED_SIZE_DESC);
+	ComPtr<ID3D12Resource> compactedSizes = nv_helpers_dx12::CreateBuffer(
+		m_device.Get(), compactedSizesBytes, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS,
+		D3D12_RESOURCE_STATE_UNORDERED_ACCESS, nv_helpers_dx12::kDefaultHeapProps);
+
+	CD3DX12_HEAP_PROPERTIES readbackHeapProperties(D3D12_HEAP_TYPE_READBACK);
+	ComPtr<ID3D12Resource> compactedSizesReadback = nv_helpers_dx12::CreateBuffer(
+		m_device.Get(), compactedSizesBytes, D3D12_RESOURCE_FLAG_NONE,
+		D3D12_RESOURCE_STATE_COPY_DEST, readbackHeapProperties);
+
+	// The builds that get compacted only live until the copies are done, so they get their own pool
+	// and the pages can go once compaction has finished. The rest go straight into the real pool.
+	AccelerationStructurePool* buildPool = new AccelerationStructurePool(m_device, context->m_blasPageSize, L"BLAS Build Pool");
+	std::vector<AccelerationStructureAllocation> builtAS(meshCount);
+
+	for (size_t i = 0; i < meshCount; i++)
+	{
+		bool compacted = context->m_blasReport.GetEntries()[i].policy.allowCompaction;
+		builtAS[i] = compacted ? buildPool->Allocate(resultSizes[i]) : context->m_blasPool->Allocate(resultSizes[i]);
+	}
+
+	RecordBottomLevelASBuilds(generators, builtAS, compactedSizes.Get());
+
+	CD3DX12_RESOURCE_BARRIER toCopySource = CD3DX12_RESOURCE_BARRIER::Transition(compactedSizes.Get(),
+		D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_SOURCE);
+	context->m_commandList->ResourceBarrier(1, &toCopySource);
+	context->m_commandList->CopyResource(compactedSizesReadback.Get(), compactedSizes.Get());
+
+	// The compacted sizes are only known once the builds have actually run.
+	ExecuteSetupCommands();
+
+	CompactBottomLevelAS(builtAS, compactedSizesReadback.Get());
+
+	OutputDebugStringA(context->m_blasReport.Format().c_str());
+
+	// Each object's instances go next to each other, its full mesh first and then its levels.
+	for (size_t i = 0; i < objectCount; i++)
+	{
+		DrawableGameObject* object = m_app->m_drawableObjects[i];
+
+		for (UINT lod = 0; lod <= object->m_lodLevels.size(); lod++)
+		{
+			SceneInstance instance = meshInstances[lod == 0 ? i : object->m_lodMeshStart + lod - 1];
+			instance.blas = context->m_bottomLevelAS[instance.meshIndex].address;
+			m_app->m_instances.push_back(instance);
+
+			// The levels get their masks from the first cull, which happens before anything's traced.
+			m_app->m_instanceMasks.push_back(lod == 0 ? object->m_instanceMask : INSTANCE_MASK_NONE);
+
+			context->m_resourceTracker.Track(RESOURCE_BLAS, object->getObjectName(), lod == 0 ? "BLAS" : "LOD BLAS",
+				context->m_bottomLevelAS[instance.meshIndex].block.size);
+		}
+
+		// The picker gets its own copy of the triangles, the vertex data on the GPU isn't coming back.
+		TriangleMesh mesh;
+		for (const SimpleVertex& vertex : m_app->m_drawableObjects[i]->getVertices())
+		{
+			mesh.positions.push_back(RayVec3(vertex.Pos.x, vertex.Pos.y, vertex.Pos.z));
+		}
+		mesh.indices.assign(m_app->m_drawableObjects[i]->getIndices().begin(), m_app->m_drawableObjects[i]->getIndices().end());
+		m_app->m_picker.AddInstance(m_app->m_picker.AddMesh(mesh), m_app->m_drawableObjects[i]->getTransformIndex());
+	}
+
+	// Nothing's been simulated yet, but the matrices still need building once.
+	m_app->m_transforms.UpdateWorld(1.0f);
+	m_app->m_picker.Update(m_app->m_transforms);
+	CreateTopLevelAS(m_app->m_instances, m_app->m_instanceMasks, m_app->m_transforms, false);
+
+	ExecuteSetupCommands();
+
+	// Everything has been copied out of the build pool by now.
+	delete buildPool;
+}
+
+//-----------------------------------------------------------------------------
+//
+// Record every BLAS build back to back. Builds in the same batch each get their
+// own slice of the scratch arena, so they can overlap on the GPU and only need
+// the one barrier at the end of the batch. That barrier is also what lets the
+// next batch reuse the arena, and what the compaction copies and the TLAS build
+// wait on
+//
+void DXRSetup::RecordBottomLevelASBuilds(std::vector<nv_helpers_dx12::BottomLevelASGenerator>& generators,
+	const std::vector<AccelerationStructureAllocation>& builtAS, ID3D12Resource* compactedSizes)
+{
+	DXRContext* context = m_app->GetContext();
+
+	std::vector<uint64_t> scratchSizes(generators.size());
+	for (size_t i = 0; i < generators.size(); i++)
+	{
+		scratchSizes[i] = generators[i].GetScratchSizeInBytes();
+	}
+
+	BlasBuildBatcher batcher(context->m_blasScratchBudget, D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BYTE_ALIGNMENT);
+	std::vector<BlasBuildBatch> batches = batcher.Plan(scratchSizes);
+	D3D12_GPU_VIRTUAL_ADDRESS scratchAddress = GetBottomLevelScratch(BlasBuildBatcher::GetScratchBytes(batches));
+
+	for (const BlasBuildBatch& batch : batches)
+	{
+		for (const BlasBatchBuild& build : batch.builds)
+		{
+			D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC buildDesc = generators[build.index].GetBuildDesc(
+				scratchAddress + build.scratchOffset, builtAS[build.index].address);
+
+			if (!context->m_blasReport.GetEntries()[build.index].policy.allowCompaction)
+			{
+				context->m_commandList->BuildRaytracingAccelerationStructure(&buildDesc, 0, nullptr);
+				continue;
+			}
+
+			D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_DESC postbuildInfo = {};
+			postbuildInfo.InfoType = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_COMPACTED_SIZE;
+			postbuildInfo.DestBuffer = compactedSizes->GetGPUVirtualAddress() +
+				build.index * sizeof(D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_COMPACTED_SIZE_DESC);
+
+			context->m_commandList->BuildRaytracingAccelerationStructure(&buildDesc, 1, &postbuildInfo);
+		}
+
+		CD3DX12_RESOURCE_BARRIER uavBarrier = CD3DX12_RESOURCE_BARRIER::UAV(nullptr);
+		context->m_commandList->ResourceBarrier(1, &uavBarrier);
+	}
+
+	context->m_blasBuildBatches = static_cast<UINT>(batches.size());
+}
+
+//-----------------------------------------------------------------------------
+//
+// Copy every BLAS whose policy allows it into the pool at its compacted size.
+// Those builds wrote their compacted sizes out, which is usually a good bit
+// smaller than the worst case the prebuild info asked us to reserve
+//
+void DXRSetup::CompactBottomLevelAS(const std::vector<AccelerationStructureAllocation>& builtAS, ID3D12Resource* compactedSizes)
+{
+	DXRContext* context = m_app->GetContext();
+
+	D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_COMPACTED_SIZE_DESC* sizes = nullptr;
+	D3D12_RANGE readRange = { 0, builtAS.size() * sizeof(D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_COMPACTED_SIZE_DESC) };
+	ThrowIfFailed(compactedSizes->Map(0, &readRange, reinterpret_cast<void**>(&sizes)));
+
+	context->m_bottomLevelAS.resize(builtAS.size());
+
+	for (size_t i = 0; i < builtAS.size(); i++)
+	{
+		// Built for updates, it's already where it's staying.
+		if (!context->m_blasReport.GetEntries()[i].policy.allowCompaction)
+		{
+			context->m_bottomLevelAS[i] = builtAS[i];
+			continue;
+		}
+
+		UINT64 compactedSize = sizes[i].CompactedSizeInBytes;
+
+		context->m_bottomLevelAS[i] = context->m_blasPool->Allocate(compactedSize);
+		context->m_commandList->CopyRaytracingAccelerationStructure(context->m_bottomLevelAS[i].address, builtAS[i].address,
+			D3D12_RAYTRACING_ACCELERATION_STRUCTURE_COPY_MODE_COMPACT);
+
+		context->m_blasReport.SetCompactedSize(i, compactedSize);
+	}
+
+	D3D12_RANGE writeRange = { 0, 0 };
+	compactedSizes->Unmap(0, &writeRange);
+
+	// The TLAS build reads the copies, so they have to be finished first.
+	CD3DX12_RESOURCE_BARRIER uavBarrier = CD3DX12_RESOURCE_BARRIER::UAV(nullptr);
+	context->m_commandList->ResourceBarrier(1, &uavBarrier);
+}
+
+//-----------------------------------------------------------------------------
+//
+// Describe a mesh's BLAS, using its slice of the geometry pools, and work out
+// the sizes of the required buffers. The memory itself comes out of the pool and
+// the scratch arena
+//
+void DXRSetup::PrepareBottomLevelAS(const MeshInfo& mesh, const BlasBuildPolicy& policy,
+	nv_helpers_dx12::BottomLevelASGenerator& generator, UINT64* scratchSizeInBytes, UINT64* resultSizeInBytes)
+{
+	DXRContext* context = m_app->GetContext();
+
+	// The indices in the pool are relative to the object's first vertex, so offsetting the vertex buffer is enough.
+	UINT64 vertexOffsetInBytes = static_cast<UINT64>(mesh.vertexOffset) * sizeof(Vertex);
+	UINT64 indexOffsetInBytes = static_cast<UINT64>(mesh.indexOffset) * sizeof(UINT);
+
+	// Adding the vertex buffer and not transforming its position.
+	if (mesh.indexCount > 0)
+	{
+		generator.AddVertexBuffer(context->m_vertexPool.Get(), vertexOffsetInBytes,
+			mesh.vertexCount, sizeof(Vertex),
+			context->m_indexPool.Get(), indexOffsetInBytes,
+			mesh.indexCount, nullptr, 0, true);
+	}
+	else
+	{
+		generator.AddVertexBuffer(context->m_vertexPool.Get(), vertexOffsetInBytes, mesh.vertexCount,
+			sizeof(Vertex), 0, 0);
+	}
+
+	// The AS build requires some scratch space to store temporary information, and
+	// the final AS needs storing as well. Both depend on the scene complexity and
+	// on the build flags.
+	generator.ComputeASBufferSizes(m_device.Get(), GetBuildFlags(policy), scratchSizeInBytes, resultSizeInBytes);
+}
+
+//-----------------------------------------------------------------------------
+//
+// Turn a build policy into the D3D12 flags it stands for
+//
+D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAGS DXRSetup::GetBuildFlags(const BlasBuildPolicy& policy)
+{
+	D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAGS flags = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_NONE;
+
+	if (policy.preferFastTrace)
+	{
+		flags |= D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_TRACE;
+	}
+	if (policy.preferFastBuild)
+	{
+		flags |= D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_BUILD;
+	}
+	if (policy.allowUpdate)
+	{
+		flags |= D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_UPDATE;
+	}
+	if (policy.allowCompaction)
+	{
+		flags |= D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_COMPACTION;
+	}
+
+	return flags;
+}
+
+//-----------------------------------------------------------------------------
+//
+// The scratch space is only needed while a build is running, so one buffer is
+// sliced up between the builds of a batch and reused by the next batch, rather
+// than one per object
+//
+D3D12_GPU_VIRTUAL_ADDRESS DXRSetup::GetBottomLevelScratch(UINT64 sizeInBytes)
+{
+	DXRContext* context = m_app->GetContext();
+
+	if (context->m_blasScratch == nullptr || context->m_blasScratchSize < sizeInBytes)
+	{
+		// Builds already recorded might still use the old one.
+		if (context->m_blasScratch != nullptr)
+		{
+			ComPtr<ID3D12Resource> oldScratch = context->m_blasScratch;
+			context->m_framePacer->Retire([oldScratch]() {});
+		}
+
+		context->m_blasScratch = nv_helpers_dx12::CreateBuffer(
+			m_device.Get(), sizeInBytes, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS,
+			D3D12_RESOURCE_STATE_UNORDERED_ACCESS, nv_helpers_dx12::kDefaultHeapProps);
+		context->m_blasScratch->SetName(L"BLAS Scratch Arena");
+		context->m_blasScratchSize = sizeInBytes;
+
+		context->m_resourceTracker.Untrack(context->m_blasScratchTrackingId);
+		context->m_blasScratchTrackingId = context->m_resourceTracker.Track(RESOURCE_AS_SCRATCH, "Scene", "BLAS Scratch Arena",
+			GetAllocationSize(context->m_blasScratch.Get()));
+	}
+
+	return context->m_blasScratch->GetGPUVirtualAddress();
+}
+
+//-----------------------------------------------------------------------------
+//
+// Close and run the command list, wait for it to finish, then reset it so
+// setup can carry on recording
+//
+void DXRSetup::ExecuteSetupCommands()
+{
+	DXRContext* context = m_app->GetContext();
+
+	// Flush the command list and wait for it to finish
+	ThrowIfFailed(context->m_commandList->Close());
+	ID3D12CommandList* ppCommandLists[] = { context->m_commandList.Get() };
+	context->m_commandQueue->ExecuteCommandLists(1, ppCommandLists);
+	m_app->WaitForGpuIdle();
+
+	// Once the command list is finished executing, reset it to be reused
+	ThrowIfFailed(
+		context->m_commandList->Reset(context->m_commandAllocators[0].Get(), nullptr));
+}
+
+//-----------------------------------------------------------------------------
+//
+// What a resource really takes up on the GPU, alignment and all, rather than
+// the size it was asked for
+//
+UINT64 DXRSetup::GetAllocationSize(ID3D12Resource* resource)
+{
+	D3D12_RESOURCE_DESC desc = resource->GetDesc();
+	return m_device->GetResourceAllocationInfo(0, 1, &desc).SizeInBytes;
+}
+
+//-----------------------------------------------------------------------------
+// Create the main acceleration structure that holds all instances of the scene.
+// Similarly to the bottom-level AS generation, it is done in 3 steps: gathering
+// the instances, computing the memory requirements for the AS, and building the
+// AS itself
+//
+void DXRSetup::CreateTopLevelAS(
+	const std::vector<SceneInstance>& instances, const std::vector<UINT>& masks,
+	const TransformBatch& transforms, bool update
+) {
+	PROFILE_CPU_SCOPE("CreateTopLevelAS");
+
+	DXRContext* context = m_app->GetContext();
+
+	context->m_topLevelASGenerator.RemoveAllInstances();
+
+	// Gather all the instances into the builder helper. The ones no ray can hit are left out, apart from on the first
+	// build, which sizes the buffers for every instance so a later frame can't need more room than it has. They keep their
+	// own ID and hit group whatever else is left out, those are how the shaders find the mesh and the object's material.
+	// An object's LOD levels share its hit group, it's only the mesh that's different.
+	for (int i = 0; i < instances.size(); i++)
+	{
+		if (update && masks[i] == INSTANCE_MASK_NONE)
+		{
+			continue;
+		}
+
+		context->m_topLevelASGenerator.AddInstance(
+			instances[i].blas,
+			transforms.GetWorld(instances[i].transformIndex),
+			instances[i].meshIndex,
+			instances[i].object * 2,
+			masks[i]
+		);
+	}
+
+	if (!update)
+	{
+		// As for the bottom-level AS, the building the AS requires some scratch space
+		// to store temporary data in addition to the actual AS. In the case of the
+		// top-level AS, the instance descriptors also need to be stored in GPU
+		// memory. This call outputs the memory requirements for each (scratch,
+		// results, instance descriptors) so that the application can allocate the
+		// corresponding memory
+		UINT64 scratchSize, resultSize, instanceDescsSize;
+
+		context->m_topLevelASGenerator.ComputeASBufferSizes(m_device.Get(), true, &scratchSize,
+			&resultSize, &instanceDescsSize);
+
+		// Create the scratch and result buffers. Since the build is all done on GPU,
+		// those can be allocated on the default heap
+		context->m_topLevelASBuffers.pScratch = nv_helpers_dx12::CreateBuffer(
+			m_device.Get(), scratchSize, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS,
+			D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+			nv_helpers_dx12::kDefaultHeapProps);
+		context->m_topLevelASBuffers.pResult = nv_helpers_dx12::CreateBuffer(
+			m_device.Get(), resultSize, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS,
+			D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE,
+			nv_helpers_dx12::kDefaultHeapProps);
+
+		// The buffer describing the instances: ID, shader binding information,
+		// matrices ... Those will be copied into the buffer by the helper through
+		// mapping, so the buffer has to be allocated on the upload heap. The CPU
+		// writes it every frame, so there's one per frame in flight.
+		for (UINT n = 0; n < FrameCount; n++)
+		{
+			context->m_frameInstanceDescs[n] = nv_helpers_dx12::CreateBuffer(
+				m_device.Get(), instanceDescsSize, D3D12_RESOURCE_FLAG_NONE,
+				D3D12_RESOURCE_STATE_GENERIC_READ, nv_helpers_dx12::kUploadHeapProps);
+		}
+
+		for (uint64_t trackingId : context->m_tlasTrackingIds)
+		{
+			context->m_resourceTracker.Untrack(trackingId);
+		}
+		context->m_tlasTrackingIds.clear();
+
+		ResourceTracker& tracker = context->m_resourceTracker;
+		context->m_tlasTrackingIds.push_back(tracker.Track(RESOURCE_TLAS, "Scene", "TLAS",
+			GetAllocationSize(context->m_topLevelASBuffers.pResult.Get())));
+		context->m_tlasTrackingIds.push_back(tracker.Track(RESOURCE_AS_SCRATCH, "Scene", "TLAS Scratch",
+			GetAllocationSize(context->m_topLevelASBuffers.pScratch.Get())));
+		context->m_tlasTrackingIds.push_back(tracker.Track(RESOURCE_TLAS, "Scene", "TLAS Instance Descriptors",
+			GetAllocationSize(context->m_frameInstanceDescs[0].Get()) * FrameCount));
+	}
+
+	// The scratch and result buffers are shared between frames, they're only touched by the GPU and
+	// everything goes down the one queue, so frame N + 1's build can't start before frame N's rays are done.
+	context->m_topLevelASBuffers.pInstanceDesc = context->m_frameInstanceDescs[context->GetFrameSlot()];
+
+	// After all the buffers are allocated, or if only an update is required, we
+	// can build the acceleration structure. Note that in the case of the update
+	// we also pass the existing AS as the 'previous' AS, so that it can be
+	// refitted in place.
+	context->m_topLevelASGenerator.Generate(context->m_commandList.Get(),
+		context->m_topLevelASBuffers.pScratch.Get(),
+		context->m_topLevelASBuffers.pResult.Get(),
+		context->m_topLevelASBuffers.pInstanceDesc.Get());
+}
+#pragma endregion
+
+#pragma region Shader Signature Methods
+//-----------------------------------------------------------------------------
+// The ray generation shader needs to access 2 resources: the raytracing output
+// and the top-level acceleration structure
+//
+
+ComPtr<ID3D12RootSignature> DXRSetup::CreateRayGenSignature() {
+	nv_helpers_dx12::RootSignatureGenerator rsc;
+	rsc.AddHeapRangesParameter(
+		{ {0 /*u0*/, 1 /*1 descriptor */, 0 /*use the implicit register space 0*/,
+		  D3D12_DESCRIPTOR_RANGE_TYPE_UAV /* UAV representing the output buffer*/,
+		  0 /*heap slot where the UAV is defined*/},
+		 {0 /*t0*/, 1, 0,
+		  D3D12_DESCRIPTOR_RANGE_TYPE_SRV /*Top-level acceleration structure*/,
+		  1},{0 /*b0*/, 1, 0, D3D12_DESCRIPTOR_RANGE_TYPE_CBV /*Camera parameters*/, 2} });
+	rsc.AddRootParameter(D3D12_ROOT_PARAMETER_TYPE_UAV, 1 /*u1*/); // Ray counters
+
+	return rsc.Generate(m_device.Get(), true);
+}
 
 //-----------------------------------------------------------------------------
 // The hit shader communicates only through the ray payload, and therefore does
@@ -987,15 +1673,19 @@ ComPtr<ID3D12RootSignature> DXRSetup::CreateRayGenSignature() {
 //
 ComPtr<ID3D12RootSignature> DXRSetup::CreateHitSignature() {
 	nv_helpers_dx12::RootSignatureGenerator rsc;
-	rsc.AddRootParameter(D3D12_ROOT_PARAMETER_TYPE_SRV, 0 /*t0*/); // vertex data
-	rsc.AddRootParameter(D3D12_ROOT_PARAMETER_TYPE_SRV, 1 /*t1*/); // indices
+	rsc.AddRootParameter(D3D12_ROOT_PARAMETER_TYPE_SRV, 0 /*t0*/); // Global vertex pool
+	rsc.AddRootParameter(D3D12_ROOT_PARAMETER_TYPE_SRV, 1 /*t1*/); // Global index pool
 	rsc.AddRootParameter(D3D12_ROOT_PARAMETER_TYPE_CBV, 0 /*b0*/); // Lighting buffer
-	rsc.AddRootParameter(D3D12_ROOT_PARAMETER_TYPE_CBV, 1 /*b1*/); // Material buffer
+	rsc.AddRootParameter(D3D12_ROOT_PARAMETER_TYPE_SRV, 0 /*t0*/, 1 /*space1*/); // Material table
+	rsc.AddRootParameter(D3D12_ROOT_PARAMETER_TYPE_SRV, 1 /*t1*/, 1 /*space1*/); // Mesh offset table
 	rsc.AddHeapRangesParameter({ { 2 /*t2*/, 1, 0, D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1 /*2nd slot of the heap (see CreateShaderResourceHeap() */ }, });/*Top-level acceleration structure*/
 
+	// Every texture in the heap, the material's texture index picks which one gets sampled.
+	// g_textures[] is unbounded in Hit.hlsl, so the range has to be unbounded too and stay the last one in its table.
 	rsc.AddHeapRangesParameter({
-	   { 3 /* shader register t3 */, m_textureNumber + m_staticTextures->size() + 1, 0, D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 3 }
+	   { 3 /* shader register t3 */, UINT_MAX /* unbounded */, 0, D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 3 }
 		});
+	rsc.AddRootParameter(D3D12_ROOT_PARAMETER_TYPE_UAV, 1 /*u1*/); // Ray counters
 
 	D3D12_STATIC_SAMPLER_DESC staticSamplerDesc;
 
@@ -1030,6 +1720,7 @@ ComPtr<ID3D12RootSignature> DXRSetup::CreateMissSignature() {
 		 {0 /*t0*/, 1, 0,
 		  D3D12_DESCRIPTOR_RANGE_TYPE_SRV /*Top-level acceleration structure*/,
 		  1},{0 /*b0*/, 1, 0, D3D12_DESCRIPTOR_RANGE_TYPE_CBV /*Camera parameters*/, 2} });
+	rsc.AddRootParameter(D3D12_ROOT_PARAMETER_TYPE_UAV, 1 /*u1*/); // Ray counters
 	return rsc.Generate(m_device.Get(), true);
 }
 
@@ -1110,16 +1801,56 @@ void DXRSetup::CreateRaytracingPipeline()
 {
 	DXRContext* context = m_app->GetContext();
 
-	nv_helpers_dx12::RayTracingPipelineGenerator pipeline(m_device.Get());
-
 	// The pipeline contains the DXIL code of all the shaders potentially executed
 	// during the raytracing process. This section compiles the HLSL code into a
 	// set of DXIL libraries. We chose to separate the code in several libraries
 	// by semantic (ray generation, hit, miss) for clarity. Any code layout can be
 	// used.
-	context->m_rayGenLibrary = nv_helpers_dx12::CompileShaderLibrary(L"RayGen.hlsl");
-	context->m_missLibrary = nv_helpers_dx12::CompileShaderLibrary(L"Miss.hlsl");
-	context->m_hitLibrary = nv_helpers_dx12::CompileShaderLibrary(L"Hit.hlsl");
+	// The compiled libraries are cached on disk, keyed on the shader source (and includes), defines and the DXC version.
+	if (!context->m_shaderCache)
+	{
+		CreateDirectoryA(m_shaderCacheDirectory.c_str(), nullptr); // Fails harmlessly if it already exists
+		context->m_shaderCache = new ShaderCache(m_shaderCacheDirectory);
+	}
+
+	context->m_rayGenLibrary = nv_helpers_dx12::CompileShaderLibrary(L"RayGen.hlsl", context->m_shaderCache);
+	context->m_missLibrary = nv_helpers_dx12::CompileShaderLibrary(L"Miss.hlsl", context->m_shaderCache);
+	context->m_hitLibrary = nv_helpers_dx12::CompileShaderLibrary(L"Hit.hlsl", context->m_shaderCache);
+
+	// Compile the specialised hit shader variants the scene needs right now.
+	CompileHitPermutations();
+
+	GenerateRaytracingPipeline();
+}
+
+// Rebuilds the pipeline from the already compiled libraries, releasing the old one first.
+
+void DXRSetup::UpdateRaytracingPipeline()
+{
+	DXRContext* context = m_app->GetContext();
+
+	// The frames still in flight were recorded with the old pipeline, so hand it to the frame pacer
+	// to let go of once they're done instead of pulling it out from under the GPU.
+	context->m_framePacer->Retire([stateObject = context->m_rtStateObject, stateObjectProps = context->m_rtStateObjectProps,
+		hitSignature = context->m_hitSignature, missSignature = context->m_missSignature, rayGenSignature = context->m_rayGenSignature]() {});
+
+	// ComPtr handles the release, calling Release() on top of Reset() would drop the reference twice.
+	context->m_rtStateObject.Reset();
+	context->m_rtStateObjectProps.Reset();
+	context->m_hitSignature.Reset();
+	context->m_missSignature.Reset();
+	context->m_rayGenSignature.Reset();
+
+	GenerateRaytracingPipeline();
+}
+
+// Builds the state object out of the already compiled libraries, shared by the create and update paths.
+
+void DXRSetup::GenerateRaytracingPipeline()
+{
+	DXRContext* context = m_app->GetContext();
+
+	nv_helpers_dx12::RayTracingPipelineGenerator pipeline(m_device.Get());
 
 	// In a way similar to DLLs, each library is associated with a number of
 	// exported symbols. This
@@ -1130,6 +1861,14 @@ void DXRSetup::CreateRaytracingPipeline()
 	pipeline.AddLibrary(context->m_missLibrary.Get(), { L"Miss" ,L"ShadowMiss" });
 	pipeline.AddLibrary(context->m_hitLibrary.Get(), { L"ClosestHit",L"AnyHit",L"PlaneClosestHit", L"ShadowHit" });
 
+	// Each variant library only exports its own closest hit shaders, so the names never clash with the uber shader's.
+	// Only the variants the scene is using go in, the rest stay compiled on the side in case they come back.
+	for (UINT features : m_activeHitPermutations)
+	{
+		pipeline.AddLibrary(context->m_hitPermutationLibraries[features].Get(), { GetHitPermutationEntryName(L"ClosestHit", features),
+			GetHitPermutationEntryName(L"PlaneClosestHit", features) });
+	}
+
 	// To be used, each DX12 shader needs a root signature defining which
 	// parameters and buffers will be accessed.
 	context->m_rayGenSignature = CreateRayGenSignature();
@@ -1154,17 +1893,10 @@ void DXRSetup::CreateRaytracingPipeline()
 	// Hit group for the triangles, with a shader simply interpolating vertex
 	// colors
 
-	// Super based way of giving each object a hit group.
+	// Super based way of giving each object a hit group, with the closest hit variant that matches its features.
 	for (int i = 0; i < m_app->m_drawableObjects.size(); i++)
 	{
-		if (m_app->m_drawableObjects[i]->m_planeMesh)
-		{
-			pipeline.AddHitGroup(m_app->m_drawableObjects[i]->m_objectHitGroupName, L"PlaneClosestHit", L"AnyHit");
-		}
-		else
-		{
-			pipeline.AddHitGroup(m_app->m_drawableObjects[i]->m_objectHitGroupName, L"ClosestHit", L"AnyHit");
-		}
+		pipeline.AddHitGroup(m_app->m_drawableObjects[i]->m_objectHitGroupName, GetClosestHitName(m_app->m_drawableObjects[i]), L"AnyHit");
 	}
 
 	pipeline.AddHitGroup(L"ShadowHitGroup", L"ShadowHit");
@@ -1188,7 +1920,7 @@ void DXRSetup::CreateRaytracingPipeline()
 	// exchanged between shaders, such as the HitInfo structure in the HLSL code.
 	// It is important to keep this value as low as possible as a too high value
 	// would result in unnecessary memory consumption and cache trashing.
-	pipeline.SetMaxPayloadSize(5 * sizeof(float)); // RGB + distance + Recursion depth
+	pipeline.SetMaxPayloadSize(7 * sizeof(float)); // RGB + distance + Recursion depth + ray cone
 
 	// Upon hitting a surface, DXR can provide several attributes to the hit. In
 	// our sample we just use the barycentric coordinates defined by the weights
@@ -1212,109 +1944,83 @@ void DXRSetup::CreateRaytracingPipeline()
 		context->m_rtStateObject->QueryInterface(IID_PPV_ARGS(&context->m_rtStateObjectProps)));
 }
 
-// Just the same again, but this time we are releasing the old pipeline.
+// Works out which hit shader variant each object needs, and compiles any we haven't got yet.
 
-void DXRSetup::UpdateRaytracingPipeline()
+void DXRSetup::CompileHitPermutations()
 {
 	DXRContext* context = m_app->GetContext();
 
-	context->m_rtStateObject->Release();
-	context->m_rtStateObject.Reset();
+	m_activeHitPermutations.clear();
 
-	context->m_rtStateObjectProps->Release();
-	context->m_rtStateObjectProps.Reset();
-
-	context->m_hitSignature->Release();
-	context->m_hitSignature.Reset();
-	context->m_missSignature->Release();
-	context->m_missSignature.Reset();
-	context->m_rayGenSignature->Release();
-	context->m_rayGenSignature.Reset();
-	nv_helpers_dx12::RayTracingPipelineGenerator pipeline(m_device.Get());
+	for (auto& object : m_app->m_drawableObjects)
+	{
+		object->m_hitShaderFeatures = object->getHitShaderFeatures(m_shadows);
 
-	pipeline.AddLibrary(context->m_rayGenLibrary.Get(), { L"RayGen" });
-	pipeline.AddLibrary(context->m_missLibrary.Get(), { L"Miss" ,L"ShadowMiss" });
-	pipeline.AddLibrary(context->m_hitLibrary.Get(), { L"ClosestHit",L"AnyHit",L"PlaneClosestHit", L"ShadowHit" });
+		if (m_useHitPermutations)
+		{
+			m_activeHitPermutations.insert(object->m_hitShaderFeatures);
+		}
+	}
 
-	// To be used, each DX12 shader needs a root signature defining which
-// parameters and buffers will be accessed.
-	context->m_rayGenSignature = CreateRayGenSignature();
-	context->m_missSignature = CreateMissSignature();
-	context->m_hitSignature = CreateHitSignature();
+	// Variants are kept around once compiled (and the shader cache keeps them on disk), so flicking a setting back is free.
+	for (UINT features : m_activeHitPermutations)
+	{
+		if (context->m_hitPermutationLibraries.count(features) != 0)
+		{
+			continue;
+		}
 
-	// 3 different shaders can be invoked to obtain an intersection: an
-	// intersection shader is called
-	// when hitting the bounding box of non-triangular geometry. This is beyond
-	// the scope of this tutorial. An any-hit shader is called on potential
-	// intersections. This shader can, for example, perform alpha-testing and
-	// discard some intersections. Finally, the closest-hit program is invoked on
-	// the intersection point closest to the ray origin. Those 3 shaders are bound
-	// together into a hit group.
+		context->m_hitPermutationLibraries[features] = nv_helpers_dx12::CompileShaderLibrary(L"Hit.hlsl", context->m_shaderCache,
+			{ L"HIT_PERMUTATION=" + std::to_wstring(features) });
+	}
 
-	// Note that for triangular geometry the intersection shader is built-in. An
-	// empty any-hit shader is also defined by default, so in our simple case each
-	// hit group contains only the closest hit shader. Note that since the
-	// exported symbols are defined above the shaders can be simply referred to by
-	// name.
+	m_pipelineUsesHitPermutations = m_useHitPermutations;
+}
 
-	// Hit group for the triangles, with a shader simply interpolating vertex
-	// colors
+bool DXRSetup::UpdateHitPermutations()
+{
+	bool changed = m_pipelineUsesHitPermutations != m_useHitPermutations;
 
-	for (int i = 0; i < m_app->m_drawableObjects.size(); i++)
+	if (m_useHitPermutations)
 	{
-		if (m_app->m_drawableObjects[i]->m_planeMesh)
-		{
-			pipeline.AddHitGroup(m_app->m_drawableObjects[i]->m_objectHitGroupName, L"PlaneClosestHit", L"AnyHit");
-		}
-		else
+		for (auto& object : m_app->m_drawableObjects)
 		{
-			pipeline.AddHitGroup(m_app->m_drawableObjects[i]->m_objectHitGroupName, L"ClosestHit", L"AnyHit");
+			if (object->getHitShaderFeatures(m_shadows) != object->m_hitShaderFeatures)
+			{
+				changed = true;
+				break;
+			}
 		}
 	}
 
-	pipeline.AddHitGroup(L"ShadowHitGroup", L"ShadowHit");
-
-	// The following section associates the root signature to each shader. Note
-	// that we can explicitly show that some shaders share the same root signature
-	// (eg. Miss and ShadowMiss). Note that the hit shaders are now only referred
-	// to as hit groups, meaning that the underlying intersection, any-hit and
-	// closest-hit shaders share the same root signature.
-	pipeline.AddRootSignatureAssociation(context->m_rayGenSignature.Get(), { L"RayGen" });
-	pipeline.AddRootSignatureAssociation(context->m_missSignature.Get(), { L"Miss", L"ShadowMiss" });
-
-	for (int i = 0; i < m_app->m_drawableObjects.size(); i++)
+	if (!changed)
 	{
-		pipeline.AddRootSignatureAssociation(context->m_hitSignature.Get(), { m_app->m_drawableObjects[i]->m_objectHitGroupName });
+		return false;
 	}
-	pipeline.AddRootSignatureAssociation(context->m_hitSignature.Get(), { L"ShadowHitGroup" });
 
-	// The payload size defines the maximum size of the data carried by the rays,
-	// ie. the the data
-	// exchanged between shaders, such as the HitInfo structure in the HLSL code.
-	// It is important to keep this value as low as possible as a too high value
-	// would result in unnecessary memory consumption and cache trashing.
-	pipeline.SetMaxPayloadSize(5 * sizeof(float)); // RGB + distance + Recursion depth
+	// Something switched a feature on or off, so swap the affected objects over to their new variant.
+	CompileHitPermutations();
+	UpdateRaytracingPipeline();
+	UpdateShaderBindingTable();
 
-	// Upon hitting a surface, DXR can provide several attributes to the hit. In
-	// our sample we just use the barycentric coordinates defined by the weights
-	// u,v of the last two vertices of the triangle. The actual barycentrics can
-	// be obtained using float3 barycentrics = float3(1.f-u-v, u, v);
-	pipeline.SetMaxAttributeSize(2 * sizeof(float)); // barycentric coordinates
+	return true;
+}
 
-	// The raytracing process can shoot rays from existing hit points, resulting
-	// in nested TraceRay calls. Our sample code traces only primary rays, which
-	// then requires a trace depth of 1. Note that this recursion depth should be
-	// kept to a minimum for best performance. Path tracing algorithms can be
-	// easily flattened into a simple loop in the ray generation.
-	pipeline.SetMaxRecursionDepth(30);
+wstring DXRSetup::GetHitPermutationEntryName(const wstring& entryName, UINT features)
+{
+	return entryName + L"_" + std::to_wstring(features);
+}
 
-	// Compile the pipeline for execution on the GPU
-	context->m_rtStateObject = pipeline.Generate();
+wstring DXRSetup::GetClosestHitName(DrawableGameObject* object)
+{
+	wstring entryName = object->m_planeMesh ? L"PlaneClosestHit" : L"ClosestHit";
 
-	// Cast the state object into a properties object, allowing to later access
-	// the shader pointers by name
-	ThrowIfFailed(
-		context->m_rtStateObject->QueryInterface(IID_PPV_ARGS(&context->m_rtStateObjectProps)));
+	if (!m_pipelineUsesHitPermutations)
+	{
+		return entryName;
+	}
+
+	return GetHitPermutationEntryName(entryName, object->m_hitShaderFeatures);
 }
 
 //-----------------------------------------------------------------------------
@@ -1351,14 +2057,43 @@ void DXRSetup::CreateRaytracingOutputBuffer()
 // Create the main heap used by the shaders, which will give access to the
 // raytracing output and the top-level acceleration structure
 //
+void DXRSetup::CreateRayCounterBuffers()
+{
+	DXRContext* context = m_app->GetContext();
+	const UINT64 counterBytes = sizeof(uint32_t) * RAY_COUNTER_COUNT;
+
+	// Bound as a root UAV, so it doesn't need a slot in the descriptor heap.
+	context->m_rayCounters = nv_helpers_dx12::CreateBuffer(
+		m_device.Get(), counterBytes, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS,
+		D3D12_RESOURCE_STATE_COMMON, nv_helpers_dx12::kDefaultHeapProps);
+	context->m_rayCounters->SetName(L"Ray Counters");
+
+	context->m_rayCounterZeros = nv_helpers_dx12::CreateBuffer(
+		m_device.Get(), counterBytes, D3D12_RESOURCE_FLAG_NONE,
+		D3D12_RESOURCE_STATE_GENERIC_READ, nv_helpers_dx12::kUploadHeapProps);
+
+	uint8_t* pData;
+	ThrowIfFailed(context->m_rayCounterZeros->Map(0, nullptr, reinterpret_cast<void**>(&pData)));
+	memset(pData, 0, counterBytes);
+	context->m_rayCounterZeros->Unmap(0, nullptr);
+
+	// One set of counts per frame slot, so a frame in flight never writes over the ones being read.
+	CD3DX12_HEAP_PROPERTIES readbackHeap(D3D12_HEAP_TYPE_READBACK);
+	context->m_rayCounterReadback = nv_helpers_dx12::CreateBuffer(
+		m_device.Get(), counterBytes * FrameCount, D3D12_RESOURCE_FLAG_NONE,
+		D3D12_RESOURCE_STATE_COPY_DEST, readbackHeap);
+	context->m_rayCounterReadback->SetName(L"Ray Counter Readback");
+}
+
 void DXRSetup::CreateShaderResourceHeap()
 {
 	DXRContext* context = m_app->GetContext();
 
 	// Create a SRV/UAV/CBV descriptor heap. We need 2 entries - 1 UAV for the
 	// raytracing output and 1 SRV for the TLAS
+	// The texture range always gets at least one slot, a scene without textures binds a null SRV there.
 	context->m_srvUavHeap = nv_helpers_dx12::CreateDescriptorHeap(
-		m_device.Get(), 3 + m_textureNumber, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, true);
+		m_device.Get(), 3 + (m_textureNumber > 0 ? m_textureNumber : 1), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, true);
 
 	// Get a handle to the heap memory on the CPU side, to be able to write the
 	// descriptors directly
@@ -1450,6 +2185,17 @@ void DXRSetup::CreateShaderResourceHeap()
 		srvHandle.ptr += m_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
 		heapPointer++;
 	}
+
+	// No textures at all, fill the first texture slot with a null SRV so the range never points at an empty descriptor.
+	if (heapPointer == 0)
+	{
+		D3D12_SHADER_RESOURCE_VIEW_DESC nullDesc = {};
+		nullDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+		nullDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+		nullDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+		nullDesc.Texture2D.MipLevels = 1;
+		m_device->CreateShaderResourceView(nullptr, &nullDesc, srvHandle);
+	}
 }
 
 //-----------------------------------------------------------------------------
@@ -1480,55 +2226,33 @@ void DXRSetup::CreateShaderBindingTable()
 	// struct is a UINT64, which then has to be reinterpreted as a pointer.
 	auto heapPointer = reinterpret_cast<UINT64*>(srvUavHeapHandle.ptr);
 
+	// Every shader counts the rays it traces, so they all get the counter buffer after their own arguments.
+	void* rayCounters = (void*)(context->m_rayCounters->GetGPUVirtualAddress());
+
 	// The ray generation only uses heap data
-	context->m_sbtHelper.AddRayGenerationProgram(L"RayGen", { heapPointer });
+	context->m_sbtHelper.AddRayGenerationProgram(L"RayGen", { heapPointer, rayCounters });
 
 	// The miss and hit shaders do not access any external resources: instead they
 	// communicate their results through the ray payload
-	context->m_sbtHelper.AddMissProgram(L"Miss", { heapPointer });
-	context->m_sbtHelper.AddMissProgram(L"ShadowMiss", { heapPointer });
+	context->m_sbtHelper.AddMissProgram(L"Miss", { heapPointer, rayCounters });
+	context->m_sbtHelper.AddMissProgram(L"ShadowMiss", { heapPointer, rayCounters });
+
+	// Every object gets the exact same arguments, the hit shaders use InstanceID() to find their mesh and material.
+	// That means swapping a texture or tweaking a material never needs the SBT to be rebuilt.
+	std::vector<void*> hitGroupArguments = {
+		(void*)(context->m_vertexPool->GetGPUVirtualAddress()),
+		(void*)(context->m_indexPool->GetGPUVirtualAddress()),
+		(void*)(context->m_lightingBuffer->GetGPUVirtualAddress()),
+		(void*)(context->m_materialTable->GetGPUVirtualAddress()),
+		(void*)(context->m_meshInfoBuffer->GetGPUVirtualAddress()),
+		heapPointer,
+		heapPointer,
+		rayCounters };
 
 	for (int i = 0; i < m_app->m_drawableObjects.size(); i++)
 	{
-		if (m_app->m_drawableObjects[i]->m_textureFile != L"NULL") // Make sure the object has a texture.
-		{
-			srvUavHeapHandle = context->m_srvUavHeap->GetGPUDescriptorHandleForHeapStart(); // Go to the start of the heap.
-
-			srvUavHeapHandle.ptr += m_device->GetDescriptorHandleIncrementSize(
-				D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV) * m_app->m_drawableObjects[i]->m_heapTextureNumber; // Get the texture from the heap
-
-			auto textureHeapPointer = reinterpret_cast<UINT64*>(srvUavHeapHandle.ptr); // Get the pointer to the texture.
-
-			context->m_sbtHelper.AddHitGroup(m_app->m_drawableObjects[i]->m_objectHitGroupName,
-				{ (void*)(m_app->m_drawableObjects[i]->getVertexBuffer()->GetGPUVirtualAddress()),
-					(void*)(m_app->m_drawableObjects[i]->getIndexBuffer()->GetGPUVirtualAddress()),
-					(void*)(m_app->m_DXRContext->m_lightingBuffer->GetGPUVirtualAddress()),
-				(void*)(m_app->m_drawableObjects[i]->m_materialBuffer->GetGPUVirtualAddress())
-				, heapPointer,textureHeapPointer });
-
-			context->m_sbtHelper.AddHitGroup(L"ShadowHitGroup",
-				{ (void*)(m_app->m_drawableObjects[i]->getVertexBuffer()->GetGPUVirtualAddress()),
-					(void*)(m_app->m_drawableObjects[i]->getIndexBuffer()->GetGPUVirtualAddress()),
-					(void*)(m_app->m_DXRContext->m_lightingBuffer->GetGPUVirtualAddress()),
-					(void*)(m_app->m_drawableObjects[i]->m_materialBuffer->GetGPUVirtualAddress())
-				,heapPointer,textureHeapPointer });
-		}
-		else
-		{
-			context->m_sbtHelper.AddHitGroup(m_app->m_drawableObjects[i]->m_objectHitGroupName,
-				{ (void*)(m_app->m_drawableObjects[i]->getVertexBuffer()->GetGPUVirtualAddress()),
-					(void*)(m_app->m_drawableObjects[i]->getIndexBuffer()->GetGPUVirtualAddress()),
-					(void*)(m_app->m_DXRContext->m_lightingBuffer->GetGPUVirtualAddress()),
-				(void*)(m_app->m_drawableObjects[i]->m_materialBuffer->GetGPUVirtualAddress())
-				, heapPointer,nullptr });
-
-			context->m_sbtHelper.AddHitGroup(L"ShadowHitGroup",
-				{ (void*)(m_app->m_drawableObjects[i]->getVertexBuffer()->GetGPUVirtualAddress()),
-					(void*)(m_app->m_drawableObjects[i]->getIndexBuffer()->GetGPUVirtualAddress()),
-					(void*)(m_app->m_DXRContext->m_lightingBuffer->GetGPUVirtualAddress()),
-					(void*)(m_app->m_drawableObjects[i]->m_materialBuffer->GetGPUVirtualAddress())
-				,heapPointer,nullptr });
-		}
+		context->m_sbtHelper.AddHitGroup(m_app->m_drawableObjects[i]->m_objectHitGroupName, hitGroupArguments);
+		context->m_sbtHelper.AddHitGroup(L"ShadowHitGroup", hitGroupArguments);
 	}
 
 	// Compute the size of the SBT given the number of shaders and their
@@ -1544,97 +2268,26 @@ void DXRSetup::CreateShaderBindingTable()
 	if (!context->m_sbtStorage) {
 		throw std::logic_error("Could not allocate the shader binding table");
 	}
+
+	// The old table (if this is a rebuild) was untracked when it was retired.
+	context->m_sbtTrackingId = context->m_resourceTracker.Track(RESOURCE_SBT, "Scene", "Shader Binding Table",
+		GetAllocationSize(context->m_sbtStorage.Get()));
 	// Compile the SBT from the shader and parameters info
 	context->m_sbtHelper.Generate(context->m_sbtStorage.Get(), context->m_rtStateObjectProps.Get());
 }
 
-// The same again, but this time we are releasing the old SBT.
+// Release the old SBT and build it again, only needed when the pipeline has been recreated.
 
 void DXRSetup::UpdateShaderBindingTable()
 {
 	DXRContext* context = m_app->GetContext();
 
-	// The SBT helper class collects calls to Add*Program.  If called several
-	// times, the helper must be emptied before re-adding shaders.
-	context->m_sbtHelper.Reset();
+	// Same as the pipeline, the old table might still be in use by a frame in flight.
+	context->m_framePacer->Retire([sbtStorage = context->m_sbtStorage]() {});
 	context->m_sbtStorage.Reset();
+	context->m_resourceTracker.Untrack(context->m_sbtTrackingId);
+	context->m_sbtTrackingId = 0;
 
-	// The pointer to the beginning of the heap is the only parameter required by
-	// shaders without root parameters
-	D3D12_GPU_DESCRIPTOR_HANDLE srvUavHeapHandle =
-		context->m_srvUavHeap->GetGPUDescriptorHandleForHeapStart();
-
-	// The helper treats both root parameter pointers and heap pointers as void*,
-	// while DX12 uses the
-	// D3D12_GPU_DESCRIPTOR_HANDLE to define heap pointers. The pointer in this
-	// struct is a UINT64, which then has to be reinterpreted as a pointer.
-	auto heapPointer = reinterpret_cast<UINT64*>(srvUavHeapHandle.ptr);
-
-	// The ray generation only uses heap data
-	context->m_sbtHelper.AddRayGenerationProgram(L"RayGen", { heapPointer });
-
-	// The miss and hit shaders do not access any external resources: instead they
-	// communicate their results through the ray payload
-	context->m_sbtHelper.AddMissProgram(L"Miss", { heapPointer });
-	context->m_sbtHelper.AddMissProgram(L"ShadowMiss", { heapPointer });
-
-	for (int i = 0; i < m_app->m_drawableObjects.size(); i++)
-	{
-		if (m_app->m_drawableObjects[i]->m_textureFile != L"NULL")
-		{
-			srvUavHeapHandle = context->m_srvUavHeap->GetGPUDescriptorHandleForHeapStart();
-
-			srvUavHeapHandle.ptr += m_device->GetDescriptorHandleIncrementSize(
-				D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV) * m_app->m_drawableObjects[i]->m_heapTextureNumber;
-
-			auto textureHeapPointer = reinterpret_cast<UINT64*>(srvUavHeapHandle.ptr);
-
-			context->m_sbtHelper.AddHitGroup(m_app->m_drawableObjects[i]->m_objectHitGroupName,
-				{ (void*)(m_app->m_drawableObjects[i]->getVertexBuffer()->GetGPUVirtualAddress()),
-					(void*)(m_app->m_drawableObjects[i]->getIndexBuffer()->GetGPUVirtualAddress()),
-					(void*)(m_app->m_DXRContext->m_lightingBuffer->GetGPUVirtualAddress()),
-				(void*)(m_app->m_drawableObjects[i]->m_materialBuffer->GetGPUVirtualAddress())
-				, heapPointer,textureHeapPointer });
-
-			context->m_sbtHelper.AddHitGroup(L"ShadowHitGroup",
-				{ (void*)(m_app->m_drawableObjects[i]->getVertexBuffer()->GetGPUVirtualAddress()),
-					(void*)(m_app->m_drawableObjects[i]->getIndexBuffer()->GetGPUVirtualAddress()),
-					(void*)(m_app->m_DXRContext->m_lightingBuffer->GetGPUVirtualAddress()),
-					(void*)(m_app->m_drawableObjects[i]->m_materialBuffer->GetGPUVirtualAddress())
-				,heapPointer,textureHeapPointer });
-		}
-		else
-		{
-			context->m_sbtHelper.AddHitGroup(m_app->m_drawableObjects[i]->m_objectHitGroupName,
-				{ (void*)(m_app->m_drawableObjects[i]->getVertexBuffer()->GetGPUVirtualAddress()),
-					(void*)(m_app->m_drawableObjects[i]->getIndexBuffer()->GetGPUVirtualAddress()),
-					(void*)(m_app->m_DXRContext->m_lightingBuffer->GetGPUVirtualAddress()),
-				(void*)(m_app->m_drawableObjects[i]->m_materialBuffer->GetGPUVirtualAddress())
-				, heapPointer,nullptr });
-
-			context->m_sbtHelper.AddHitGroup(L"ShadowHitGroup",
-				{ (void*)(m_app->m_drawableObjects[i]->getVertexBuffer()->GetGPUVirtualAddress()),
-					(void*)(m_app->m_drawableObjects[i]->getIndexBuffer()->GetGPUVirtualAddress()),
-					(void*)(m_app->m_DXRContext->m_lightingBuffer->GetGPUVirtualAddress()),
-					(void*)(m_app->m_drawableObjects[i]->m_materialBuffer->GetGPUVirtualAddress())
-				,heapPointer,nullptr });
-		}
-	}
-
-	// Compute the size of the SBT given the number of shaders and their
-	// parameters
-	uint32_t sbtSize = context->m_sbtHelper.ComputeSBTSize();
-
-	// Create the SBT on the upload heap. This is required as the helper will use
-	// mapping to write the SBT contents. After the SBT compilation it could be
-	// copied to the default heap for performance.
-	context->m_sbtStorage = nv_helpers_dx12::CreateBuffer(
-		m_device.Get(), sbtSize, D3D12_RESOURCE_FLAG_NONE,
-		D3D12_RESOURCE_STATE_GENERIC_READ, nv_helpers_dx12::kUploadHeapProps);
-	if (!context->m_sbtStorage) {
-		throw std::logic_error("Could not allocate the shader binding table");
-	}
-	// Compile the SBT from the shader and parameters info
-	context->m_sbtHelper.Generate(context->m_sbtStorage.Get(), context->m_rtStateObjectProps.Get());
+	CreateShaderBindingTable();
 }
 #pragma endregion
\ No newline at end of file
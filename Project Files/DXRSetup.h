@@ -3,7 +3,12 @@
 #pragma region Includes
 //Include{s}
 #include "DXRApp.h"
+#include <set>
 #include "common.h"
+#include "AccelerationStructurePool.h"
+#include "BlasBuildPolicy.h"
+#include "BlasBuildBatcher.h"
+#include "nv_helpers_dx12/BottomLevelASGenerator.h"
 #pragma endregion
 
 /// <summary>
@@ -40,6 +45,13 @@ private:
 	vector<std::pair<wstring, int>> m_textures;
 
 	SamplerType m_samplerType = POINTY;
+
+	bool m_useHitPermutations = true; // Use the specialised hit shader variants instead of the uber shader
+	bool m_pipelineUsesHitPermutations = false; // What the current pipeline was actually built with
+	std::set<UINT> m_activeHitPermutations; // The feature masks the scene needs right now
+
+	string m_shaderCacheDirectory = "ShaderCache";
+	string m_meshLodCacheDirectory = "MeshCache";
 #pragma endregion
 
 #pragma region Init Methods
@@ -79,6 +91,25 @@ private:
 	/// </summary>
 	void LoadTextures();
 
+	/// <summary>
+	/// Adds a group at the origin and parents the objects to it, so they stay where they are but move with the group.
+	/// </summary>
+	/// <param name="name">The group's name in the UI.</param>
+	/// <param name="members">The objects to put in it.</param>
+	void CreateSceneGroup(const string& name, const vecDrawables& members);
+
+	/// <summary>
+	/// Reorders every loaded mesh for the vertex cache and gets the LOD chain for the ones big enough to need one, out of the
+	/// mesh cache if it's been through before.
+	/// </summary>
+	void BuildMeshCache();
+
+	/// <summary>
+	/// Packs every object's vertices and indices into the global geometry pools and builds the mesh offset table.
+	/// The LOD levels' indices go in after all the objects', sharing their object's vertices.
+	/// </summary>
+	void CreateGeometryPools();
+
 	/// <summary>
 	/// Creates all acceleration structures (bottom and top).
 	/// </summary>
@@ -87,18 +118,65 @@ private:
 	/// <summary>
 	/// Creates the top-level acceleration structure that holds all instances of the scene.
 	/// </summary>
-	/// <param name="instances">A vector of pairs containing BLAS and transform matrices.</param>
+	/// <param name="instances">Each instance's BLAS, mesh and object, and where its world matrix is in the transforms.</param>
+	/// <param name="masks">Each instance's InstanceMask bits, the ones at 0 are left out of the TLAS.</param>
+	/// <param name="transforms">Each instance's world matrix, copied straight into its descriptor.</param>
 	/// <param name="update">Indicates whether to update the TLAS.</param>
-	void CreateTopLevelAS(const std::vector<std::pair<ComPtr<ID3D12Resource>, DirectX::XMMATRIX>>& instances, bool update);
+	void CreateTopLevelAS(const std::vector<SceneInstance>& instances, const std::vector<UINT>& masks,
+		const TransformBatch& transforms, bool update);
+
+	/// <summary>
+	/// Fills in a BLAS generator with a mesh's triangles out of the geometry pools and works out its buffer sizes.
+	/// </summary>
+	/// <param name="mesh">Where the mesh is in the pools, an object's full mesh or one of its LOD levels.</param>
+	/// <param name="policy">How the BLAS should be built.</param>
+	/// <param name="generator">The generator to fill in.</param>
+	/// <param name="scratchSizeInBytes">Receives the scratch size the build needs.</param>
+	/// <param name="resultSizeInBytes">Receives the worst case size of the built BLAS.</param>
+	void PrepareBottomLevelAS(const MeshInfo& mesh, const BlasBuildPolicy& policy,
+		nv_helpers_dx12::BottomLevelASGenerator& generator, UINT64* scratchSizeInBytes, UINT64* resultSizeInBytes);
+
+	/// <summary>
+	/// Gets the D3D12 build flags for a BLAS build policy.
+	/// </summary>
+	/// <param name="policy">The policy to convert.</param>
+	/// <returns>The build flags, without PERFORM_UPDATE.</returns>
+	D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAGS GetBuildFlags(const BlasBuildPolicy& policy);
+
+	/// <summary>
+	/// Records every BLAS build in batches, with one barrier per batch rather than one per build.
+	/// </summary>
+	/// <param name="generators">The prepared generators, one per object.</param>
+	/// <param name="builtAS">Where each BLAS gets built.</param>
+	/// <param name="compactedSizes">Where the builds that get compacted write their compacted size, 8 bytes per object.</param>
+	void RecordBottomLevelASBuilds(std::vector<nv_helpers_dx12::BottomLevelASGenerator>& generators,
+		const std::vector<AccelerationStructureAllocation>& builtAS, ID3D12Resource* compactedSizes);
 
 	/// <summary>
-	/// Creates the bottom-level acceleration structure for an instance.
+	/// Gets the shared BLAS scratch arena, growing it if a build needs more than it has.
 	/// </summary>
-	/// <param name="vVertexBuffers">A vector of pairs containing vertex buffers.</param>
-	/// <param name="vIndexBuffers">A vector of pairs containing index buffers.</param>
-	/// <returns>AccelerationStructureBuffers for the BLAS.</returns>
-	AccelerationStructureBuffers CreateBottomLevelAS(std::vector<std::pair<ComPtr<ID3D12Resource>, uint32_t>> vVertexBuffers,
-		std::vector<std::pair<ComPtr<ID3D12Resource>, uint32_t>> vIndexBuffers);
+	/// <param name="sizeInBytes">The scratch size the build needs.</param>
+	/// <returns>The address of the scratch arena.</returns>
+	D3D12_GPU_VIRTUAL_ADDRESS GetBottomLevelScratch(UINT64 sizeInBytes);
+
+	/// <summary>
+	/// Copies every BLAS whose policy allows it into the pool at its compacted size, once the builds have run and their sizes have been read back.
+	/// </summary>
+	/// <param name="builtAS">Where each BLAS was built.</param>
+	/// <param name="compactedSizes">The readback buffer the builds wrote their compacted sizes to.</param>
+	void CompactBottomLevelAS(const std::vector<AccelerationStructureAllocation>& builtAS, ID3D12Resource* compactedSizes);
+
+	/// <summary>
+	/// Gets how much GPU memory a resource actually takes up, for the resource tracker.
+	/// </summary>
+	/// <param name="resource">The resource to measure.</param>
+	/// <returns>The allocation size in bytes.</returns>
+	UINT64 GetAllocationSize(ID3D12Resource* resource);
+
+	/// <summary>
+	/// Runs what's been recorded into the command list during setup, waits for it, and opens the list again.
+	/// </summary>
+	void ExecuteSetupCommands();
 #pragma endregion
 
 #pragma region Shader Signature Methods
@@ -154,6 +232,11 @@ private:
 	/// </summary>
 	void UpdateRaytracingPipeline();
 
+	/// <summary>
+	/// Builds the raytracing pipeline state object out of the compiled shader libraries.
+	/// </summary>
+	void GenerateRaytracingPipeline();
+
 	/// <summary>
 	/// Creates the output buffer for raytracing results.
 	/// </summary>
@@ -164,17 +247,51 @@ private:
 	/// </summary>
 	void CreateShaderResourceHeap();
 
+	/// <summary>
+	/// Creates the ray counter buffer the shaders count into, the zeros it's cleared from and the readback buffer.
+	/// </summary>
+	void CreateRayCounterBuffers();
+
 	/// <summary>
 	/// Creates the shader binding table.
 	/// </summary>
 	void CreateShaderBindingTable();
 
 	/// <summary>
-	/// Updates the shader binding table.
+	/// Rebuilds the shader binding table. Only needed when the pipeline changes, texture swaps go through the material table.
 	/// </summary>
 	void UpdateShaderBindingTable();
 #pragma endregion
 
+#pragma region Shader Permutation Methods
+	/// <summary>
+	/// Works out each object's hit shader features and compiles any variants that haven't been compiled yet.
+	/// </summary>
+	void CompileHitPermutations();
+
+	/// <summary>
+	/// Gets the name of a hit shader variant's entry point.
+	/// </summary>
+	/// <param name="entryName">The uber shader's entry point name.</param>
+	/// <param name="features">The variant's feature mask.</param>
+	/// <returns>The variant's entry point name.</returns>
+	wstring GetHitPermutationEntryName(const wstring& entryName, UINT features);
+
+	/// <summary>
+	/// Gets the closest hit shader an object's hit group should use.
+	/// </summary>
+	/// <param name="object">The object.</param>
+	/// <returns>The closest hit entry point name.</returns>
+	wstring GetClosestHitName(DrawableGameObject* object);
+
+public:
+	/// <summary>
+	/// Rebuilds the pipeline and SBT if any object now needs a different hit shader variant.
+	/// </summary>
+	/// <returns>True if the pipeline was rebuilt.</returns>
+	bool UpdateHitPermutations();
+#pragma endregion
+
 public:
 #pragma region Constructors and Destructors
 	/// <summary>
@@ -198,6 +315,16 @@ public:
 	/// <param name="rY">The amount of rays on the Y axis, 1 is every pixel and 10 is ten times less</param>
 	void UpdateCamera(float rX, float rY);
 
+	/// <summary>
+	/// Gets the inverse view and projection matrices the ray generation shader turns pixels into rays with.
+	/// </summary>
+	void GetInverseCameraMatrices(XMMATRIX& invView, XMMATRIX& invProj);
+
+	/// <summary>
+	/// Gets the side planes of the camera's frustum and where the eye is, for culling instances against. The distance is left to the caller.
+	/// </summary>
+	void GetCameraCullVolume(CullVolume& volume);
+
 	/// <summary>
 	/// Creates the lighting buffer.
 	/// </summary>
@@ -216,13 +343,58 @@ public:
 	void UpdateLightingBuffer(XMFLOAT4 lightPosition, XMFLOAT4 lightAmbientColor, XMFLOAT4 lightDiffuseColor, XMFLOAT4 lightSpecularColor, float lightSpecularPower, float pointLightRange, UINT shadowRayCount);
 
 	/// <summary>
-	/// Creates all the object material buffers for the scene.
+	/// Creates the material table for the scene, one entry per object.
 	/// </summary>
 	void CreateMaterialBuffers();
 
 	/// <summary>
-	/// Updates the material buffers with new material data.
+	/// Writes every object's material data into this frame's slice of the upload ring.
 	/// </summary>
 	void UpdateMaterialBuffers();
+
+	/// <summary>
+	/// Grabs this frame's chunks of the upload ring for the camera, light and material constants. Call it once per frame, after BeginFrame.
+	/// </summary>
+	void AllocateFrameConstants();
+
+	/// <summary>
+	/// Records the copies from this frame's upload chunks into the camera, light and material buffers.
+	/// Has to be recorded before anything on the command list reads them.
+	/// </summary>
+	void CopyFrameConstants();
+#pragma endregion
+
+#pragma region Ray Counter Methods
+	/// <summary>
+	/// Records clearing the ray counters, call it before DispatchRays.
+	/// </summary>
+	void ClearRayCounters();
+
+	/// <summary>
+	/// Records copying the ray counters into this frame slot's part of the readback buffer, call it after DispatchRays.
+	/// </summary>
+	/// <param name="frameSeconds">How long this frame took, so the counts can be turned into rates.</param>
+	void ReadBackRayCounters(float frameSeconds);
+
+	/// <summary>
+	/// Picks up the counts from the last frame that used this slot. Call it once the frame pacer has the slot, it never waits.
+	/// </summary>
+	void CollectRayCounters();
+#pragma endregion
+
+#pragma region Upload Methods
+	/// <summary>
+	/// Creates the upload ring used for per frame constants and staging copies.
+	/// </summary>
+	void CreateUploadRing();
+
+	/// <summary>
+	/// Gets some mapped upload memory that stays valid until the GPU has finished the current frame (or the setup flush).
+	/// Comes out of the upload ring, or out of a one off buffer if the ring can't fit it.
+	/// </summary>
+	/// <param name="size">The number of bytes wanted.</param>
+	/// <param name="alignment">The alignment of the offset, has to be a power of two.</param>
+	/// <returns>The resource, offset and CPU address to write to.</returns>
+	UploadAllocation AllocateUpload(UINT64 size, UINT64 alignment);
 #pragma endregion
 };
\ No newline at end of file
@@ -18,7 +18,16 @@ DXSample::DXSample(UINT width, UINT height, std::wstring name) :
 	m_width(width),
 	m_height(height),
 	m_title(name),
-	m_useWarpDevice(false)
+	m_useWarpDevice(false),
+	m_dumpResources(false),
+	m_offlineFrames(0),
+	m_offlineOutput(L"Render"),
+	m_distributeWorkers(0),
+	m_tileSize(128),
+	m_workerPort(0),
+	m_workerId(0),
+	m_updateGoldens(false),
+	m_kernelBenchmark(false)
 {
 	WCHAR assetsPath[512];
 	GetAssetsPath(assetsPath, _countof(assetsPath));
@@ -87,5 +96,50 @@ void DXSample::ParseCommandLineArgs(WCHAR* argv[], int argc)
 			m_useWarpDevice = true;
 			m_title = m_title + L" (WARP)";
 		}
+		else if (_wcsnicmp(argv[i], L"-dumpresources", wcslen(argv[i])) == 0 ||
+			_wcsnicmp(argv[i], L"/dumpresources", wcslen(argv[i])) == 0)
+		{
+			m_dumpResources = true;
+		}
+		else if ((_wcsicmp(argv[i], L"-render") == 0 || _wcsicmp(argv[i], L"/render") == 0) && i + 1 < argc)
+		{
+			m_offlineFrames = static_cast<UINT>(_wtoi(argv[++i]));
+		}
+		else if ((_wcsicmp(argv[i], L"-path") == 0 || _wcsicmp(argv[i], L"/path") == 0) && i + 1 < argc)
+		{
+			m_offlinePath = argv[++i];
+		}
+		else if ((_wcsicmp(argv[i], L"-out") == 0 || _wcsicmp(argv[i], L"/out") == 0) && i + 1 < argc)
+		{
+			m_offlineOutput = argv[++i];
+		}
+		else if ((_wcsicmp(argv[i], L"-distribute") == 0 || _wcsicmp(argv[i], L"/distribute") == 0) && i + 1 < argc)
+		{
+			m_distributeWorkers = static_cast<UINT>(_wtoi(argv[++i]));
+		}
+		else if ((_wcsicmp(argv[i], L"-tile") == 0 || _wcsicmp(argv[i], L"/tile") == 0) && i + 1 < argc)
+		{
+			m_tileSize = max(static_cast<UINT>(_wtoi(argv[++i])), 8u);
+		}
+		else if ((_wcsicmp(argv[i], L"-worker") == 0 || _wcsicmp(argv[i], L"/worker") == 0) && i + 1 < argc)
+		{
+			m_workerPort = static_cast<UINT>(_wtoi(argv[++i]));
+		}
+		else if ((_wcsicmp(argv[i], L"-workerid") == 0 || _wcsicmp(argv[i], L"/workerid") == 0) && i + 1 < argc)
+		{
+			m_workerId = static_cast<UINT>(_wtoi(argv[++i]));
+		}
+		else if ((_wcsicmp(argv[i], L"-golden") == 0 || _wcsicmp(argv[i], L"/golden") == 0) && i + 1 < argc)
+		{
+			m_goldenDirectory = argv[++i];
+		}
+		else if (_wcsicmp(argv[i], L"-updategolden") == 0 || _wcsicmp(argv[i], L"/updategolden") == 0)
+		{
+			m_updateGoldens = true;
+		}
+		else if (_wcsicmp(argv[i], L"-kernelbench") == 0 || _wcsicmp(argv[i], L"/kernelbench") == 0)
+		{
+			m_kernelBenchmark = true;
+		}
 	}
 }
@@ -33,6 +33,18 @@ public:
 	UINT GetWidth() const           { return m_width; }
 	UINT GetHeight() const          { return m_height; }
 	const WCHAR* GetTitle() const   { return m_title.c_str(); }
+	bool GetDumpResources() const   { return m_dumpResources; }
+	UINT GetOfflineFrames() const   { return m_offlineFrames; }
+	const std::wstring& GetOfflinePath() const   { return m_offlinePath; }
+	const std::wstring& GetOfflineOutput() const { return m_offlineOutput; }
+	UINT GetDistributeWorkers() const { return m_distributeWorkers; }
+	UINT GetTileSize() const        { return m_tileSize; }
+	UINT GetWorkerPort() const      { return m_workerPort; }
+	UINT GetWorkerId() const        { return m_workerId; }
+	const std::wstring& GetGoldenDirectory() const { return m_goldenDirectory; }
+	bool GetUpdateGoldens() const   { return m_updateGoldens; }
+	bool GetKernelBenchmark() const { return m_kernelBenchmark; }
+	bool IsHeadless() const         { return m_offlineFrames > 0 || m_workerPort > 0 || !m_goldenDirectory.empty(); }
 
 	void ParseCommandLineArgs(_In_reads_(argc) WCHAR* argv[], int argc);
 
@@ -49,6 +61,29 @@ protected:
 	// Adapter info.
 	bool m_useWarpDevice;
 
+	// Write the resource accounting out as JSON once setup is done.
+	bool m_dumpResources;
+
+	// Render this many frames along a camera path with no window, write them out and quit. 0 is the normal interactive app.
+	UINT m_offlineFrames;
+	std::wstring m_offlinePath;
+	std::wstring m_offlineOutput;
+
+	// Split a -render's frames into tiles and render them in this many worker processes instead.
+	UINT m_distributeWorkers;
+	UINT m_tileSize;
+
+	// Set when this process is one of those workers, it renders whatever tiles the coordinator on this port sends.
+	UINT m_workerPort;
+	UINT m_workerId;
+
+	// Render the golden image poses and compare them against the goldens in this directory, or replace them.
+	std::wstring m_goldenDirectory;
+	bool m_updateGoldens;
+
+	// Time the CPU ray kernels against the stored baseline and quit, nothing gets rendered.
+	bool m_kernelBenchmark;
+
 private:
 	// Root assets path.
 	std::wstring m_assetsPath;
@@ -7,11 +7,12 @@ using namespace std;
 #pragma endregion
 
 #pragma region Constructors and Destructors
-DrawableGameObject::DrawableGameObject(XMFLOAT3 position, XMFLOAT3 rotation, XMFLOAT3 scale, string objectName)
+DrawableGameObject::DrawableGameObject(TransformBatch* transforms, XMFLOAT3 position, XMFLOAT3 rotation, XMFLOAT3 scale, string objectName)
 {
-	m_position = position;
-	m_rotation = rotation;
-	m_scale = scale;
+	// The world matrix gets built along with every other object's, next time the batch updates.
+	m_transforms = transforms;
+	m_transformIndex = m_transforms->Add(TransformVec3(position.x, position.y, position.z), TransformVec3(rotation.x, rotation.y, rotation.z),
+		TransformVec3(scale.x, scale.y, scale.z));
 
 	this->setObjectName(objectName); // This is used for UI and debugging purposes
 
@@ -19,16 +20,9 @@ DrawableGameObject::DrawableGameObject(XMFLOAT3 position, XMFLOAT3 rotation, XMF
 
 	m_objectHitGroupName.assign(objectName.begin(), objectName.end()); // This is used for the hit group name per object.
 
-	XMMATRIX newRotation = XMMatrixRotationX(XMConvertToRadians(m_rotation.x)) * XMMatrixRotationY(XMConvertToRadians(m_rotation.y)) * XMMatrixRotationZ(m_rotation.z);
-	XMMATRIX newTranslation = XMMatrixTranslation(m_position.x, m_position.y, m_position.z);
-	XMMATRIX newScale = XMMatrixScaling(m_scale.x, m_scale.y, m_scale.z);
+	this->setOrginalTransformValues(position, rotation, scale); // Record the original transform values
 
-	// Initialize the world matrix
-	XMStoreFloat4x4(&m_World, newTranslation * newRotation * newScale);
-
-	this->setOrginalTransformValues(this->getPosition(), this->getRotation(), this->getScale()); // Record the original transform values
-
-	this->update(0.0f);
+	this->update();
 }
 
 DrawableGameObject::~DrawableGameObject()
@@ -69,7 +63,7 @@ HRESULT DrawableGameObject::initCubeMesh(ComPtr<ID3D12Device5> device)
 {
 	// Create the vertex buffer.
 	{
-		Vertex cubeVertices[] = {
+		SimpleVertex cubeVertices[] = {
 			// Front face
 			{{1.0f,1.0f,1.0f},{0.0f,0.0f,1.0f,1.0f},{1.0f,1.0f}},
 			{{-1.0f,1.0f,1.0f},{0.0f,0.0f,1.0f,1.0f},{0.0f,1.0f}},
@@ -109,27 +103,8 @@ HRESULT DrawableGameObject::initCubeMesh(ComPtr<ID3D12Device5> device)
 
 		m_meshData.VertexCount = 24;
 
-		const UINT vertexBufferSize = sizeof(cubeVertices);
-
-		// Note: using upload heaps to transfer static data like vert buffers is not
-		// recommended. Every time the GPU needs it, the upload heap will be
-		// marshalled over. Please read up on Default Heap usage. An upload heap is
-		// used here for code simplicity and because there are very few verts to
-		// actually transfer.
-		ThrowIfFailed(device->CreateCommittedResource(
-			&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD), D3D12_HEAP_FLAG_NONE,
-			&CD3DX12_RESOURCE_DESC::Buffer(vertexBufferSize),
-			D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
-			IID_PPV_ARGS(&m_meshData.VertexBuffer)));
-
-		// Copy the triangle data to the vertex buffer.
-		UINT8* pVertexDataBegin;
-		CD3DX12_RANGE readRange(
-			0, 0); // We do not intend to read from this resource on the CPU.
-		ThrowIfFailed(m_meshData.VertexBuffer->Map(
-			0, &readRange, reinterpret_cast<void**>(&pVertexDataBegin)));
-		memcpy(pVertexDataBegin, cubeVertices, sizeof(cubeVertices));
-		m_meshData.VertexBuffer->Unmap(0, nullptr);
+		// Kept on the CPU, CreateGeometryPools stages it into the default heap vertex pool.
+		m_meshData.Vertices.assign(std::begin(cubeVertices), std::end(cubeVertices));
 	}
 
 	// create the index buffer
@@ -157,20 +132,7 @@ HRESULT DrawableGameObject::initCubeMesh(ComPtr<ID3D12Device5> device)
 
 		m_meshData.IndexCount = sizeof(indices) / sizeof(UINT);
 
-		const UINT indexBufferSize = sizeof(indices);
-		CD3DX12_HEAP_PROPERTIES heapProperty = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-		CD3DX12_RESOURCE_DESC bufferResource = CD3DX12_RESOURCE_DESC::Buffer(indexBufferSize);
-		ThrowIfFailed(device->CreateCommittedResource(
-			&heapProperty, D3D12_HEAP_FLAG_NONE, &bufferResource, //
-			D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&m_meshData.IndexBuffer)));
-
-		// Copy the triangle data to the index buffer.
-		CD3DX12_RANGE readRange(0, 0); // We do not intend to read from this resource on the CPU.
-
-		UINT8* pIndexDataBegin;
-		ThrowIfFailed(m_meshData.IndexBuffer->Map(0, &readRange, reinterpret_cast<void**>(&pIndexDataBegin)));
-		memcpy(pIndexDataBegin, indices, indexBufferSize);
-		m_meshData.IndexBuffer->Unmap(0, nullptr);
+		m_meshData.Indices.assign(std::begin(indices), std::end(indices));
 	}
 
 	m_cubeMesh = true;
@@ -182,7 +144,7 @@ HRESULT DrawableGameObject::initPlaneMesh(ComPtr<ID3D12Device5> device)
 	// Create the vertex buffer.
 	{
 		float diameter = 0.5f;
-		Vertex planeVertices[] = {
+		SimpleVertex planeVertices[] = {
 					{ XMFLOAT3(-diameter,  diameter, 0.0f), XMFLOAT4(0.0f, 1.0f, 0.0f, 1.0f), XMFLOAT2(0.0f, 0.0f) }, // 0:
 	{ XMFLOAT3(-diameter, -diameter, 0.0f), XMFLOAT4(0.0f, 1.0f, 0.0f, 1.0f), XMFLOAT2(0.0f, 1.0f) }, // 1:
 	{ XMFLOAT3(diameter,  diameter, 0.0f), XMFLOAT4(0.0f, 1.0f, 0.0f, 1.0f), XMFLOAT2(1.0f, 0.0f) }, // 2:
@@ -191,27 +153,8 @@ HRESULT DrawableGameObject::initPlaneMesh(ComPtr<ID3D12Device5> device)
 
 		m_meshData.VertexCount = 4;
 
-		const UINT vertexBufferSize = sizeof(planeVertices);
-
-		// Note: using upload heaps to transfer static data like vert buffers is not
-		// recommended. Every time the GPU needs it, the upload heap will be
-		// marshalled over. Please read up on Default Heap usage. An upload heap is
-		// used here for code simplicity and because there are very few verts to
-		// actually transfer.
-		ThrowIfFailed(device->CreateCommittedResource(
-			&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD), D3D12_HEAP_FLAG_NONE,
-			&CD3DX12_RESOURCE_DESC::Buffer(vertexBufferSize),
-			D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
-			IID_PPV_ARGS(&m_meshData.VertexBuffer)));
-
-		// Copy the triangle data to the vertex buffer.
-		UINT8* pVertexDataBegin;
-		CD3DX12_RANGE readRange(
-			0, 0); // We do not intend to read from this resource on the CPU.
-		ThrowIfFailed(m_meshData.VertexBuffer->Map(
-			0, &readRange, reinterpret_cast<void**>(&pVertexDataBegin)));
-		memcpy(pVertexDataBegin, planeVertices, sizeof(planeVertices));
-		m_meshData.VertexBuffer->Unmap(0, nullptr);
+		// Kept on the CPU, CreateGeometryPools stages it into the default heap vertex pool.
+		m_meshData.Vertices.assign(std::begin(planeVertices), std::end(planeVertices));
 	}
 
 	// create the index buffer
@@ -224,20 +167,7 @@ HRESULT DrawableGameObject::initPlaneMesh(ComPtr<ID3D12Device5> device)
 
 		m_meshData.IndexCount = sizeof(indices) / sizeof(UINT);
 
-		const UINT indexBufferSize = sizeof(indices);
-		CD3DX12_HEAP_PROPERTIES heapProperty = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-		CD3DX12_RESOURCE_DESC bufferResource = CD3DX12_RESOURCE_DESC::Buffer(indexBufferSize);
-		ThrowIfFailed(device->CreateCommittedResource(
-			&heapProperty, D3D12_HEAP_FLAG_NONE, &bufferResource, //
-			D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&m_meshData.IndexBuffer)));
-
-		// Copy the triangle data to the index buffer.
-		CD3DX12_RANGE readRange(0, 0); // We do not intend to read from this resource on the CPU.
-
-		UINT8* pIndexDataBegin;
-		ThrowIfFailed(m_meshData.IndexBuffer->Map(0, &readRange, reinterpret_cast<void**>(&pIndexDataBegin)));
-		memcpy(pIndexDataBegin, indices, indexBufferSize);
-		m_meshData.IndexBuffer->Unmap(0, nullptr);
+		m_meshData.Indices.assign(std::begin(indices), std::end(indices));
 	}
 
 	m_planeMesh = true;
@@ -247,33 +177,81 @@ HRESULT DrawableGameObject::initPlaneMesh(ComPtr<ID3D12Device5> device)
 HRESULT DrawableGameObject::initOBJMesh(ComPtr<ID3D12Device5> device, char* szOBJName)
 {
 	m_meshData = OBJLoader::Load(szOBJName, device.Get());
-	assert(m_meshData.VertexBuffer);
+	assert(!m_meshData.Vertices.empty());
 	m_objMesh = true;
 	return S_OK;
 }
 
+void DrawableGameObject::reorderMesh(const std::vector<uint32_t>& vertexOrder, const std::vector<uint32_t>& indices)
+{
+	std::vector<SimpleVertex> vertices;
+	vertices.reserve(vertexOrder.size());
+	for (uint32_t vertex : vertexOrder)
+	{
+		vertices.push_back(m_meshData.Vertices[vertex]);
+	}
+
+	m_meshData.Vertices.swap(vertices);
+	m_meshData.Indices.assign(indices.begin(), indices.end());
+	m_meshData.VertexCount = static_cast<UINT>(m_meshData.Vertices.size());
+	m_meshData.IndexCount = static_cast<UINT>(m_meshData.Indices.size());
+}
+
 DrawableGameObject* DrawableGameObject::createCopy()
 {
-	DrawableGameObject* pobj = new DrawableGameObject(this->getPosition(), this->getRotation(), this->getScale(), this->getObjectName());
+	DrawableGameObject* pobj = new DrawableGameObject(m_transforms, this->getPosition(), this->getRotation(), this->getScale(), this->getObjectName());
+
+	// The copy has its own transform, don't let the assignment point it back at this one's.
+	UINT transformIndex = pobj->m_transformIndex;
 	*pobj = *this;
+	pobj->m_transformIndex = transformIndex;
+	m_transforms->SetParent(transformIndex, m_transforms->GetParent(m_transformIndex));
 	return pobj;
 }
 #pragma endregion
 
 #pragma region Getters and Setters
+XMMATRIX DrawableGameObject::getTransform()
+{
+	// The batch keeps it transposed for the instance descriptors, so turn it back round.
+	const float* world = m_transforms->GetWorld(m_transformIndex);
+	return XMMatrixTranspose(XMMATRIX(world[0], world[1], world[2], world[3],
+		world[4], world[5], world[6], world[7],
+		world[8], world[9], world[10], world[11],
+		0.0f, 0.0f, 0.0f, 1.0f));
+}
+
 void DrawableGameObject::setPosition(XMFLOAT3 position)
 {
-	m_position = position;
+	m_transforms->SetPosition(m_transformIndex, TransformVec3(position.x, position.y, position.z));
+}
+
+XMFLOAT3 DrawableGameObject::getPosition()
+{
+	TransformVec3 position = m_transforms->GetPosition(m_transformIndex);
+	return XMFLOAT3(position.x, position.y, position.z);
 }
 
 void DrawableGameObject::setRotation(XMFLOAT3 rotation)
 {
-	m_rotation = rotation;
+	m_transforms->SetRotation(m_transformIndex, TransformVec3(rotation.x, rotation.y, rotation.z));
+}
+
+XMFLOAT3 DrawableGameObject::getRotation()
+{
+	TransformVec3 rotation = m_transforms->GetRotation(m_transformIndex);
+	return XMFLOAT3(rotation.x, rotation.y, rotation.z);
 }
 
 void DrawableGameObject::setScale(XMFLOAT3 scale)
 {
-	m_scale = scale;
+	m_transforms->SetScale(m_transformIndex, TransformVec3(scale.x, scale.y, scale.z));
+}
+
+XMFLOAT3 DrawableGameObject::getScale()
+{
+	TransformVec3 scale = m_transforms->GetScale(m_transformIndex);
+	return XMFLOAT3(scale.x, scale.y, scale.z);
 }
 
 void DrawableGameObject::setOrginalTransformValues(XMFLOAT3 position, XMFLOAT3 rotation, XMFLOAT3 scale)
@@ -283,25 +261,40 @@ void DrawableGameObject::setOrginalTransformValues(XMFLOAT3 position, XMFLOAT3 r
 	m_orginalScale = scale;
 }
 
+UINT DrawableGameObject::getHitShaderFeatures(bool shadows)
+{
+	// Uses the UI bools rather than the material buffer, the material buffer only catches up in update().
+	UINT features = HIT_FEATURE_NONE;
+
+	if (m_reflection) features |= HIT_FEATURE_REFLECTION;
+
+	if (m_triOutline) features |= HIT_FEATURE_TRI_OUTLINE;
+
+	if (m_texture) features |= HIT_FEATURE_TEXTURE;
+
+	if (shadows) features |= HIT_FEATURE_SHADOWS;
+
+	// No bit for roughness, it's a slider and dragging it through 0 would rebuild the pipeline. Hit.hlsl checks it at runtime.
+
+	return features;
+}
+
 #pragma endregion
 
 #pragma region Update Methods
 void DrawableGameObject::resetTransform()
 {
-	m_position = m_orginalPosition;
-	m_rotation = m_orginalRotation;
-	m_scale = m_orginalScale;
+	setPosition(m_orginalPosition);
+	setRotation(m_orginalRotation);
+	setScale(m_orginalScale);
 
-	m_autoRotateX = false;
-	m_autoRotateY = false;
-	m_autoRotateZ = false;
+	setAutoRotate(0, false);
+	setAutoRotate(1, false);
+	setAutoRotate(2, false);
 }
 
-void DrawableGameObject::update(float t)
+void DrawableGameObject::update()
 {
-	static float cummulativeTime = 0;
-	cummulativeTime += t;
-
 	// Some basic checks to make sure the object isn't going to explode.
 	if (m_reflection)
 	{
@@ -330,38 +323,7 @@ void DrawableGameObject::update(float t)
 		m_materialBufferData.texture = 0;
 	}
 
-	// Don't overflow the rotation
-	if (m_rotation.x > 360.0f) m_rotation.x = 0.0f;
-
-	if (m_rotation.x < -360.0f) m_rotation.x = 0.0f;
-
-	if (m_rotation.y > 360.0f) m_rotation.y = 0.0f;
-
-	if (m_rotation.y < -360.0f) m_rotation.y = 0.0f;
-
-	if (m_rotation.z > 360.0f) m_rotation.z = 0.0f;
-
-	if (m_rotation.z < -360.0f) m_rotation.z = 0.0f;
-
-	if (m_autoRotateX)
-	{
-		m_rotation.x += m_autoRotationSpeed * t;
-	}
-
-	if (m_autoRotateY)
-	{
-		m_rotation.y += m_autoRotationSpeed * t;
-	}
-
-	if (m_autoRotateZ)
-	{
-		m_rotation.z += m_autoRotationSpeed * t;
-	}
-
-	XMMATRIX rotation = XMMatrixRotationX(XMConvertToRadians(m_rotation.x)) * XMMatrixRotationY(XMConvertToRadians(m_rotation.y)) * XMMatrixRotationZ(XMConvertToRadians(m_rotation.z));
-	XMMATRIX translation = XMMatrixTranslation(m_position.x, m_position.y, m_position.z);
-	XMMATRIX scale = XMMatrixScaling(m_scale.x, m_scale.y, m_scale.z);
-
-	XMStoreFloat4x4(&m_World, scale * rotation * translation);
+	// The shader indexes its texture array with this, so never hand it a negative number.
+	m_materialBufferData.textureIndex = m_heapTextureNumber < 0 ? 0 : static_cast<UINT>(m_heapTextureNumber);
 }
 #pragma endregion
\ No newline at end of file
@@ -3,7 +3,10 @@
 #pragma region Includes
 //Include{s}
 #include "common.h"
+#include "MeshLod.h"
+#include "MeshOptimiser.h"
 #include "OBJLoader.h"
+#include "TransformBatch.h"
 using Microsoft::WRL::ComPtr;
 #pragma endregion
 
@@ -17,11 +20,12 @@ public:
 	/// <summary>
 	/// Initializes a new instance of the GameObject class.
 	/// </summary>
+	/// <param name="transforms">Where the object's transform lives, it's added to it here.</param>
 	/// <param name="position">The initial position of the object.</param>
 	/// <param name="rotation">The initial rotation of the object.</param>
 	/// <param name="scale">The initial scale of the object.</param>
 	/// <param name="objectName">The name of the object. (FOR UI)</param>
-	DrawableGameObject(XMFLOAT3 position, XMFLOAT3 rotation, XMFLOAT3 scale, string objectName);
+	DrawableGameObject(TransformBatch* transforms, XMFLOAT3 position, XMFLOAT3 rotation, XMFLOAT3 scale, string objectName);
 
 	/// <summary>
 	/// Destructor for the GameObject class.
@@ -64,14 +68,20 @@ public:
 	/// <returns>HRESULT indicating success or failure.</returns>
 	HRESULT initOBJMesh(ComPtr<ID3D12Device5> device, char* szOBJName);
 
+	/// <summary>
+	/// Swaps the mesh for a reordered (and possibly welded) version of itself, as MeshOptimiser hands it back.
+	/// </summary>
+	/// <param name="vertexOrder">Which of the current vertices each new vertex is.</param>
+	/// <param name="indices">The new indices, into the new vertices.</param>
+	void reorderMesh(const std::vector<uint32_t>& vertexOrder, const std::vector<uint32_t>& indices);
+
 #pragma endregion
 
 #pragma region Update Methods
 	/// <summary>
-	/// Updates the object based on the elapsed time.
+	/// Brings the material buffer up to date with the UI. The transform is updated with everything else's, in the TransformBatch.
 	/// </summary>
-	/// <param name="t">The elapsed time.</param>
-	void update(float t);
+	void update();
 
 	/// <summary>
 	/// Resets the object's transform to its original values.
@@ -85,52 +95,64 @@ public:
 	/// Provides access to the object's properties, such as position, rotation, scale, and mesh data.
 	/// </summary>
 
-	ComPtr<ID3D12Resource> getVertexBuffer() { return m_meshData.VertexBuffer; }
-	ComPtr<ID3D12Resource> getIndexBuffer() { return m_meshData.IndexBuffer; }
-	XMMATRIX getTransform() { return XMLoadFloat4x4(&m_World); }
+	const std::vector<SimpleVertex>& getVertices() { return m_meshData.Vertices; }
+	const std::vector<UINT>& getIndices() { return m_meshData.Indices; }
+	XMMATRIX getTransform();
 	void setPosition(XMFLOAT3 position);
-	XMFLOAT3 getPosition() { return m_position; }
+	XMFLOAT3 getPosition();
 	void setRotation(XMFLOAT3 rotation);
-	XMFLOAT3 getRotation() { return m_rotation; }
+	XMFLOAT3 getRotation();
 	void setScale(XMFLOAT3 scale);
-	XMFLOAT3 getScale() { return m_scale; }
+	XMFLOAT3 getScale();
+	bool getAutoRotate(int axis) { return m_transforms->GetAutoRotate(m_transformIndex, axis); }
+	void setAutoRotate(int axis, bool autoRotate) { m_transforms->SetAutoRotate(m_transformIndex, axis, autoRotate); }
+	float getAutoRotationSpeed() { return m_transforms->GetAutoRotationSpeed(m_transformIndex); }
+	void setAutoRotationSpeed(float speed) { m_transforms->SetAutoRotationSpeed(m_transformIndex, speed); }
+	UINT getTransformIndex() { return m_transformIndex; }
 	unsigned int getVertexCount() { return m_meshData.VertexCount; }
 	unsigned int getIndexCount() { return m_meshData.IndexCount; }
 	string getObjectName() { return m_objectName; }
 	void setObjectName(string name) { m_objectName = name; }
 	void setOrginalTransformValues(XMFLOAT3 position, XMFLOAT3 rotation, XMFLOAT3 scale);
+
+	/// <summary>
+	/// Gets the hit shader features this object needs, used to pick its hit shader variant.
+	/// </summary>
+	/// <param name="shadows">Whether shadows are turned on for the scene.</param>
+	/// <returns>A mask of HitShaderFeature bits.</returns>
+	UINT getHitShaderFeatures(bool shadows);
 #pragma endregion
 
 #pragma region Public Variables
 	string m_objectName;
-	bool m_autoRotateX = false;
-	bool m_autoRotateY = false;
-	bool m_autoRotateZ = false;
 	bool m_planeMesh = false;
 	bool m_objMesh = false;
 	bool m_cubeMesh = false;
 	bool m_textMesh = false;
+	bool m_deformingMesh = false; // Vertices change after load, so the BLAS is built for refitting instead of compacted
 	wstring m_objectHitGroupName;
-	float m_autoRotationSpeed = 50.0f;
 	bool m_reflection = false;
 	bool m_triOutline = true;
 	bool m_texture = false;
 	ComPtr<ID3D12Resource> m_textureResource;
 	D3D12_RESOURCE_DESC m_textureDesc;
-	ComPtr<ID3D12Resource> m_textureUploadHeap;
 	wstring m_textureFile = L"NULL";
 	int m_heapTextureNumber = -1;
-	ComPtr<ID3D12Resource> m_materialBuffer;
-	uint32_t m_materialBufferSize = 256;
 	MaterialBuffer m_materialBufferData;
+	UINT m_vertexPoolOffset = 0; // First vertex of this object in the global vertex pool
+	UINT m_indexPoolOffset = 0; // First index of this object in the global index pool
+	UINT m_hitShaderFeatures = HIT_FEATURE_NONE; // The hit shader variant this object's hit group is currently using
+	UINT m_instanceMask = INSTANCE_MASK_ALL; // Which kinds of ray can hit it, as InstanceMask bits
+	std::vector<MeshLodLevel> m_lodLevels; // Coarser versions of the mesh for wide shadow and reflection cones, empty for most objects
+	UINT m_lodMeshStart = 0; // Where its LOD levels' MeshInfos start in the mesh table
+	MeshLocality m_loadedLocality; // How cache friendly the mesh was as loaded, zero unless it went through the optimiser
+	MeshLocality m_optimisedLocality; // And how cache friendly it is now
 #pragma endregion
 
 private:
 #pragma region Private Variables
-	XMFLOAT4X4 m_World;
-	XMFLOAT3 m_position;
-	XMFLOAT3 m_rotation;
-	XMFLOAT3 m_scale;
+	TransformBatch* m_transforms;
+	UINT m_transformIndex;
 	XMFLOAT3 m_orginalPosition;
 	XMFLOAT3 m_orginalRotation;
 	XMFLOAT3 m_orginalScale;
@@ -0,0 +1,128 @@
+#pragma region Includes
+//Include{s}
+#include "FrameClock.h"
+#include <chrono>
+#include <stdexcept>
+#pragma endregion
+
+const double FrameClock::kMaxVariableDelta = 0.25;
+
+#pragma region Clock Sources
+uint64_t SteadyClockSource::NowNs()
+{
+	auto now = std::chrono::steady_clock::now().time_since_epoch();
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count());
+}
+#pragma endregion
+
+#pragma region Constructors and Destructors
+FrameClock::FrameClock(IClockSource* source, double fixedStepSeconds, uint32_t maxStepsPerFrame)
+{
+	m_source = source != nullptr ? source : &m_steadySource;
+	m_maxStepsPerFrame = maxStepsPerFrame > 0 ? maxStepsPerFrame : 1;
+	SetFixedStep(fixedStepSeconds);
+}
+#pragma endregion
+
+#pragma region Clock Methods
+void FrameClock::Tick()
+{
+	uint64_t nowNs = m_source->NowNs();
+
+	// The first frame has nothing to measure against, so it gets no time at all.
+	m_realDelta = m_frameCount == 0 ? 0.0 : (nowNs - m_lastNs) / 1000000000.0;
+	m_realTime += m_realDelta;
+	m_lastNs = nowNs;
+	m_frameCount++;
+
+	switch (m_mode)
+	{
+	case FRAME_CLOCK_VARIABLE:
+		m_steps = 1;
+		m_stepDelta = m_realDelta < kMaxVariableDelta ? m_realDelta : kMaxVariableDelta;
+		m_alpha = 1.0;
+		break;
+
+	case FRAME_CLOCK_FIXED_STEP:
+	case FRAME_CLOCK_INTERPOLATED:
+	{
+		m_accumulator += m_realDelta;
+		m_stepDelta = m_fixedStep;
+		m_steps = 0;
+
+		while (m_accumulator >= m_fixedStep)
+		{
+			m_accumulator -= m_fixedStep;
+
+			if (m_steps < m_maxStepsPerFrame)
+			{
+				m_steps++;
+			}
+			else
+			{
+				m_droppedSteps++;
+			}
+		}
+
+		m_alpha = m_mode == FRAME_CLOCK_INTERPOLATED ? m_accumulator / m_fixedStep : 1.0;
+		break;
+	}
+
+	case FRAME_CLOCK_BENCHMARK:
+	default:
+		m_steps = 1;
+		m_stepDelta = m_fixedStep;
+		m_alpha = 1.0;
+		break;
+	}
+
+	m_simulationTime += m_steps * m_stepDelta;
+}
+
+void FrameClock::Reset()
+{
+	m_frameCount = 0;
+	m_realDelta = 0.0;
+	m_realTime = 0.0;
+	m_accumulator = 0.0;
+	m_simulationTime = 0.0;
+	m_stepDelta = 0.0;
+	m_alpha = 1.0;
+	m_steps = 0;
+	m_droppedSteps = 0;
+}
+
+void FrameClock::SetMode(FrameClockMode mode)
+{
+	if (mode < 0 || mode >= FRAME_CLOCK_MODE_COUNT)
+	{
+		throw std::out_of_range("Unknown frame clock mode");
+	}
+
+	// Leftover time from another mode would come out as a burst of steps.
+	m_accumulator = 0.0;
+	m_mode = mode;
+}
+
+void FrameClock::SetFixedStep(double seconds)
+{
+	if (!(seconds > 0.0))
+	{
+		throw std::logic_error("Frame clock fixed step has to be more than 0");
+	}
+
+	m_fixedStep = seconds;
+}
+
+const char* FrameClock::GetModeName(FrameClockMode mode)
+{
+	switch (mode)
+	{
+	case FRAME_CLOCK_VARIABLE: return "Variable";
+	case FRAME_CLOCK_FIXED_STEP: return "Fixed Step";
+	case FRAME_CLOCK_INTERPOLATED: return "Interpolated";
+	case FRAME_CLOCK_BENCHMARK: return "Benchmark";
+	default: return "Unknown";
+	}
+}
+#pragma endregion
@@ -0,0 +1,141 @@
+#pragma once
+
+#pragma region Includes
+//Include{s}
+#include <cstddef>
+#include <cstdint>
+#pragma endregion
+
+// No Windows headers, the clock source is swappable so a fake one can step time by hand.
+
+/// <summary>
+/// Where the frame clock gets the time from. Has to be monotonic.
+/// </summary>
+class IClockSource
+{
+public:
+	virtual ~IClockSource() {}
+
+	/// <summary>
+	/// Gets the current time in nanoseconds, from whatever epoch the source likes.
+	/// </summary>
+	virtual uint64_t NowNs() = 0;
+};
+
+/// <summary>
+/// The SteadyClockSource class. steady_clock, which is QueryPerformanceCounter underneath on MSVC.
+/// </summary>
+class SteadyClockSource : public IClockSource
+{
+public:
+	uint64_t NowNs() override;
+};
+
+#pragma region Data Structures
+/// <summary>
+/// How the frame clock hands out simulation time.
+/// </summary>
+enum FrameClockMode
+{
+	FRAME_CLOCK_VARIABLE, // One step per frame, as long as the frame took
+	FRAME_CLOCK_FIXED_STEP, // As many fixed steps as fit in the time that's passed, render the newest state
+	FRAME_CLOCK_INTERPOLATED, // Same steps as fixed, but render between the last two states
+	FRAME_CLOCK_BENCHMARK, // Exactly one fixed step per frame whatever the wall clock says, so runs replay the same
+	FRAME_CLOCK_MODE_COUNT,
+};
+#pragma endregion
+
+/// <summary>
+/// The FrameClock class. Measures real frame time at nanosecond resolution and turns it into simulation steps.
+/// Tick once per frame, run GetSimulationSteps() steps of GetSimulationDeltaSeconds() each, then render.
+/// </summary>
+class FrameClock
+{
+public:
+#pragma region Constructors and Destructors
+	/// <summary>
+	/// Initializes a new instance of the FrameClock class.
+	/// </summary>
+	/// <param name="source">Where the time comes from, not owned. Null uses steady_clock.</param>
+	/// <param name="fixedStepSeconds">The step length for the fixed modes.</param>
+	/// <param name="maxStepsPerFrame">The most steps a fixed mode runs in one frame, after a long stall the rest is dropped rather than caught up.</param>
+	FrameClock(IClockSource* source = nullptr, double fixedStepSeconds = 1.0 / 60.0, uint32_t maxStepsPerFrame = 8);
+#pragma endregion
+
+#pragma region Clock Methods
+	/// <summary>
+	/// Starts a new frame. Samples the clock and works out this frame's simulation steps.
+	/// </summary>
+	void Tick();
+
+	/// <summary>
+	/// Starts again from zero, the next Tick is treated as the first frame.
+	/// </summary>
+	void Reset();
+
+	void SetMode(FrameClockMode mode);
+	FrameClockMode GetMode() const { return m_mode; }
+
+	void SetFixedStep(double seconds);
+	double GetFixedStep() const { return m_fixedStep; }
+#pragma endregion
+
+#pragma region Getters
+	/// <summary>
+	/// Gets how long the last frame really took, in every mode.
+	/// </summary>
+	double GetRealDeltaSeconds() const { return m_realDelta; }
+
+	/// <summary>
+	/// Gets the wall time since the first Tick.
+	/// </summary>
+	double GetRealTime() const { return m_realTime; }
+
+	/// <summary>
+	/// Gets how many simulation steps to run this frame, can be 0 in the fixed modes.
+	/// </summary>
+	uint32_t GetSimulationSteps() const { return m_steps; }
+
+	/// <summary>
+	/// Gets the length of each simulation step this frame.
+	/// </summary>
+	double GetSimulationDeltaSeconds() const { return m_stepDelta; }
+
+	/// <summary>
+	/// Gets the simulated time after this frame's steps.
+	/// </summary>
+	double GetSimulationTime() const { return m_simulationTime; }
+
+	/// <summary>
+	/// Gets how far between the last two simulated states to render, 0 to 1. Always 1 outside the interpolated mode.
+	/// </summary>
+	double GetInterpolationAlpha() const { return m_alpha; }
+
+	uint64_t GetFrameCount() const { return m_frameCount; }
+	uint64_t GetDroppedSteps() const { return m_droppedSteps; }
+
+	static const char* GetModeName(FrameClockMode mode);
+#pragma endregion
+
+private:
+#pragma region Private Variables
+	static const double kMaxVariableDelta; // Past this (a breakpoint, a window drag) the variable step is clamped
+
+	IClockSource* m_source;
+	SteadyClockSource m_steadySource;
+	FrameClockMode m_mode = FRAME_CLOCK_VARIABLE;
+	double m_fixedStep;
+	uint32_t m_maxStepsPerFrame;
+
+	uint64_t m_lastNs = 0;
+	uint64_t m_frameCount = 0;
+	double m_realDelta = 0.0;
+	double m_realTime = 0.0;
+	double m_accumulator = 0.0;
+	double m_simulationTime = 0.0;
+	double m_stepDelta = 0.0;
+	double m_alpha = 1.0;
+	uint32_t m_steps = 0;
+	uint64_t m_droppedSteps = 0;
+#pragma endregion
+};
@@ -0,0 +1,102 @@
+#pragma region Includes
+//Include{s}
+#include "FramePacer.h"
+#include <stdexcept>
+#pragma endregion
+
+#pragma region Constructors and Destructors
+FramePacer::FramePacer(IFrameQueue* queue, uint32_t framesInFlight)
+{
+	if (queue == nullptr || framesInFlight == 0)
+	{
+		throw std::logic_error("The frame pacer needs a queue and at least one frame in flight");
+	}
+
+	m_queue = queue;
+	m_frameFenceValues.assign(framesInFlight, 0);
+}
+
+FramePacer::~FramePacer()
+{
+	Flush();
+}
+#pragma endregion
+
+#pragma region Frame Methods
+uint32_t FramePacer::BeginFrame()
+{
+	// Only wait if the GPU hasn't finished with this slot's last use, that's the whole point of having more than one.
+	uint64_t slotFenceValue = m_frameFenceValues[m_frameIndex];
+
+	if (m_queue->GetCompletedValue() < slotFenceValue)
+	{
+		m_stats.stalls++;
+		m_queue->WaitForValue(slotFenceValue);
+	}
+
+	ReclaimRetired();
+
+	return m_frameIndex;
+}
+
+uint64_t FramePacer::EndFrame()
+{
+	uint64_t fenceValue = m_nextFenceValue++;
+	m_queue->Signal(fenceValue);
+
+	m_frameFenceValues[m_frameIndex] = fenceValue;
+	m_frameIndex = (m_frameIndex + 1) % GetFramesInFlight();
+	m_stats.framesSubmitted++;
+
+	return fenceValue;
+}
+
+uint64_t FramePacer::Flush()
+{
+	// Signal on its own so work submitted outside of a frame (setup, uploads) gets waited on too.
+	uint64_t fenceValue = m_nextFenceValue++;
+	m_queue->Signal(fenceValue);
+	m_queue->WaitForValue(fenceValue);
+	m_stats.flushes++;
+
+	RunRetired(fenceValue);
+
+	return fenceValue;
+}
+
+void FramePacer::Retire(ReleaseFunction release)
+{
+	// The next signal is the earliest one that covers everything recorded up to now, including the frame being built.
+	RetiredResource resource;
+	resource.fenceValue = m_nextFenceValue;
+	resource.release = release;
+	m_retired.push_back(resource);
+}
+
+void FramePacer::ReclaimRetired()
+{
+	if (!m_retired.empty())
+	{
+		RunRetired(m_queue->GetCompletedValue());
+	}
+}
+#pragma endregion
+
+#pragma region Private Methods
+void FramePacer::RunRetired(uint64_t completedValue)
+{
+	// Fence values only go up, so the queue is already sorted and we can stop at the first one that isn't done.
+	while (!m_retired.empty() && m_retired.front().fenceValue <= completedValue)
+	{
+		ReleaseFunction release = m_retired.front().release;
+		m_retired.pop_front();
+
+		if (release)
+		{
+			release();
+		}
+
+		m_stats.retired++;
+	}
+}
+#pragma endregion
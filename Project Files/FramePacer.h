@@ -0,0 +1,146 @@
+#pragma once
+
+#pragma region Includes
+//Include{s}
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <vector>
+#pragma endregion
+
+// No Windows headers in here either, the pacer only deals in fence values so a fake queue can drive it.
+
+/// <summary>
+/// The bits of a GPU queue the frame pacer needs. The D3D12 version wraps a command queue and a fence,
+/// anything else (a test double, say) just has to keep the completed value moving.
+/// </summary>
+class IFrameQueue
+{
+public:
+	virtual ~IFrameQueue() {}
+
+	/// <summary>
+	/// Queues a fence signal behind all the work submitted so far.
+	/// </summary>
+	/// <param name="value">The value the fence is set to once that work is done.</param>
+	virtual void Signal(uint64_t value) = 0;
+
+	/// <summary>
+	/// Gets the last fence value the GPU got through.
+	/// </summary>
+	virtual uint64_t GetCompletedValue() = 0;
+
+	/// <summary>
+	/// Blocks the CPU until the fence reaches the given value.
+	/// </summary>
+	virtual void WaitForValue(uint64_t value) = 0;
+};
+
+/// <summary>
+/// Running totals for the frame pacer.
+/// </summary>
+struct FramePacerStats
+{
+	uint64_t framesSubmitted = 0;
+	uint64_t stalls = 0; // How many times BeginFrame had to wait for the GPU
+	uint64_t flushes = 0;
+	uint64_t retired = 0; // Deferred releases that have actually run
+};
+
+/// <summary>
+/// The FramePacer class. Keeps up to N frames in flight, each frame slot remembers the fence value it was submitted with,
+/// so the CPU only waits when it laps the GPU. Also holds on to resources that have been swapped out until the GPU is done with them.
+/// </summary>
+class FramePacer
+{
+public:
+#pragma region Types
+	/// <summary>
+	/// Releases whatever it captured. Run once the GPU can no longer be using it.
+	/// </summary>
+	typedef std::function<void()> ReleaseFunction;
+#pragma endregion
+
+#pragma region Constructors and Destructors
+	/// <summary>
+	/// Initializes a new instance of the FramePacer class.
+	/// </summary>
+	/// <param name="queue">The queue to pace, not owned.</param>
+	/// <param name="framesInFlight">How many frames the CPU may get ahead of the GPU, at least 1.</param>
+	FramePacer(IFrameQueue* queue, uint32_t framesInFlight);
+
+	/// <summary>
+	/// Waits for the GPU and runs every pending release.
+	/// </summary>
+	~FramePacer();
+#pragma endregion
+
+#pragma region Frame Methods
+	/// <summary>
+	/// Starts a frame. Waits until the slot being reused has finished on the GPU and runs any releases that are now safe.
+	/// After this returns, the slot's command allocator and upload memory can be overwritten.
+	/// </summary>
+	/// <returns>The frame slot to record into.</returns>
+	uint32_t BeginFrame();
+
+	/// <summary>
+	/// Ends a frame, call it after the frame's command lists have been submitted.
+	/// Signals the queue and moves on to the next slot.
+	/// </summary>
+	/// <returns>The fence value the frame was signalled with.</returns>
+	uint64_t EndFrame();
+
+	/// <summary>
+	/// Waits until the GPU has finished everything submitted so far, then runs every pending release.
+	/// </summary>
+	/// <returns>The fence value that was waited on.</returns>
+	uint64_t Flush();
+
+	/// <summary>
+	/// Holds on to a resource until the GPU has finished all the work submitted up to and including the current frame.
+	/// </summary>
+	/// <param name="release">Called (and destroyed) once it's safe, capturing the resource in it is enough.</param>
+	void Retire(ReleaseFunction release);
+
+	/// <summary>
+	/// Runs every pending release the GPU has got past. BeginFrame already does this.
+	/// </summary>
+	void ReclaimRetired();
+#pragma endregion
+
+#pragma region Getters
+	uint32_t GetFramesInFlight() const { return static_cast<uint32_t>(m_frameFenceValues.size()); }
+	uint32_t GetFrameIndex() const { return m_frameIndex; }
+	uint64_t GetFrameFenceValue(uint32_t frameIndex) const { return m_frameFenceValues[frameIndex]; }
+	uint64_t GetLastSignaledValue() const { return m_nextFenceValue - 1; }
+	uint64_t GetCompletedValue() { return m_queue->GetCompletedValue(); }
+	size_t GetPendingRetirements() const { return m_retired.size(); }
+	const FramePacerStats& GetStats() const { return m_stats; }
+#pragma endregion
+
+private:
+#pragma region Private Types
+	struct RetiredResource
+	{
+		uint64_t fenceValue;
+		ReleaseFunction release;
+	};
+#pragma endregion
+
+#pragma region Private Methods
+	/// <summary>
+	/// Runs the releases whose fence value is at or below the completed value, in the order they were retired.
+	/// </summary>
+	void RunRetired(uint64_t completedValue);
+#pragma endregion
+
+#pragma region Private Variables
+	IFrameQueue* m_queue;
+	std::vector<uint64_t> m_frameFenceValues; // What each slot was last signalled with, 0 means never used
+	uint32_t m_frameIndex = 0;
+	uint64_t m_nextFenceValue = 1;
+	std::deque<RetiredResource> m_retired;
+	FramePacerStats m_stats;
+#pragma endregion
+};
@@ -0,0 +1,71 @@
+#include "stdafx.h"
+
+#pragma region Includes
+//Include{s}
+#include "FrameReadback.h"
+#pragma endregion
+
+#pragma region Constructors and Destructors
+FrameReadback::FrameReadback(ComPtr<ID3D12Device5> device, ComPtr<ID3D12Resource> outputResource, uint32_t frameSlots, const wchar_t* name)
+{
+	m_outputResource = outputResource;
+
+	D3D12_RESOURCE_DESC outputDesc = m_outputResource->GetDesc();
+	m_width = static_cast<uint32_t>(outputDesc.Width);
+	m_height = outputDesc.Height;
+
+	// Rows in the readback are padded out to 256 bytes, so ask the device what the layout is rather than assume it.
+	UINT64 totalBytes;
+	device->GetCopyableFootprints(&outputDesc, 0, 1, 0, &m_footprint, nullptr, nullptr, &totalBytes);
+	m_slotBytes = (totalBytes + D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT - 1) & ~static_cast<UINT64>(D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT - 1);
+
+	CD3DX12_HEAP_PROPERTIES readbackHeap(D3D12_HEAP_TYPE_READBACK);
+	CD3DX12_RESOURCE_DESC readbackDesc = CD3DX12_RESOURCE_DESC::Buffer(m_slotBytes * frameSlots);
+	ThrowIfFailed(device->CreateCommittedResource(&readbackHeap, D3D12_HEAP_FLAG_NONE, &readbackDesc,
+		D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&m_readback)));
+	m_readback->SetName(name);
+}
+#pragma endregion
+
+#pragma region Readback Methods
+void FrameReadback::RecordCopy(ID3D12GraphicsCommandList* commandList, uint32_t slot)
+{
+	D3D12_TEXTURE_COPY_LOCATION source = {};
+	source.pResource = m_outputResource.Get();
+	source.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+	source.SubresourceIndex = 0;
+
+	D3D12_TEXTURE_COPY_LOCATION destination = {};
+	destination.pResource = m_readback.Get();
+	destination.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
+	destination.PlacedFootprint = m_footprint;
+	destination.PlacedFootprint.Offset = slot * m_slotBytes;
+
+	commandList->CopyTextureRegion(&destination, 0, 0, 0, &source, nullptr);
+}
+
+void FrameReadback::Read(uint32_t slot, std::vector<uint8_t>& pixels)
+{
+	D3D12_RANGE readRange = { slot * m_slotBytes, slot * m_slotBytes + m_footprint.Footprint.RowPitch * m_height };
+	D3D12_RANGE writtenRange = { 0, 0 };
+
+	uint8_t* pData;
+	ThrowIfFailed(m_readback->Map(0, &readRange, reinterpret_cast<void**>(&pData)));
+
+	// Take the row padding out, and the alpha, a PNG would show it.
+	uint32_t rowBytes = m_width * 4;
+	pixels.resize(static_cast<size_t>(rowBytes) * m_height);
+	for (uint32_t row = 0; row < m_height; row++)
+	{
+		uint8_t* destination = pixels.data() + static_cast<size_t>(row) * rowBytes;
+		memcpy(destination, pData + readRange.Begin + static_cast<size_t>(row) * m_footprint.Footprint.RowPitch, rowBytes);
+
+		for (uint32_t x = 0; x < m_width; x++)
+		{
+			destination[x * 4 + 3] = 255;
+		}
+	}
+
+	m_readback->Unmap(0, &writtenRange);
+}
+#pragma endregion
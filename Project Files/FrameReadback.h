@@ -0,0 +1,51 @@
+#pragma once
+
+#pragma region Includes
+//Include{s}
+#include "DXRApp.h"
+#pragma endregion
+
+/// <summary>
+/// The FrameReadback class. Copies the raytracing output back to the CPU, into a part of one readback buffer per frame slot,
+/// so a frame's copy can be read once the pacer hands its slot back without anything waiting on the GPU.
+/// </summary>
+class FrameReadback
+{
+public:
+#pragma region Constructors and Destructors
+	/// <summary>
+	/// Initializes a new instance of the FrameReadback class.
+	/// </summary>
+	/// <param name="device">The device to make the readback buffer on.</param>
+	/// <param name="outputResource">The raytracing output, frames are copied out of it.</param>
+	/// <param name="frameSlots">How many frames can be in flight.</param>
+	/// <param name="name">What the buffer's called in PIX and the debug layer.</param>
+	FrameReadback(ComPtr<ID3D12Device5> device, ComPtr<ID3D12Resource> outputResource, uint32_t frameSlots, const wchar_t* name);
+#pragma endregion
+
+#pragma region Readback Methods
+	/// <summary>
+	/// Copies the output into the slot's part of the buffer. The output has to be a copy source already.
+	/// </summary>
+	void RecordCopy(ID3D12GraphicsCommandList* commandList, uint32_t slot);
+
+	/// <summary>
+	/// Reads what the slot copied, as tightly packed RGBA8 with the alpha set, since nothing writes a meaningful one.
+	/// Only once the GPU's finished with the slot.
+	/// </summary>
+	void Read(uint32_t slot, std::vector<uint8_t>& pixels);
+
+	uint32_t GetWidth() const { return m_width; }
+	uint32_t GetHeight() const { return m_height; }
+#pragma endregion
+
+private:
+#pragma region Private Variables
+	ComPtr<ID3D12Resource> m_outputResource;
+	ComPtr<ID3D12Resource> m_readback;
+	D3D12_PLACED_SUBRESOURCE_FOOTPRINT m_footprint = {};
+	UINT64 m_slotBytes = 0;
+	uint32_t m_width;
+	uint32_t m_height;
+#pragma endregion
+};
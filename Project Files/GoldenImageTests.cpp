@@ -0,0 +1,154 @@
+#include "stdafx.h"
+
+#pragma region Includes
+//Include{s}
+#include "GoldenImageTests.h"
+#include <fstream>
+#include "OfflineRenderer.h"
+#pragma endregion
+
+// Anything under these is a real change, a different driver or GPU moves the numbers a lot less than that.
+const double GoldenImageTests::kMinSsim = 0.98;
+const double GoldenImageTests::kMaxMeanFlip = 0.05;
+
+#pragma region Constructors and Destructors
+GoldenImageTests::GoldenImageTests(ComPtr<ID3D12Device5> device, ComPtr<ID3D12Resource> outputResource, uint32_t frameSlots,
+	const std::string& directory, bool updateGoldens)
+	: m_readback(device, outputResource, frameSlots, L"Golden Image Readback")
+{
+	m_directory = directory;
+	m_updateGoldens = updateGoldens;
+
+	// Both ends of the path and the bits in between, which between them see every object, the shadows and the reflections.
+	const int poseCount = 5;
+	for (int i = 0; i < poseCount; i++)
+	{
+		char name[32];
+		snprintf(name, sizeof(name), "path_%03d", i * 100 / (poseCount - 1));
+
+		GoldenTestCase testCase;
+		testCase.name = name;
+		testCase.splineTransition = static_cast<float>(i) / (poseCount - 1);
+		m_cases.push_back(testCase);
+	}
+
+	m_pending.assign(frameSlots, false);
+	m_pendingCases.assign(frameSlots, 0);
+	m_pendingFrameMs.assign(frameSlots, 0.0);
+}
+#pragma endregion
+
+#pragma region Test Methods
+float GoldenImageTests::GetCurrentTransition() const
+{
+	return m_cases[min(m_recordCase, m_cases.size() - 1)].splineTransition;
+}
+
+void GoldenImageTests::RecordFrame(ID3D12GraphicsCommandList* commandList, uint32_t slot, double frameMs)
+{
+	if (m_recordCase >= m_cases.size())
+	{
+		return;
+	}
+
+	if (m_recordFrame >= kWarmupFrames)
+	{
+		m_timedMs += frameMs;
+	}
+
+	if (++m_recordFrame < kFramesPerCase)
+	{
+		return;
+	}
+
+	m_readback.RecordCopy(commandList, slot);
+	m_pending[slot] = true;
+	m_pendingCases[slot] = m_recordCase;
+	m_pendingFrameMs[slot] = m_timedMs / (kFramesPerCase - kWarmupFrames);
+
+	m_recordCase++;
+	m_recordFrame = 0;
+	m_timedMs = 0.0;
+}
+
+void GoldenImageTests::CollectFrame(uint32_t slot)
+{
+	if (!m_pending[slot])
+	{
+		return;
+	}
+
+	m_pending[slot] = false;
+	const GoldenTestCase& testCase = m_cases[m_pendingCases[slot]];
+	std::string goldenPath = m_directory + "\\" + testCase.name + ".png";
+	uint32_t width = m_readback.GetWidth();
+	uint32_t height = m_readback.GetHeight();
+
+	std::vector<uint8_t> pixels;
+	m_readback.Read(slot, pixels);
+
+	GoldenTestResult result;
+	result.name = testCase.name;
+	result.frameMs = m_pendingFrameMs[slot];
+
+	if (m_updateGoldens)
+	{
+		result.hasGolden = OfflineRenderer::EncodePng(goldenPath, width, height, pixels.data());
+		result.passed = result.hasGolden;
+		m_results.push_back(result);
+		return;
+	}
+
+	uint32_t goldenWidth, goldenHeight;
+	std::vector<uint8_t> golden;
+	result.hasGolden = OfflineRenderer::DecodePng(goldenPath, goldenWidth, goldenHeight, golden) && goldenWidth == width && goldenHeight == height;
+
+	if (result.hasGolden)
+	{
+		std::vector<uint8_t> errorMap;
+		result.compare = ImageCompare::Compare(golden.data(), pixels.data(), width, height, &errorMap);
+		result.passed = result.compare.ssim >= kMinSsim && result.compare.meanFlip <= kMaxMeanFlip;
+
+		if (!result.passed)
+		{
+			OfflineRenderer::EncodePng(m_directory + "\\" + testCase.name + "_flip.png", width, height, errorMap.data());
+		}
+	}
+
+	// Keep what it actually rendered next to the golden, whatever was wrong, so it can be looked at or copied over.
+	if (!result.passed)
+	{
+		OfflineRenderer::EncodePng(m_directory + "\\" + testCase.name + "_actual.png", width, height, pixels.data());
+	}
+
+	m_results.push_back(result);
+}
+
+bool GoldenImageTests::Finish(const std::string& resultsPath)
+{
+	bool allPassed = true;
+	for (const GoldenTestResult& result : m_results)
+	{
+		char line[256];
+		snprintf(line, sizeof(line), "Golden %s: %s, SSIM %.4f, FLIP %.4f, %.3f ms\n", result.name.c_str(),
+			!result.hasGolden ? "no golden" : result.passed ? "passed" : "FAILED", result.compare.ssim, result.compare.meanFlip, result.frameMs);
+		OutputDebugStringA(line);
+		allPassed = allPassed && result.passed;
+	}
+
+	std::ofstream file(resultsPath, std::ios::trunc);
+	if (!file)
+	{
+		return false;
+	}
+
+	file << "test,ssim,mean_flip,max_flip,visible_flip_percent,frame_ms,has_golden,passed\n";
+	for (const GoldenTestResult& result : m_results)
+	{
+		file << result.name << ',' << result.compare.ssim << ',' << result.compare.meanFlip << ',' << result.compare.maxFlip << ',' <<
+			result.compare.flipAbovePercent << ',' << result.frameMs << ',' << (result.hasGolden ? 1 : 0) << ',' << (result.passed ? 1 : 0) << '\n';
+	}
+
+	return allPassed && static_cast<bool>(file);
+}
+#pragma endregion
@@ -0,0 +1,108 @@
+#pragma once
+
+#pragma region Includes
+//Include{s}
+#include "FrameReadback.h"
+#include "ImageCompare.h"
+#pragma endregion
+
+#pragma region Data Structures
+/// <summary>
+/// One golden image test, a camera pose on the path.
+/// </summary>
+struct GoldenTestCase
+{
+	std::string name; // The golden is this with .png on the end
+	float splineTransition; // Where on the camera path, 0 to 1
+};
+
+/// <summary>
+/// How one test went.
+/// </summary>
+struct GoldenTestResult
+{
+	std::string name;
+	ImageCompareResult compare;
+	double frameMs = 0.0; // Average frame time at this pose, so a slow shading change shows up next to a wrong one
+	bool hasGolden = false;
+	bool passed = false;
+};
+#pragma endregion
+
+/// <summary>
+/// The GoldenImageTests class. Renders the scene from a fixed set of camera poses and compares each one against a stored
+/// golden with SSIM and FLIP, so a shading change that breaks the image gets caught. Each pose is held for a few frames,
+/// the last one is read back and the rest are timed.
+/// </summary>
+class GoldenImageTests
+{
+public:
+#pragma region Constructors and Destructors
+	/// <summary>
+	/// Initializes a new instance of the GoldenImageTests class.
+	/// </summary>
+	/// <param name="device">The device to make the readback buffer on.</param>
+	/// <param name="outputResource">The raytracing output, frames are copied out of it.</param>
+	/// <param name="frameSlots">How many frames can be in flight.</param>
+	/// <param name="directory">Where the goldens are.</param>
+	/// <param name="updateGoldens">Write the renders out as the new goldens instead of comparing them.</param>
+	GoldenImageTests(ComPtr<ID3D12Device5> device, ComPtr<ID3D12Resource> outputResource, uint32_t frameSlots,
+		const std::string& directory, bool updateGoldens);
+#pragma endregion
+
+#pragma region Test Methods
+	/// <summary>
+	/// Where on the camera path the frame being set up now should be.
+	/// </summary>
+	float GetCurrentTransition() const;
+
+	/// <summary>
+	/// Counts a frame for the current pose, and on its last one copies the output out. The output has to be a copy source already.
+	/// </summary>
+	/// <param name="frameMs">How long the frame took.</param>
+	void RecordFrame(ID3D12GraphicsCommandList* commandList, uint32_t slot, double frameMs);
+
+	/// <summary>
+	/// Compares the image the slot copied out last time round, if it did. Call it once the pacer has the slot.
+	/// </summary>
+	void CollectFrame(uint32_t slot);
+
+	/// <summary>
+	/// Whether every pose has been compared.
+	/// </summary>
+	bool IsFinished() const { return m_results.size() >= m_cases.size(); }
+
+	/// <summary>
+	/// Writes every test's scores and frame time to a CSV.
+	/// </summary>
+	/// <returns>True if every test passed and the CSV was written.</returns>
+	bool Finish(const std::string& resultsPath);
+
+	const std::vector<GoldenTestResult>& GetResults() const { return m_results; }
+#pragma endregion
+
+#pragma region Thresholds
+	static const double kMinSsim;
+	static const double kMaxMeanFlip;
+	static const uint32_t kFramesPerCase = 16;
+	static const uint32_t kWarmupFrames = 4; // Not timed, the first frames at a new pose rebuild caches and aren't typical
+#pragma endregion
+
+private:
+#pragma region Private Variables
+	FrameReadback m_readback;
+	std::string m_directory;
+	bool m_updateGoldens;
+
+	std::vector<GoldenTestCase> m_cases;
+	size_t m_recordCase = 0;
+	uint32_t m_recordFrame = 0;
+	double m_timedMs = 0.0;
+
+	std::vector<bool> m_pending;
+	std::vector<size_t> m_pendingCases;
+	std::vector<double> m_pendingFrameMs;
+
+	std::vector<GoldenTestResult> m_results;
+#pragma endregion
+};
@@ -0,0 +1,158 @@
+#pragma region Includes
+//Include{s}
+#include "GpuTimestampTracker.h"
+#include <stdexcept>
+#pragma endregion
+
+#pragma region Constructors and Destructors
+GpuTimestampTracker::GpuTimestampTracker(IFrameQueue* queue, uint32_t frameSlots, uint32_t maxScopesPerFrame, uint32_t historySize)
+{
+	if (queue == nullptr || frameSlots == 0 || maxScopesPerFrame == 0)
+	{
+		throw std::logic_error("GPU timestamp tracker needs a queue, at least one frame slot and at least one scope per frame");
+	}
+
+	m_queue = queue;
+	m_slots.resize(frameSlots);
+	m_maxScopesPerFrame = maxScopesPerFrame;
+	m_historySize = historySize;
+}
+#pragma endregion
+
+#pragma region Frame Methods
+std::vector<GpuFrameResult> GpuTimestampTracker::BeginFrame(uint32_t slot, uint64_t frame, IGpuTimestampReader* reader)
+{
+	if (slot >= m_slots.size())
+	{
+		throw std::out_of_range("GPU timestamp frame slot out of range");
+	}
+
+	std::vector<GpuFrameResult> resolved = Collect(reader);
+
+	// Still pending means the GPU hasn't finished with it. Waiting here would defeat the point, so its results go.
+	FrameSlot& frameSlot = m_slots[slot];
+	if (frameSlot.pending)
+	{
+		m_stats.framesDropped++;
+	}
+
+	frameSlot.frame = frame;
+	frameSlot.fenceValue = 0;
+	frameSlot.pending = false;
+	frameSlot.scopes.clear();
+
+	m_currentSlot = slot;
+	m_depth = 0;
+	m_recording = true;
+
+	return resolved;
+}
+
+uint32_t GpuTimestampTracker::BeginScope(const char* name)
+{
+	FrameSlot& frameSlot = m_slots[m_currentSlot];
+
+	if (!m_recording || frameSlot.scopes.size() >= m_maxScopesPerFrame)
+	{
+		m_stats.scopesDropped++;
+		return kInvalidScope;
+	}
+
+	GpuScopeResult scope;
+	scope.name = name;
+	scope.depth = m_depth++;
+	frameSlot.scopes.push_back(scope);
+
+	return static_cast<uint32_t>(frameSlot.scopes.size() - 1);
+}
+
+void GpuTimestampTracker::EndScope(uint32_t scope)
+{
+	if (scope != kInvalidScope && m_depth > 0)
+	{
+		m_depth--;
+	}
+}
+
+void GpuTimestampTracker::GetResolveRange(uint32_t& firstQuery, uint32_t& queryCount) const
+{
+	firstQuery = m_currentSlot * m_maxScopesPerFrame * 2;
+	queryCount = static_cast<uint32_t>(m_slots[m_currentSlot].scopes.size()) * 2;
+}
+
+void GpuTimestampTracker::EndFrame(uint64_t fenceValue)
+{
+	if (!m_recording)
+	{
+		return;
+	}
+
+	FrameSlot& frameSlot = m_slots[m_currentSlot];
+	frameSlot.fenceValue = fenceValue;
+	frameSlot.pending = !frameSlot.scopes.empty();
+
+	m_recording = false;
+}
+
+std::vector<GpuFrameResult> GpuTimestampTracker::Collect(IGpuTimestampReader* reader)
+{
+	std::vector<GpuFrameResult> resolved;
+	uint64_t completedValue = m_queue->GetCompletedValue();
+
+	// Oldest first, so the history stays in frame order whichever slots they're in.
+	while (true)
+	{
+		int oldest = -1;
+
+		for (uint32_t slot = 0; slot < m_slots.size(); slot++)
+		{
+			const FrameSlot& frameSlot = m_slots[slot];
+			if (frameSlot.pending && frameSlot.fenceValue <= completedValue &&
+				(oldest < 0 || frameSlot.fenceValue < m_slots[oldest].fenceValue))
+			{
+				oldest = static_cast<int>(slot);
+			}
+		}
+
+		if (oldest < 0)
+		{
+			break;
+		}
+
+		resolved.push_back(ResolveSlot(static_cast<uint32_t>(oldest), reader));
+	}
+
+	return resolved;
+}
+#pragma endregion
+
+#pragma region Private Methods
+GpuFrameResult GpuTimestampTracker::ResolveSlot(uint32_t slot, IGpuTimestampReader* reader)
+{
+	FrameSlot& frameSlot = m_slots[slot];
+
+	std::vector<uint64_t> ticks(frameSlot.scopes.size() * 2);
+	reader->ReadTimestamps(slot * m_maxScopesPerFrame * 2, static_cast<uint32_t>(ticks.size()), ticks.data());
+
+	GpuFrameResult result;
+	result.frame = frameSlot.frame;
+	result.scopes = frameSlot.scopes;
+
+	for (size_t i = 0; i < result.scopes.size(); i++)
+	{
+		result.scopes[i].startTicks = ticks[i * 2];
+		result.scopes[i].endTicks = ticks[i * 2 + 1];
+	}
+
+	frameSlot.pending = false;
+	m_stats.framesResolved++;
+
+	m_history.push_back(result);
+	while (m_history.size() > m_historySize)
+	{
+		m_history.pop_front();
+	}
+
+	return result;
+}
+#pragma endregion
@@ -0,0 +1,164 @@
+#pragma once
+
+#pragma region Includes
+//Include{s}
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+#include "FramePacer.h"
+#pragma endregion
+
+// No Windows headers, this only hands out query indices and reads ticks back, so a fake queue and a fake reader can drive it.
+
+/// <summary>
+/// Where the resolved timestamps get read from. The D3D12 version reads the readback buffer the queries were resolved into.
+/// </summary>
+class IGpuTimestampReader
+{
+public:
+	virtual ~IGpuTimestampReader() {}
+
+	/// <summary>
+	/// Reads resolved timestamps. Only called for queries whose frame the GPU has finished.
+	/// </summary>
+	/// <param name="firstQuery">The first query index.</param>
+	/// <param name="queryCount">How many to read.</param>
+	/// <param name="timestamps">Where to write them, queryCount long.</param>
+	virtual void ReadTimestamps(uint32_t firstQuery, uint32_t queryCount, uint64_t* timestamps) = 0;
+};
+
+#pragma region Data Structures
+/// <summary>
+/// One timed GPU scope, in GPU ticks.
+/// </summary>
+struct GpuScopeResult
+{
+	const char* name = nullptr; // Has to outlive the results, string literals are fine
+	uint64_t startTicks = 0;
+	uint64_t endTicks = 0;
+	uint32_t depth = 0;
+};
+
+/// <summary>
+/// Every scope one frame recorded, once the GPU has got through it.
+/// </summary>
+struct GpuFrameResult
+{
+	uint64_t frame = 0; // The CPU profiler frame it was recorded in
+	std::vector<GpuScopeResult> scopes;
+};
+
+/// <summary>
+/// Running totals for the timestamp tracker.
+/// </summary>
+struct GpuTimestampStats
+{
+	uint64_t framesResolved = 0;
+	uint64_t framesDropped = 0; // A slot got reused before its results came back, shouldn't happen with the pacer waiting on it
+	uint64_t scopesDropped = 0; // Asked for more scopes in a frame than there were queries for
+};
+#pragma endregion
+
+/// <summary>
+/// The GpuTimestampTracker class. Each frame slot gets its own range of timestamp queries, two per scope.
+/// A frame's results are only read once the queue's fence says the GPU is past it, so collecting never waits.
+/// </summary>
+class GpuTimestampTracker
+{
+public:
+	static const uint32_t kInvalidScope = 0xFFFFFFFF;
+
+#pragma region Constructors and Destructors
+	/// <summary>
+	/// Initializes a new instance of the GpuTimestampTracker class.
+	/// </summary>
+	/// <param name="queue">The queue the frames are submitted on, not owned.</param>
+	/// <param name="frameSlots">How many frame slots there are, same as the frame pacer.</param>
+	/// <param name="maxScopesPerFrame">How many scopes a frame can time.</param>
+	/// <param name="historySize">How many resolved frames to keep.</param>
+	GpuTimestampTracker(IFrameQueue* queue, uint32_t frameSlots, uint32_t maxScopesPerFrame, uint32_t historySize);
+#pragma endregion
+
+#pragma region Frame Methods
+	/// <summary>
+	/// Starts recording a frame into a slot. Every finished frame is collected first, so whatever the slot held is dropped
+	/// only if the GPU still isn't done with it.
+	/// </summary>
+	/// <param name="slot">The frame slot, the pacer's frame index.</param>
+	/// <param name="frame">The frame number to tag the results with.</param>
+	/// <param name="reader">Where to read finished frames from.</param>
+	/// <returns>The frames that were collected, oldest first, same as Collect.</returns>
+	std::vector<GpuFrameResult> BeginFrame(uint32_t slot, uint64_t frame, IGpuTimestampReader* reader);
+
+	/// <summary>
+	/// Opens a scope in the current frame.
+	/// </summary>
+	/// <returns>The scope, or kInvalidScope if the frame is out of queries. Invalid scopes can be ended, they're just skipped.</returns>
+	uint32_t BeginScope(const char* name);
+
+	/// <summary>
+	/// Closes a scope in the current frame.
+	/// </summary>
+	void EndScope(uint32_t scope);
+
+	/// <summary>
+	/// Gets the range of queries the current frame used, this is what needs resolving before the command list is closed.
+	/// </summary>
+	void GetResolveRange(uint32_t& firstQuery, uint32_t& queryCount) const;
+
+	/// <summary>
+	/// Ends the current frame.
+	/// </summary>
+	/// <param name="fenceValue">The fence value the frame was signalled with.</param>
+	void EndFrame(uint64_t fenceValue);
+
+	/// <summary>
+	/// Reads back every frame the GPU has finished. Never waits.
+	/// </summary>
+	/// <returns>The frames that were resolved this time, oldest first.</returns>
+	std::vector<GpuFrameResult> Collect(IGpuTimestampReader* reader);
+#pragma endregion
+
+#pragma region Getters
+	uint32_t GetBeginQuery(uint32_t scope) const { return (m_currentSlot * m_maxScopesPerFrame + scope) * 2; }
+	uint32_t GetEndQuery(uint32_t scope) const { return GetBeginQuery(scope) + 1; }
+	uint32_t GetQueryCount() const { return static_cast<uint32_t>(m_slots.size()) * m_maxScopesPerFrame * 2; }
+
+	/// <summary>
+	/// Gets the resolved frames, oldest first.
+	/// </summary>
+	const std::deque<GpuFrameResult>& GetHistory() const { return m_history; }
+	const GpuTimestampStats& GetStats() const { return m_stats; }
+#pragma endregion
+
+private:
+#pragma region Private Types
+	struct FrameSlot
+	{
+		uint64_t frame = 0;
+		uint64_t fenceValue = 0;
+		bool pending = false; // Submitted and not read back yet
+		std::vector<GpuScopeResult> scopes; // Ticks get filled in when it's read back
+	};
+#pragma endregion
+
+#pragma region Private Methods
+	/// <summary>
+	/// Reads a finished slot's ticks back and adds it to the history.
+	/// </summary>
+	GpuFrameResult ResolveSlot(uint32_t slot, IGpuTimestampReader* reader);
+#pragma endregion
+
+#pragma region Private Variables
+	IFrameQueue* m_queue;
+	std::vector<FrameSlot> m_slots;
+	uint32_t m_maxScopesPerFrame;
+	uint32_t m_historySize;
+	uint32_t m_currentSlot = 0;
+	uint32_t m_depth = 0;
+	bool m_recording = false;
+	std::deque<GpuFrameResult> m_history;
+	GpuTimestampStats m_stats;
+#pragma endregion
+};
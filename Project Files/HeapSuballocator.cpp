@@ -0,0 +1,188 @@
+#pragma region Includes
+//Include{s}
+#include "HeapSuballocator.h"
+#include <iterator>
+#include <stdexcept>
+#pragma endregion
+
+#pragma region Constructors and Destructors
+HeapSuballocator::HeapSuballocator(uint64_t heapSize)
+{
+	if (heapSize == 0)
+	{
+		throw std::logic_error("The heap suballocator needs a heap size");
+	}
+
+	m_heapSize = heapSize;
+}
+#pragma endregion
+
+#pragma region Allocation Methods
+HeapAllocation HeapSuballocator::Allocate(uint64_t size, uint64_t alignment)
+{
+	if (alignment == 0 || (alignment & (alignment - 1)) != 0)
+	{
+		throw std::logic_error("Heap suballocator alignment has to be a power of two");
+	}
+
+	if (size == 0)
+	{
+		return HeapAllocation();
+	}
+
+	// Best fit, the free block that leaves the least behind wins. There are only ever a handful of heaps.
+	uint32_t bestHeap = HeapAllocation::kInvalidHeap;
+	uint64_t bestBlockOffset = 0;
+	uint64_t bestAlignedOffset = 0;
+	uint64_t bestLeftover = UINT64_MAX;
+
+	for (uint32_t heapIndex = 0; heapIndex < m_heaps.size(); heapIndex++)
+	{
+		for (auto& block : m_heaps[heapIndex].freeBlocks)
+		{
+			uint64_t alignedOffset = (block.first + alignment - 1) & ~(alignment - 1);
+			uint64_t blockEnd = block.first + block.second;
+
+			if (alignedOffset + size > blockEnd)
+			{
+				continue;
+			}
+
+			uint64_t leftover = block.second - size;
+			if (leftover < bestLeftover)
+			{
+				bestHeap = heapIndex;
+				bestBlockOffset = block.first;
+				bestAlignedOffset = alignedOffset;
+				bestLeftover = leftover;
+			}
+		}
+	}
+
+	if (bestHeap != HeapAllocation::kInvalidHeap)
+	{
+		return TakeFromBlock(bestHeap, bestBlockOffset, bestAlignedOffset, size);
+	}
+
+	// Nothing fits, so add a heap. Heaps start at offset 0, which is aligned to anything.
+	Heap heap;
+	heap.size = size > m_heapSize ? size : m_heapSize;
+	heap.freeBlocks[0] = heap.size;
+	m_heaps.push_back(heap);
+	m_stats.bytesReserved += heap.size;
+
+	return TakeFromBlock(static_cast<uint32_t>(m_heaps.size() - 1), 0, 0, size);
+}
+
+void HeapSuballocator::Free(const HeapAllocation& allocation)
+{
+	if (!allocation.IsValid())
+	{
+		return;
+	}
+
+	if (allocation.heapIndex >= m_heaps.size())
+	{
+		throw std::logic_error("Freeing a block from a heap that doesn't exist");
+	}
+
+	std::map<uint64_t, uint64_t>& freeBlocks = m_heaps[allocation.heapIndex].freeBlocks;
+
+	uint64_t offset = allocation.offset;
+	uint64_t size = allocation.size;
+
+	// Merge with the block after it.
+	auto next = freeBlocks.find(offset + size);
+	if (next != freeBlocks.end())
+	{
+		size += next->second;
+		freeBlocks.erase(next);
+	}
+
+	// And the block before it.
+	auto after = freeBlocks.lower_bound(offset);
+	if (after != freeBlocks.begin())
+	{
+		auto previous = std::prev(after);
+		if (previous->first + previous->second == offset)
+		{
+			offset = previous->first;
+			size += previous->second;
+			freeBlocks.erase(previous);
+		}
+	}
+
+	freeBlocks[offset] = size;
+
+	m_stats.frees++;
+	m_stats.bytesAllocated -= allocation.size;
+}
+#pragma endregion
+
+#pragma region Getters
+uint64_t HeapSuballocator::GetLargestFreeBlock() const
+{
+	uint64_t largest = 0;
+
+	for (const Heap& heap : m_heaps)
+	{
+		for (auto& block : heap.freeBlocks)
+		{
+			if (block.second > largest)
+			{
+				largest = block.second;
+			}
+		}
+	}
+
+	return largest;
+}
+
+double HeapSuballocator::GetFragmentation() const
+{
+	uint64_t freeBytes = GetFreeBytes();
+	if (freeBytes == 0)
+	{
+		return 0.0;
+	}
+
+	return 1.0 - static_cast<double>(GetLargestFreeBlock()) / static_cast<double>(freeBytes);
+}
+#pragma endregion
+
+#pragma region Private Methods
+HeapAllocation HeapSuballocator::TakeFromBlock(uint32_t heapIndex, uint64_t blockOffset, uint64_t alignedOffset, uint64_t size)
+{
+	std::map<uint64_t, uint64_t>& freeBlocks = m_heaps[heapIndex].freeBlocks;
+
+	uint64_t blockSize = freeBlocks[blockOffset];
+	freeBlocks.erase(blockOffset);
+
+	// The alignment padding in front stays free, small as it is.
+	if (alignedOffset > blockOffset)
+	{
+		freeBlocks[blockOffset] = alignedOffset - blockOffset;
+	}
+
+	uint64_t end = alignedOffset + size;
+	uint64_t blockEnd = blockOffset + blockSize;
+	if (blockEnd > end)
+	{
+		freeBlocks[end] = blockEnd - end;
+	}
+
+	HeapAllocation allocation;
+	allocation.heapIndex = heapIndex;
+	allocation.offset = alignedOffset;
+	allocation.size = size;
+
+	m_stats.allocations++;
+	m_stats.bytesAllocated += size;
+	if (m_stats.bytesAllocated > m_stats.peakBytesAllocated)
+	{
+		m_stats.peakBytesAllocated = m_stats.bytesAllocated;
+	}
+
+	return allocation;
+}
+#pragma endregion
@@ -0,0 +1,106 @@
+#pragma once
+
+#pragma region Includes
+//Include{s}
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+#pragma endregion
+
+// Bookkeeping only, no Windows headers. Says which heap and offset a block goes at, the caller owns the memory.
+
+#pragma region Data Structures
+/// <summary>
+/// Where a block ended up. heapIndex is kInvalidHeap if the allocation failed.
+/// </summary>
+struct HeapAllocation
+{
+	static const uint32_t kInvalidHeap = 0xFFFFFFFF;
+
+	uint32_t heapIndex = kInvalidHeap;
+	uint64_t offset = 0;
+	uint64_t size = 0;
+
+	bool IsValid() const { return heapIndex != kInvalidHeap; }
+};
+
+/// <summary>
+/// Running totals for the suballocator.
+/// </summary>
+struct HeapSuballocatorStats
+{
+	uint64_t allocations = 0;
+	uint64_t frees = 0;
+	uint64_t bytesReserved = 0; // Every heap's size added up
+	uint64_t bytesAllocated = 0; // Currently handed out
+	uint64_t peakBytesAllocated = 0;
+};
+#pragma endregion
+
+/// <summary>
+/// The HeapSuballocator class. Packs blocks into a list of fixed size heaps, best fit with free block coalescing,
+/// adding a heap whenever nothing fits. Blocks bigger than the heap size get a heap to themselves.
+/// </summary>
+class HeapSuballocator
+{
+public:
+#pragma region Constructors and Destructors
+	/// <summary>
+	/// Initializes a new instance of the HeapSuballocator class.
+	/// </summary>
+	/// <param name="heapSize">The size of each heap in bytes.</param>
+	HeapSuballocator(uint64_t heapSize);
+#pragma endregion
+
+#pragma region Allocation Methods
+	/// <summary>
+	/// Finds room for a block, adding a heap if none of the current ones can fit it.
+	/// </summary>
+	/// <param name="size">The size of the block in bytes.</param>
+	/// <param name="alignment">The alignment of the block's offset, has to be a power of two.</param>
+	/// <returns>Where the block goes. Check GetHeapCount afterwards, the caller has to back any new heap with memory.</returns>
+	HeapAllocation Allocate(uint64_t size, uint64_t alignment);
+
+	/// <summary>
+	/// Gives a block back, merging it with any free neighbours.
+	/// </summary>
+	void Free(const HeapAllocation& allocation);
+#pragma endregion
+
+#pragma region Getters
+	uint32_t GetHeapCount() const { return static_cast<uint32_t>(m_heaps.size()); }
+	uint64_t GetHeapSize(uint32_t heapIndex) const { return m_heaps[heapIndex].size; }
+	uint64_t GetFreeBytes() const { return m_stats.bytesReserved - m_stats.bytesAllocated; }
+	uint64_t GetLargestFreeBlock() const;
+
+	/// <summary>
+	/// Gets how broken up the free space is, 0 when it's all one block and heading to 1 as it splinters.
+	/// </summary>
+	double GetFragmentation() const;
+
+	const HeapSuballocatorStats& GetStats() const { return m_stats; }
+#pragma endregion
+
+private:
+#pragma region Private Types
+	struct Heap
+	{
+		uint64_t size;
+		std::map<uint64_t, uint64_t> freeBlocks; // offset -> size, sorted so neighbours are easy to find
+	};
+#pragma endregion
+
+#pragma region Private Methods
+	/// <summary>
+	/// Carves an aligned block out of a free block, whatever's left either side stays free.
+	/// </summary>
+	HeapAllocation TakeFromBlock(uint32_t heapIndex, uint64_t blockOffset, uint64_t alignedOffset, uint64_t size);
+#pragma endregion
+
+#pragma region Private Variables
+	uint64_t m_heapSize;
+	std::vector<Heap> m_heaps;
+	HeapSuballocatorStats m_stats;
+#pragma endregion
+};
@@ -5,19 +5,74 @@
 #pragma endregion
 
 
+#pragma region Permutations
+// Feature bits for the hit shader variants.
+// IMPORTANT - the C++ version of these is 'HitShaderFeature' found in the common.h file
+#define HIT_FEATURE_REFLECTION 1
+#define HIT_FEATURE_TRI_OUTLINE 2
+#define HIT_FEATURE_TEXTURE 4
+#define HIT_FEATURE_SHADOWS 8
+
+#define CONCAT_INNER(a, b) a##b
+#define CONCAT(a, b) CONCAT_INNER(a, b)
+
+#ifdef HIT_PERMUTATION
+// Specialised variant, the feature checks are compile time constants so the code for unused features gets stripped.
+#define HAS_FEATURE(feature, runtimeCheck) ((HIT_PERMUTATION & (feature)) != 0)
+#define HIT_ENTRY_NAME(name) CONCAT(name, CONCAT(_, HIT_PERMUTATION))
+#else
+// The uber shader, checks the material (and lights) at runtime.
+#define HAS_FEATURE(feature, runtimeCheck) (runtimeCheck)
+#define HIT_ENTRY_NAME(name) name
+#endif
+#pragma endregion
+
+
 #pragma region Shader Data
 
-// Object Tri Data
+// Material Data for an object, one entry per instance in the material table.
+struct MaterialData
+{ // IMPORTANT - the C++ version of this is 'MaterialBuffer' found in the common.h file
+	uint reflection;
+	float shininess;
+	int maxRecursionDepth;
+	uint triOutline;
+	float triThickness;
+	float3 triColour;
+	float4 objectColour;
+	float roughness;
+	uint texture;
+	uint textureIndex;
+	float padding2;
+};
+
+// Where an object's triangles live inside the global vertex and index pools.
+struct MeshInfo
+{ // IMPORTANT - the C++ version of this is 'MeshInfo' found in the common.h file
+	uint vertexOffset;
+	uint indexOffset;
+	uint vertexCount;
+	uint indexCount;
+	uint materialIndex;
+};
+
+// Global vertex pool, every object's vertices packed back to back
 StructuredBuffer<STriVertex> BTriVertex : register(t0);
 
-// Object Index Data
+// Global index pool, every object's indices packed back to back (relative to the object's first vertex)
 StructuredBuffer<int> indices : register(t1);
 
 // Acceleration Structure for the object
 RaytracingAccelerationStructure SceneBVH : register(t2);
 
-// Texture Data for the object
-Texture2D<float4> g_texture : register(t3);
+// Every texture in the heap, indexed with the material's texture index
+Texture2D<float4> g_textures[] : register(t3);
+
+// Material table, indexed by the mesh's materialIndex
+StructuredBuffer<MaterialData> g_materials : register(t0, space1);
+
+// Mesh offset table, indexed by InstanceID(). Every object's full mesh comes first, then the LOD levels
+StructuredBuffer<MeshInfo> g_meshInfo : register(t1, space1);
 
 // Sampler for the object for the texture
 SamplerState g_sampler : register(s0);
@@ -36,21 +91,6 @@ cbuffer LightParams : register(b0)
 	float4 padding;
 
 }
-
-// Material Data for the object
-cbuffer MaterialBuffer : register(b1)
-{
-	uint reflection;
-	float shininess;
-	int maxRecursionDepth;
-	uint triOutline;
-	float triThickness;
-	float3 triColour;
-	float4 objectColour;
-	float roughness;
-	uint texture;
-	float2 padding2;
-}
 #pragma endregion
 
 #pragma region Hit Attribute Functions
@@ -90,24 +130,24 @@ float random(float2 uv)
 #pragma region Lighting Functions
 
 // Calculates the diffuse lighting for the object.
-float4 CalculateDiffuseLighting(float3 lightDirection, float3 worldNormal)
+float4 CalculateDiffuseLighting(in MaterialData material, float3 lightDirection, float3 worldNormal)
 {
 	float diffuseAmount = saturate(dot(lightDirection, normalize(worldNormal)));
 
 	float diffuseCoEfficent = saturate(dot(lightDirection, worldNormal));
 
-	float4 diffuseOut = diffuseAmount * diffuseCoEfficent * lightDiffuseColor * objectColour;
+	float4 diffuseOut = diffuseAmount * diffuseCoEfficent * lightDiffuseColor * material.objectColour;
 
 	return diffuseOut;
 }
 
 // Calculates the ambient lighting for the object.
-float4 CalculateAmbientLighting(float3 worldNormal)
+float4 CalculateAmbientLighting(in MaterialData material, float3 worldNormal)
 {
 
 	float4 ambientColorMin = lightAmbientColor - 0.1;
 	float a = 1 - saturate(dot(worldNormal, float3(0, -1, 0)));
-	float4 ambientOut = objectColour * lerp(ambientColorMin, lightAmbientColor, a);
+	float4 ambientOut = material.objectColour * lerp(ambientColorMin, lightAmbientColor, a);
 
 	return ambientOut;
 }
@@ -134,9 +174,9 @@ float4 CalculateSpecularLighting(float3 hitWorldPosition, float3 lightDirection,
 #pragma region RayTracing Functions
 
 // Calculates the reflection ray for the object.
-float4 TraceReflectionRay(in RayDesc reflectionRay,in uint recursionDepth)
+float4 TraceReflectionRay(in MaterialData material, in RayDesc reflectionRay,in uint recursionDepth, float2 cone)
 {
-	if (recursionDepth >= maxRecursionDepth)
+	if (recursionDepth >= material.maxRecursionDepth)
 	{
 		return float4(0.0f, 0.0f, 0.0f, 0.0f);
 	}
@@ -145,8 +185,13 @@ float4 TraceReflectionRay(in RayDesc reflectionRay,in uint recursionDepth)
 
 	reflectionPayload.colorAndDistance = float4(0.0f, 0.0f, 0.0f, 0.0f);
 	reflectionPayload.recursiveDepth = recursionDepth + 1;
+	reflectionPayload.cone = cone;
+
+	// The wider the cone already is, the less of the mesh's detail it can make out, so it can see a coarser LOD.
+	uint mask = LodInstanceMask(uint3(INSTANCE_MASK_REFLECTION, INSTANCE_MASK_REFLECTION_LOD1, INSTANCE_MASK_REFLECTION_LOD2), cone.x);
 
-	TraceRay(SceneBVH, RAY_FLAG_FORCE_NON_OPAQUE, 0xFF, 0, 0, 0, reflectionRay, reflectionPayload);
+	CountRays(RAY_COUNTER_REFLECTION, 1);
+	TraceRay(SceneBVH, RAY_FLAG_FORCE_NON_OPAQUE, mask, 0, 0, 0, reflectionRay, reflectionPayload);
 
 
 	return reflectionPayload.colorAndDistance;
@@ -160,10 +205,10 @@ float3 FresnelReflectanceSchlick(float3 worldNormal, float3 albedo)
 }
 
 // Test if the object has reflection rays
-float3 TestReflectionRays(float3 colorOut, float3 hitWorldPosition, float3 worldNormal, HitInfo payload)
+float3 TestReflectionRays(in MaterialData material, float3 colorOut, float3 hitWorldPosition, float3 worldNormal, HitInfo payload, float coneWidth)
 {
 
-	if (reflection == 1)
+	if (HAS_FEATURE(HIT_FEATURE_REFLECTION, material.reflection == 1))
 	{
 		RayDesc reflectionRay;
 
@@ -172,11 +217,14 @@ float3 TestReflectionRays(float3 colorOut, float3 hitWorldPosition, float3 world
 		reflectionRay.TMin = 0.00001f;
 		reflectionRay.TMax = 100000;
 
-		float4 reflectionColor = TraceReflectionRay(reflectionRay, payload.recursiveDepth);
-		float3 fresnelReflectance = FresnelReflectanceSchlick( worldNormal, objectColour.xyz);
+		// Roughness tips the normal by up to its own value, which swings the reflection by twice that.
+		float2 reflectionCone = float2(coneWidth, payload.cone.y + 2.0f * material.roughness);
 
+		float4 reflectionColor = TraceReflectionRay(material, reflectionRay, payload.recursiveDepth, reflectionCone);
+		float3 fresnelReflectance = FresnelReflectanceSchlick( worldNormal, material.objectColour.xyz);
 
-		float4 reflectionOut = shininess * float4(fresnelReflectance, 1) * reflectionColor;
+
+		float4 reflectionOut = material.shininess * float4(fresnelReflectance, 1) * reflectionColor;
 
 
 		colorOut += reflectionOut;
@@ -187,15 +235,21 @@ float3 TestReflectionRays(float3 colorOut, float3 hitWorldPosition, float3 world
 }
 
 // Calculates the shadow rays for the object and adds the diffuse and specular lighting to the colorOut.
-float3 TraceShadowRays(float3 colorOut, float4 diffuseColour, float4 specularColour, float3 hitWorldPosition, float3 worldNormal, float3 lightDirection)
+float3 TraceShadowRays(float3 colorOut, float4 diffuseColour, float4 specularColour, float3 hitWorldPosition, float3 worldNormal, float3 lightDirection, float coneWidth)
 {
-	if (shadows == 0)
+	// The shading point is already blurred over the incoming cone's footprint, so the shadow doesn't need any more detail than that.
+	uint mask = LodInstanceMask(uint3(INSTANCE_MASK_SHADOW, INSTANCE_MASK_SHADOW_LOD1, INSTANCE_MASK_SHADOW_LOD2), coneWidth);
+
+	if (!HAS_FEATURE(HIT_FEATURE_SHADOWS, shadows != 0))
 	{
 		colorOut += diffuseColour;
 		colorOut += specularColour;
 	}
 	else
 	{
+		// The main shadow ray plus however many soft shadow rays the loop gets through, counted in one go at the end.
+		uint shadowRaysTraced = 1;
+
 		{
 			RayDesc ray;
 
@@ -207,7 +261,7 @@ float3 TraceShadowRays(float3 colorOut, float4 diffuseColour, float4 specularCol
 
 			ShadowHitInfo shadowPayload;
 			shadowPayload.isHit = false;
-			TraceRay(SceneBVH, RAY_FLAG_FORCE_NON_OPAQUE, 0xFF, 1, 0, 1, ray, shadowPayload);
+			TraceRay(SceneBVH, RAY_FLAG_FORCE_NON_OPAQUE, mask, 1, 0, 1, ray, shadowPayload);
 
 			if (!shadowPayload.isHit)
 			{
@@ -233,11 +287,14 @@ float3 TraceShadowRays(float3 colorOut, float4 diffuseColour, float4 specularCol
 
 			ShadowHitInfo shadowPayload;
 			shadowPayload.isHit = false;
-			TraceRay(SceneBVH, RAY_FLAG_FORCE_NON_OPAQUE, 0xFF, 1, 0, 1, ray, shadowPayload);
+			TraceRay(SceneBVH, RAY_FLAG_FORCE_NON_OPAQUE, mask, 1, 0, 1, ray, shadowPayload);
 
 			shadowTotal += shadowPayload.isHit ? 0.0f : 1.0f;
+			shadowRaysTraced++;
 		}
 
+		CountRays(RAY_COUNTER_SHADOW, shadowRaysTraced);
+
 		float shadowFactor = shadowTotal / shawdowRayCount;
 		colorOut *= shadowFactor;
 	}
@@ -249,16 +306,16 @@ float3 TraceShadowRays(float3 colorOut, float4 diffuseColour, float4 specularCol
 #pragma region Outline Functions
 
 // Draws the triangle outlines for the object.
-float3 DrawTriOutlines(float3 colorOut, float3 barycentrics)
+float3 DrawTriOutlines(in MaterialData material, float3 colorOut, float3 barycentrics)
 {
 
-	if (triOutline == 1)
+	if (HAS_FEATURE(HIT_FEATURE_TRI_OUTLINE, material.triOutline == 1))
 	{
 		float minB = min(barycentrics.x, min(barycentrics.y, barycentrics.z));
 
-		if (minB < triThickness)
+		if (minB < material.triThickness)
 		{
-			colorOut = triColour;
+			colorOut = material.triColour;
 		}
 	}
 	return colorOut;
@@ -268,21 +325,24 @@ float3 DrawTriOutlines(float3 colorOut, float3 barycentrics)
 
 #pragma region Normal Functions
 // Calculates the triangle normal for the object.
-float3 CalculateTriangleNormal(uint vertid, Attributes attrib)
+float3 CalculateTriangleNormal(in MeshInfo mesh, uint vertid, Attributes attrib)
 {
+	uint indexBase = mesh.indexOffset + vertid;
+
 	float3 vertexNormals[3];
-	vertexNormals[0] = BTriVertex[indices[vertid + 0]].normal.xyz;
-	vertexNormals[1] = BTriVertex[indices[vertid + 1]].normal.xyz;
-	vertexNormals[2] = BTriVertex[indices[vertid + 2]].normal.xyz;
+	vertexNormals[0] = BTriVertex[mesh.vertexOffset + indices[indexBase + 0]].normal.xyz;
+	vertexNormals[1] = BTriVertex[mesh.vertexOffset + indices[indexBase + 1]].normal.xyz;
+	vertexNormals[2] = BTriVertex[mesh.vertexOffset + indices[indexBase + 2]].normal.xyz;
 	float3 triangleNormal = HitAttribute(vertexNormals, attrib);
 	return triangleNormal;
 }
 
 // Calculates the roughness normal for the object.
-float3 CalculateRoughnessNormal(float3 hitWorldPosition,float3 worldNormal)
+float3 CalculateRoughnessNormal(in MaterialData material, float3 hitWorldPosition,float3 worldNormal)
 {
 
-	if (roughness == 0.0f)
+	// Always a runtime check, the roughness slider goes through 0 and that mustn't rebuild the pipeline.
+	if (material.roughness == 0.0f)
 	{
 		return worldNormal;
 	}
@@ -296,7 +356,7 @@ float3 CalculateRoughnessNormal(float3 hitWorldPosition,float3 worldNormal)
 
 	float3 randomVector = float3(rand1, rand2, rand3);
 
-	randomVector *= scaledNoise * roughness;
+	randomVector *= scaledNoise * material.roughness;
 
 	return normalize(worldNormal + randomVector);
 }
@@ -304,20 +364,23 @@ float3 CalculateRoughnessNormal(float3 hitWorldPosition,float3 worldNormal)
 
 #pragma region Texture Functions
 // Calculates the texture colour for the object.
-float4 CalculateTextureColour(uint vertid, Attributes attrib)
+float4 CalculateTextureColour(in MaterialData material, in MeshInfo mesh, uint vertid, Attributes attrib)
 {
 	float4 textureColour = { 0, 0, 0, 0 };
 
-	if (texture == 1)
+	if (HAS_FEATURE(HIT_FEATURE_TEXTURE, material.texture == 1))
 	{
+		uint indexBase = mesh.indexOffset + vertid;
+
 		float2 texCoords[3];
-		texCoords[0] = BTriVertex[indices[vertid + 0]].tex;
-		texCoords[1] = BTriVertex[indices[vertid + 1]].tex;
-		texCoords[2] = BTriVertex[indices[vertid + 2]].tex;
+		texCoords[0] = BTriVertex[mesh.vertexOffset + indices[indexBase + 0]].tex;
+		texCoords[1] = BTriVertex[mesh.vertexOffset + indices[indexBase + 1]].tex;
+		texCoords[2] = BTriVertex[mesh.vertexOffset + indices[indexBase + 2]].tex;
 
 		float2 texCoord = HitAttribute(texCoords, attrib);
 
-	   textureColour = g_texture.SampleLevel(g_sampler, texCoord, 0);
+	   // Neighbouring rays can hit objects with different textures, so the index is non-uniform.
+	   textureColour = g_textures[NonUniformResourceIndex(material.textureIndex)].SampleLevel(g_sampler, texCoord, 0);
 	}
 
 	return textureColour;
@@ -326,37 +389,40 @@ float4 CalculateTextureColour(uint vertid, Attributes attrib)
 
 
 #pragma region Hit Shaders
-// Hit shader for objects that are not planes.
+// Hit shader for objects that are not planes. Variants get their feature mask tacked on the end of the name, e.g. ClosestHit_5.
 [shader("closesthit")]
-void ClosestHit(inout HitInfo payload, Attributes attrib)
+void HIT_ENTRY_NAME(ClosestHit)(inout HitInfo payload, Attributes attrib)
 {
 	float3 barycentrics = float3(1.0f - attrib.bary.x - attrib.bary.y, attrib.bary.x, attrib.bary.y);
 	uint vertid = 3 * PrimitiveIndex();
 
+	// Every object shares the same hit group arguments, so the instance ID is what picks out our mesh, and the mesh our material.
+	MeshInfo mesh = g_meshInfo[InstanceID()];
+	MaterialData material = g_materials[mesh.materialIndex];
 
-
-	float3 triangleNormal = CalculateTriangleNormal(vertid, attrib);
+	float3 triangleNormal = CalculateTriangleNormal(mesh, vertid, attrib);
 
 	float3 worldNormal = normalize(mul(triangleNormal, (float3x3) ObjectToWorld4x3()));
 	float3 hitWorldPosition = HitWorldPosition();
+	float coneWidth = payload.cone.x + payload.cone.y * RayTCurrent() * length(WorldRayDirection()); // Camera rays aren't normalised
 
 	float3 lightDirection = normalize((float3) lightPosition - hitWorldPosition);
 	float distance = length((float3) lightPosition - hitWorldPosition);
 	float attenuation = saturate(1.0 - distance / lightRange);
 
-	float3 roughnessNormal = CalculateRoughnessNormal(hitWorldPosition, worldNormal);
-	float4 textureColour = CalculateTextureColour(vertid, attrib) * attenuation;
-	float4 diffuseColour = CalculateDiffuseLighting(lightDirection, roughnessNormal) * attenuation;
-	float4 ambientColour = CalculateAmbientLighting(roughnessNormal) * attenuation;
+	float3 roughnessNormal = CalculateRoughnessNormal(material, hitWorldPosition, worldNormal);
+	float4 textureColour = CalculateTextureColour(material, mesh, vertid, attrib) * attenuation;
+	float4 diffuseColour = CalculateDiffuseLighting(material, lightDirection, roughnessNormal) * attenuation;
+	float4 ambientColour = CalculateAmbientLighting(material, roughnessNormal) * attenuation;
 	float4 specularColour = CalculateSpecularLighting(hitWorldPosition, lightDirection, roughnessNormal) * attenuation;
 
 	float3 colorOut = textureColour + ambientColour;
 
-	colorOut = DrawTriOutlines(colorOut, barycentrics);
+	colorOut = DrawTriOutlines(material, colorOut, barycentrics);
 
-	colorOut = TraceShadowRays(colorOut, diffuseColour, specularColour, hitWorldPosition, roughnessNormal, lightDirection);
+	colorOut = TraceShadowRays(colorOut, diffuseColour, specularColour, hitWorldPosition, roughnessNormal, lightDirection, coneWidth);
 
-	colorOut = TestReflectionRays(colorOut, hitWorldPosition, roughnessNormal, payload);
+	colorOut = TestReflectionRays(material, colorOut, hitWorldPosition, roughnessNormal, payload, coneWidth);
 
 	payload.colorAndDistance += float4(colorOut.xyz, RayTCurrent());
 }
@@ -373,34 +439,38 @@ void AnyHit(inout HitInfo payload, Attributes attrib)
 
 // Hit shader for objects that are planes.
 [shader("closesthit")]
-void PlaneClosestHit(inout HitInfo payload, Attributes attrib)
+void HIT_ENTRY_NAME(PlaneClosestHit)(inout HitInfo payload, Attributes attrib)
 {
 
 	float3 barycentrics = float3(1.0f - attrib.bary.x - attrib.bary.y, attrib.bary.x, attrib.bary.y);
 
 	uint vertid = 3 * PrimitiveIndex();
 
-	float3 triangleNormal = CalculateTriangleNormal(vertid, attrib);
+	MeshInfo mesh = g_meshInfo[InstanceID()];
+	MaterialData material = g_materials[mesh.materialIndex];
+
+	float3 triangleNormal = CalculateTriangleNormal(mesh, vertid, attrib);
 
 	float3 worldNormal = normalize(mul(triangleNormal, (float3x3) ObjectToWorld4x3()));
 	float3 hitWorldPosition = HitWorldPosition();
+	float coneWidth = payload.cone.x + payload.cone.y * RayTCurrent() * length(WorldRayDirection()); // Camera rays aren't normalised
 
 	float3 lightDirection = normalize((float3) lightPosition - hitWorldPosition);
 	float distance = length((float3) lightPosition - hitWorldPosition);
 	float attenuation = saturate(1.0 - distance / lightRange);
 
-	float3 roughnessNormal = CalculateRoughnessNormal(hitWorldPosition, worldNormal);
-	float4 textureColour = CalculateTextureColour(vertid, attrib) * attenuation;
-	float4 diffuseColour = CalculateDiffuseLighting(lightDirection, roughnessNormal) * attenuation;
-	float4 ambientColour = CalculateAmbientLighting(roughnessNormal) * attenuation;
+	float3 roughnessNormal = CalculateRoughnessNormal(material, hitWorldPosition, worldNormal);
+	float4 textureColour = CalculateTextureColour(material, mesh, vertid, attrib) * attenuation;
+	float4 diffuseColour = CalculateDiffuseLighting(material, lightDirection, roughnessNormal) * attenuation;
+	float4 ambientColour = CalculateAmbientLighting(material, roughnessNormal) * attenuation;
 
 	float3 colorOut = textureColour + ambientColour;
 
-	colorOut = DrawTriOutlines(colorOut, barycentrics);
+	colorOut = DrawTriOutlines(material, colorOut, barycentrics);
 
-	colorOut = TraceShadowRays(colorOut, diffuseColour, float4(0, 0, 0, 0), hitWorldPosition, roughnessNormal, lightDirection);
+	colorOut = TraceShadowRays(colorOut, diffuseColour, float4(0, 0, 0, 0), hitWorldPosition, roughnessNormal, lightDirection, coneWidth);
 
-	colorOut = TestReflectionRays(colorOut, hitWorldPosition, roughnessNormal, payload);
+	colorOut = TestReflectionRays(material, colorOut, hitWorldPosition, roughnessNormal, payload, coneWidth);
 
 	payload.colorAndDistance = float4(colorOut.xyz, RayTCurrent());
 }
@@ -0,0 +1,246 @@
+#pragma region Includes
+//Include{s}
+#include "ImageCompare.h"
+#include <algorithm>
+#include <cmath>
+#pragma endregion
+
+const float ImageCompare::kVisibleFlip = 0.1f;
+
+#pragma region Colour Helpers
+namespace
+{
+	struct Lab
+	{
+		float L, a, b;
+	};
+
+	float SrgbToLinear(float c)
+	{
+		return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+	}
+
+	float LabCurve(float t)
+	{
+		const float delta = 6.0f / 29.0f;
+		return t > delta * delta * delta ? std::cbrt(t) : t / (3.0f * delta * delta) + 4.0f / 29.0f;
+	}
+
+	// Linear sRGB to L*a*b* against a D65 white, with FLIP's Hunt adjustment, so colour differences in the dark count for less.
+	Lab LinearToHuntLab(float r, float g, float b)
+	{
+		r = std::min(std::max(r, 0.0f), 1.0f);
+		g = std::min(std::max(g, 0.0f), 1.0f);
+		b = std::min(std::max(b, 0.0f), 1.0f);
+
+		float x = (0.4124564f * r + 0.3575761f * g + 0.1804375f * b) / 0.9504559f;
+		float y = 0.2126729f * r + 0.7151522f * g + 0.0721750f * b;
+		float z = (0.0193339f * r + 0.1191920f * g + 0.9503041f * b) / 1.0890578f;
+
+		Lab lab;
+		lab.L = 116.0f * LabCurve(y) - 16.0f;
+		lab.a = 500.0f * (LabCurve(x) - LabCurve(y)) * 0.01f * lab.L;
+		lab.b = 200.0f * (LabCurve(y) - LabCurve(z)) * 0.01f * lab.L;
+		return lab;
+	}
+
+	// HyAB, which behaves better than plain Euclidean L*a*b* for the big differences renders tend to have.
+	float HyAB(const Lab& first, const Lab& second)
+	{
+		float da = first.a - second.a;
+		float db = first.b - second.b;
+		return std::fabs(first.L - second.L) + std::sqrt(da * da + db * db);
+	}
+
+	// Linear RGB with a [1 2 1] blur both ways, edges clamped.
+	std::vector<float> BlurredLinear(const uint8_t* pixels, uint32_t width, uint32_t height)
+	{
+		float lut[256];
+		for (int i = 0; i < 256; i++)
+		{
+			lut[i] = SrgbToLinear(i / 255.0f);
+		}
+
+		size_t pixelCount = static_cast<size_t>(width) * height;
+		std::vector<float> linear(pixelCount * 3);
+		for (size_t i = 0; i < pixelCount; i++)
+		{
+			linear[i * 3 + 0] = lut[pixels[i * 4 + 0]];
+			linear[i * 3 + 1] = lut[pixels[i * 4 + 1]];
+			linear[i * 3 + 2] = lut[pixels[i * 4 + 2]];
+		}
+
+		std::vector<float> horizontal(linear.size());
+		for (uint32_t y = 0; y < height; y++)
+		{
+			for (uint32_t x = 0; x < width; x++)
+			{
+				size_t left = static_cast<size_t>(y) * width + (x > 0 ? x - 1 : x);
+				size_t centre = static_cast<size_t>(y) * width + x;
+				size_t right = static_cast<size_t>(y) * width + (x + 1 < width ? x + 1 : x);
+				for (int c = 0; c < 3; c++)
+				{
+					horizontal[centre * 3 + c] = 0.25f * linear[left * 3 + c] + 0.5f * linear[centre * 3 + c] + 0.25f * linear[right * 3 + c];
+				}
+			}
+		}
+
+		for (uint32_t y = 0; y < height; y++)
+		{
+			for (uint32_t x = 0; x < width; x++)
+			{
+				size_t up = static_cast<size_t>(y > 0 ? y - 1 : y) * width + x;
+				size_t centre = static_cast<size_t>(y) * width + x;
+				size_t down = static_cast<size_t>(y + 1 < height ? y + 1 : y) * width + x;
+				for (int c = 0; c < 3; c++)
+				{
+					linear[centre * 3 + c] = 0.25f * horizontal[up * 3 + c] + 0.5f * horizontal[centre * 3 + c] + 0.25f * horizontal[down * 3 + c];
+				}
+			}
+		}
+
+		return linear;
+	}
+}
+#pragma endregion
+
+#pragma region Compare Methods
+ImageCompareResult ImageCompare::Compare(const uint8_t* reference, const uint8_t* test, uint32_t width, uint32_t height,
+	std::vector<uint8_t>* errorMap)
+{
+	ImageCompareResult result;
+	if (width == 0 || height == 0)
+	{
+		return result;
+	}
+
+	result.ssim = Ssim(reference, test, width, height);
+
+	std::vector<float> flip = FlipColourError(reference, test, width, height);
+	double total = 0.0;
+	size_t visible = 0;
+	for (float error : flip)
+	{
+		total += error;
+		result.maxFlip = std::max(result.maxFlip, static_cast<double>(error));
+		visible += error > kVisibleFlip ? 1 : 0;
+	}
+	result.meanFlip = total / flip.size();
+	result.flipAbovePercent = 100.0 * visible / flip.size();
+
+	if (errorMap != nullptr)
+	{
+		errorMap->resize(flip.size() * 4);
+		for (size_t i = 0; i < flip.size(); i++)
+		{
+			uint8_t value = static_cast<uint8_t>(std::min(flip[i], 1.0f) * 255.0f + 0.5f);
+			(*errorMap)[i * 4 + 0] = value;
+			(*errorMap)[i * 4 + 1] = value;
+			(*errorMap)[i * 4 + 2] = value;
+			(*errorMap)[i * 4 + 3] = 255;
+		}
+	}
+
+	return result;
+}
+
+double ImageCompare::Ssim(const uint8_t* reference, const uint8_t* test, uint32_t width, uint32_t height)
+{
+	if (width == 0 || height == 0)
+	{
+		return 1.0;
+	}
+
+	// The usual constants, for 8 bit values.
+	const double c1 = (0.01 * 255.0) * (0.01 * 255.0);
+	const double c2 = (0.03 * 255.0) * (0.03 * 255.0);
+
+	size_t pixelCount = static_cast<size_t>(width) * height;
+	std::vector<float> lumaReference(pixelCount);
+	std::vector<float> lumaTest(pixelCount);
+	for (size_t i = 0; i < pixelCount; i++)
+	{
+		lumaReference[i] = 0.299f * reference[i * 4 + 0] + 0.587f * reference[i * 4 + 1] + 0.114f * reference[i * 4 + 2];
+		lumaTest[i] = 0.299f * test[i * 4 + 0] + 0.587f * test[i * 4 + 1] + 0.114f * test[i * 4 + 2];
+	}
+
+	// Images smaller than a window are just one window.
+	uint32_t windowWidth = std::min(width, 8u);
+	uint32_t windowHeight = std::min(height, 8u);
+	double total = 0.0;
+	size_t windows = 0;
+
+	for (uint32_t top = 0; top + windowHeight <= height; top += std::max(windowHeight / 2, 1u))
+	{
+		for (uint32_t left = 0; left + windowWidth <= width; left += std::max(windowWidth / 2, 1u))
+		{
+			double sumReference = 0.0, sumTest = 0.0;
+			double sumReferenceSq = 0.0, sumTestSq = 0.0, sumCross = 0.0;
+
+			for (uint32_t y = top; y < top + windowHeight; y++)
+			{
+				for (uint32_t x = left; x < left + windowWidth; x++)
+				{
+					size_t i = static_cast<size_t>(y) * width + x;
+					double r = lumaReference[i];
+					double t = lumaTest[i];
+					sumReference += r;
+					sumTest += t;
+					sumReferenceSq += r * r;
+					sumTestSq += t * t;
+					sumCross += r * t;
+				}
+			}
+
+			double n = static_cast<double>(windowWidth) * windowHeight;
+			double meanReference = sumReference / n;
+			double meanTest = sumTest / n;
+			double varianceReference = sumReferenceSq / n - meanReference * meanReference;
+			double varianceTest = sumTestSq / n - meanTest * meanTest;
+			double covariance = sumCross / n - meanReference * meanTest;
+
+			total += ((2.0 * meanReference * meanTest + c1) * (2.0 * covariance + c2)) /
+				((meanReference * meanReference + meanTest * meanTest + c1) * (varianceReference + varianceTest + c2));
+			windows++;
+		}
+	}
+
+	return total / windows;
+}
+
+std::vector<float> ImageCompare::FlipColourError(const uint8_t* reference, const uint8_t* test, uint32_t width, uint32_t height)
+{
+	// FLIP's constants. The error gets compressed, then the small differences are stretched out over most of the range,
+	// since those are the ones it's most important to tell apart.
+	const float qc = 0.7f;
+	const float pc = 0.4f;
+	const float pt = 0.95f;
+
+	Lab green = LinearToHuntLab(0.0f, 1.0f, 0.0f);
+	Lab blue = LinearToHuntLab(0.0f, 0.0f, 1.0f);
+	float cmax = std::pow(HyAB(green, blue), qc);
+
+	std::vector<float> linearReference = BlurredLinear(reference, width, height);
+	std::vector<float> linearTest = BlurredLinear(test, width, height);
+
+	size_t pixelCount = static_cast<size_t>(width) * height;
+	std::vector<float> error(pixelCount);
+	for (size_t i = 0; i < pixelCount; i++)
+	{
+		Lab first = LinearToHuntLab(linearReference[i * 3 + 0], linearReference[i * 3 + 1], linearReference[i * 3 + 2]);
+		Lab second = LinearToHuntLab(linearTest[i * 3 + 0], linearTest[i * 3 + 1], linearTest[i * 3 + 2]);
+		float distance = std::pow(HyAB(first, second), qc);
+
+		if (distance < pc * cmax)
+		{
+			error[i] = distance * pt / (pc * cmax);
+		}
+		else
+		{
+			error[i] = std::min(pt + (distance - pc * cmax) / (cmax - pc * cmax) * (1.0f - pt), 1.0f);
+		}
+	}
+
+	return error;
+}
+#pragma endregion
@@ -0,0 +1,55 @@
+#pragma once
+
+#pragma region Includes
+//Include{s}
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#pragma endregion
+
+// No Windows headers, this only does maths on pixels, loading and saving the images is left to whoever calls it.
+
+#pragma region Data Structures
+/// <summary>
+/// How different two images are.
+/// </summary>
+struct ImageCompareResult
+{
+	double ssim = 1.0; // Structural similarity of the luminance, 1 is identical
+	double meanFlip = 0.0; // Mean perceptual colour error, 0 is identical and 1 is as different as green and blue
+	double maxFlip = 0.0; // The worst single pixel
+	double flipAbovePercent = 0.0; // How much of the image is over the visible error threshold, as a percentage
+};
+#pragma endregion
+
+/// <summary>
+/// The ImageCompare class. Compares a render against a golden image with two metrics that catch different things.
+/// SSIM picks up structure, like a missing shadow edge or a blurred reflection, and the FLIP colour error picks up
+/// shading that's drifted, like a changed Fresnel term, weighted by how noticeable the change actually is.
+/// </summary>
+class ImageCompare
+{
+public:
+	/// <summary>
+	/// Compares two RGBA8 images of the same size. Alpha is ignored.
+	/// </summary>
+	/// <param name="errorMap">If not null, gets a greyscale RGBA8 image of the FLIP error, white is worst.</param>
+	static ImageCompareResult Compare(const uint8_t* reference, const uint8_t* test, uint32_t width, uint32_t height,
+		std::vector<uint8_t>* errorMap = nullptr);
+
+	/// <summary>
+	/// Mean SSIM of the luminance over 8x8 windows, overlapping by half.
+	/// </summary>
+	static double Ssim(const uint8_t* reference, const uint8_t* test, uint32_t width, uint32_t height);
+
+	/// <summary>
+	/// The colour part of NVIDIA's FLIP, per pixel. Both images get a small blur, standing in for FLIP's contrast
+	/// sensitivity filters, then it's the HyAB distance in Hunt adjusted L*a*b*, squashed into 0 to 1.
+	/// </summary>
+	static std::vector<float> FlipColourError(const uint8_t* reference, const uint8_t* test, uint32_t width, uint32_t height);
+
+	/// <summary>
+	/// The FLIP error above which a difference is easy to see, used for the percentage in the result.
+	/// </summary>
+	static const float kVisibleFlip;
+};
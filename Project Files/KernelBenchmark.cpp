@@ -0,0 +1,1736 @@
+#pragma region Includes
+//Include{s}
+#include "KernelBenchmark.h"
+#include "BlasBuildBatcher.h"
+#include "BlasBuildPolicy.h"
+#include "CameraSpline.h"
+#include "CpuProfiler.h"
+#include "FramePacer.h"
+#include "GpuTimestampTracker.h"
+#include "HeapSuballocator.h"
+#include "MeshLod.h"
+#include "MeshOptimiser.h"
+#include "ScenePicker.h"
+#include "ShaderCache.h"
+#include "TileProtocol.h"
+#include "TileScheduler.h"
+#include "TransformBatch.h"
+#include "UploadRingAllocator.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#pragma endregion
+
+#pragma region Workload Helpers
+namespace
+{
+	// Everything is made from the same seed, so two runs time exactly the same work.
+	const unsigned int kSeed = 1234;
+	const int kRayCount = 4096;
+	const int kTriangleCount = 256;
+	const int kBoxPacketCount = 64;
+	const int kBvhRayCount = 16384;
+	const int kShadeCount = 1 << 20;
+	const int kTransformCount = 100000;
+	const int kPickInstanceCount = 4096;
+	const int kPickRayCount = 4096;
+	const int kLodSelectCount = 1 << 20;
+	const int kSplineEvalCount = 1 << 18;
+
+	// Equal steps along a path have to be within this much of each other. The steps are big enough that float positions
+	// aren't what's being measured.
+	const double kSplineSpeedTolerance = 0.0025;
+
+	// How many frames the upload ring traces run for.
+	const int kRingFrameCount = 20000;
+
+	// The BLAS pool as DXRContext sets it up, and how often the scene's BLASes get replayed and rebuilt.
+	const uint64_t kBlasPageSize = 4 * 1024 * 1024;
+	const uint64_t kBlasScratchBudget = 32 * 1024 * 1024;
+	const uint64_t kBlasAlignment = 256;
+	const int kBlasReplayCount = 1000;
+	const int kBlasRebuildCount = 1 << 16;
+
+	// How many scopes the profiler workloads open, and what they're held up against: a 60Hz frame opening this many scopes,
+	// which is a good few more than DXRRuntime does now. Scopes can't cost more than this much of that frame.
+	const int kProfilerScopeCount = 1 << 20;
+	const int kProfilerScopesPerFrame = 32;
+	const double kProfilerFrameNs = 1e9 / 60.0;
+	const double kProfilerFrameBudget = 0.001;
+
+	// The meshes that get LOD chains in the scene, the knot being the big one.
+	const char* const kLodMeshes[] = { "torusKnot", "Text" };
+
+	// The meshes in Objects, the BVH numbers are one per mesh.
+	const char* const kMeshes[] =
+	{
+		"BetterThanAidan", "BetterThanJack", "BetterThanJacob", "BetterThanJames", "BetterThanLouise", "BetterThanScott",
+		"Text", "Text2", "ball", "donut", "torusKnot",
+	};
+
+	RayVec3 RandomDirection(std::mt19937& random)
+	{
+		std::normal_distribution<float> normal(0.0f, 1.0f);
+		RayVec3 direction(normal(random), normal(random), normal(random));
+		float length = std::sqrt(direction.x * direction.x + direction.y * direction.y + direction.z * direction.z);
+		return length > 0.0f ? RayVec3(direction.x / length, direction.y / length, direction.z / length) : RayVec3(0.0f, 0.0f, 1.0f);
+	}
+
+	RayVec3 RandomPoint(std::mt19937& random, const KernelBox& box)
+	{
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+		return RayVec3(box.minimum.x + (box.maximum.x - box.minimum.x) * unit(random),
+			box.minimum.y + (box.maximum.y - box.minimum.y) * unit(random),
+			box.minimum.z + (box.maximum.z - box.minimum.z) * unit(random));
+	}
+
+	// Rays from outside the box aimed at somewhere inside it, so most of them have something to find.
+	std::vector<KernelRay> MakeRays(std::mt19937& random, const KernelBox& box, int count)
+	{
+		RayVec3 centre((box.minimum.x + box.maximum.x) * 0.5f, (box.minimum.y + box.maximum.y) * 0.5f, (box.minimum.z + box.maximum.z) * 0.5f);
+		RayVec3 extent(box.maximum.x - box.minimum.x, box.maximum.y - box.minimum.y, box.maximum.z - box.minimum.z);
+		float radius = std::sqrt(extent.x * extent.x + extent.y * extent.y + extent.z * extent.z);
+
+		std::vector<KernelRay> rays;
+		rays.reserve(count);
+		for (int i = 0; i < count; i++)
+		{
+			RayVec3 offset = RandomDirection(random);
+			RayVec3 origin(centre.x + offset.x * radius, centre.y + offset.y * radius, centre.z + offset.z * radius);
+			RayVec3 target = RandomPoint(random, box);
+			RayVec3 direction(target.x - origin.x, target.y - origin.y, target.z - origin.z);
+			float length = std::sqrt(direction.x * direction.x + direction.y * direction.y + direction.z * direction.z);
+			rays.push_back(KernelRay(origin, RayVec3(direction.x / length, direction.y / length, direction.z / length)));
+		}
+		return rays;
+	}
+
+	void Multiply(const float a[4][4], const float b[4][4], float result[4][4])
+	{
+		for (int row = 0; row < 4; row++)
+		{
+			for (int column = 0; column < 4; column++)
+			{
+				result[row][column] = a[row][0] * b[0][column] + a[row][1] * b[1][column] + a[row][2] * b[2][column] + a[row][3] * b[3][column];
+			}
+		}
+	}
+
+	// What DrawableGameObject::update used to do for every object, every step: wrap, spin, then three rotation matrices,
+	// a scale and a translation multiplied together, one object at a time.
+	void ScalarTransform(TransformVec3& rotation, const TransformVec3& position, const TransformVec3& scale, float turn, float world[12])
+	{
+		if (std::fabs(rotation.x) > 360.0f) rotation.x = 0.0f;
+		if (std::fabs(rotation.y) > 360.0f) rotation.y = 0.0f;
+		if (std::fabs(rotation.z) > 360.0f) rotation.z = 0.0f;
+		rotation.y += turn;
+
+		const float toRadians = 0.0174532925f;
+		float sx = std::sin(rotation.x * toRadians), cx = std::cos(rotation.x * toRadians);
+		float sy = std::sin(rotation.y * toRadians), cy = std::cos(rotation.y * toRadians);
+		float sz = std::sin(rotation.z * toRadians), cz = std::cos(rotation.z * toRadians);
+
+		float scaling[4][4] = { { scale.x, 0, 0, 0 }, { 0, scale.y, 0, 0 }, { 0, 0, scale.z, 0 }, { 0, 0, 0, 1 } };
+		float rotateX[4][4] = { { 1, 0, 0, 0 }, { 0, cx, sx, 0 }, { 0, -sx, cx, 0 }, { 0, 0, 0, 1 } };
+		float rotateY[4][4] = { { cy, 0, -sy, 0 }, { 0, 1, 0, 0 }, { sy, 0, cy, 0 }, { 0, 0, 0, 1 } };
+		float rotateZ[4][4] = { { cz, sz, 0, 0 }, { -sz, cz, 0, 0 }, { 0, 0, 1, 0 }, { 0, 0, 0, 1 } };
+		float translation[4][4] = { { 1, 0, 0, 0 }, { 0, 1, 0, 0 }, { 0, 0, 1, 0 }, { position.x, position.y, position.z, 1 } };
+
+		float first[4][4], second[4][4];
+		Multiply(scaling, rotateX, first);
+		Multiply(first, rotateY, second);
+		Multiply(second, rotateZ, first);
+		Multiply(first, translation, second);
+
+		for (int row = 0; row < 3; row++)
+		{
+			for (int column = 0; column < 4; column++)
+			{
+				world[row * 4 + column] = second[column][row];
+			}
+		}
+	}
+
+	// One frame of upload ring traffic, and the fence value the GPU has got through by the time it starts.
+	struct RingRequest
+	{
+		uint32_t size;
+		uint32_t alignment;
+	};
+
+	struct RingFrame
+	{
+		std::vector<RingRequest> requests;
+		uint64_t completedFence;
+	};
+
+	struct RingTrace
+	{
+		const char* name;
+		uint64_t capacity;
+		std::vector<RingFrame> frames;
+		uint64_t allocations;
+	};
+
+	struct RingLive
+	{
+		uint64_t fence;
+		uint64_t offset;
+		uint64_t size;
+	};
+
+	// Plays a trace through a fresh ring, allocate, finish the frame, reclaim what's done, the same as DXRRuntime does. When
+	// overlaps isn't null every allocation is checked against the ones still in flight, which is far too slow to time.
+	UploadRingStats ReplayRing(const RingTrace& trace, uint64_t* overlaps)
+	{
+		UploadRingAllocator ring(trace.capacity);
+		std::deque<RingLive> live;
+
+		for (size_t frame = 0; frame < trace.frames.size(); frame++)
+		{
+			ring.Reclaim(trace.frames[frame].completedFence);
+			while (overlaps != nullptr && !live.empty() && live.front().fence <= trace.frames[frame].completedFence)
+			{
+				live.pop_front();
+			}
+
+			for (const RingRequest& request : trace.frames[frame].requests)
+			{
+				uint64_t offset = 0;
+				if (!ring.Allocate(request.size, request.alignment, offset) || overlaps == nullptr)
+				{
+					continue;
+				}
+
+				for (const RingLive& other : live)
+				{
+					*overlaps += offset < other.offset + other.size && other.offset < offset + request.size ? 1 : 0;
+				}
+				*overlaps += offset % request.alignment != 0 || offset + request.size > trace.capacity ? 1 : 0;
+
+				RingLive allocation = { frame + 1, offset, request.size };
+				live.push_back(allocation);
+			}
+
+			ring.FinishFrame(frame + 1);
+		}
+
+		return ring.GetStats();
+	}
+
+	// What the BLAS pool looks like once a trace has been replayed.
+	struct BlasReplay
+	{
+		uint64_t allocations = 0;
+		uint64_t failedAllocations = 0;
+		uint64_t buildBytesReserved = 0; // The pages the uncompacted builds needed, gone once compaction's done
+		HeapSuballocatorStats stats;
+		uint32_t heapCount = 0;
+		double fragmentation = 0.0;
+	};
+
+	// Builds a BLAS the way DXRSetup does, the uncompacted build in the build pool and then the compacted copy in the real
+	// one, or straight into the real one if it isn't compacted.
+	HeapAllocation AllocateBlas(const BlasMemoryEntry& entry, HeapSuballocator& pool, HeapSuballocator& buildPool, BlasReplay& replay)
+	{
+		if (!entry.policy.allowCompaction)
+		{
+			HeapAllocation allocation = pool.Allocate(entry.reservedBytes, kBlasAlignment);
+			replay.allocations++;
+			replay.failedAllocations += allocation.IsValid() ? 0 : 1;
+			return allocation;
+		}
+
+		HeapAllocation built = buildPool.Allocate(entry.reservedBytes, kBlasAlignment);
+		HeapAllocation allocation = pool.Allocate(entry.finalBytes, kBlasAlignment);
+		replay.allocations += 2;
+		replay.failedAllocations += (built.IsValid() ? 0 : 1) + (allocation.IsValid() ? 0 : 1);
+		if (built.IsValid())
+		{
+			buildPool.Free(built);
+		}
+		return allocation;
+	}
+
+	// Plays a recorded scene through the pool, every BLAS built at once like at load, then rebuilds random ones the given
+	// number of times. A rebuild frees the old BLAS after its replacement is in, the same as retiring it through the pacer.
+	BlasReplay ReplayBlasTrace(const std::vector<BlasMemoryEntry>& entries, int rebuilds, std::mt19937& random)
+	{
+		BlasReplay replay;
+		HeapSuballocator pool(kBlasPageSize);
+
+		// The load builds every uncompacted BLAS before any of them are copied, so the build pool has to hold them all.
+		HeapSuballocator buildPool(kBlasPageSize);
+		std::vector<HeapAllocation> built(entries.size());
+		for (size_t i = 0; i < entries.size(); i++)
+		{
+			built[i] = entries[i].policy.allowCompaction ? buildPool.Allocate(entries[i].reservedBytes, kBlasAlignment) :
+				pool.Allocate(entries[i].reservedBytes, kBlasAlignment);
+			replay.allocations++;
+			replay.failedAllocations += built[i].IsValid() ? 0 : 1;
+		}
+
+		std::vector<HeapAllocation> blases(entries.size());
+		for (size_t i = 0; i < entries.size(); i++)
+		{
+			blases[i] = built[i];
+			if (entries[i].policy.allowCompaction)
+			{
+				blases[i] = pool.Allocate(entries[i].finalBytes, kBlasAlignment);
+				replay.allocations++;
+				replay.failedAllocations += blases[i].IsValid() ? 0 : 1;
+				if (built[i].IsValid())
+				{
+					buildPool.Free(built[i]);
+				}
+			}
+		}
+
+		std::uniform_int_distribution<size_t> pick(0, entries.empty() ? 0 : entries.size() - 1);
+		for (int i = 0; i < rebuilds && !entries.empty(); i++)
+		{
+			size_t index = pick(random);
+			HeapAllocation rebuilt = AllocateBlas(entries[index], pool, buildPool, replay);
+			if (blases[index].IsValid())
+			{
+				pool.Free(blases[index]);
+			}
+			blases[index] = rebuilt;
+		}
+
+		replay.buildBytesReserved = buildPool.GetStats().bytesReserved;
+
+		replay.stats = pool.GetStats();
+		replay.heapCount = pool.GetHeapCount();
+		replay.fragmentation = pool.GetFragmentation();
+		return replay;
+	}
+
+	// A queue that's got as far as it's told, and a reader whose ticks are ten times the query index, so every tick read
+	// back says which query it came from.
+	class FakeFrameQueue : public IFrameQueue
+	{
+	public:
+		void Signal(uint64_t value) override { m_signalled = value; }
+		uint64_t GetCompletedValue() override { return m_completed; }
+		void WaitForValue(uint64_t value) override { m_completed = std::max(m_completed, value); }
+
+		uint64_t m_signalled = 0;
+		uint64_t m_completed = 0;
+	};
+
+	class FakeTimestampReader : public IGpuTimestampReader
+	{
+	public:
+		void ReadTimestamps(uint32_t firstQuery, uint32_t queryCount, uint64_t* timestamps) override
+		{
+			for (uint32_t i = 0; i < queryCount; i++)
+			{
+				timestamps[i] = (firstQuery + i) * 10ull;
+			}
+		}
+	};
+
+	uint32_t CountBits(uint32_t mask)
+	{
+		uint32_t count = 0;
+		for (; mask != 0; mask &= mask - 1)
+		{
+			count++;
+		}
+		return count;
+	}
+}
+#pragma endregion
+
+#pragma region Constructors and Destructors
+KernelBenchmark::KernelBenchmark(double regressionTolerance, int repeats)
+	: m_regressionTolerance(regressionTolerance), m_repeats(std::max(repeats, 1))
+{
+}
+#pragma endregion
+
+#pragma region Benchmark Methods
+bool KernelBenchmark::LoadBaseline(const std::string& path)
+{
+	std::ifstream file(path);
+	if (!file)
+	{
+		return false;
+	}
+
+	m_baseline.clear();
+
+	// Same layout WriteCsv writes, only the name and ns_per_op are needed.
+	std::string line;
+	std::getline(file, line);
+	while (std::getline(file, line))
+	{
+		std::istringstream stream(line);
+		std::string name, unit, operations, nsPerOp;
+		if (std::getline(stream, name, ',') && std::getline(stream, unit, ',') && std::getline(stream, operations, ',') &&
+			std::getline(stream, nsPerOp, ','))
+		{
+			m_baseline[name] = std::strtod(nsPerOp.c_str(), nullptr);
+		}
+	}
+
+	return !m_baseline.empty();
+}
+
+void KernelBenchmark::Run(const std::string& objectDirectory)
+{
+	m_results.clear();
+	m_checks.clear();
+	RunTriangleKernels();
+	RunBoxKernels();
+	RunBvhKernels(objectDirectory);
+	RunShadingKernels();
+	RunTransformKernels();
+	RunPickKernels(objectDirectory);
+	RunLodKernels(objectDirectory);
+	RunSplineKernels();
+	RunUploadRingKernels();
+	RunBlasHeapKernels(objectDirectory);
+	RunProfilerKernels();
+	RunBlasPolicyChecks();
+	RunTileChecks();
+	RunGpuTimestampChecks();
+	RunFramePacerChecks();
+	RunShaderCacheChecks();
+}
+
+bool KernelBenchmark::WriteCsv(const std::string& path) const
+{
+	std::ofstream file(path, std::ios::trunc);
+	if (!file)
+	{
+		return false;
+	}
+
+	file << "name,unit,operations,ns_per_op,ops_per_second,baseline_ns_per_op,regressed\n";
+	for (const KernelBenchmarkResult& result : m_results)
+	{
+		file << result.name << ',' << result.unit << ',' << result.operations << ',' << result.nsPerOp << ',' << result.opsPerSecond << ','
+			<< result.baselineNsPerOp << ',' << (result.regressed ? 1 : 0) << '\n';
+	}
+
+	return static_cast<bool>(file);
+}
+
+bool KernelBenchmark::WriteChecksCsv(const std::string& path) const
+{
+	std::ofstream file(path, std::ios::trunc);
+	if (!file)
+	{
+		return false;
+	}
+
+	file << "name,passed,detail\n";
+	for (const KernelCheckResult& check : m_checks)
+	{
+		file << check.name << ',' << (check.passed ? 1 : 0) << ",\"" << check.detail << "\"\n";
+	}
+
+	return static_cast<bool>(file);
+}
+
+std::string KernelBenchmark::FormatResult(const KernelBenchmarkResult& result)
+{
+	std::ostringstream stream;
+	stream << result.name << ": " << result.nsPerOp << " ns/" << result.unit << ", " << result.opsPerSecond << ' ' << result.unit << "s/sec";
+	if (result.baselineNsPerOp > 0.0)
+	{
+		stream << " (" << (result.nsPerOp / result.baselineNsPerOp - 1.0) * 100.0 << "% vs baseline)";
+	}
+	if (result.regressed)
+	{
+		stream << " REGRESSED";
+	}
+	return stream.str();
+}
+
+std::string KernelBenchmark::FormatCheck(const KernelCheckResult& check)
+{
+	return check.name + ": " + (check.passed ? "passed" : "FAILED") + ", " + check.detail;
+}
+
+bool KernelBenchmark::HasRegressions() const
+{
+	for (const KernelBenchmarkResult& result : m_results)
+	{
+		if (result.regressed)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+bool KernelBenchmark::HasFailedChecks() const
+{
+	for (const KernelCheckResult& check : m_checks)
+	{
+		if (!check.passed)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+#pragma endregion
+
+#pragma region Private Methods
+template <class Kernel>
+void KernelBenchmark::Measure(const std::string& name, const std::string& unit, uint64_t operations, Kernel kernel)
+{
+	// One run to warm the caches and the branch predictors, which doesn't count.
+	m_sink += kernel();
+
+	double bestNs = 0.0;
+	for (int i = 0; i < m_repeats; i++)
+	{
+		auto start = std::chrono::steady_clock::now();
+		m_sink += kernel();
+		auto end = std::chrono::steady_clock::now();
+
+		double ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+		bestNs = i == 0 ? ns : std::min(bestNs, ns);
+	}
+
+	KernelBenchmarkResult result;
+	result.name = name;
+	result.unit = unit;
+	result.operations = operations;
+	result.nsPerOp = bestNs / operations;
+	result.opsPerSecond = bestNs > 0.0 ? operations * 1e9 / bestNs : 0.0;
+
+	auto baseline = m_baseline.find(name);
+	if (baseline != m_baseline.end() && baseline->second > 0.0)
+	{
+		result.baselineNsPerOp = baseline->second;
+		result.regressed = result.nsPerOp > baseline->second * (1.0 + m_regressionTolerance);
+	}
+
+	m_results.push_back(result);
+}
+
+void KernelBenchmark::Check(const std::string& name, bool passed, const std::string& detail)
+{
+	KernelCheckResult check;
+	check.name = name;
+	check.passed = passed;
+	check.detail = detail;
+	m_checks.push_back(check);
+}
+
+void KernelBenchmark::RunTriangleKernels()
+{
+	std::mt19937 random(kSeed);
+	KernelBox bounds;
+	bounds.minimum = RayVec3(-1.0f, -1.0f, -1.0f);
+	bounds.maximum = RayVec3(1.0f, 1.0f, 1.0f);
+
+	// Smallish triangles scattered through the box, so the tests go down all the early outs as well as the hits.
+	std::vector<RayVec3> vertices;
+	vertices.reserve(kTriangleCount * 3);
+	for (int i = 0; i < kTriangleCount; i++)
+	{
+		RayVec3 centre = RandomPoint(random, bounds);
+		for (int corner = 0; corner < 3; corner++)
+		{
+			RayVec3 offset = RandomDirection(random);
+			vertices.push_back(RayVec3(centre.x + offset.x * 0.3f, centre.y + offset.y * 0.3f, centre.z + offset.z * 0.3f));
+		}
+	}
+
+	std::vector<KernelRay> rays = MakeRays(random, bounds, kRayCount);
+	std::vector<WatertightRay> shears;
+	shears.reserve(rays.size());
+	for (const KernelRay& ray : rays)
+	{
+		shears.push_back(WatertightRay(ray));
+	}
+
+	uint64_t tests = static_cast<uint64_t>(kRayCount) * kTriangleCount;
+
+	Measure("triangle_moller_trumbore", "test", tests, [&]()
+	{
+		uint64_t hits = 0;
+		for (const KernelRay& ray : rays)
+		{
+			for (int i = 0; i < kTriangleCount; i++)
+			{
+				float t;
+				hits += RayKernels::IntersectMollerTrumbore(ray, vertices[i * 3 + 0], vertices[i * 3 + 1], vertices[i * 3 + 2], t) ? 1 : 0;
+			}
+		}
+		return hits;
+	});
+
+	Measure("triangle_watertight", "test", tests, [&]()
+	{
+		uint64_t hits = 0;
+		for (size_t r = 0; r < rays.size(); r++)
+		{
+			for (int i = 0; i < kTriangleCount; i++)
+			{
+				float t;
+				hits += RayKernels::IntersectWatertight(rays[r], shears[r], vertices[i * 3 + 0], vertices[i * 3 + 1], vertices[i * 3 + 2], t) ? 1 : 0;
+			}
+		}
+		return hits;
+	});
+}
+
+void KernelBenchmark::RunBoxKernels()
+{
+	std::mt19937 random(kSeed);
+	std::uniform_real_distribution<float> size(0.05f, 0.5f);
+	KernelBox bounds;
+	bounds.minimum = RayVec3(-1.0f, -1.0f, -1.0f);
+	bounds.maximum = RayVec3(1.0f, 1.0f, 1.0f);
+
+	std::vector<KernelBox> boxes(kBoxPacketCount * BoxPacket::kWidth);
+	std::vector<BoxPacket> packets(kBoxPacketCount);
+	for (size_t i = 0; i < boxes.size(); i++)
+	{
+		RayVec3 centre = RandomPoint(random, bounds);
+		RayVec3 half(size(random), size(random), size(random));
+		boxes[i].minimum = RayVec3(centre.x - half.x, centre.y - half.y, centre.z - half.z);
+		boxes[i].maximum = RayVec3(centre.x + half.x, centre.y + half.y, centre.z + half.z);
+
+		BoxPacket& packet = packets[i / BoxPacket::kWidth];
+		size_t lane = i % BoxPacket::kWidth;
+		packet.minX[lane] = boxes[i].minimum.x;
+		packet.minY[lane] = boxes[i].minimum.y;
+		packet.minZ[lane] = boxes[i].minimum.z;
+		packet.maxX[lane] = boxes[i].maximum.x;
+		packet.maxY[lane] = boxes[i].maximum.y;
+		packet.maxZ[lane] = boxes[i].maximum.z;
+	}
+
+	std::vector<KernelRay> rays = MakeRays(random, bounds, kRayCount);
+	uint64_t tests = static_cast<uint64_t>(kRayCount) * boxes.size();
+	BoxKernelLevel level = RayKernels::GetSupportedBoxKernel();
+
+	Measure("box_scalar", "test", tests, [&]()
+	{
+		uint64_t hits = 0;
+		for (const KernelRay& ray : rays)
+		{
+			for (const KernelBox& box : boxes)
+			{
+				hits += RayKernels::IntersectBox(ray, box, ray.tMax) ? 1 : 0;
+			}
+		}
+		return hits;
+	});
+
+	Measure("box_sse", "test", tests, [&]()
+	{
+		uint64_t hits = 0;
+		for (const KernelRay& ray : rays)
+		{
+			for (const BoxPacket& packet : packets)
+			{
+				for (int first = 0; first < BoxPacket::kWidth; first += 4)
+				{
+					hits += CountBits(RayKernels::IntersectBoxesSse(ray, packet, first, ray.tMax));
+				}
+			}
+		}
+		return hits;
+	});
+
+	// The wider ones are only timed if this CPU can actually run them, so they're missing from the results otherwise.
+	if (level >= BOX_KERNEL_AVX2)
+	{
+		Measure("box_avx2", "test", tests, [&]()
+		{
+			uint64_t hits = 0;
+			for (const KernelRay& ray : rays)
+			{
+				for (const BoxPacket& packet : packets)
+				{
+					hits += CountBits(RayKernels::IntersectBoxesAvx2(ray, packet, 0, ray.tMax));
+					hits += CountBits(RayKernels::IntersectBoxesAvx2(ray, packet, 8, ray.tMax));
+				}
+			}
+			return hits;
+		});
+	}
+
+	if (level >= BOX_KERNEL_AVX512)
+	{
+		Measure("box_avx512", "test", tests, [&]()
+		{
+			uint64_t hits = 0;
+			for (const KernelRay& ray : rays)
+			{
+				for (const BoxPacket& packet : packets)
+				{
+					hits += CountBits(RayKernels::IntersectBoxesAvx512(ray, packet, ray.tMax));
+				}
+			}
+			return hits;
+		});
+	}
+}
+
+void KernelBenchmark::RunBvhKernels(const std::string& objectDirectory)
+{
+	for (const char* meshName : kMeshes)
+	{
+		TriangleMesh mesh;
+		if (!TriangleBvh::LoadObj(objectDirectory + "/" + meshName + ".obj", mesh))
+		{
+			continue;
+		}
+
+		TriangleBvh bvh(mesh);
+		std::mt19937 random(kSeed);
+		std::vector<KernelRay> rays = MakeRays(random, bvh.GetBounds(), kBvhRayCount);
+
+		Measure(std::string("bvh_") + meshName, "ray", rays.size(), [&]()
+		{
+			uint64_t hits = 0;
+			for (const KernelRay& ray : rays)
+			{
+				KernelHit hit;
+				hits += bvh.Intersect(ray, hit) ? 1 : 0;
+			}
+			return hits;
+		});
+	}
+}
+
+void KernelBenchmark::RunShadingKernels()
+{
+	std::mt19937 random(kSeed);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	// Hits of a camera looking down Z at a sphere, one sample per shaded pixel.
+	struct ShadeSample
+	{
+		RayVec3 albedo;
+		RayVec3 normal;
+		RayVec3 direction;
+		RayVec3 position;
+	};
+
+	RayVec3 origin(0.0f, 0.0f, -5.0f);
+	RayVec3 lightDirection(0.57735f, 0.57735f, -0.57735f);
+	std::vector<ShadeSample> samples(kShadeCount);
+	for (ShadeSample& sample : samples)
+	{
+		sample.albedo = RayVec3(unit(random), unit(random), unit(random));
+		sample.normal = RandomDirection(random);
+		sample.normal.z = -std::fabs(sample.normal.z);
+		sample.position = sample.normal;
+		RayVec3 direction(sample.position.x - origin.x, sample.position.y - origin.y, sample.position.z - origin.z);
+		float length = std::sqrt(direction.x * direction.x + direction.y * direction.y + direction.z * direction.z);
+		sample.direction = RayVec3(direction.x / length, direction.y / length, direction.z / length);
+	}
+
+	// The colours get summed and returned, otherwise the compiler is free to drop the maths.
+	Measure("shade_blinn_phong", "hit", samples.size(), [&]()
+	{
+		float total = 0.0f;
+		for (const ShadeSample& sample : samples)
+		{
+			RayVec3 colour = ShadingKernels::ShadeBlinnPhong(sample.albedo, sample.normal, lightDirection, origin, sample.direction, sample.position, 32.0f);
+			total += colour.x + colour.y + colour.z;
+		}
+		return static_cast<uint64_t>(total);
+	});
+
+	Measure("shade_fresnel_schlick", "hit", samples.size(), [&]()
+	{
+		float total = 0.0f;
+		for (const ShadeSample& sample : samples)
+		{
+			RayVec3 colour = ShadingKernels::FresnelReflectanceSchlick(sample.direction, sample.normal, sample.albedo);
+			total += colour.x + colour.y + colour.z;
+		}
+		return static_cast<uint64_t>(total);
+	});
+}
+
+void KernelBenchmark::RunTransformKernels()
+{
+	std::mt19937 random(kSeed);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	const float stepSeconds = 1.0f / 60.0f;
+
+	std::vector<TransformVec3> positions(kTransformCount), rotations(kTransformCount), scales(kTransformCount);
+	for (int i = 0; i < kTransformCount; i++)
+	{
+		positions[i] = TransformVec3(unit(random) * 50.0f, unit(random) * 50.0f, unit(random) * 50.0f);
+		rotations[i] = TransformVec3(unit(random) * 180.0f, unit(random) * 180.0f, unit(random) * 180.0f);
+		scales[i] = TransformVec3(1.0f + unit(random) * 0.5f, 1.0f + unit(random) * 0.5f, 1.0f + unit(random) * 0.5f);
+	}
+
+	// Every object spinning, the old way and the batched way, then the batch with only 1 in 100 moving, which is what scenes
+	// mostly look like. The batch numbers include the step as well as the matrices, same as the scalar one.
+	std::vector<float> world(static_cast<size_t>(kTransformCount) * 12);
+	Measure("transforms_scalar_100k", "object", kTransformCount, [&]()
+	{
+		for (int i = 0; i < kTransformCount; i++)
+		{
+			ScalarTransform(rotations[i], positions[i], scales[i], 50.0f * stepSeconds, &world[static_cast<size_t>(i) * 12]);
+		}
+		return static_cast<uint64_t>(world[0] != 0.0f ? 1 : 0);
+	});
+
+	TransformBatch everyObject;
+	TransformBatch someObjects;
+	for (int i = 0; i < kTransformCount; i++)
+	{
+		everyObject.Add(positions[i], rotations[i], scales[i]);
+		everyObject.SetAutoRotate(i, 1, true);
+		someObjects.Add(positions[i], rotations[i], scales[i]);
+		someObjects.SetAutoRotate(i, 1, i % 100 == 0);
+	}
+	everyObject.UpdateWorld(1.0f);
+	someObjects.UpdateWorld(1.0f);
+
+	Measure("transforms_batch_100k", "object", kTransformCount, [&]()
+	{
+		everyObject.Step(stepSeconds);
+		everyObject.UpdateWorld(1.0f);
+		return static_cast<uint64_t>(everyObject.GetUpdatedCount());
+	});
+
+	Measure("transforms_batch_100k_1pct", "object", kTransformCount, [&]()
+	{
+		someObjects.Step(stepSeconds);
+		someObjects.UpdateWorld(1.0f);
+		return static_cast<uint64_t>(someObjects.GetUpdatedCount());
+	});
+
+	// The same objects as 1000 parents with 99 children each, and one parent moved a step. Only its 100 matrices should
+	// get worked out, the rest of the time is finding that out.
+	TransformBatch hierarchy;
+	for (int i = 0; i < kTransformCount; i++)
+	{
+		hierarchy.Add(positions[i], rotations[i], scales[i]);
+		if (i % 100 != 0)
+		{
+			hierarchy.SetParent(i, i - i % 100);
+		}
+	}
+	hierarchy.UpdateWorld(1.0f);
+
+	uint32_t movedParent = 0;
+	Measure("transforms_hierarchy_100k_1parent", "object", kTransformCount, [&]()
+	{
+		movedParent = (movedParent + 100) % kTransformCount;
+		TransformVec3 position = hierarchy.GetPosition(movedParent);
+		hierarchy.SetPosition(movedParent, TransformVec3(position.x + 0.01f, position.y, position.z));
+		hierarchy.Step(stepSeconds);
+		hierarchy.UpdateWorld(1.0f);
+		return static_cast<uint64_t>(hierarchy.GetUpdatedCount());
+	});
+}
+
+void KernelBenchmark::RunPickKernels(const std::string& objectDirectory)
+{
+	TriangleMesh mesh;
+	if (!TriangleBvh::LoadObj(objectDirectory + "/donut.obj", mesh))
+	{
+		return;
+	}
+
+	// Thousands of donuts scattered through a box, and rays from in front of it the way the mouse would send them.
+	std::mt19937 random(kSeed);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	TransformBatch transforms;
+	ScenePicker picker;
+	uint32_t donut = picker.AddMesh(mesh);
+	for (int i = 0; i < kPickInstanceCount; i++)
+	{
+		uint32_t transform = transforms.Add(TransformVec3(unit(random) * 100.0f, unit(random) * 100.0f, unit(random) * 100.0f),
+			TransformVec3(unit(random) * 180.0f, unit(random) * 180.0f, unit(random) * 180.0f), TransformVec3(1.0f, 1.0f, 1.0f));
+		picker.AddInstance(donut, transform);
+	}
+	transforms.UpdateWorld(1.0f);
+	picker.Update(transforms);
+
+	std::vector<RayVec3> origins(kPickRayCount), directions(kPickRayCount);
+	for (int i = 0; i < kPickRayCount; i++)
+	{
+		origins[i] = RayVec3(0.0f, 0.0f, -200.0f);
+		RayVec3 direction(unit(random) * 0.5f, unit(random) * 0.5f, 1.0f);
+		float length = std::sqrt(direction.x * direction.x + direction.y * direction.y + direction.z * direction.z);
+		directions[i] = RayVec3(direction.x / length, direction.y / length, direction.z / length);
+	}
+
+	Measure("pick_4096_instances", "ray", kPickRayCount, [&]()
+	{
+		uint64_t hits = 0;
+		for (int i = 0; i < kPickRayCount; i++)
+		{
+			PickHit hit;
+			hits += picker.Pick(origins[i], directions[i], hit) ? 1 : 0;
+		}
+		return hits;
+	});
+
+	// What a frame with something moving costs the picker, every instance's bounds and the refit.
+	Measure("pick_refit_4096_instances", "instance", kPickInstanceCount, [&]()
+	{
+		picker.Update(transforms);
+		return static_cast<uint64_t>(picker.GetInstanceCount());
+	});
+
+	// The same instances culled for the TLAS, by a 90 degree frustum down z from the front of the box that reaches half way in.
+	CullVolume volume;
+	const float planes[4][4] = { { 1.0f, 0.0f, 1.0f, 200.0f }, { -1.0f, 0.0f, 1.0f, 200.0f }, { 0.0f, 1.0f, 1.0f, 200.0f }, { 0.0f, -1.0f, 1.0f, 200.0f } };
+	std::memcpy(volume.planes, planes, sizeof(planes));
+	volume.eye = RayVec3(0.0f, 0.0f, -200.0f);
+	volume.maxDistance = 200.0f;
+	std::vector<uint8_t> cullResults;
+
+	Measure("cull_4096_instances", "instance", kPickInstanceCount, [&]()
+	{
+		picker.Cull(volume, cullResults);
+
+		uint64_t visible = 0;
+		for (uint8_t result : cullResults)
+		{
+			visible += result & ScenePicker::kInFrustum ? 1 : 0;
+		}
+		return visible;
+	});
+}
+
+void KernelBenchmark::RunLodKernels(const std::string& objectDirectory)
+{
+	// The whole chain, from the mesh as the scene loads it.
+	std::vector<MeshLodLevel> knotLevels;
+	for (const char* meshName : kLodMeshes)
+	{
+		TriangleMesh mesh;
+		if (!TriangleBvh::LoadObj(objectDirectory + "/" + meshName + ".obj", mesh))
+		{
+			continue;
+		}
+
+		// The scene's loader gives every corner its own vertex, so the simplifier and optimiser get the mesh the same way.
+		TriangleMesh corners;
+		corners.positions.reserve(mesh.indices.size());
+		corners.indices.resize(mesh.indices.size());
+		for (size_t i = 0; i < mesh.indices.size(); i++)
+		{
+			corners.positions.push_back(mesh.positions[mesh.indices[i]]);
+			corners.indices[i] = static_cast<uint32_t>(i);
+		}
+
+		std::vector<MeshLodLevel> levels;
+		Measure(std::string("simplify_") + meshName, "triangle", corners.GetTriangleCount(), [&]()
+		{
+			MeshLod::BuildChain(corners, corners.positions.data(), sizeof(RayVec3), levels);
+
+			uint64_t triangles = 0;
+			for (const MeshLodLevel& level : levels)
+			{
+				triangles += level.indices.size() / 3;
+			}
+			return triangles;
+		});
+
+		if (knotLevels.empty())
+		{
+			knotLevels = levels;
+		}
+
+		std::vector<uint32_t> vertexOrder, indices;
+		Measure(std::string("optimise_") + meshName, "triangle", corners.GetTriangleCount(), [&]()
+		{
+			MeshOptimiser::Optimise(corners, corners.positions.data(), sizeof(RayVec3), vertexOrder, indices);
+			return static_cast<uint64_t>(vertexOrder.size());
+		});
+	}
+
+	if (knotLevels.empty())
+	{
+		return;
+	}
+
+	// Picking a level for every band of every object is per frame work, so here's a lot of them at random widths and scales.
+	std::mt19937 random(kSeed);
+	std::uniform_real_distribution<float> width(0.0f, 0.5f);
+	std::uniform_real_distribution<float> scale(0.1f, 4.0f);
+	std::vector<float> widths(kLodSelectCount), scales(kLodSelectCount);
+	for (int i = 0; i < kLodSelectCount; i++)
+	{
+		widths[i] = width(random);
+		scales[i] = scale(random);
+	}
+
+	Measure("lod_select", "ray", kLodSelectCount, [&]()
+	{
+		uint64_t levels = 0;
+		for (int i = 0; i < kLodSelectCount; i++)
+		{
+			levels += MeshLod::SelectLevel(knotLevels, MeshLod::SelectBand(widths[i]), scales[i], 1.0f);
+		}
+		return levels;
+	});
+}
+
+void KernelBenchmark::RunSplineKernels()
+{
+	// The runtime's default path, and a long smooth helix so the table search has something to do.
+	std::vector<SplineVec3> helixPoints;
+	for (int i = 0; i < 200; i++)
+	{
+		float angle = i * 0.3f;
+		helixPoints.push_back(SplineVec3(10.0f * std::cos(angle), i * 0.2f, 10.0f * std::sin(angle)));
+	}
+
+	struct SplinePath
+	{
+		const char* name;
+		CameraSpline spline;
+		int steps;
+	};
+	SplinePath paths[] =
+	{
+		{ "default", CameraSpline({ SplineVec3(0.0f, 0.0f, 0.0f), SplineVec3(0.0f, 0.0f, 5.0f), SplineVec3(1.0f, 0.0f, 5.0f), SplineVec3(0.0f, 0.0f, 0.0f) }), 1000 },
+		{ "helix", CameraSpline(helixPoints), 2000 },
+	};
+
+	// Constant speed, every step the same length as every other.
+	for (const SplinePath& path : paths)
+	{
+		double expected = static_cast<double>(path.spline.GetLength()) / path.steps;
+		double worst = 0.0;
+		SplineVec3 previous = path.spline.Evaluate(0.0f).position;
+		for (int step = 1; step <= path.steps; step++)
+		{
+			SplineVec3 position = path.spline.Evaluate(static_cast<float>(step) / path.steps).position;
+			double dx = static_cast<double>(position.x) - previous.x;
+			double dy = static_cast<double>(position.y) - previous.y;
+			double dz = static_cast<double>(position.z) - previous.z;
+			worst = std::max(worst, std::fabs(std::sqrt(dx * dx + dy * dy + dz * dz) / expected - 1.0));
+			previous = position;
+		}
+
+		std::ostringstream detail;
+		detail << path.steps << " equal steps within " << worst * 100.0 << "% of each other";
+		Check(std::string("spline_constant_speed_") + path.name, worst <= kSplineSpeedTolerance, detail.str());
+	}
+
+	// Scattered along the helix, so every lookup is a cold search.
+	const CameraSpline& helix = paths[1].spline;
+	Measure("spline_eval", "evaluation", kSplineEvalCount, [&]()
+	{
+		float sum = 0.0f;
+		for (int i = 0; i < kSplineEvalCount; i++)
+		{
+			float progress = i * 0.618034f;
+			sum += helix.Evaluate(progress - std::floor(progress)).position.x;
+		}
+		return static_cast<uint64_t>(sum != 0.0f);
+	});
+}
+
+void KernelBenchmark::RunUploadRingKernels()
+{
+	std::mt19937 random(kSeed);
+	RingTrace traces[2];
+
+	// What the scene does: the camera, lights and materials every frame with 2 in flight, and now and then a texture sized
+	// upload, through the same 4 MB ring.
+	traces[0].name = "scene";
+	traces[0].capacity = 4 * 1024 * 1024;
+	std::uniform_int_distribution<uint32_t> textureSize(64 * 1024, 1024 * 1024);
+	for (int frame = 0; frame < kRingFrameCount; frame++)
+	{
+		RingFrame ringFrame;
+		ringFrame.completedFence = frame > 2 ? frame - 2 : 0;
+		ringFrame.requests.push_back({ 256, 256 });
+		ringFrame.requests.push_back({ 256, 256 });
+		ringFrame.requests.push_back({ 16 * 64, 256 });
+		if (frame % 64 == 0)
+		{
+			ringFrame.requests.push_back({ textureSize(random), 512 });
+		}
+		traces[0].frames.push_back(ringFrame);
+	}
+
+	// Something nastier: a small ring, any size and alignment, and the GPU anywhere from 1 to 4 frames behind, so it wraps
+	// all the time and some allocations don't fit.
+	traces[1].name = "stress";
+	traces[1].capacity = 256 * 1024;
+	std::uniform_int_distribution<int> requestCount(1, 16);
+	std::uniform_int_distribution<int> sizeBits(4, 16);
+	std::uniform_int_distribution<int> alignmentBits(2, 12);
+	std::uniform_int_distribution<int> lag(1, 4);
+	uint64_t completed = 0;
+	for (int frame = 0; frame < kRingFrameCount; frame++)
+	{
+		RingFrame ringFrame;
+		int behind = lag(random);
+		completed = std::max<uint64_t>(completed, frame > behind ? frame - behind : 0);
+		ringFrame.completedFence = completed;
+		for (int i = requestCount(random); i > 0; i--)
+		{
+			std::uniform_int_distribution<uint32_t> size(1, 1u << sizeBits(random));
+			ringFrame.requests.push_back({ size(random), 1u << alignmentBits(random) });
+		}
+		traces[1].frames.push_back(ringFrame);
+	}
+
+	for (RingTrace& trace : traces)
+	{
+		uint32_t largestRequest = 0, largestAlignment = 0;
+		trace.allocations = 0;
+		for (const RingFrame& frame : trace.frames)
+		{
+			for (const RingRequest& request : frame.requests)
+			{
+				largestRequest = std::max(largestRequest, request.size);
+				largestAlignment = std::max(largestAlignment, request.alignment);
+				trace.allocations++;
+			}
+		}
+
+		Measure(std::string("upload_ring_") + trace.name, "allocation", trace.allocations, [&]()
+		{
+			return ReplayRing(trace, nullptr).allocations;
+		});
+
+		// A wrap only skips the end of the ring when what's asked for doesn't fit there, so it can never skip more than that.
+		uint64_t overlaps = 0;
+		UploadRingStats stats = ReplayRing(trace, &overlaps);
+		bool wrapBounded = stats.largestWrapWaste < static_cast<uint64_t>(largestRequest) + largestAlignment;
+
+		std::ostringstream detail;
+		detail << stats.allocations << " allocated, " << stats.failedAllocations << " didn't fit, " << overlaps << " overlapping, "
+			<< (stats.bytesAllocated > 0 ? 100.0 * stats.bytesWasted / stats.bytesAllocated : 0.0) << "% wasted, "
+			<< stats.wraps << " wraps, most skipped at one wrap " << stats.largestWrapWaste << " bytes";
+		Check(std::string("upload_ring_") + trace.name, overlaps == 0 && wrapBounded, detail.str());
+	}
+}
+
+void KernelBenchmark::RunBlasHeapKernels(const std::string& objectDirectory)
+{
+	// The sizes every BLAS in the scene asked for, recorded with -dumpresources.
+	BlasMemoryReport trace;
+	if (!trace.ReadCsv(objectDirectory + "/BlasTrace.csv"))
+	{
+		return;
+	}
+
+	const std::vector<BlasMemoryEntry>& entries = trace.GetEntries();
+	std::mt19937 random(kSeed);
+	BlasReplay scene = ReplayBlasTrace(entries, 0, random);
+
+	Measure("blas_heap_scene", "allocation", scene.allocations * kBlasReplayCount, [&]()
+	{
+		uint64_t heaps = 0;
+		for (int i = 0; i < kBlasReplayCount; i++)
+		{
+			heaps += ReplayBlasTrace(entries, 0, random).heapCount;
+		}
+		return heaps;
+	});
+
+	random.seed(kSeed);
+	BlasReplay rebuilt = ReplayBlasTrace(entries, kBlasRebuildCount, random);
+
+	Measure("blas_heap_rebuild", "allocation", rebuilt.allocations, [&]()
+	{
+		random.seed(kSeed);
+		return ReplayBlasTrace(entries, kBlasRebuildCount, random).stats.allocations;
+	});
+
+	// The scratch the load's batches share, next to what every build asking for its own would have come to.
+	std::vector<uint64_t> scratchSizes;
+	uint64_t scratchBytes = 0;
+	for (const BlasMemoryEntry& entry : entries)
+	{
+		scratchSizes.push_back(entry.scratchBytes);
+		scratchBytes += entry.scratchBytes;
+	}
+	BlasBuildBatcher batcher(kBlasScratchBudget, kBlasAlignment);
+	std::vector<BlasBuildBatch> batches = batcher.Plan(scratchSizes);
+
+	// Whatever's been rebuilt, every BLAS is still in there exactly once at its final size.
+	BlasReplay replays[] = { scene, rebuilt };
+	const char* names[] = { "blas_heap_scene", "blas_heap_rebuild" };
+	for (int i = 0; i < 2; i++)
+	{
+		const BlasReplay& replay = replays[i];
+		std::ostringstream detail;
+		detail << entries.size() << " BLASes, " << replay.allocations << " allocated, " << replay.failedAllocations << " failed, "
+			<< replay.stats.bytesAllocated / 1024.0 << " KB in " << replay.heapCount << " heaps of " << kBlasPageSize / 1024 << " KB, "
+			<< (replay.stats.bytesReserved > 0 ? 100.0 * replay.stats.bytesAllocated / replay.stats.bytesReserved : 0.0) << "% used, "
+			<< 100.0 * replay.fragmentation << "% fragmented, build pool " << replay.buildBytesReserved / 1024.0 << " KB, scratch "
+			<< BlasBuildBatcher::GetScratchBytes(batches) / 1024.0 << " KB in " << batches.size() << " batches for "
+			<< scratchBytes / 1024.0 << " KB of builds";
+		Check(names[i], replay.failedAllocations == 0 && replay.stats.bytesAllocated == trace.GetFinalBytes(), detail.str());
+	}
+}
+
+void KernelBenchmark::RunProfilerKernels()
+{
+	CpuProfiler& profiler = CpuProfiler::Get();
+	bool wasEnabled = profiler.IsEnabled();
+
+	// The same loop three times, once bare, once with a scope and once with the scope but the profiler off. The volatile
+	// counter is all that keeps the bare loop from going altogether.
+	Measure("profiler_empty_loop", "iteration", kProfilerScopeCount, [&]()
+	{
+		volatile uint64_t count = 0;
+		for (int i = 0; i < kProfilerScopeCount; i++)
+		{
+			count = count + 1;
+		}
+		return count;
+	});
+
+	profiler.SetEnabled(true);
+	Measure("profiler_scope", "scope", kProfilerScopeCount, [&]()
+	{
+		volatile uint64_t count = 0;
+		for (int i = 0; i < kProfilerScopeCount; i++)
+		{
+			PROFILE_CPU_SCOPE("Kernel Benchmark Scope");
+			count = count + 1;
+		}
+		return count;
+	});
+
+	profiler.SetEnabled(false);
+	Measure("profiler_scope_disabled", "scope", kProfilerScopeCount, [&]()
+	{
+		volatile uint64_t count = 0;
+		for (int i = 0; i < kProfilerScopeCount; i++)
+		{
+			PROFILE_CPU_SCOPE("Kernel Benchmark Scope");
+			count = count + 1;
+		}
+		return count;
+	});
+
+	profiler.SetEnabled(wasEnabled);
+	profiler.Clear();
+
+	// The three results just went on the end.
+	double emptyNs = m_results[m_results.size() - 3].nsPerOp;
+	double scopeNs = std::max(m_results[m_results.size() - 2].nsPerOp - emptyNs, 0.0);
+	double disabledNs = std::max(m_results[m_results.size() - 1].nsPerOp - emptyNs, 0.0);
+	double framePercent = 100.0 * scopeNs * kProfilerScopesPerFrame / kProfilerFrameNs;
+
+	std::ostringstream detail;
+	detail << scopeNs << " ns a scope over the empty loop, " << disabledNs << " ns with the profiler off, " << kProfilerScopesPerFrame
+		<< " scopes are " << framePercent << "% of a 60Hz frame";
+	Check("profiler_scope_overhead", framePercent <= 100.0 * kProfilerFrameBudget, detail.str());
+}
+
+void KernelBenchmark::RunBlasPolicyChecks()
+{
+	DefaultBlasPolicySelector selector;
+
+	BlasMeshDescription staticMesh;
+	staticMesh.name = "Static";
+	staticMesh.vertexCount = 1024;
+	staticMesh.indexCount = 3072;
+	BlasBuildPolicy staticPolicy = selector.SelectPolicy(staticMesh);
+
+	Check("blas_policy_static", staticPolicy.allowCompaction && staticPolicy.preferFastTrace && !staticPolicy.allowUpdate &&
+		!staticPolicy.preferFastBuild, "a static mesh gets fast trace and compaction, and no update");
+
+	BlasMeshDescription deformingMesh = staticMesh;
+	deformingMesh.name = "Deforming";
+	deformingMesh.deforming = true;
+	BlasBuildPolicy deformingPolicy = selector.SelectPolicy(deformingMesh);
+
+	Check("blas_policy_deforming", deformingPolicy.allowUpdate && deformingPolicy.preferFastBuild && !deformingPolicy.allowCompaction &&
+		!deformingPolicy.preferFastTrace, "a deforming mesh gets fast build and update, and no compaction");
+
+	// Two compacted and one that isn't, which keeps its reserved size: 4096 + 2048 + 1024 reserved, 1024 + 2048 + 1024 final.
+	BlasMemoryReport report;
+	size_t first = report.AddBuild("Compacted", staticPolicy, 512, 4096);
+	report.AddBuild("Deforming", deformingPolicy, 256, 2048);
+	size_t third = report.AddBuild("Compacted Small", staticPolicy, 1024, 1024);
+	report.SetCompactedSize(first, 1024);
+	report.SetCompactedSize(third, 1024);
+
+	bool sums = report.GetReservedBytes() == 7168 && report.GetFinalBytes() == 4096 && report.GetSavedBytes() == 3072 &&
+		report.GetLargestScratchBytes() == 1024 && report.GetEntries()[1].finalBytes == 2048;
+	bool formatted = report.Format().find("saved 3.0 KB (42.9%)") != std::string::npos;
+
+	// A readback that says a BLAS grew would wrap the saved bytes round, so it has to be refused.
+	bool refused = false;
+	try
+	{
+		report.SetCompactedSize(first, 8192);
+	}
+	catch (const std::logic_error&)
+	{
+		refused = true;
+	}
+
+	std::ostringstream detail;
+	detail << "reserved " << report.GetReservedBytes() << ", final " << report.GetFinalBytes() << ", saved " << report.GetSavedBytes()
+		<< " bytes, " << (formatted ? "" : "not ") << "formatted as 42.9% saved, growing a BLAS " << (refused ? "refused" : "accepted");
+	Check("blas_policy_report", sums && formatted && refused && report.GetFinalBytes() == 4096, detail.str());
+}
+
+void KernelBenchmark::RunTileChecks()
+{
+	// Two workers, 16 tiles dealt 8 each. Once worker 0 is through its own it takes the rest off the back of worker 1's.
+	{
+		TileScheduler scheduler(64, 64, 16, 2);
+		scheduler.AddFrame(0);
+
+		std::vector<uint32_t> order;
+		TileJob job;
+		while (scheduler.NextTile(0, 0.0, job))
+		{
+			order.push_back(job.tileId);
+		}
+
+		std::vector<uint32_t> sorted = order;
+		std::sort(sorted.begin(), sorted.end());
+		bool everyTileOnce = sorted.size() == 16 && std::unique(sorted.begin(), sorted.end()) == sorted.end();
+
+		std::ostringstream detail;
+		detail << order.size() << " tiles for the one worker, " << scheduler.GetStats().stolen << " stolen, first stolen "
+			<< (order.size() > 8 ? order[8] : 0) << ", worker 1 left with " << (scheduler.NextTile(1, 0.0, job) ? "some" : "none");
+		Check("tile_steal", everyTileOnce && scheduler.GetStats().stolen == 8 && order[8] == 15 && order[15] == 1, detail.str());
+	}
+
+	// Two tiles taking a second each. Once one's been out three times that long, the idle worker gets a copy, whichever
+	// comes back first counts and the other's thrown away.
+	{
+		TileScheduler scheduler(64, 32, 32, 2);
+		scheduler.AddFrame(0);
+
+		TileJob slow, fast, copy;
+		scheduler.NextTile(0, 0.0, slow);
+		scheduler.NextTile(1, 0.0, fast);
+		scheduler.CompleteTile(1, fast.tileId, 1.0);
+
+		bool tooSoon = !scheduler.NextTile(1, 2.0, copy);
+		bool copied = scheduler.NextTile(1, 4.0, copy) && copy.speculative && copy.tileId == slow.tileId;
+		bool copyWon = scheduler.CompleteTile(1, copy.tileId, 4.5);
+		bool slowLost = !scheduler.CompleteTile(0, slow.tileId, 5.0);
+
+		std::ostringstream detail;
+		detail << (tooSoon ? "no copy" : "a copy") << " at 2s, " << (copied ? "a copy" : "no copy") << " at 4s, "
+			<< scheduler.GetStats().speculative << " speculative, " << scheduler.GetStats().duplicates << " duplicates, "
+			<< scheduler.GetOutstandingTiles() << " outstanding";
+		Check("tile_speculative", tooSoon && copied && copyWon && slowLost && scheduler.GetStats().duplicates == 1 &&
+			scheduler.GetOutstandingTiles() == 0, detail.str());
+	}
+
+	// Three workers with two tiles each, and the middle one is lost halfway through its first. Both of its tiles go to the
+	// others, the one it had out first, and anything it sends afterwards is a duplicate.
+	{
+		TileScheduler scheduler(48, 32, 16, 3);
+		scheduler.AddFrame(0);
+
+		TileJob lostJob, job;
+		scheduler.NextTile(1, 0.0, lostJob);
+		scheduler.RemoveWorker(1);
+
+		bool dead = !scheduler.NextTile(1, 0.0, job) && scheduler.GetInFlight(1) == 0 && scheduler.GetAliveWorkers() == 2;
+		uint32_t done = 0;
+		bool lostTileRedone = false;
+		for (uint32_t worker = 0; worker < 3; worker += 2)
+		{
+			while (scheduler.NextTile(worker, 1.0, job))
+			{
+				lostTileRedone = lostTileRedone || job.tileId == lostJob.tileId;
+				done += scheduler.CompleteTile(worker, job.tileId, 2.0) ? 1 : 0;
+			}
+		}
+		bool lateIgnored = !scheduler.CompleteTile(1, lostJob.tileId, 3.0);
+
+		std::ostringstream detail;
+		detail << scheduler.GetStats().requeued << " requeued, " << done << " of 6 done by the others, "
+			<< scheduler.GetOutstandingTiles() << " outstanding";
+		Check("tile_remove_worker", dead && lostTileRedone && lateIgnored && done == 6 && scheduler.GetStats().requeued == 1 &&
+			scheduler.GetOutstandingTiles() == 0, detail.str());
+	}
+
+	// A result that comes in a byte at a time still comes out whole, and one cut short waits for the rest.
+	{
+		TileMessage sent;
+		sent.type = TILE_MESSAGE_RESULT;
+		sent.tileId = 7;
+		sent.frame = 3;
+		sent.frameCount = 10;
+		sent.rect.x = 16;
+		sent.rect.y = 32;
+		sent.rect.width = 2;
+		sent.rect.height = 2;
+		sent.renderMs = 1.5;
+		sent.pixels.assign(16, 0xAB);
+
+		std::vector<uint8_t> bytes;
+		TileProtocol::Encode(sent, bytes);
+
+		TileMessageDecoder decoder;
+		TileMessage received;
+		bool early = false;
+		for (size_t i = 0; i + 1 < bytes.size(); i++)
+		{
+			decoder.Feed(&bytes[i], 1);
+			early = early || decoder.Next(received);
+		}
+		decoder.Feed(&bytes.back(), 1);
+		bool whole = decoder.Next(received) && received.tileId == 7 && received.frame == 3 && received.rect.y == 32 &&
+			received.renderMs == 1.5 && received.pixels == sent.pixels;
+
+		Check("tile_decoder_truncated", !early && whole && !decoder.HasError() && decoder.GetBufferedBytes() == 0,
+			std::string(early ? "a message before its last byte" : "nothing before the last byte") + ", " + (whole ? "whole" : "broken") + " after it");
+	}
+
+	// A payload size past the limit, one too small for the fixed fields, and a pixel count that disagrees with the payload
+	// size all break the stream rather than being read.
+	{
+		TileMessage sent;
+		sent.type = TILE_MESSAGE_RESULT;
+		sent.pixels.assign(16, 0);
+		std::vector<uint8_t> valid;
+		TileProtocol::Encode(sent, valid);
+
+		// The payload size is the header's last four bytes, the pixel count the payload's.
+		auto corrupt = [&](size_t offset, uint32_t value)
+		{
+			std::vector<uint8_t> bytes = valid;
+			for (size_t i = 0; i < 4; i++)
+			{
+				bytes[offset + i] = static_cast<uint8_t>(value >> (8 * i));
+			}
+
+			TileMessageDecoder decoder;
+			TileMessage message;
+			decoder.Feed(bytes.data(), bytes.size());
+			return !decoder.Next(message) && decoder.HasError();
+		};
+
+		size_t payloadSizeOffset = TileProtocol::kHeaderBytes - 4;
+		size_t pixelCountOffset = valid.size() - sent.pixels.size() - 4;
+		bool oversized = corrupt(payloadSizeOffset, TileProtocol::kMaxPayloadBytes + 1);
+		bool undersized = corrupt(payloadSizeOffset, 8);
+		bool mismatched = corrupt(pixelCountOffset, 12);
+
+		std::ostringstream detail;
+		detail << "oversized " << (oversized ? "refused" : "read") << ", undersized " << (undersized ? "refused" : "read")
+			<< ", pixel count mismatch " << (mismatched ? "refused" : "read");
+		Check("tile_decoder_oversized", oversized && undersized && mismatched, detail.str());
+	}
+
+	// A rect whose right edge wraps past 2^32 would look like it fits if the edges were added up.
+	{
+		TileRect wrapped;
+		wrapped.x = 0xFFFFFFF0u;
+		wrapped.width = 0x20;
+		wrapped.height = 16;
+		TileRect edge;
+		edge.x = 48;
+		edge.y = 48;
+		edge.width = 16;
+		edge.height = 16;
+		TileRect over = edge;
+		over.width = 17;
+
+		bool fits = TileScheduler::RectFits(edge, 64, 64);
+		bool refused = !TileScheduler::RectFits(wrapped, 64, 64) && !TileScheduler::RectFits(over, 64, 64);
+		Check("tile_rect_fits", fits && refused, std::string("edge tile ") + (fits ? "fits" : "refused") + ", wrapping and overhanging " +
+			(refused ? "refused" : "accepted"));
+	}
+
+	// The coordinator places a result by what the scheduler handed out, so that has to be there until the tile's done and
+	// gone after, including for a second frame's tiles.
+	{
+		TileScheduler scheduler(64, 32, 32, 1);
+		scheduler.AddFrame(4);
+		scheduler.AddFrame(5);
+
+		TileJob first, second, third;
+		scheduler.NextTile(0, 0.0, first);
+		scheduler.NextTile(0, 0.0, second);
+		scheduler.NextTile(0, 0.0, third);
+
+		uint64_t frame = 0;
+		TileRect rect;
+		bool found = scheduler.GetTile(second.tileId, frame, rect) && frame == 4 && rect.x == 32 && rect.y == 0 &&
+			rect.width == 32 && rect.height == 32;
+		bool nextFrame = scheduler.GetTile(third.tileId, frame, rect) && frame == 5 && rect.x == 0;
+		scheduler.CompleteTile(0, second.tileId, 1.0);
+		bool gone = !scheduler.GetTile(second.tileId, frame, rect) && !scheduler.GetTile(99, frame, rect);
+
+		Check("tile_lookup", found && nextFrame && gone, std::string("scheduled rect ") + (found ? "found" : "wrong") + ", next frame's " +
+			(nextFrame ? "found" : "wrong") + ", finished and unknown tiles " + (gone ? "gone" : "still there"));
+	}
+}
+
+void KernelBenchmark::RunGpuTimestampChecks()
+{
+	FakeFrameQueue queue;
+	FakeTimestampReader reader;
+	GpuTimestampTracker tracker(&queue, 2, 2, 8);
+	uint64_t returnedFrames = 0;
+
+	// Frame 1 in slot 0, a scope with one inside it and a third that there's no room for.
+	returnedFrames += tracker.BeginFrame(0, 1, &reader).size();
+	uint32_t outer = tracker.BeginScope("Outer");
+	uint32_t inner = tracker.BeginScope("Inner");
+	uint32_t overflow = tracker.BeginScope("Overflow");
+	tracker.EndScope(overflow);
+	tracker.EndScope(inner);
+	tracker.EndScope(outer);
+	uint32_t firstQuery, queryCount;
+	tracker.GetResolveRange(firstQuery, queryCount);
+	tracker.EndFrame(1);
+
+	// Frame 2 in slot 1 while the GPU hasn't got anywhere, so there's nothing to collect yet.
+	std::vector<GpuFrameResult> nothingYet = tracker.BeginFrame(1, 2, &reader);
+	returnedFrames += nothingYet.size();
+	tracker.EndScope(tracker.BeginScope("Second"));
+	tracker.EndFrame(2);
+
+	// The GPU catches up on both, and starting frame 3 hands them both back, oldest first.
+	queue.m_completed = 2;
+	std::vector<GpuFrameResult> caughtUp = tracker.BeginFrame(0, 3, &reader);
+	returnedFrames += caughtUp.size();
+	tracker.EndScope(tracker.BeginScope("Third"));
+	tracker.EndFrame(3);
+
+	bool scopes = outer == 0 && inner == 1 && overflow == GpuTimestampTracker::kInvalidScope && tracker.GetStats().scopesDropped == 1 &&
+		firstQuery == 0 && queryCount == 4;
+	bool collected = nothingYet.empty() && caughtUp.size() == 2 && caughtUp[0].frame == 1 && caughtUp[1].frame == 2 &&
+		caughtUp[0].scopes.size() == 2 && caughtUp[0].scopes[1].depth == 1 && caughtUp[0].scopes[1].startTicks == 20 &&
+		caughtUp[0].scopes[1].endTicks == 30 && caughtUp[1].scopes.size() == 1 && caughtUp[1].scopes[0].startTicks == 40;
+
+	// Slot 0 comes round again before the GPU's done with frame 3, so that frame's results go.
+	tracker.BeginFrame(1, 4, &reader);
+	tracker.EndFrame(4);
+	returnedFrames += tracker.BeginFrame(0, 5, &reader).size();
+	bool dropped = tracker.GetStats().framesDropped == 1;
+
+	// Every frame that was resolved was handed back to the caller, none were only put in the history.
+	bool nothingLost = returnedFrames == tracker.GetStats().framesResolved && tracker.GetHistory().size() == returnedFrames;
+
+	std::ostringstream detail;
+	detail << tracker.GetStats().framesResolved << " frames resolved, " << returnedFrames << " handed back, "
+		<< tracker.GetStats().framesDropped << " dropped, " << tracker.GetStats().scopesDropped << " scopes dropped";
+	Check("gpu_timestamps", scopes && collected && dropped && nothingLost, detail.str());
+}
+
+void KernelBenchmark::RunFramePacerChecks()
+{
+	// Two frames in flight. The first two slots have never been used so neither waits, and nor does frame 3 once the GPU is
+	// through frame 1. Frame 4 comes back round to frame 2's slot while the GPU's still on it, which is the only stall, and
+	// it only waits for that frame rather than everything.
+	{
+		FakeFrameQueue queue;
+		FramePacer pacer(&queue, 2);
+
+		pacer.BeginFrame();
+		pacer.EndFrame();
+		pacer.BeginFrame();
+		pacer.EndFrame();
+		bool freeSlots = pacer.GetStats().stalls == 0;
+
+		queue.m_completed = 1;
+		bool caughtUp = pacer.BeginFrame() == 0 && pacer.GetStats().stalls == 0;
+		pacer.EndFrame();
+
+		bool lapped = pacer.BeginFrame() == 1 && pacer.GetStats().stalls == 1 && queue.m_completed == 2;
+		pacer.EndFrame();
+
+		std::ostringstream detail;
+		detail << pacer.GetStats().stalls << " stalls in " << pacer.GetStats().framesSubmitted << " frames, waited up to "
+			<< queue.m_completed << " of " << queue.m_signalled;
+		Check("frame_pacer_stall", freeSlots && caughtUp && lapped, detail.str());
+	}
+
+	// Two things retired in frame 1 and one in frame 2. Nothing runs until the fence is past the frame it was retired in,
+	// and then they run in the order they were retired.
+	{
+		FakeFrameQueue queue;
+		FramePacer pacer(&queue, 2);
+		std::string order;
+
+		pacer.BeginFrame();
+		pacer.Retire([&order]() { order += 'A'; });
+		pacer.Retire([&order]() { order += 'B'; });
+		pacer.EndFrame();
+		pacer.BeginFrame();
+		pacer.Retire([&order]() { order += 'C'; });
+		pacer.EndFrame();
+
+		pacer.ReclaimRetired();
+		bool held = order.empty() && pacer.GetPendingRetirements() == 3;
+		queue.m_completed = 1;
+		pacer.ReclaimRetired();
+		bool firstFrame = order == "AB" && pacer.GetPendingRetirements() == 1;
+		queue.m_completed = 2;
+		pacer.ReclaimRetired();
+		bool secondFrame = order == "ABC" && pacer.GetPendingRetirements() == 0 && pacer.GetStats().retired == 3;
+
+		Check("frame_pacer_retire", held && firstFrame && secondFrame, "ran " + (order.empty() ? std::string("nothing") : order) + ", " +
+			(held ? "held" : "ran early") + " before the fence");
+	}
+
+	// A flush waits on a signal of its own past every frame, so it drains anything pending, including something retired in a
+	// frame that hasn't been submitted yet.
+	{
+		FakeFrameQueue queue;
+		FramePacer pacer(&queue, 3);
+		uint32_t released = 0;
+
+		pacer.BeginFrame();
+		pacer.Retire([&released]() { released++; });
+		pacer.EndFrame();
+		pacer.BeginFrame();
+		pacer.Retire([&released]() { released++; });
+		pacer.Retire([&released]() { released++; });
+
+		uint64_t flushedAt = pacer.Flush();
+		bool drained = released == 3 && pacer.GetPendingRetirements() == 0 && flushedAt == 2 && queue.m_completed == 2 &&
+			pacer.GetStats().flushes == 1;
+
+		std::ostringstream detail;
+		detail << released << " of 3 released, " << pacer.GetPendingRetirements() << " pending, waited on " << flushedAt;
+		Check("frame_pacer_flush", drained, detail.str());
+	}
+}
+
+void KernelBenchmark::RunShaderCacheChecks()
+{
+	// The shaders live in memory and the compiler just counts and hands the source back, only the entries go to disk, in
+	// the working directory next to the CSVs. Each one is removed again at the end.
+	std::map<std::string, std::string> files;
+	files["Shaders/Check.hlsl"] = "#include \"Common.hlsl\"\nfloat4 Shade() { return Colour(); }\n";
+	files["Shaders/Common.hlsl"] = "float4 Colour() { return 1; }\n";
+
+	ShaderCache cache("", [&files](const std::string& path, std::string& outContents)
+	{
+		auto file = files.find(path);
+		if (file == files.end())
+		{
+			return false;
+		}
+		outContents = file->second;
+		return true;
+	});
+
+	uint32_t compiles = 0;
+	ShaderCache::CompileFunction compile = [&compiles](const std::string&, const std::string& source)
+	{
+		compiles++;
+		return std::vector<uint8_t>(source.begin(), source.end());
+	};
+
+	std::vector<uint64_t> keys;
+	const std::vector<std::string> plain = { "-T", "lib_6_3" };
+	const std::vector<std::string> defined = { "-T", "lib_6_3", "-D", "ROUGHNESS=1" };
+
+	// Anything left behind by a run that didn't get as far as cleaning up is removed before a request that should miss.
+	auto request = [&](const std::vector<std::string>& arguments, const std::string& compilerVersion, bool fresh)
+	{
+		if (fresh)
+		{
+			std::remove(cache.GetEntryPath(cache.ComputeKey("Shaders/Check.hlsl", arguments, compilerVersion)).c_str());
+		}
+		std::vector<uint8_t> bytes = cache.GetOrCompile("Shaders/Check.hlsl", arguments, compilerVersion, compile);
+		keys.push_back(cache.GetLastRecord().key);
+		return bytes;
+	};
+
+	// A miss compiles and stores it, asking again loads what was stored.
+	{
+		std::vector<uint8_t> compiled = request(plain, "1.0", true);
+		bool missed = compiles == 1 && !cache.GetLastRecord().hit;
+		std::vector<uint8_t> loaded = request(plain, "1.0", false);
+		bool hit = compiles == 1 && cache.GetLastRecord().hit && loaded == compiled;
+
+		std::ostringstream detail;
+		detail << cache.GetStats().misses << " misses, " << cache.GetStats().hits << " hits, " << cache.GetStats().failedWrites
+			<< " failed writes, " << (loaded == compiled ? "same" : "different") << " bytes back";
+		Check("shader_cache_hit", missed && hit && cache.GetStats().failedWrites == 0, detail.str());
+	}
+
+	// A different define, a change to the included file and a new compiler each give a new key and a compile.
+	{
+		request(defined, "1.0", true);
+		bool define = compiles == 2 && !cache.GetLastRecord().hit && keys.back() != keys[0];
+
+		files["Shaders/Common.hlsl"] = "float4 Colour() { return 0.5; }\n";
+		request(plain, "1.0", true);
+		bool include = compiles == 3 && !cache.GetLastRecord().hit && keys.back() != keys[0];
+
+		uint64_t includeKey = keys.back();
+		request(plain, "1.1", true);
+		bool compiler = compiles == 4 && !cache.GetLastRecord().hit && keys.back() != includeKey && keys.back() != keys[0];
+
+		Check("shader_cache_invalidate", define && include && compiler, std::string("define ") + (define ? "missed" : "hit") +
+			", include " + (include ? "missed" : "hit") + ", compiler version " + (compiler ? "missed" : "hit"));
+	}
+
+	// An entry cut short, or with a byte flipped, is compiled again and rewritten rather than loaded.
+	{
+		std::string entryPath = cache.GetEntryPath(keys.back());
+		std::string stored;
+		{
+			std::ifstream file(entryPath, std::ios::binary);
+			std::ostringstream contents;
+			contents << file.rdbuf();
+			stored = contents.str();
+		}
+
+		std::ofstream(entryPath, std::ios::binary | std::ios::trunc) << stored.substr(0, stored.size() / 2);
+		std::vector<uint8_t> afterTruncate = request(plain, "1.1", false);
+		bool truncated = compiles == 5 && !cache.GetLastRecord().hit;
+
+		std::string flipped = stored;
+		flipped.back() ^= 0x20;
+		std::ofstream(entryPath, std::ios::binary | std::ios::trunc) << flipped;
+		std::vector<uint8_t> afterFlip = request(plain, "1.1", false);
+		bool corrupt = compiles == 6 && !cache.GetLastRecord().hit;
+
+		std::vector<uint8_t> reloaded = request(plain, "1.1", false);
+		bool rewritten = compiles == 6 && cache.GetLastRecord().hit && reloaded == afterFlip && afterFlip == afterTruncate;
+
+		Check("shader_cache_corrupt", truncated && corrupt && rewritten, std::string("truncated entry ") + (truncated ? "recompiled" : "loaded") +
+			", corrupt entry " + (corrupt ? "recompiled" : "loaded") + ", " + (rewritten ? "rewritten" : "not rewritten"));
+	}
+
+	// Eight requests over two sets of arguments leave two records, each holding its latest request.
+	{
+		const std::vector<ShaderCacheRecord>& records = cache.GetRecords();
+		bool onePerSet = records.size() == 2 && records[0].arguments == "-T lib_6_3" && records[0].hit && records[0].key == keys.back() &&
+			records[1].arguments == "-T lib_6_3 -D ROUGHNESS=1" && !records[1].hit;
+
+		std::ostringstream detail;
+		detail << records.size() << " records for " << keys.size() << " requests";
+		Check("shader_cache_records", onePerSet, detail.str());
+	}
+
+	std::sort(keys.begin(), keys.end());
+	keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+	for (uint64_t key : keys)
+	{
+		std::remove(cache.GetEntryPath(key).c_str());
+	}
+}
+#pragma endregion
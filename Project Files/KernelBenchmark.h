@@ -0,0 +1,140 @@
+#pragma once
+
+#pragma region Includes
+//Include{s}
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include "RayKernels.h"
+#pragma endregion
+
+// No Windows headers, it's all CPU work and the clock is std::chrono.
+
+#pragma region Data Structures
+/// <summary>
+/// How one kernel did.
+/// </summary>
+struct KernelBenchmarkResult
+{
+	std::string name;
+	std::string unit; // What one op is, a triangle test, a box test, a ray through a whole BVH or a shaded hit
+	uint64_t operations = 0;
+	double nsPerOp = 0.0;
+	double opsPerSecond = 0.0; // Rays per second for the BVH ones
+	double baselineNsPerOp = 0.0; // 0 if the baseline didn't have it
+	bool regressed = false;
+};
+
+/// <summary>
+/// How one check did. Checks sit alongside the kernels for the portable code whose numbers are only worth anything if it's
+/// still doing the right thing, or that has nothing worth timing at all.
+/// </summary>
+struct KernelCheckResult
+{
+	std::string name;
+	bool passed = false;
+	std::string detail; // What was measured, whether it passed or not
+};
+#pragma endregion
+
+/// <summary>
+/// The KernelBenchmark class. Times the CPU copies of the intersection and shading kernels: both triangle tests, the slab
+/// test at every SIMD width the CPU has, BVH traversal over the shipped meshes, the Hit.hlsl lighting, the object transform
+/// update, mouse picking, instance culling, mesh simplification and mesh optimisation, camera spline evaluation, upload
+/// ring allocation, BLAS heap suballocation and the CPU profiler's scopes. Each kernel runs a few times and keeps its best,
+/// which is the least noisy number on a machine doing other things. Some of them also come with checks that what they timed
+/// is still right, and the frame pacer and shader cache have checks of their own.
+/// </summary>
+class KernelBenchmark
+{
+public:
+#pragma region Constructors and Destructors
+	/// <summary>
+	/// Initializes a new instance of the KernelBenchmark class.
+	/// </summary>
+	/// <param name="regressionTolerance">How much slower than the baseline a kernel can be before it's flagged, 0.1 is 10%.</param>
+	/// <param name="repeats">How many times each kernel runs, the best one counts.</param>
+	KernelBenchmark(double regressionTolerance = 0.1, int repeats = 5);
+#pragma endregion
+
+#pragma region Benchmark Methods
+	/// <summary>
+	/// Reads a previous run's CSV to compare against. Load it before Run.
+	/// </summary>
+	/// <returns>False if there isn't one.</returns>
+	bool LoadBaseline(const std::string& path);
+
+	/// <summary>
+	/// Runs every kernel.
+	/// </summary>
+	/// <param name="objectDirectory">Where the meshes are.</param>
+	void Run(const std::string& objectDirectory);
+
+	/// <summary>
+	/// Writes the results out, in the same layout LoadBaseline reads, so a run can be copied over to be the next baseline.
+	/// </summary>
+	bool WriteCsv(const std::string& path) const;
+
+	/// <summary>
+	/// Writes the checks out, one per line, name, passed and detail.
+	/// </summary>
+	bool WriteChecksCsv(const std::string& path) const;
+
+	/// <summary>
+	/// One line about a result, for the debug output.
+	/// </summary>
+	static std::string FormatResult(const KernelBenchmarkResult& result);
+
+	/// <summary>
+	/// One line about a check, for the debug output.
+	/// </summary>
+	static std::string FormatCheck(const KernelCheckResult& check);
+
+	bool HasRegressions() const;
+	bool HasFailedChecks() const;
+	const std::vector<KernelBenchmarkResult>& GetResults() const { return m_results; }
+	const std::vector<KernelCheckResult>& GetChecks() const { return m_checks; }
+#pragma endregion
+
+private:
+#pragma region Private Methods
+	/// <summary>
+	/// Times a kernel, which returns how many hits it found so none of the work can be optimised away.
+	/// </summary>
+	template <class Kernel>
+	void Measure(const std::string& name, const std::string& unit, uint64_t operations, Kernel kernel);
+
+	/// <summary>
+	/// Records a check.
+	/// </summary>
+	void Check(const std::string& name, bool passed, const std::string& detail);
+
+	void RunTriangleKernels();
+	void RunBoxKernels();
+	void RunBvhKernels(const std::string& objectDirectory);
+	void RunShadingKernels();
+	void RunTransformKernels();
+	void RunPickKernels(const std::string& objectDirectory);
+	void RunLodKernels(const std::string& objectDirectory);
+	void RunSplineKernels();
+	void RunUploadRingKernels();
+	void RunBlasHeapKernels(const std::string& objectDirectory);
+	void RunProfilerKernels();
+	void RunBlasPolicyChecks();
+	void RunTileChecks();
+	void RunGpuTimestampChecks();
+	void RunFramePacerChecks();
+	void RunShaderCacheChecks();
+#pragma endregion
+
+#pragma region Private Variables
+	double m_regressionTolerance;
+	int m_repeats;
+	std::map<std::string, double> m_baseline;
+	std::vector<KernelBenchmarkResult> m_results;
+	std::vector<KernelCheckResult> m_checks;
+	uint64_t m_sink = 0;
+#pragma endregion
+};
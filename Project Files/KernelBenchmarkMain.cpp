@@ -0,0 +1,40 @@
+#pragma region Includes
+//Include{s}
+#include "KernelBenchmark.h"
+#include <cstdio>
+#pragma endregion
+
+// The same run as -kernelbench, without a window or a device, so the portable code can be timed and checked on any machine.
+// The baseline is read from and the CSVs written to the working directory, the meshes come from the first argument if
+// there is one and Objects if not.
+
+int main(int argc, char** argv)
+{
+	KernelBenchmark benchmark;
+	benchmark.LoadBaseline("KernelBaseline.csv");
+	benchmark.Run(argc > 1 ? argv[1] : "Objects");
+
+	for (const KernelBenchmarkResult& result : benchmark.GetResults())
+	{
+		printf("%s\n", KernelBenchmark::FormatResult(result).c_str());
+	}
+	for (const KernelCheckResult& check : benchmark.GetChecks())
+	{
+		printf("%s\n", KernelBenchmark::FormatCheck(check).c_str());
+	}
+
+	// A CSV that couldn't be written fails the run too, otherwise the next baseline comparison is against stale numbers.
+	bool written = true;
+	if (!benchmark.WriteCsv("KernelBenchmark.csv"))
+	{
+		fprintf(stderr, "Couldn't write KernelBenchmark.csv\n");
+		written = false;
+	}
+	if (!benchmark.WriteChecksCsv("KernelChecks.csv"))
+	{
+		fprintf(stderr, "Couldn't write KernelChecks.csv\n");
+		written = false;
+	}
+
+	return benchmark.HasRegressions() || benchmark.HasFailedChecks() || !written ? 1 : 0;
+}
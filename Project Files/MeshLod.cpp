@@ -0,0 +1,708 @@
+#pragma region Includes
+//Include{s}
+#include "MeshLod.h"
+#include "MeshOptimiser.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <unordered_map>
+#pragma endregion
+
+#pragma region Helpers
+namespace
+{
+	// Where shadow and reflection rays move on to the next band, as the width of their cone in world units.
+	// IMPORTANT - the hlsl version of these are the LOD_BAND_ defines in Common.hlsl
+	const float kBandWidths[MeshLod::kBandCount] = { 0.0f, 0.05f, 0.2f };
+
+	// Border and seam edges get a plane through them at right angles to the surface, weighted up so they keep their shape.
+	const double kBorderWeight = 10.0;
+
+	// A collapse that turns any of the triangles left further than this (the cosine) is folding the mesh over, not simplifying it.
+	const double kMinNormalCosine = 0.25;
+
+	// The symmetric 4x4 matrix's upper triangle, and the area its planes were summed over.
+	struct Quadric
+	{
+		double a00, a01, a02, a03, a11, a12, a13, a22, a23, a33;
+		double weight;
+	};
+
+	// One side of a triangle, with the welded vertices it joins packed into the key, smallest first.
+	struct Edge
+	{
+		uint64_t key;
+		uint32_t triangle;
+		uint32_t first; // The vertices the triangle actually uses, at the key's low and high ends
+		uint32_t second;
+	};
+
+	struct Collapse
+	{
+		double cost;
+		uint32_t from; // Welded vertices
+		uint32_t to;
+		uint32_t edgeTriangles;
+	};
+
+	struct PositionKey
+	{
+		uint32_t bits[3];
+
+		bool operator==(const PositionKey& other) const
+		{
+			return bits[0] == other.bits[0] && bits[1] == other.bits[1] && bits[2] == other.bits[2];
+		}
+	};
+
+	struct PositionHash
+	{
+		size_t operator()(const PositionKey& key) const
+		{
+			return (key.bits[0] * 73856093u) ^ (key.bits[1] * 19349663u) ^ (key.bits[2] * 83492791u);
+		}
+	};
+
+	void AddPlane(Quadric& quadric, double nx, double ny, double nz, double d, double weight)
+	{
+		quadric.a00 += weight * nx * nx;
+		quadric.a01 += weight * nx * ny;
+		quadric.a02 += weight * nx * nz;
+		quadric.a03 += weight * nx * d;
+		quadric.a11 += weight * ny * ny;
+		quadric.a12 += weight * ny * nz;
+		quadric.a13 += weight * ny * d;
+		quadric.a22 += weight * nz * nz;
+		quadric.a23 += weight * nz * d;
+		quadric.a33 += weight * d * d;
+		quadric.weight += weight;
+	}
+
+	void AddQuadric(Quadric& quadric, const Quadric& other)
+	{
+		quadric.a00 += other.a00;
+		quadric.a01 += other.a01;
+		quadric.a02 += other.a02;
+		quadric.a03 += other.a03;
+		quadric.a11 += other.a11;
+		quadric.a12 += other.a12;
+		quadric.a13 += other.a13;
+		quadric.a22 += other.a22;
+		quadric.a23 += other.a23;
+		quadric.a33 += other.a33;
+		quadric.weight += other.weight;
+	}
+
+	// The squared distance from the planes, averaged over their area.
+	double Evaluate(const Quadric& quadric, const RayVec3& point)
+	{
+		double x = point.x;
+		double y = point.y;
+		double z = point.z;
+		double result = quadric.a00 * x * x + 2.0 * quadric.a01 * x * y + 2.0 * quadric.a02 * x * z + 2.0 * quadric.a03 * x +
+			quadric.a11 * y * y + 2.0 * quadric.a12 * y * z + 2.0 * quadric.a13 * y +
+			quadric.a22 * z * z + 2.0 * quadric.a23 * z + quadric.a33;
+		return quadric.weight > 0.0 ? std::max(result, 0.0) / quadric.weight : 0.0;
+	}
+
+	void TriangleNormal(const RayVec3& p0, const RayVec3& p1, const RayVec3& p2, double normal[3])
+	{
+		double ex = static_cast<double>(p1.x) - p0.x, ey = static_cast<double>(p1.y) - p0.y, ez = static_cast<double>(p1.z) - p0.z;
+		double fx = static_cast<double>(p2.x) - p0.x, fy = static_cast<double>(p2.y) - p0.y, fz = static_cast<double>(p2.z) - p0.z;
+		normal[0] = ey * fz - ez * fy;
+		normal[1] = ez * fx - ex * fz;
+		normal[2] = ex * fy - ey * fx;
+	}
+
+	double Dot(const double a[3], const double b[3])
+	{
+		return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+	}
+
+	// Ericson's closest point on a triangle, from Real-Time Collision Detection, returned as the squared distance to it.
+	double PointTriangleDistanceSquared(const RayVec3& point, const RayVec3& a, const RayVec3& b, const RayVec3& c)
+	{
+		double ab[3] = { static_cast<double>(b.x) - a.x, static_cast<double>(b.y) - a.y, static_cast<double>(b.z) - a.z };
+		double ac[3] = { static_cast<double>(c.x) - a.x, static_cast<double>(c.y) - a.y, static_cast<double>(c.z) - a.z };
+		double ap[3] = { static_cast<double>(point.x) - a.x, static_cast<double>(point.y) - a.y, static_cast<double>(point.z) - a.z };
+		double closest[3];
+
+		double d1 = Dot(ab, ap), d2 = Dot(ac, ap);
+		double bp[3] = { static_cast<double>(point.x) - b.x, static_cast<double>(point.y) - b.y, static_cast<double>(point.z) - b.z };
+		double d3 = Dot(ab, bp), d4 = Dot(ac, bp);
+		double cp[3] = { static_cast<double>(point.x) - c.x, static_cast<double>(point.y) - c.y, static_cast<double>(point.z) - c.z };
+		double d5 = Dot(ab, cp), d6 = Dot(ac, cp);
+		double va = d3 * d6 - d5 * d4, vb = d5 * d2 - d1 * d6, vc = d1 * d4 - d3 * d2;
+
+		double v, w;
+		if (d1 <= 0.0 && d2 <= 0.0) { v = 0.0; w = 0.0; }
+		else if (d3 >= 0.0 && d4 <= d3) { v = 1.0; w = 0.0; }
+		else if (d6 >= 0.0 && d5 <= d6) { v = 0.0; w = 1.0; }
+		else if (vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0) { v = d1 / (d1 - d3); w = 0.0; }
+		else if (vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0) { v = 0.0; w = d2 / (d2 - d6); }
+		else if (va <= 0.0 && d4 - d3 >= 0.0 && d5 - d6 >= 0.0) { w = (d4 - d3) / ((d4 - d3) + (d5 - d6)); v = 1.0 - w; }
+		else
+		{
+			double denominator = 1.0 / (va + vb + vc);
+			v = vb * denominator;
+			w = vc * denominator;
+		}
+
+		for (int axis = 0; axis < 3; axis++)
+		{
+			closest[axis] = ap[axis] - ab[axis] * v - ac[axis] * w;
+		}
+		return Dot(closest, closest);
+	}
+
+	// Every side of every triangle still standing, sorted so the triangles sharing a welded edge are next to each other.
+	void CollectEdges(const std::vector<uint32_t>& corners, const std::vector<uint8_t>& alive, const std::vector<uint32_t>& weld,
+		std::vector<Edge>& edges)
+	{
+		edges.clear();
+
+		for (uint32_t triangle = 0; triangle < alive.size(); triangle++)
+		{
+			if (!alive[triangle])
+			{
+				continue;
+			}
+
+			for (int side = 0; side < 3; side++)
+			{
+				uint32_t a = corners[triangle * 3 + side];
+				uint32_t b = corners[triangle * 3 + (side + 1) % 3];
+				if (weld[a] > weld[b])
+				{
+					std::swap(a, b);
+				}
+
+				Edge edge;
+				edge.key = (static_cast<uint64_t>(weld[a]) << 32) | weld[b];
+				edge.triangle = triangle;
+				edge.first = a;
+				edge.second = b;
+				edges.push_back(edge);
+			}
+		}
+
+		std::sort(edges.begin(), edges.end(), [](const Edge& a, const Edge& b) { return a.key < b.key; });
+	}
+
+	// An edge only one triangle uses is the edge of the mesh. One where the triangles either side use different vertices is
+	// a seam in the normals or UVs, and it's kept just the same. More than two triangles and it's a mess, so it's left alone too.
+	// Vertices are compared by what they hold rather than their index, the OBJ loader gives every corner its own copy.
+	bool IsBorder(const std::vector<Edge>& edges, const std::vector<uint32_t>& identity, size_t first, size_t count)
+	{
+		return count != 2 || identity[edges[first].first] != identity[edges[first + 1].first] ||
+			identity[edges[first].second] != identity[edges[first + 1].second];
+	}
+}
+#pragma endregion
+
+// Callers may well take these by reference, so they need somewhere to live.
+const uint32_t MeshLod::kMaxLevels;
+const uint32_t MeshLod::kBandCount;
+const size_t MeshLod::kMinTriangles;
+
+#pragma region Simplification Methods
+float MeshLod::Simplify(const TriangleMesh& mesh, const void* vertices, size_t vertexStride, size_t targetIndexCount,
+	std::vector<uint32_t>& result)
+{
+	const std::vector<RayVec3>& positions = mesh.positions;
+	uint32_t vertexCount = static_cast<uint32_t>(positions.size());
+	uint32_t triangleCount = static_cast<uint32_t>(mesh.GetTriangleCount());
+	size_t targetTriangles = targetIndexCount / 3;
+
+	// Weld by position, every vertex points at the first one in the same place. The simplifier works on the welded vertices
+	// and the triangles keep pointing at the real ones.
+	std::vector<uint32_t> weld(vertexCount);
+	{
+		std::unordered_map<PositionKey, uint32_t, PositionHash> firstAt;
+		firstAt.reserve(vertexCount);
+		for (uint32_t vertex = 0; vertex < vertexCount; vertex++)
+		{
+			PositionKey key;
+			std::memcpy(key.bits, &positions[vertex], sizeof(key.bits));
+			weld[vertex] = firstAt.emplace(key, vertex).first->second;
+		}
+	}
+
+	// And weld by the whole vertex, so two corners that only differ in their index don't look like a seam.
+	std::vector<uint32_t> identity;
+	if (vertices != nullptr)
+	{
+		MeshOptimiser::WeldVertices(vertices, vertexCount, vertexStride, identity);
+	}
+	else
+	{
+		identity.resize(vertexCount);
+		std::iota(identity.begin(), identity.end(), 0u);
+	}
+
+	std::vector<uint32_t> corners(mesh.indices.begin(), mesh.indices.begin() + triangleCount * 3);
+	std::vector<uint8_t> alive(triangleCount, 0);
+	std::vector<uint32_t> collapsedInto(vertexCount);
+	std::iota(collapsedInto.begin(), collapsedInto.end(), 0u);
+	std::vector<Quadric> quadrics(vertexCount, Quadric());
+	size_t liveTriangles = 0;
+
+	// Every triangle's plane goes into its corners' quadrics, weighted by its area.
+	for (uint32_t triangle = 0; triangle < triangleCount; triangle++)
+	{
+		uint32_t w0 = weld[corners[triangle * 3]], w1 = weld[corners[triangle * 3 + 1]], w2 = weld[corners[triangle * 3 + 2]];
+		if (w0 == w1 || w1 == w2 || w2 == w0)
+		{
+			continue;
+		}
+
+		alive[triangle] = 1;
+		liveTriangles++;
+
+		double normal[3];
+		TriangleNormal(positions[w0], positions[w1], positions[w2], normal);
+		double length = std::sqrt(Dot(normal, normal));
+		if (length == 0.0)
+		{
+			continue;
+		}
+
+		double nx = normal[0] / length, ny = normal[1] / length, nz = normal[2] / length;
+		double d = -(nx * positions[w0].x + ny * positions[w0].y + nz * positions[w0].z);
+		AddPlane(quadrics[w0], nx, ny, nz, d, length * 0.5);
+		AddPlane(quadrics[w1], nx, ny, nz, d, length * 0.5);
+		AddPlane(quadrics[w2], nx, ny, nz, d, length * 0.5);
+	}
+
+	std::vector<Edge> edges;
+	CollectEdges(corners, alive, weld, edges);
+
+	// Border and seam edges also get a plane standing up off the surface along them, so moving along them is cheap and moving
+	// off them isn't.
+	for (size_t first = 0, count = 0; first < edges.size(); first += count)
+	{
+		for (count = 1; first + count < edges.size() && edges[first + count].key == edges[first].key; count++);
+
+		if (!IsBorder(edges, identity, first, count))
+		{
+			continue;
+		}
+
+		const uint32_t* triangle = &corners[edges[first].triangle * 3];
+		double normal[3];
+		TriangleNormal(positions[weld[triangle[0]]], positions[weld[triangle[1]]], positions[weld[triangle[2]]], normal);
+
+		const RayVec3& p0 = positions[weld[edges[first].first]];
+		const RayVec3& p1 = positions[weld[edges[first].second]];
+		double edge[3] = { static_cast<double>(p1.x) - p0.x, static_cast<double>(p1.y) - p0.y, static_cast<double>(p1.z) - p0.z };
+		double side[3] = { edge[1] * normal[2] - edge[2] * normal[1], edge[2] * normal[0] - edge[0] * normal[2], edge[0] * normal[1] - edge[1] * normal[0] };
+		double length = std::sqrt(Dot(side, side));
+		if (length == 0.0)
+		{
+			continue;
+		}
+
+		double nx = side[0] / length, ny = side[1] / length, nz = side[2] / length;
+		double d = -(nx * p0.x + ny * p0.y + nz * p0.z);
+		double weight = Dot(edge, edge) * kBorderWeight;
+		AddPlane(quadrics[weld[edges[first].first]], nx, ny, nz, d, weight);
+		AddPlane(quadrics[weld[edges[first].second]], nx, ny, nz, d, weight);
+	}
+
+	std::vector<uint32_t> borderEdges(vertexCount);
+	std::vector<uint32_t> adjacencyStart(vertexCount + 1);
+	std::vector<uint32_t> adjacency;
+	std::vector<uint8_t> locked(vertexCount);
+	std::vector<uint32_t> marks(vertexCount, 0);
+	uint32_t mark = 0;
+	std::vector<Collapse> collapses;
+	std::vector<std::pair<uint32_t, uint32_t>> pairs;
+	bool edgesCurrent = true; // The first pass can use the edges the borders were found from
+
+	// Each pass works out what every edge would cost to collapse and does the cheapest ones that don't touch each other.
+	while (liveTriangles > targetTriangles)
+	{
+		if (!edgesCurrent)
+		{
+			CollectEdges(corners, alive, weld, edges);
+		}
+		edgesCurrent = false;
+
+		// The triangles around each welded vertex, counting sort style.
+		std::fill(adjacencyStart.begin(), adjacencyStart.end(), 0);
+		for (uint32_t triangle = 0; triangle < triangleCount; triangle++)
+		{
+			for (int corner = 0; corner < 3 && alive[triangle]; corner++)
+			{
+				adjacencyStart[weld[corners[triangle * 3 + corner]] + 1]++;
+			}
+		}
+		for (uint32_t vertex = 0; vertex < vertexCount; vertex++)
+		{
+			adjacencyStart[vertex + 1] += adjacencyStart[vertex];
+		}
+		adjacency.resize(adjacencyStart[vertexCount]);
+		std::vector<uint32_t> next(adjacencyStart.begin(), adjacencyStart.end() - 1);
+		for (uint32_t triangle = 0; triangle < triangleCount; triangle++)
+		{
+			for (int corner = 0; corner < 3 && alive[triangle]; corner++)
+			{
+				adjacency[next[weld[corners[triangle * 3 + corner]]]++] = triangle;
+			}
+		}
+
+		// A vertex on a border only moves along it. The ones where borders meet or end (not 2 border edges) stay put.
+		std::fill(borderEdges.begin(), borderEdges.end(), 0);
+		for (size_t first = 0, count = 0; first < edges.size(); first += count)
+		{
+			for (count = 1; first + count < edges.size() && edges[first + count].key == edges[first].key; count++);
+
+			if (IsBorder(edges, identity, first, count))
+			{
+				borderEdges[edges[first].key >> 32]++;
+				borderEdges[edges[first].key & 0xFFFFFFFF]++;
+			}
+		}
+
+		collapses.clear();
+		for (size_t first = 0, count = 0; first < edges.size(); first += count)
+		{
+			for (count = 1; first + count < edges.size() && edges[first + count].key == edges[first].key; count++);
+
+			bool border = IsBorder(edges, identity, first, count);
+			uint32_t a = static_cast<uint32_t>(edges[first].key >> 32);
+			uint32_t b = static_cast<uint32_t>(edges[first].key & 0xFFFFFFFF);
+
+			Quadric merged = quadrics[a];
+			AddQuadric(merged, quadrics[b]);
+
+			Collapse collapse;
+			collapse.cost = -1.0;
+			collapse.edgeTriangles = static_cast<uint32_t>(count);
+
+			if (borderEdges[a] == 0 || (border && borderEdges[a] == 2))
+			{
+				collapse.cost = Evaluate(merged, positions[b]);
+				collapse.from = a;
+				collapse.to = b;
+			}
+
+			if (borderEdges[b] == 0 || (border && borderEdges[b] == 2))
+			{
+				double cost = Evaluate(merged, positions[a]);
+				if (collapse.cost < 0.0 || cost < collapse.cost)
+				{
+					collapse.cost = cost;
+					collapse.from = b;
+					collapse.to = a;
+				}
+			}
+
+			if (collapse.cost >= 0.0)
+			{
+				collapses.push_back(collapse);
+			}
+		}
+
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+		// About as many as the target still needs and half again, so the order stays close to cheapest first across passes.
+		size_t needed = (liveTriangles - targetTriangles) / 2 + 1;
+		size_t passLimit = needed + needed / 2;
+		size_t done = 0;
+		std::fill(locked.begin(), locked.end(), 0);
+
+		for (size_t i = 0; i < collapses.size() && done < passLimit && liveTriangles > targetTriangles; i++)
+		{
+			const Collapse& collapse = collapses[i];
+			uint32_t from = collapse.from;
+			uint32_t to = collapse.to;
+
+			if (locked[from] || locked[to])
+			{
+				continue;
+			}
+
+			// Any more neighbours in common than triangles on the edge and the collapse would pinch the mesh into a non-manifold mess.
+			mark++;
+			for (uint32_t j = adjacencyStart[from]; j < adjacencyStart[from + 1]; j++)
+			{
+				for (int corner = 0; corner < 3; corner++)
+				{
+					marks[weld[corners[adjacency[j] * 3 + corner]]] = mark;
+				}
+			}
+
+			mark++;
+			uint32_t common = 0;
+			for (uint32_t j = adjacencyStart[to]; j < adjacencyStart[to + 1]; j++)
+			{
+				for (int corner = 0; corner < 3; corner++)
+				{
+					uint32_t vertex = weld[corners[adjacency[j] * 3 + corner]];
+					if (vertex != from && vertex != to && marks[vertex] == mark - 1)
+					{
+						marks[vertex] = mark;
+						common++;
+					}
+				}
+			}
+
+			if (common > collapse.edgeTriangles)
+			{
+				continue;
+			}
+
+			// Something has to be left standing round the vertex, or a small piece of the mesh collapses away to nothing.
+			uint32_t surviving = (adjacencyStart[from + 1] - adjacencyStart[from]) + (adjacencyStart[to + 1] - adjacencyStart[to]);
+			if (surviving <= 2 * collapse.edgeTriangles)
+			{
+				continue;
+			}
+
+			// None of the triangles that are left can fold over.
+			bool folds = false;
+			for (uint32_t j = adjacencyStart[from]; j < adjacencyStart[from + 1] && !folds; j++)
+			{
+				const uint32_t* triangle = &corners[adjacency[j] * 3];
+				RayVec3 before[3];
+				RayVec3 after[3];
+				bool dies = false;
+
+				for (int corner = 0; corner < 3; corner++)
+				{
+					uint32_t vertex = weld[triangle[corner]];
+					dies = dies || vertex == to;
+					before[corner] = positions[vertex];
+					after[corner] = vertex == from ? positions[to] : positions[vertex];
+				}
+
+				if (dies)
+				{
+					continue;
+				}
+
+				double normalBefore[3];
+				double normalAfter[3];
+				TriangleNormal(before[0], before[1], before[2], normalBefore);
+				TriangleNormal(after[0], after[1], after[2], normalAfter);
+
+				double lengths = std::sqrt(Dot(normalBefore, normalBefore) * Dot(normalAfter, normalAfter));
+				folds = Dot(normalBefore, normalBefore) > 0.0 && Dot(normalBefore, normalAfter) <= kMinNormalCosine * lengths;
+			}
+
+			if (folds)
+			{
+				continue;
+			}
+
+			// Nor can any of them land on top of one of the triangles already round the other end, which is what's left when a
+			// small closed piece (a tetrahedron) collapses, right before it vanishes altogether.
+			bool doubles = false;
+			for (uint32_t j = adjacencyStart[from]; j < adjacencyStart[from + 1] && !doubles; j++)
+			{
+				const uint32_t* triangle = &corners[adjacency[j] * 3];
+				uint32_t others[2];
+				int otherCount = 0;
+				bool dies = false;
+
+				for (int corner = 0; corner < 3; corner++)
+				{
+					uint32_t vertex = weld[triangle[corner]];
+					dies = dies || vertex == to;
+					if (vertex != from && otherCount < 2)
+					{
+						others[otherCount++] = vertex;
+					}
+				}
+
+				for (uint32_t k = adjacencyStart[to]; k < adjacencyStart[to + 1] && !dies && !doubles; k++)
+				{
+					const uint32_t* existing = &corners[adjacency[k] * 3];
+					bool hasFirst = false;
+					bool hasSecond = false;
+					for (int corner = 0; corner < 3; corner++)
+					{
+						hasFirst = hasFirst || weld[existing[corner]] == others[0];
+						hasSecond = hasSecond || weld[existing[corner]] == others[1];
+					}
+					doubles = hasFirst && hasSecond;
+				}
+			}
+
+			if (doubles)
+			{
+				continue;
+			}
+
+			// The triangles on the edge go, and the vertices they join are how the rest know which side of a seam they're on.
+			pairs.clear();
+			for (uint32_t j = adjacencyStart[from]; j < adjacencyStart[from + 1]; j++)
+			{
+				uint32_t* triangle = &corners[adjacency[j] * 3];
+				uint32_t fromCorner = UINT32_MAX;
+				uint32_t toCorner = UINT32_MAX;
+
+				for (int corner = 0; corner < 3; corner++)
+				{
+					fromCorner = weld[triangle[corner]] == from ? triangle[corner] : fromCorner;
+					toCorner = weld[triangle[corner]] == to ? triangle[corner] : toCorner;
+					locked[weld[triangle[corner]]] = 1; // Their triangles have changed, so the adjacency's out of date for them
+				}
+
+				if (toCorner != UINT32_MAX)
+				{
+					pairs.push_back(std::make_pair(fromCorner, toCorner));
+					alive[adjacency[j]] = 0;
+					liveTriangles--;
+				}
+			}
+
+			for (uint32_t j = adjacencyStart[from]; j < adjacencyStart[from + 1]; j++)
+			{
+				if (!alive[adjacency[j]])
+				{
+					continue;
+				}
+
+				uint32_t* triangle = &corners[adjacency[j] * 3];
+				for (int corner = 0; corner < 3; corner++)
+				{
+					if (weld[triangle[corner]] != from)
+					{
+						continue;
+					}
+
+					uint32_t replacement = to;
+					for (const std::pair<uint32_t, uint32_t>& pair : pairs)
+					{
+						replacement = pair.first == triangle[corner] ? pair.second : replacement;
+					}
+					triangle[corner] = replacement;
+				}
+			}
+
+			AddQuadric(quadrics[to], quadrics[from]);
+			collapsedInto[from] = to;
+			locked[from] = 1;
+			locked[to] = 1;
+			done++;
+		}
+
+		if (done == 0)
+		{
+			break;
+		}
+	}
+
+	result.clear();
+	result.reserve(liveTriangles * 3);
+	for (uint32_t triangle = 0; triangle < triangleCount; triangle++)
+	{
+		if (alive[triangle])
+		{
+			result.insert(result.end(), corners.begin() + triangle * 3, corners.begin() + triangle * 3 + 3);
+		}
+	}
+
+	// The quadrics only give an average over the planes a vertex has soaked up, which badly undersells curved outlines on
+	// flat meshes like the text. So the error's measured instead: every original vertex against the triangles left round
+	// the vertex it ended up collapsed into. The surface nearest it could be somewhere else, so this can only be an overestimate.
+	std::vector<uint32_t> resultStart(vertexCount + 1, 0);
+	std::vector<uint32_t> resultTriangles(result.size());
+	for (uint32_t index : result)
+	{
+		resultStart[weld[index] + 1]++;
+	}
+	for (uint32_t vertex = 0; vertex < vertexCount; vertex++)
+	{
+		resultStart[vertex + 1] += resultStart[vertex];
+	}
+	{
+		std::vector<uint32_t> next(resultStart.begin(), resultStart.end() - 1);
+		for (uint32_t i = 0; i < result.size(); i++)
+		{
+			resultTriangles[next[weld[result[i]]]++] = i / 3;
+		}
+	}
+
+	double maxError = 0.0;
+	for (uint32_t vertex = 0; vertex < vertexCount; vertex++)
+	{
+		if (weld[vertex] != vertex)
+		{
+			continue;
+		}
+
+		uint32_t root = vertex;
+		while (collapsedInto[root] != root)
+		{
+			root = collapsedInto[root];
+		}
+		collapsedInto[vertex] = root; // Squash the chain so the vertices collapsed into this one don't walk it again
+
+		double nearest = resultStart[root] == resultStart[root + 1] ? 0.0 : 1e300;
+		for (uint32_t j = resultStart[root]; j < resultStart[root + 1]; j++)
+		{
+			const uint32_t* triangle = &result[resultTriangles[j] * 3];
+			nearest = std::min(nearest, PointTriangleDistanceSquared(positions[vertex], positions[triangle[0]], positions[triangle[1]], positions[triangle[2]]));
+		}
+		maxError = std::max(maxError, nearest);
+	}
+
+	return static_cast<float>(std::sqrt(maxError));
+}
+
+void MeshLod::BuildChain(const TriangleMesh& mesh, const void* vertices, size_t vertexStride, std::vector<MeshLodLevel>& levels)
+{
+	levels.clear();
+
+	size_t triangles = mesh.GetTriangleCount();
+	if (triangles < kMinTriangles)
+	{
+		return;
+	}
+
+	size_t previous = triangles;
+	for (uint32_t level = 1; level <= kMaxLevels; level++)
+	{
+		MeshLodLevel lod;
+		lod.error = Simplify(mesh, vertices, vertexStride, (triangles >> (2 * level)) * 3, lod.indices);
+
+		// Not worth a BLAS of its own if it couldn't get much smaller than the level before.
+		size_t lodTriangles = lod.indices.size() / 3;
+		if (lodTriangles == 0 || lodTriangles > previous * 3 / 4)
+		{
+			break;
+		}
+
+		previous = lodTriangles;
+		levels.push_back(std::move(lod));
+	}
+}
+#pragma endregion
+
+#pragma region Selection Methods
+uint32_t MeshLod::SelectBand(float coneWidth)
+{
+	uint32_t band = 0;
+	while (band + 1 < kBandCount && coneWidth >= kBandWidths[band + 1])
+	{
+		band++;
+	}
+	return band;
+}
+
+uint32_t MeshLod::SelectLevel(const std::vector<MeshLodLevel>& levels, uint32_t band, float worldScale, float errorPerWidth)
+{
+	float allowed = kBandWidths[std::min(band, kBandCount - 1)] * errorPerWidth;
+
+	uint32_t level = 0;
+	for (uint32_t i = 0; i < levels.size() && levels[i].error * worldScale <= allowed; i++)
+	{
+		level = i + 1;
+	}
+	return level;
+}
+#pragma endregion
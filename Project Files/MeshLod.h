@@ -0,0 +1,79 @@
+#pragma once
+
+#pragma region Includes
+//Include{s}
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "RayKernels.h"
+#pragma endregion
+
+// No Windows headers, it's positions and indices in and indices out, so the simplifier runs (and gets benchmarked) anywhere.
+
+#pragma region Data Structures
+/// <summary>
+/// A coarser version of a mesh. It only ever drops vertices, so its indices point into the full mesh's vertices and the
+/// normals and UVs come along for free.
+/// </summary>
+struct MeshLodLevel
+{
+	std::vector<uint32_t> indices;
+	float error = 0.0f; // How far the surface can have moved from the full mesh, in object space
+};
+#pragma endregion
+
+/// <summary>
+/// The MeshLod class. Builds LOD chains with Garland and Heckbert's quadric error metric, collapsing each edge onto one of its
+/// own vertices, and picks which level a ray should see from how wide its cone is. Vertices are welded by position before
+/// simplifying, and the edges where the vertices either side hold different normals or UVs are kept as they are, the same as
+/// the edge of an open mesh.
+/// </summary>
+class MeshLod
+{
+public:
+	// There are mask bits for 3 cone bands, so a chain is the full mesh and up to 2 coarser levels.
+	static const uint32_t kMaxLevels = 2;
+	static const uint32_t kBandCount = kMaxLevels + 1;
+
+	// Anything smaller than this isn't worth simplifying, its BLAS is already tiny.
+	static const size_t kMinTriangles = 512;
+
+#pragma region Simplification Methods
+	/// <summary>
+	/// Collapses edges, cheapest first, until the mesh is down to the target or nothing else can go without tearing or folding it.
+	/// </summary>
+	/// <param name="vertices">The whole vertices, one per position, which decide where the seams are. Null if the mesh's
+	/// indices already say which corners share a vertex.</param>
+	/// <param name="vertexStride">How many bytes a vertex is.</param>
+	/// <param name="targetIndexCount">How many indices to get down to, 3 a triangle.</param>
+	/// <param name="result">The simplified mesh's indices, into mesh.positions.</param>
+	/// <returns>The furthest the surface moved, in the mesh's own units.</returns>
+	static float Simplify(const TriangleMesh& mesh, const void* vertices, size_t vertexStride, size_t targetIndexCount,
+		std::vector<uint32_t>& result);
+
+	/// <summary>
+	/// Builds the chain, each level a quarter of the triangles of the one before. Every level is simplified from the full mesh,
+	/// so its error is against that rather than piling up. It stops early once a level stops getting any smaller.
+	/// </summary>
+	/// <param name="vertices">The whole vertices, the same as Simplify. Null if the indices already share them.</param>
+	/// <param name="levels">The coarser levels, finest first. Empty if the mesh is too small to bother.</param>
+	static void BuildChain(const TriangleMesh& mesh, const void* vertices, size_t vertexStride, std::vector<MeshLodLevel>& levels);
+#pragma endregion
+
+#pragma region Selection Methods
+	/// <summary>
+	/// Which band a ray's in, from its cone's width where it starts. The hlsl version is LodInstanceMask in Common.hlsl.
+	/// </summary>
+	/// <returns>0 for a narrow cone, up to kBandCount - 1.</returns>
+	static uint32_t SelectBand(float coneWidth);
+
+	/// <summary>
+	/// Which level of a chain rays in a band should see: the coarsest whose error, scaled up into the world, is no bigger than
+	/// the narrowest cone in the band.
+	/// </summary>
+	/// <param name="worldScale">The object's biggest scale, which is what its error grows by.</param>
+	/// <param name="errorPerWidth">How much error a cone's width is allowed to hide, 1 is as much as the width.</param>
+	/// <returns>0 for the full mesh, otherwise the level's index in the chain plus 1.</returns>
+	static uint32_t SelectLevel(const std::vector<MeshLodLevel>& levels, uint32_t band, float worldScale, float errorPerWidth);
+#pragma endregion
+};
@@ -0,0 +1,256 @@
+#pragma region Includes
+//Include{s}
+#include "MeshLodCache.h"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#pragma endregion
+
+#pragma region Helpers
+namespace
+{
+	// The same FNV-1a as the shader cache.
+	const uint64_t kFnvOffsetBasis = 14695981039346656037ull;
+	const uint64_t kFnvPrime = 1099511628211ull;
+
+	// "RLOD", at the front of every entry so a stray file in the directory can't be read as a mesh.
+	const uint32_t kEntryMagic = 0x444F4C52;
+
+	void HashBytes(uint64_t& hash, const void* data, size_t size)
+	{
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= bytes[i];
+			hash *= kFnvPrime;
+		}
+	}
+
+	template <typename T>
+	bool ReadValue(std::ifstream& file, T& value)
+	{
+		file.read(reinterpret_cast<char*>(&value), sizeof(value));
+		return file.good();
+	}
+
+	template <typename T>
+	void WriteValue(std::ofstream& file, const T& value)
+	{
+		file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+	}
+
+	// A count then that many indices, every one of which has to be under the limit. The count's checked against the most
+	// there can be and what's left of the file before anything's allocated, a garbage one could ask for 16GB.
+	bool ReadIndices(std::ifstream& file, std::vector<uint32_t>& indices, size_t maxCount, size_t limit)
+	{
+		uint32_t count = 0;
+		if (!ReadValue(file, count) || count > maxCount)
+		{
+			return false;
+		}
+
+		std::streampos start = file.tellg();
+		file.seekg(0, std::ios::end);
+		std::streamoff remaining = file.tellg() - start;
+		file.seekg(start);
+		if (!file.good() || remaining < static_cast<std::streamoff>(count * sizeof(uint32_t)))
+		{
+			return false;
+		}
+
+		indices.resize(count);
+		file.read(reinterpret_cast<char*>(indices.data()), static_cast<std::streamsize>(count * sizeof(uint32_t)));
+		if (!file.good())
+		{
+			return false;
+		}
+
+		for (uint32_t index : indices)
+		{
+			if (index >= limit)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void WriteIndices(std::ofstream& file, const std::vector<uint32_t>& indices)
+	{
+		WriteValue(file, static_cast<uint32_t>(indices.size()));
+		file.write(reinterpret_cast<const char*>(indices.data()), static_cast<std::streamsize>(indices.size() * sizeof(uint32_t)));
+	}
+
+	double MillisecondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+}
+
+// Callers may well take these by reference, so they need somewhere to live.
+const uint32_t MeshLodCache::kFormatVersion;
+#pragma endregion
+
+#pragma region Constructors and Destructors
+MeshLodCache::MeshLodCache(const std::string& cacheDirectory)
+{
+	m_cacheDirectory = cacheDirectory;
+
+	if (!m_cacheDirectory.empty() && m_cacheDirectory.back() != '/' && m_cacheDirectory.back() != '\\')
+	{
+		m_cacheDirectory += '/';
+	}
+}
+#pragma endregion
+
+#pragma region Cache Methods
+void MeshLodCache::GetOrBuild(const TriangleMesh& mesh, const void* vertices, size_t vertexStride, bool withLods, CachedMesh& outMesh)
+{
+	auto start = std::chrono::steady_clock::now();
+	uint64_t key = ComputeKey(mesh, vertices, vertexStride, withLods);
+
+	if (LoadEntry(key, mesh.positions.size(), mesh.GetTriangleCount() * 3, outMesh))
+	{
+		m_stats.hits++;
+		m_stats.totalLoadMilliseconds += MillisecondsSince(start);
+		return;
+	}
+
+	MeshOptimiser::Optimise(mesh, vertices, vertexStride, outMesh.vertexOrder, outMesh.indices);
+
+	// The levels index the optimised vertices, so they're simplified from the optimised mesh rather than the loaded one.
+	outMesh.levels.clear();
+	if (withLods)
+	{
+		TriangleMesh optimised;
+		optimised.positions.reserve(outMesh.vertexOrder.size());
+		for (uint32_t vertex : outMesh.vertexOrder)
+		{
+			optimised.positions.push_back(mesh.positions[vertex]);
+		}
+		optimised.indices = outMesh.indices;
+
+		// The optimiser has welded every corner that matches byte for byte, so the indices already say where the seams are.
+		MeshLod::BuildChain(optimised, nullptr, 0, outMesh.levels);
+
+		// Collapses leave the triangles where they were, which is in the right area but not the right order.
+		for (MeshLodLevel& level : outMesh.levels)
+		{
+			MeshOptimiser::OptimiseVertexCache(level.indices, optimised.positions.size());
+		}
+	}
+
+	m_stats.misses++;
+	m_stats.totalBuildMilliseconds += MillisecondsSince(start);
+
+	// A failed write only costs us building it again next launch.
+	if (!StoreEntry(key, outMesh))
+	{
+		m_stats.failedWrites++;
+	}
+}
+
+uint64_t MeshLodCache::ComputeKey(const TriangleMesh& mesh, const void* vertices, size_t vertexStride, bool withLods) const
+{
+	// The limits go in as well as the version, so changing them doesn't need a bump.
+	uint64_t key = kFnvOffsetBasis;
+	uint32_t settings[4] = { kFormatVersion, MeshLod::kMaxLevels, static_cast<uint32_t>(MeshLod::kMinTriangles), withLods ? 1u : 0u };
+	HashBytes(key, settings, sizeof(settings));
+
+	// The whole vertices rather than just the positions, as they decide what gets welded.
+	uint64_t vertexCount = mesh.positions.size();
+	uint64_t stride = vertexStride;
+	HashBytes(key, &vertexCount, sizeof(vertexCount));
+	HashBytes(key, &stride, sizeof(stride));
+	HashBytes(key, vertices, mesh.positions.size() * vertexStride);
+
+	uint64_t indexCount = mesh.indices.size();
+	HashBytes(key, &indexCount, sizeof(indexCount));
+	HashBytes(key, mesh.indices.data(), mesh.indices.size() * sizeof(uint32_t));
+
+	return key;
+}
+
+std::string MeshLodCache::GetEntryPath(uint64_t key) const
+{
+	char name[17];
+	snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(key));
+	return m_cacheDirectory + name + ".lod";
+}
+#pragma endregion
+
+#pragma region Private Methods
+bool MeshLodCache::LoadEntry(uint64_t key, size_t vertexCount, size_t indexCount, CachedMesh& outMesh) const
+{
+	std::ifstream file(GetEntryPath(key), std::ios::binary);
+	if (!file.good())
+	{
+		return false;
+	}
+
+	// The key should make a bad index impossible, but one would take the GPU down with it, so every one gets a look.
+	uint32_t magic = 0;
+	uint32_t levelCount = 0;
+	if (!ReadValue(file, magic) || magic != kEntryMagic ||
+		!ReadIndices(file, outMesh.vertexOrder, vertexCount, vertexCount) || outMesh.vertexOrder.empty() ||
+		!ReadIndices(file, outMesh.indices, indexCount, outMesh.vertexOrder.size()) || outMesh.indices.empty() ||
+		outMesh.indices.size() != indexCount ||
+		!ReadValue(file, levelCount) || levelCount > MeshLod::kMaxLevels)
+	{
+		return false;
+	}
+
+	outMesh.levels.resize(levelCount);
+	for (MeshLodLevel& level : outMesh.levels)
+	{
+		if (!ReadValue(file, level.error) || !ReadIndices(file, level.indices, indexCount, outMesh.vertexOrder.size()) ||
+			level.indices.empty() || level.indices.size() % 3 != 0)
+		{
+			outMesh.levels.clear();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool MeshLodCache::StoreEntry(uint64_t key, const CachedMesh& mesh) const
+{
+	std::string entryPath = GetEntryPath(key);
+	std::string tempPath = entryPath + ".tmp";
+
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		if (!file.good())
+		{
+			return false;
+		}
+
+		// A mesh that didn't simplify still gets an entry with no levels, so it isn't tried again every launch.
+		WriteValue(file, kEntryMagic);
+		WriteIndices(file, mesh.vertexOrder);
+		WriteIndices(file, mesh.indices);
+		WriteValue(file, static_cast<uint32_t>(mesh.levels.size()));
+		for (const MeshLodLevel& level : mesh.levels)
+		{
+			WriteValue(file, level.error);
+			WriteIndices(file, level.indices);
+		}
+
+		if (!file.good())
+		{
+			return false;
+		}
+	}
+
+	// rename won't overwrite on Windows, and the old entry has the same key so it holds the same mesh anyway.
+	std::remove(entryPath.c_str());
+	if (std::rename(tempPath.c_str(), entryPath.c_str()) != 0)
+	{
+		std::remove(tempPath.c_str());
+		return false;
+	}
+
+	return true;
+}
+#pragma endregion
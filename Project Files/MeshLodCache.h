@@ -0,0 +1,106 @@
+#pragma once
+
+#pragma region Includes
+//Include{s}
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MeshLod.h"
+#include "MeshOptimiser.h"
+#pragma endregion
+
+// No Windows headers, same as the shader cache, so the LODs can be built and cached from the kernel benchmark too.
+
+#pragma region Data Structures
+/// <summary>
+/// Running totals for the mesh LOD cache.
+/// </summary>
+struct MeshLodCacheStats
+{
+	uint32_t hits = 0;
+	uint32_t misses = 0;
+	uint32_t failedWrites = 0;
+	double totalBuildMilliseconds = 0.0;
+	double totalLoadMilliseconds = 0.0;
+};
+
+/// <summary>
+/// What the cache keeps for a mesh, its optimised order and the LOD chain built from it.
+/// </summary>
+struct CachedMesh
+{
+	std::vector<uint32_t> vertexOrder; // Which of the loaded vertices each optimised vertex is
+	std::vector<uint32_t> indices; // Into the optimised vertices
+	std::vector<MeshLodLevel> levels; // Also into the optimised vertices, empty unless they were asked for
+};
+#pragma endregion
+
+/// <summary>
+/// The MeshLodCache class. A content addressed, on disk cache for the meshes MeshOptimiser reorders and the LOD chains
+/// MeshLod builds from them, so a mesh is only ever optimised and simplified once. The key covers the mesh's vertices and
+/// indices and the version of both.
+/// </summary>
+class MeshLodCache
+{
+public:
+	// Bump this whenever MeshLod or MeshOptimiser changes what it builds, so old entries don't get loaded.
+	static const uint32_t kFormatVersion = 2;
+
+#pragma region Constructors and Destructors
+	/// <summary>
+	/// Initializes a new instance of the MeshLodCache class.
+	/// </summary>
+	/// <param name="cacheDirectory">The directory chains are stored in, it must already exist.</param>
+	MeshLodCache(const std::string& cacheDirectory);
+#pragma endregion
+
+#pragma region Cache Methods
+	/// <summary>
+	/// Gets a mesh's optimised order and LOD chain, from disk if there's an entry for it, otherwise by building them and
+	/// storing the result. The LOD levels are built from the optimised mesh and get their own vertex cache pass.
+	/// </summary>
+	/// <param name="mesh">The positions (one per vertex) and indices as they were loaded.</param>
+	/// <param name="vertices">The whole vertices, the optimiser only welds ones that match byte for byte.</param>
+	/// <param name="vertexStride">How many bytes a vertex is.</param>
+	/// <param name="withLods">Whether to build the LOD chain as well.</param>
+	void GetOrBuild(const TriangleMesh& mesh, const void* vertices, size_t vertexStride, bool withLods, CachedMesh& outMesh);
+
+	/// <summary>
+	/// Computes the cache key for a mesh, without building anything.
+	/// </summary>
+	/// <returns>The 64 bit cache key.</returns>
+	uint64_t ComputeKey(const TriangleMesh& mesh, const void* vertices, size_t vertexStride, bool withLods) const;
+
+	/// <summary>
+	/// Gets the path a key is stored at.
+	/// </summary>
+	/// <param name="key">The cache key.</param>
+	/// <returns>The file path of the cache entry.</returns>
+	std::string GetEntryPath(uint64_t key) const;
+#pragma endregion
+
+#pragma region Getters
+	const MeshLodCacheStats& GetStats() const { return m_stats; }
+#pragma endregion
+
+private:
+#pragma region Private Methods
+	/// <summary>
+	/// Loads a cache entry from disk, checking every index is in range of the mesh it's for and no count is bigger than the
+	/// mesh could need.
+	/// </summary>
+	/// <returns>True if the entry exists and is whole.</returns>
+	bool LoadEntry(uint64_t key, size_t vertexCount, size_t indexCount, CachedMesh& outMesh) const;
+
+	/// <summary>
+	/// Stores a cache entry on disk. Writes to a temp file first so a crash can't leave half an entry behind.
+	/// </summary>
+	/// <returns>True if the entry was written.</returns>
+	bool StoreEntry(uint64_t key, const CachedMesh& mesh) const;
+#pragma endregion
+
+#pragma region Private Variables
+	std::string m_cacheDirectory;
+	MeshLodCacheStats m_stats;
+#pragma endregion
+};
@@ -0,0 +1,451 @@
+#pragma region Includes
+//Include{s}
+#include "MeshOptimiser.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#pragma endregion
+
+#pragma region Helpers
+namespace
+{
+	// Forsyth's LRU and scoring, straight out of "Linear-Speed Vertex Cache Optimisation". It aims at a bigger cache than the
+	// one the ACMR's reported against, which does no harm to the smaller ones.
+	const uint32_t kForsythCacheSize = 32;
+	const float kCacheDecayPower = 1.5f;
+	const float kLastTriangleScore = 0.75f;
+	const float kValenceBoostScale = 2.0f;
+	const float kValenceBoostPower = 0.5f;
+	const uint32_t kMaxValenceScore = 64; // Past this the boost barely changes, so it's worked out rather than looked up
+
+	// 10 bits an axis, which is a thousand cells across even the biggest mesh.
+	const uint32_t kMortonBits = 10;
+
+	uint32_t HashVertex(const uint8_t* vertex, size_t vertexStride)
+	{
+		uint32_t hash = 2166136261u;
+		for (size_t i = 0; i < vertexStride; i++)
+		{
+			hash ^= vertex[i];
+			hash *= 16777619u;
+		}
+		return hash;
+	}
+
+	// Spreads the bottom 10 bits out to every third bit.
+	uint32_t SpreadBits(uint32_t value)
+	{
+		value &= 0x3FF;
+		value = (value | (value << 16)) & 0x030000FF;
+		value = (value | (value << 8)) & 0x0300F00F;
+		value = (value | (value << 4)) & 0x030C30C3;
+		value = (value | (value << 2)) & 0x09249249;
+		return value;
+	}
+
+	uint32_t ToCell(float value, float minimum, float scale)
+	{
+		float cell = (value - minimum) * scale;
+		return static_cast<uint32_t>(std::min(std::max(cell, 0.0f), static_cast<float>((1 << kMortonBits) - 1)));
+	}
+
+	struct ForsythTables
+	{
+		float cache[kForsythCacheSize];
+		float valence[kMaxValenceScore + 1];
+
+		ForsythTables()
+		{
+			for (uint32_t position = 0; position < kForsythCacheSize; position++)
+			{
+				// The last triangle's vertices get a flat score, so it doesn't just keep fanning round one of them.
+				cache[position] = position < 3 ? kLastTriangleScore :
+					std::pow(1.0f - static_cast<float>(position - 3) / (kForsythCacheSize - 3), kCacheDecayPower);
+			}
+
+			valence[0] = 0.0f;
+			for (uint32_t remaining = 1; remaining <= kMaxValenceScore; remaining++)
+			{
+				valence[remaining] = kValenceBoostScale * std::pow(static_cast<float>(remaining), -kValenceBoostPower);
+			}
+		}
+	};
+
+	float VertexScore(const ForsythTables& tables, int32_t cachePosition, uint32_t remaining)
+	{
+		// Nothing left to draw with it, so there's no point keeping it around.
+		if (remaining == 0)
+		{
+			return -1.0f;
+		}
+
+		float score = cachePosition >= 0 ? tables.cache[cachePosition] : 0.0f;
+		return score + (remaining <= kMaxValenceScore ? tables.valence[remaining] :
+			kValenceBoostScale * std::pow(static_cast<float>(remaining), -kValenceBoostPower));
+	}
+}
+
+// Callers may well take these by reference, so they need somewhere to live.
+const uint32_t MeshOptimiser::kReportCacheSize;
+const uint32_t MeshOptimiser::kFetchLineBytes;
+const uint32_t MeshOptimiser::kFetchCacheLines;
+#pragma endregion
+
+#pragma region Optimisation Methods
+void MeshOptimiser::Optimise(const TriangleMesh& mesh, const void* vertices, size_t vertexStride,
+	std::vector<uint32_t>& vertexOrder, std::vector<uint32_t>& indices)
+{
+	std::vector<uint32_t> remap;
+	size_t weldedCount = WeldVertices(vertices, mesh.positions.size(), vertexStride, remap);
+
+	// Every welded vertex is the first of the ones it was made from, which is what the rest of the passes see.
+	std::vector<uint32_t> firstVertex(weldedCount);
+	for (size_t vertex = remap.size(); vertex-- > 0;)
+	{
+		firstVertex[remap[vertex]] = static_cast<uint32_t>(vertex);
+	}
+
+	std::vector<RayVec3> positions(weldedCount);
+	for (size_t vertex = 0; vertex < weldedCount; vertex++)
+	{
+		positions[vertex] = mesh.positions[firstVertex[vertex]];
+	}
+
+	indices.resize(mesh.GetTriangleCount() * 3);
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		indices[i] = remap[mesh.indices[i]];
+	}
+
+	SortTrianglesMorton(positions, indices);
+	OptimiseVertexCache(indices, weldedCount);
+
+	std::vector<uint32_t> fetchOrder;
+	OptimiseVertexFetch(indices, weldedCount, fetchOrder);
+
+	vertexOrder.resize(weldedCount);
+	for (size_t vertex = 0; vertex < weldedCount; vertex++)
+	{
+		vertexOrder[vertex] = firstVertex[fetchOrder[vertex]];
+	}
+}
+
+size_t MeshOptimiser::WeldVertices(const void* vertices, size_t vertexCount, size_t vertexStride, std::vector<uint32_t>& remap)
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(vertices);
+	remap.assign(vertexCount, UINT32_MAX);
+
+	// Open addressing, at most half full. Each slot holds the first vertex with those bytes.
+	size_t tableSize = 1;
+	while (tableSize < vertexCount * 2)
+	{
+		tableSize *= 2;
+	}
+	std::vector<uint32_t> table(tableSize, UINT32_MAX);
+
+	uint32_t weldedCount = 0;
+	for (size_t vertex = 0; vertex < vertexCount; vertex++)
+	{
+		const uint8_t* vertexBytes = bytes + vertex * vertexStride;
+		size_t slot = HashVertex(vertexBytes, vertexStride) & (tableSize - 1);
+
+		while (table[slot] != UINT32_MAX && std::memcmp(bytes + table[slot] * vertexStride, vertexBytes, vertexStride) != 0)
+		{
+			slot = (slot + 1) & (tableSize - 1);
+		}
+
+		if (table[slot] == UINT32_MAX)
+		{
+			table[slot] = static_cast<uint32_t>(vertex);
+			remap[vertex] = weldedCount++;
+		}
+		else
+		{
+			remap[vertex] = remap[table[slot]];
+		}
+	}
+
+	return weldedCount;
+}
+
+void MeshOptimiser::SortTrianglesMorton(const std::vector<RayVec3>& positions, std::vector<uint32_t>& indices)
+{
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount < 2)
+	{
+		return;
+	}
+
+	RayVec3 minimum(1e30f, 1e30f, 1e30f);
+	RayVec3 maximum(-1e30f, -1e30f, -1e30f);
+	for (uint32_t index : indices)
+	{
+		const RayVec3& position = positions[index];
+		minimum = RayVec3(std::min(minimum.x, position.x), std::min(minimum.y, position.y), std::min(minimum.z, position.z));
+		maximum = RayVec3(std::max(maximum.x, position.x), std::max(maximum.y, position.y), std::max(maximum.z, position.z));
+	}
+
+	// One scale for every axis, so a long thin mesh is cut into cubes rather than slivers.
+	float extent = std::max(maximum.x - minimum.x, std::max(maximum.y - minimum.y, maximum.z - minimum.z));
+	float scale = extent > 0.0f ? static_cast<float>(1 << kMortonBits) / extent : 0.0f;
+
+	std::vector<std::pair<uint32_t, uint32_t>> codes(triangleCount);
+	for (size_t triangle = 0; triangle < triangleCount; triangle++)
+	{
+		const RayVec3& p0 = positions[indices[triangle * 3]];
+		const RayVec3& p1 = positions[indices[triangle * 3 + 1]];
+		const RayVec3& p2 = positions[indices[triangle * 3 + 2]];
+		const float third = 1.0f / 3.0f;
+
+		uint32_t x = ToCell((p0.x + p1.x + p2.x) * third, minimum.x, scale);
+		uint32_t y = ToCell((p0.y + p1.y + p2.y) * third, minimum.y, scale);
+		uint32_t z = ToCell((p0.z + p1.z + p2.z) * third, minimum.z, scale);
+		codes[triangle] = std::make_pair(SpreadBits(x) | (SpreadBits(y) << 1) | (SpreadBits(z) << 2), static_cast<uint32_t>(triangle));
+	}
+
+	// Ties keep the order they came in, so the same mesh always sorts the same way.
+	std::sort(codes.begin(), codes.end());
+
+	std::vector<uint32_t> sorted(triangleCount * 3);
+	for (size_t i = 0; i < triangleCount; i++)
+	{
+		std::memcpy(&sorted[i * 3], &indices[codes[i].second * 3], sizeof(uint32_t) * 3);
+	}
+	indices.swap(sorted);
+}
+
+void MeshOptimiser::OptimiseVertexCache(std::vector<uint32_t>& indices, size_t vertexCount)
+{
+	static const ForsythTables tables;
+
+	uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+	if (triangleCount < 2)
+	{
+		return;
+	}
+
+	// Each vertex's triangles that haven't been drawn yet, the drawn ones get swapped off the end of its range.
+	std::vector<uint32_t> remaining(vertexCount, 0);
+	for (uint32_t i = 0; i < triangleCount * 3; i++)
+	{
+		remaining[indices[i]]++;
+	}
+
+	std::vector<uint32_t> adjacencyStart(vertexCount + 1, 0);
+	for (size_t vertex = 0; vertex < vertexCount; vertex++)
+	{
+		adjacencyStart[vertex + 1] = adjacencyStart[vertex] + remaining[vertex];
+	}
+
+	std::vector<uint32_t> adjacency(triangleCount * 3);
+	{
+		std::vector<uint32_t> next(adjacencyStart.begin(), adjacencyStart.end() - 1);
+		for (uint32_t i = 0; i < triangleCount * 3; i++)
+		{
+			adjacency[next[indices[i]]++] = i / 3;
+		}
+	}
+
+	std::vector<int32_t> cachePosition(vertexCount, -1);
+	std::vector<float> vertexScores(vertexCount);
+	for (size_t vertex = 0; vertex < vertexCount; vertex++)
+	{
+		vertexScores[vertex] = VertexScore(tables, -1, remaining[vertex]);
+	}
+
+	std::vector<float> triangleScores(triangleCount);
+	for (uint32_t triangle = 0; triangle < triangleCount; triangle++)
+	{
+		triangleScores[triangle] = vertexScores[indices[triangle * 3]] + vertexScores[indices[triangle * 3 + 1]] + vertexScores[indices[triangle * 3 + 2]];
+	}
+
+	std::vector<uint8_t> drawn(triangleCount, 0);
+	std::vector<uint32_t> result;
+	result.reserve(triangleCount * 3);
+
+	// Room for the whole cache plus the 3 vertices pushed on the front before the end falls off.
+	uint32_t cache[kForsythCacheSize + 3];
+	uint32_t newCache[kForsythCacheSize + 3];
+	uint32_t cacheCount = 0;
+	uint32_t nextUndrawn = 0;
+	uint32_t best = UINT32_MAX;
+
+	for (uint32_t drawnCount = 0; drawnCount < triangleCount; drawnCount++)
+	{
+		// Nothing in the cache has anything left to draw, so carry on in the order the triangles came in.
+		if (best == UINT32_MAX)
+		{
+			while (drawn[nextUndrawn])
+			{
+				nextUndrawn++;
+			}
+			best = nextUndrawn;
+		}
+
+		drawn[best] = 1;
+		const uint32_t* corners = &indices[best * 3];
+		result.insert(result.end(), corners, corners + 3);
+
+		uint32_t newCount = 0;
+		for (int corner = 0; corner < 3; corner++)
+		{
+			uint32_t vertex = corners[corner];
+
+			uint32_t first = adjacencyStart[vertex];
+			uint32_t last = first + remaining[vertex] - 1;
+			for (uint32_t j = first; j <= last; j++)
+			{
+				if (adjacency[j] == best)
+				{
+					std::swap(adjacency[j], adjacency[last]);
+					break;
+				}
+			}
+			remaining[vertex]--;
+
+			newCache[newCount++] = vertex;
+		}
+
+		for (uint32_t i = 0; i < cacheCount; i++)
+		{
+			if (cache[i] != corners[0] && cache[i] != corners[1] && cache[i] != corners[2])
+			{
+				newCache[newCount++] = cache[i];
+			}
+		}
+
+		// Whatever falls off the end loses its cache score, and everything still in it gets a new one.
+		for (uint32_t i = 0; i < newCount; i++)
+		{
+			uint32_t vertex = newCache[i];
+			cachePosition[vertex] = i < kForsythCacheSize ? static_cast<int32_t>(i) : -1;
+			vertexScores[vertex] = VertexScore(tables, cachePosition[vertex], remaining[vertex]);
+		}
+
+		cacheCount = std::min(newCount, kForsythCacheSize);
+		std::memcpy(cache, newCache, sizeof(uint32_t) * cacheCount);
+
+		// Only the triangles round the changed vertices can have a new score, and only the ones round the cache are candidates.
+		best = UINT32_MAX;
+		float bestScore = -1.0f;
+		for (uint32_t i = 0; i < newCount; i++)
+		{
+			uint32_t vertex = newCache[i];
+			for (uint32_t j = adjacencyStart[vertex]; j < adjacencyStart[vertex] + remaining[vertex]; j++)
+			{
+				uint32_t triangle = adjacency[j];
+				const uint32_t* triangleCorners = &indices[triangle * 3];
+				triangleScores[triangle] = vertexScores[triangleCorners[0]] + vertexScores[triangleCorners[1]] + vertexScores[triangleCorners[2]];
+
+				if (i < cacheCount && triangleScores[triangle] > bestScore)
+				{
+					bestScore = triangleScores[triangle];
+					best = triangle;
+				}
+			}
+		}
+	}
+
+	indices.swap(result);
+}
+
+void MeshOptimiser::OptimiseVertexFetch(std::vector<uint32_t>& indices, size_t vertexCount, std::vector<uint32_t>& vertexOrder)
+{
+	std::vector<uint32_t> newIndex(vertexCount, UINT32_MAX);
+	vertexOrder.clear();
+	vertexOrder.reserve(vertexCount);
+
+	for (uint32_t& index : indices)
+	{
+		if (newIndex[index] == UINT32_MAX)
+		{
+			newIndex[index] = static_cast<uint32_t>(vertexOrder.size());
+			vertexOrder.push_back(index);
+		}
+		index = newIndex[index];
+	}
+
+	for (size_t vertex = 0; vertex < vertexCount; vertex++)
+	{
+		if (newIndex[vertex] == UINT32_MAX)
+		{
+			vertexOrder.push_back(static_cast<uint32_t>(vertex));
+		}
+	}
+}
+#pragma endregion
+
+#pragma region Analysis Methods
+MeshLocality MeshOptimiser::Analyse(const std::vector<uint32_t>& indices, size_t vertexCount, size_t vertexStride)
+{
+	MeshLocality locality;
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+	{
+		return locality;
+	}
+
+	// A vertex is in the FIFO if fewer than its size misses have happened since it went in.
+	std::vector<uint64_t> insertedAt(vertexCount, 0);
+	std::vector<uint8_t> used(vertexCount, 0);
+	uint64_t timestamp = kReportCacheSize + 1;
+	uint64_t misses = 0;
+
+	// The fetch cache is a tiny LRU of lines, the line and when it was last touched.
+	uint64_t lines[kFetchCacheLines];
+	uint64_t lastUsed[kFetchCacheLines] = {};
+	std::fill(lines, lines + kFetchCacheLines, UINT64_MAX);
+	uint64_t fetchClock = 0;
+	uint64_t bytesFetched = 0;
+
+	for (size_t i = 0; i < triangleCount * 3; i++)
+	{
+		uint32_t vertex = indices[i];
+		used[vertex] = 1;
+
+		if (timestamp - insertedAt[vertex] <= kReportCacheSize)
+		{
+			continue;
+		}
+
+		insertedAt[vertex] = timestamp++;
+		misses++;
+
+		// A miss means the vertex gets read, which is however many lines it straddles.
+		uint64_t firstLine = vertex * vertexStride / kFetchLineBytes;
+		uint64_t lastLine = ((vertex + 1) * vertexStride - 1) / kFetchLineBytes;
+		for (uint64_t line = firstLine; line <= lastLine; line++)
+		{
+			uint32_t slot = 0;
+			for (uint32_t j = 0; j < kFetchCacheLines; j++)
+			{
+				if (lines[j] == line)
+				{
+					slot = j;
+					break;
+				}
+				slot = lastUsed[j] < lastUsed[slot] ? j : slot;
+			}
+
+			if (lines[slot] != line)
+			{
+				lines[slot] = line;
+				bytesFetched += kFetchLineBytes;
+			}
+			lastUsed[slot] = ++fetchClock;
+		}
+	}
+
+	size_t usedCount = 0;
+	for (uint8_t isUsed : used)
+	{
+		usedCount += isUsed;
+	}
+
+	locality.acmr = static_cast<float>(misses) / triangleCount;
+	locality.atvr = static_cast<float>(misses) / usedCount;
+	locality.overfetch = static_cast<float>(bytesFetched) / (usedCount * vertexStride);
+	locality.bytesPerTriangle = static_cast<float>(bytesFetched) / triangleCount;
+	return locality;
+}
+#pragma endregion
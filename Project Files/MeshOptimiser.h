@@ -0,0 +1,86 @@
+#pragma once
+
+#pragma region Includes
+//Include{s}
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "RayKernels.h"
+#pragma endregion
+
+// No Windows headers, vertices are just so many bytes each in here, so it runs (and gets benchmarked) anywhere.
+
+#pragma region Data Structures
+/// <summary>
+/// How well an index buffer's order suits the hardware, from running it through a simulated vertex cache and memory.
+/// </summary>
+struct MeshLocality
+{
+	float acmr = 0.0f; // Average cache miss ratio, vertices fetched per triangle. 3 is every corner missing, 0.5 is about the best there is
+	float atvr = 0.0f; // Average transformed vertex ratio, vertices fetched per vertex the mesh uses. 1 is perfect
+	float overfetch = 0.0f; // Bytes read through the cache lines per byte of vertices the mesh uses. 1 is perfect
+	float bytesPerTriangle = 0.0f; // Bytes read through the cache lines per triangle, which is what welding brings down
+};
+#pragma endregion
+
+/// <summary>
+/// The MeshOptimiser class. Reorders a mesh for locality without changing what it looks like. Identical vertices get welded
+/// (the OBJ loader gives every corner its own), the triangles get sorted along a Morton curve so neighbours in space are
+/// neighbours in the buffer, then Tom Forsyth's linear speed vertex cache optimisation orders them for reuse, and finally
+/// the vertices are renumbered in the order they're first used so the fetches walk forward through memory.
+/// </summary>
+class MeshOptimiser
+{
+public:
+	// The FIFO the ACMR is measured with, the usual size to quote so the numbers compare with everyone else's.
+	static const uint32_t kReportCacheSize = 16;
+
+	// The cache lines vertex fetches go through, and how many of them the fetch simulation keeps.
+	static const uint32_t kFetchLineBytes = 64;
+	static const uint32_t kFetchCacheLines = 64;
+
+#pragma region Optimisation Methods
+	/// <summary>
+	/// Runs every pass in order.
+	/// </summary>
+	/// <param name="mesh">The positions (one per vertex) and indices as they were loaded.</param>
+	/// <param name="vertices">The whole vertices, which have to match byte for byte to be welded.</param>
+	/// <param name="vertexStride">How many bytes a vertex is.</param>
+	/// <param name="vertexOrder">Which of the loaded vertices each optimised vertex is.</param>
+	/// <param name="indices">The optimised indices, into the optimised vertices.</param>
+	static void Optimise(const TriangleMesh& mesh, const void* vertices, size_t vertexStride,
+		std::vector<uint32_t>& vertexOrder, std::vector<uint32_t>& indices);
+
+	/// <summary>
+	/// Finds the vertices that are byte for byte the same.
+	/// </summary>
+	/// <param name="remap">The welded vertex each vertex becomes, numbered in the order they first turn up.</param>
+	/// <returns>How many vertices are left.</returns>
+	static size_t WeldVertices(const void* vertices, size_t vertexCount, size_t vertexStride, std::vector<uint32_t>& remap);
+
+	/// <summary>
+	/// Sorts the triangles by the Morton code of their centres, within the bounds of the mesh.
+	/// </summary>
+	static void SortTrianglesMorton(const std::vector<RayVec3>& positions, std::vector<uint32_t>& indices);
+
+	/// <summary>
+	/// Forsyth's greedy ordering, each triangle picked for how many of its vertices are still in the cache and how few other
+	/// triangles they have left. When nothing in the cache has anything left, it carries on from the next triangle in the
+	/// order it was given, so a Morton sort beforehand still decides where it goes next.
+	/// </summary>
+	static void OptimiseVertexCache(std::vector<uint32_t>& indices, size_t vertexCount);
+
+	/// <summary>
+	/// Renumbers the vertices in the order the indices first use them. Vertices nothing uses go on the end.
+	/// </summary>
+	/// <param name="vertexOrder">The old vertex each new vertex is.</param>
+	static void OptimiseVertexFetch(std::vector<uint32_t>& indices, size_t vertexCount, std::vector<uint32_t>& vertexOrder);
+#pragma endregion
+
+#pragma region Analysis Methods
+	/// <summary>
+	/// Measures an index buffer against a kReportCacheSize FIFO and kFetchCacheLines of kFetchLineBytes.
+	/// </summary>
+	static MeshLocality Analyse(const std::vector<uint32_t>& indices, size_t vertexCount, size_t vertexStride);
+#pragma endregion
+};
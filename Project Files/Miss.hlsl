@@ -11,9 +11,10 @@ cbuffer CameraParams : register(b0)
     float4x4 projectionI;
     float rX;
     float rY;
-    float2 padding;
+    float2 tileOffset; // Where this dispatch starts in the output, for tile renders
     float transMode;
-    float3 morePadding;
+    float2 frameSize; // The whole output's size, which isn't the dispatch's when it's a tile
+    float pixelSpreadAngle; // How fast a primary ray's cone widens, one pixel's worth of angle
 
 }
 #pragma endregion
@@ -23,8 +24,10 @@ cbuffer CameraParams : register(b0)
 [shader("miss")]
 void Miss(inout HitInfo payload : SV_RayPayload)
 {
-    uint2 launchIndex = DispatchRaysIndex().xy;
-    float2 dims = float2(DispatchRaysDimensions().xy);
+    CountRays(RAY_COUNTER_MISS, 1);
+
+    uint2 launchIndex = DispatchRaysIndex().xy + uint2(tileOffset);
+    float2 dims = frameSize;
     float2 d = (((launchIndex.xy + 0.5f) / dims.xy) * 2.f - 1.f);
 
     float4 target = mul(projectionI, float4(d.x, -d.y, 1, 1));
@@ -73,6 +76,7 @@ void Miss(inout HitInfo payload : SV_RayPayload)
 [shader("miss")]
 void ShadowMiss(inout ShadowHitInfo payload : SV_RayPayload)
 {
+    CountRays(RAY_COUNTER_MISS, 1);
     payload.isHit = false;
 }
 #pragma endregion
\ No newline at end of file
@@ -218,48 +218,12 @@ MeshData OBJLoader::Load(char* filename, ID3D12Device* _pd3dDevice, bool invertT
 				indicesArray[i] = meshIndices[i];
 			}
 
-			// VERTEX BUFFER ------------------------------------------------------------------------------------------
-			int s = sizeof(SimpleVertex);
-			const UINT vertexBufferSize = sizeof(SimpleVertex) * meshVertices.size();
-			meshData.VertexCount = meshVertices.size();
-			//ComPtr<ID3D12Resource> m_cubeVertexBuffer;
-
-			// Note: using upload heaps to transfer static data like vert buffers is not
-			// recommended. Every time the GPU needs it, the upload heap will be
-			// marshalled over. Please read up on Default Heap usage. An upload heap is
-			// used here for code simplicity and because there are very few verts to
-			// actually transfer.
-			ThrowIfFailed(_pd3dDevice->CreateCommittedResource(
-				&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD), D3D12_HEAP_FLAG_NONE,
-				&CD3DX12_RESOURCE_DESC::Buffer(vertexBufferSize),
-				D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
-				IID_PPV_ARGS(&meshData.VertexBuffer)));
-
-			// Copy the triangle data to the vertex buffer.
-			UINT8* pVertexDataBegin;
-			CD3DX12_RANGE readRange(0, 0); // We do not intend to read from this resource on the CPU.
-			ThrowIfFailed(meshData.VertexBuffer->Map(0, &readRange, reinterpret_cast<void**>(&pVertexDataBegin)));
-			memcpy(pVertexDataBegin, finalVerts, vertexBufferSize);
-			meshData.VertexBuffer->Unmap(0, nullptr);
-
-			// INDEX BUFFER ------------------------------------------------------------------------------------------
-
-			const UINT indexBufferSize = sizeof(unsigned int) * numMeshIndices;
-			meshData.IndexCount = numMeshIndices;
-
-			CD3DX12_HEAP_PROPERTIES heapProperty = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-			CD3DX12_RESOURCE_DESC bufferResource = CD3DX12_RESOURCE_DESC::Buffer(indexBufferSize);
-			ThrowIfFailed(_pd3dDevice->CreateCommittedResource(
-				&heapProperty, D3D12_HEAP_FLAG_NONE, &bufferResource, //
-				D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&meshData.IndexBuffer)));
+			// The GPU copy is made later on, when every mesh gets packed into the geometry pools.
+			meshData.VertexCount = numMeshVertices;
+			meshData.Vertices.assign(finalVerts, finalVerts + numMeshVertices);
 
-			// Copy the triangle data to the index buffer.
-			//CD3DX12_RANGE readRange(0, 0); // We do not intend to read from this resource on the CPU.
-
-			UINT8* pIndexDataBegin;
-			ThrowIfFailed(meshData.IndexBuffer->Map(0, &readRange, reinterpret_cast<void**>(&pIndexDataBegin)));
-			memcpy(pIndexDataBegin, indicesArray, indexBufferSize);
-			meshData.IndexBuffer->Unmap(0, nullptr);
+			meshData.IndexCount = numMeshIndices;
+			meshData.Indices.assign(indicesArray, indicesArray + numMeshIndices);
 
 			delete[] indicesArray;
 			delete[] finalVerts;
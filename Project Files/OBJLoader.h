@@ -15,16 +15,6 @@
 using namespace DirectX;
 using Microsoft::WRL::ComPtr;
 
-struct MeshData
-{
-	ComPtr<ID3D12Resource> VertexBuffer;
-	ComPtr<ID3D12Resource> IndexBuffer;
-	UINT VBStride;
-	UINT VBOffset;
-	UINT IndexCount;
-	UINT VertexCount;
-};
-
 struct SimpleVertex
 {
 	XMFLOAT3 Pos;
@@ -37,6 +27,16 @@ struct SimpleVertex
 	};
 };
 
+struct MeshData
+{
+	std::vector<SimpleVertex> Vertices;
+	std::vector<UINT> Indices;
+	UINT VBStride;
+	UINT VBOffset;
+	UINT IndexCount;
+	UINT VertexCount;
+};
+
 namespace OBJLoader
 {
 	//The only method you'll need to call
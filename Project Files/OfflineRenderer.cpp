@@ -0,0 +1,172 @@
+#include "stdafx.h"
+
+#pragma region Includes
+//Include{s}
+#include "OfflineRenderer.h"
+#include <algorithm>
+#include <fstream>
+#include <wincodec.h>
+#pragma endregion
+
+#pragma region Constructors and Destructors
+OfflineRenderer::OfflineRenderer(ComPtr<ID3D12Device5> device, ComPtr<ID3D12Resource> outputResource, uint32_t frameSlots, uint32_t frameCount,
+	const std::string& outputPrefix)
+	: m_readback(device, outputResource, frameSlots, L"Offline Render Readback"), m_writer(&OfflineRenderer::EncodePng, 4)
+{
+	m_frameCount = frameCount;
+	m_outputPrefix = outputPrefix;
+
+	m_pending.assign(frameSlots, false);
+	m_pendingFrames.assign(frameSlots, 0);
+	m_pendingRenderMs.assign(frameSlots, 0.0);
+}
+#pragma endregion
+
+#pragma region Frame Methods
+void OfflineRenderer::CollectFrame(uint32_t slot)
+{
+	if (!m_pending[slot])
+	{
+		return;
+	}
+
+	ImageWriteJob job;
+	job.frame = m_pendingFrames[slot];
+	job.width = m_readback.GetWidth();
+	job.height = m_readback.GetHeight();
+	job.renderMs = m_pendingRenderMs[slot];
+
+	char frameName[32];
+	snprintf(frameName, sizeof(frameName), "_%05u.png", m_pendingFrames[slot]);
+	job.path = m_outputPrefix + frameName;
+
+	m_readback.Read(slot, job.pixels);
+	m_pending[slot] = false;
+	m_framesCollected++;
+
+	// Blocks if the writer's a few frames behind, which keeps memory bounded on long runs.
+	m_writer.Submit(std::move(job));
+}
+
+void OfflineRenderer::RecordCapture(ID3D12GraphicsCommandList* commandList, uint32_t slot, double renderMs)
+{
+	if (m_framesRecorded >= m_frameCount)
+	{
+		return;
+	}
+
+	m_readback.RecordCopy(commandList, slot);
+
+	m_pending[slot] = true;
+	m_pendingFrames[slot] = m_framesRecorded++;
+	m_pendingRenderMs[slot] = renderMs;
+}
+
+bool OfflineRenderer::Finish(const std::string& timingsPath)
+{
+	m_writer.Flush();
+
+	std::vector<ImageWriteResult> results = m_writer.TakeResults();
+	m_results.insert(m_results.end(), results.begin(), results.end());
+
+	std::ofstream file(timingsPath, std::ios::trunc);
+	if (!file)
+	{
+		return false;
+	}
+
+	bool allWritten = true;
+	file << "frame,path,render_ms,encode_ms,written\n";
+	for (const ImageWriteResult& result : m_results)
+	{
+		file << result.frame << ',' << result.path << ',' << result.renderMs << ',' << result.encodeMs << ',' << (result.succeeded ? 1 : 0) << '\n';
+		allWritten = allWritten && result.succeeded;
+	}
+
+	return allWritten && static_cast<bool>(file);
+}
+#pragma endregion
+
+#pragma region Encoder Methods
+bool OfflineRenderer::EncodePng(const std::string& path, uint32_t width, uint32_t height, const uint8_t* pixels)
+{
+	// COM is per thread, and this runs on the writer's, so it gets its own factory.
+	static thread_local ComPtr<IWICImagingFactory> wicFactory;
+	if (wicFactory == nullptr)
+	{
+		HRESULT hr = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+		if (FAILED(hr) && hr != RPC_E_CHANGED_MODE) return false;
+
+		hr = CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&wicFactory));
+		if (FAILED(hr)) return false;
+	}
+
+	std::wstring widePath(path.begin(), path.end());
+
+	ComPtr<IWICStream> stream;
+	ComPtr<IWICBitmapEncoder> encoder;
+	ComPtr<IWICBitmapFrameEncode> frame;
+	if (FAILED(wicFactory->CreateStream(&stream))) return false;
+	if (FAILED(stream->InitializeFromFilename(widePath.c_str(), GENERIC_WRITE))) return false;
+	if (FAILED(wicFactory->CreateEncoder(GUID_ContainerFormatPng, nullptr, &encoder))) return false;
+	if (FAILED(encoder->Initialize(stream.Get(), WICBitmapEncoderNoCache))) return false;
+	if (FAILED(encoder->CreateNewFrame(&frame, nullptr))) return false;
+	if (FAILED(frame->Initialize(nullptr))) return false;
+	if (FAILED(frame->SetSize(width, height))) return false;
+
+	// The encoder can swap the format for one it likes better, BGRA is the one it'll pick if it doesn't take RGBA.
+	WICPixelFormatGUID format = GUID_WICPixelFormat32bppRGBA;
+	if (FAILED(frame->SetPixelFormat(&format))) return false;
+
+	UINT stride = width * 4;
+	UINT imageBytes = stride * height;
+	std::vector<uint8_t> swizzled;
+	const uint8_t* source = pixels;
+
+	if (IsEqualGUID(format, GUID_WICPixelFormat32bppBGRA))
+	{
+		swizzled.assign(pixels, pixels + imageBytes);
+		for (UINT i = 0; i < imageBytes; i += 4)
+		{
+			std::swap(swizzled[i], swizzled[i + 2]);
+		}
+		source = swizzled.data();
+	}
+	else if (!IsEqualGUID(format, GUID_WICPixelFormat32bppRGBA))
+	{
+		return false;
+	}
+
+	if (FAILED(frame->WritePixels(height, stride, imageBytes, const_cast<BYTE*>(source)))) return false;
+	if (FAILED(frame->Commit())) return false;
+	return SUCCEEDED(encoder->Commit());
+}
+
+bool OfflineRenderer::DecodePng(const std::string& path, uint32_t& width, uint32_t& height, std::vector<uint8_t>& pixels)
+{
+	// The texture loader has probably started COM on this thread already, this is fine either way.
+	HRESULT hr = CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED);
+	if (FAILED(hr) && hr != RPC_E_CHANGED_MODE) return false;
+
+	ComPtr<IWICImagingFactory> wicFactory;
+	if (FAILED(CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&wicFactory)))) return false;
+
+	std::wstring widePath(path.begin(), path.end());
+
+	ComPtr<IWICBitmapDecoder> decoder;
+	ComPtr<IWICBitmapFrameDecode> frame;
+	ComPtr<IWICFormatConverter> converter;
+	if (FAILED(wicFactory->CreateDecoderFromFilename(widePath.c_str(), nullptr, GENERIC_READ, WICDecodeMetadataCacheOnDemand, &decoder))) return false;
+	if (FAILED(decoder->GetFrame(0, &frame))) return false;
+	if (FAILED(frame->GetSize(&width, &height))) return false;
+
+	// Whatever it was saved as, it comes out the same layout as the renders.
+	if (FAILED(wicFactory->CreateFormatConverter(&converter))) return false;
+	if (FAILED(converter->Initialize(frame.Get(), GUID_WICPixelFormat32bppRGBA, WICBitmapDitherTypeNone, nullptr, 0.0,
+		WICBitmapPaletteTypeCustom))) return false;
+
+	UINT stride = width * 4;
+	pixels.resize(static_cast<size_t>(stride) * height);
+	return SUCCEEDED(converter->CopyPixels(nullptr, stride, static_cast<UINT>(pixels.size()), pixels.data()));
+}
+#pragma endregion
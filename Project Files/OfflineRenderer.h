@@ -0,0 +1,88 @@
+#pragma once
+
+#pragma region Includes
+//Include{s}
+#include "AsyncImageWriter.h"
+#include "FrameReadback.h"
+#pragma endregion
+
+/// <summary>
+/// The OfflineRenderer class. Copies the raytracing output of a set number of frames back to the CPU and writes them out as PNGs.
+/// Each frame slot has its own part of the readback buffer, read once the pacer hands the slot back, so the GPU never waits on it,
+/// and the encoding happens on the writer's thread, so it overlaps the next frames rendering.
+/// </summary>
+class OfflineRenderer
+{
+public:
+#pragma region Constructors and Destructors
+	/// <summary>
+	/// Initializes a new instance of the OfflineRenderer class.
+	/// </summary>
+	/// <param name="device">The device to make the readback buffer on.</param>
+	/// <param name="outputResource">The raytracing output, frames are copied out of it.</param>
+	/// <param name="frameSlots">How many frames can be in flight.</param>
+	/// <param name="frameCount">How many frames to write.</param>
+	/// <param name="outputPrefix">What the files are called, the frame number and .png go on the end.</param>
+	OfflineRenderer(ComPtr<ID3D12Device5> device, ComPtr<ID3D12Resource> outputResource, uint32_t frameSlots, uint32_t frameCount,
+		const std::string& outputPrefix);
+#pragma endregion
+
+#pragma region Frame Methods
+	/// <summary>
+	/// Picks up the frame the slot copied out last time round and queues it for writing. Call it once the pacer has the slot.
+	/// </summary>
+	void CollectFrame(uint32_t slot);
+
+	/// <summary>
+	/// Copies this frame's output into the slot's part of the readback buffer, if there are still frames to capture.
+	/// The output has to be a copy source already.
+	/// </summary>
+	/// <param name="renderMs">How long the frame took, written next to its encode time.</param>
+	void RecordCapture(ID3D12GraphicsCommandList* commandList, uint32_t slot, double renderMs);
+
+	/// <summary>
+	/// Whether every frame has been read back and handed to the writer.
+	/// </summary>
+	bool IsFinished() const { return m_framesCollected >= m_frameCount; }
+
+	/// <summary>
+	/// Waits for the writer, then writes every frame's render and encode times to a CSV.
+	/// </summary>
+	/// <returns>False if a frame or the CSV couldn't be written.</returns>
+	bool Finish(const std::string& timingsPath);
+
+	uint32_t GetFrameCount() const { return m_frameCount; }
+	uint32_t GetFramesRecorded() const { return m_framesRecorded; }
+	uint32_t GetFramesCollected() const { return m_framesCollected; }
+#pragma endregion
+
+#pragma region Encoder Methods
+	/// <summary>
+	/// Writes a PNG through WIC. Safe to call from the writer's thread.
+	/// </summary>
+	static bool EncodePng(const std::string& path, uint32_t width, uint32_t height, const uint8_t* pixels);
+
+	/// <summary>
+	/// Reads a PNG (or anything else WIC knows) as tightly packed RGBA8.
+	/// </summary>
+	/// <returns>False if it isn't there or couldn't be read.</returns>
+	static bool DecodePng(const std::string& path, uint32_t& width, uint32_t& height, std::vector<uint8_t>& pixels);
+#pragma endregion
+
+private:
+#pragma region Private Variables
+	FrameReadback m_readback;
+
+	std::vector<bool> m_pending;
+	std::vector<uint32_t> m_pendingFrames;
+	std::vector<double> m_pendingRenderMs;
+
+	uint32_t m_frameCount;
+	uint32_t m_framesRecorded = 0;
+	uint32_t m_framesCollected = 0;
+	std::string m_outputPrefix;
+	std::vector<ImageWriteResult> m_results;
+
+	AsyncImageWriter m_writer;
+#pragma endregion
+};
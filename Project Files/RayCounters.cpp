@@ -0,0 +1,80 @@
+#pragma region Includes
+//Include{s}
+#include "RayCounters.h"
+#pragma endregion
+
+#pragma region Constructors and Destructors
+RayRateTracker::RayRateTracker(size_t windowFrames)
+{
+	m_windowFrames = windowFrames > 0 ? windowFrames : 1;
+}
+#pragma endregion
+
+#pragma region Tracking Methods
+void RayRateTracker::AddFrame(uint64_t frame, double seconds, const uint32_t counts[RAY_COUNTER_COUNT])
+{
+	RayCounterSample sample;
+	sample.frame = frame;
+	sample.seconds = seconds;
+
+	for (int type = 0; type < RAY_COUNTER_COUNT; type++)
+	{
+		sample.counts[type] = counts[type];
+		m_lifetimeCounts[type] += counts[type];
+	}
+
+	m_samples.push_back(sample);
+	while (m_samples.size() > m_windowFrames)
+	{
+		m_samples.pop_front();
+	}
+}
+
+void RayRateTracker::Clear()
+{
+	m_samples.clear();
+
+	for (int type = 0; type < RAY_COUNTER_COUNT; type++)
+	{
+		m_lifetimeCounts[type] = 0;
+	}
+}
+#pragma endregion
+
+#pragma region Getters
+double RayRateTracker::GetRaysPerSecond(RayCounterType type) const
+{
+	double seconds = 0.0;
+	uint64_t rays = 0;
+
+	for (const RayCounterSample& sample : m_samples)
+	{
+		seconds += sample.seconds;
+		rays += sample.counts[type];
+	}
+
+	return seconds > 0.0 ? rays / seconds : 0.0;
+}
+
+double RayRateTracker::GetTotalRaysPerSecond() const
+{
+	return GetRaysPerSecond(RAY_COUNTER_PRIMARY) + GetRaysPerSecond(RAY_COUNTER_SHADOW) + GetRaysPerSecond(RAY_COUNTER_REFLECTION);
+}
+
+RayCounterSample RayRateTracker::GetLatest() const
+{
+	return m_samples.empty() ? RayCounterSample() : m_samples.back();
+}
+
+const char* RayRateTracker::GetCounterName(RayCounterType type)
+{
+	switch (type)
+	{
+	case RAY_COUNTER_PRIMARY: return "Primary";
+	case RAY_COUNTER_SHADOW: return "Shadow";
+	case RAY_COUNTER_REFLECTION: return "Reflection";
+	case RAY_COUNTER_MISS: return "Miss";
+	default: return "Unknown";
+	}
+}
+#pragma endregion
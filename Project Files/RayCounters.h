@@ -0,0 +1,95 @@
+#pragma once
+
+#pragma region Includes
+//Include{s}
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#pragma endregion
+
+// No Windows headers, the counts come off the GPU already and this just turns them into rates.
+
+#pragma region Data Structures
+/// <summary>
+/// The kinds of ray the shaders count, in the order they sit in the counter buffer.
+/// IMPORTANT - the hlsl version of these is the RAY_COUNTER_* byte offsets in Common.hlsl
+/// </summary>
+enum RayCounterType
+{
+	RAY_COUNTER_PRIMARY,
+	RAY_COUNTER_SHADOW,
+	RAY_COUNTER_REFLECTION,
+	RAY_COUNTER_MISS, // Any ray that missed, so these are also counted in their own type
+	RAY_COUNTER_COUNT,
+};
+
+/// <summary>
+/// One frame's ray counts.
+/// </summary>
+struct RayCounterSample
+{
+	uint64_t frame = 0;
+	double seconds = 0.0; // How long the frame took
+	uint64_t counts[RAY_COUNTER_COUNT] = {};
+};
+#pragma endregion
+
+/// <summary>
+/// The RayRateTracker class. Keeps the last few frames' ray counts and works out rays per second over them.
+/// </summary>
+class RayRateTracker
+{
+public:
+#pragma region Constructors and Destructors
+	/// <summary>
+	/// Initializes a new instance of the RayRateTracker class.
+	/// </summary>
+	/// <param name="windowFrames">How many frames the rates are averaged over.</param>
+	RayRateTracker(size_t windowFrames = 60);
+#pragma endregion
+
+#pragma region Tracking Methods
+	/// <summary>
+	/// Adds a frame's counts.
+	/// </summary>
+	/// <param name="frame">The frame the counts are from.</param>
+	/// <param name="seconds">How long that frame took.</param>
+	/// <param name="counts">One count per RayCounterType.</param>
+	void AddFrame(uint64_t frame, double seconds, const uint32_t counts[RAY_COUNTER_COUNT]);
+
+	void Clear();
+#pragma endregion
+
+#pragma region Getters
+	/// <summary>
+	/// Gets rays per second of one type over the window.
+	/// </summary>
+	double GetRaysPerSecond(RayCounterType type) const;
+
+	/// <summary>
+	/// Gets rays per second of every type over the window. Misses aren't added, they're already counted in their own type.
+	/// </summary>
+	double GetTotalRaysPerSecond() const;
+
+	/// <summary>
+	/// Gets the newest frame's counts, all zero if there isn't one yet.
+	/// </summary>
+	RayCounterSample GetLatest() const;
+
+	/// <summary>
+	/// Gets every kind of ray traced since the tracker was made or cleared.
+	/// </summary>
+	uint64_t GetLifetimeCount(RayCounterType type) const { return m_lifetimeCounts[type]; }
+
+	size_t GetSampleCount() const { return m_samples.size(); }
+
+	static const char* GetCounterName(RayCounterType type);
+#pragma endregion
+
+private:
+#pragma region Private Variables
+	size_t m_windowFrames;
+	std::deque<RayCounterSample> m_samples;
+	uint64_t m_lifetimeCounts[RAY_COUNTER_COUNT] = {};
+#pragma endregion
+};
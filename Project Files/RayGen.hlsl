@@ -18,9 +18,10 @@ cbuffer CameraParams : register(b0)
 	float4x4 projectionI;
 	float rX;
 	float rY;
-	float2 padding;
+	float2 tileOffset; // Where this dispatch starts in the output, for tile renders
 	float transMode;
-	float3 morePadding;
+	float2 frameSize; // The whole output's size, which isn't the dispatch's when it's a tile
+	float pixelSpreadAngle; // How fast a primary ray's cone widens, one pixel's worth of angle
 
 }
 #pragma endregion
@@ -32,11 +33,13 @@ cbuffer CameraParams : register(b0)
 
 	payload.colorAndDistance = float4(0, 0, 0, 0);
 	payload.recursiveDepth = 0;
+	payload.cone = float2(0, pixelSpreadAngle); // A camera ray's cone starts as a point at the eye
 
   // Get the location within the dispatched 2D grid of work items
   // (often maps to pixels, so this could represent a pixel coordinate).
-  uint2 launchIndex = DispatchRaysIndex().xy;
-  float2 dims = float2(DispatchRaysDimensions().xy);
+  // The dispatch might only be a tile of the frame, so offset it back to where it sits in the whole output.
+  uint2 launchIndex = DispatchRaysIndex().xy + uint2(tileOffset);
+  float2 dims = frameSize;
   float2 d = (((launchIndex.xy + 0.5f) / dims.xy) * 2.f - 1.f);
   // Define a ray, consisting of origin, direction, and the min-max distance
   // values
@@ -48,7 +51,10 @@ cbuffer CameraParams : register(b0)
   ray.TMin = 0;
   ray.TMax = 100000;
 
-	if ((launchIndex.x % rX == 0) && (launchIndex.y % rY == 0))
+	bool traced = (launchIndex.x % rX == 0) && (launchIndex.y % rY == 0);
+	CountRays(RAY_COUNTER_PRIMARY, traced ? 1 : 0);
+
+	if (traced)
 	{
   // Trace the ray
 		TraceRay(
@@ -62,9 +68,9 @@ cbuffer CameraParams : register(b0)
 
 	  // Parameter name: InstanceInclusionMask
 	  // Instance inclusion mask, which can be used to mask out some geometry to
-	  // this ray by and-ing the mask with a geometry mask. The 0xFF flag then
-	  // indicates no geometry will be masked
-	  0xFF,
+	  // this ray by and-ing the mask with a geometry mask. Camera rays only see
+	  // the objects that are visible to the camera
+	  INSTANCE_MASK_CAMERA,
 
 	  // Parameter name: RayContributionToHitGroupIndex
 	  // Depending on the type of ray, a given object can have several hit
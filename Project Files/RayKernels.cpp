@@ -0,0 +1,498 @@
+#pragma region Includes
+//Include{s}
+#include "RayKernels.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#pragma endregion
+
+// MSVC lets any function use any intrinsic, GCC and Clang have to be told which ones a function is allowed.
+#if defined(_MSC_VER)
+#define RAY_KERNELS_TARGET(features)
+#else
+#define RAY_KERNELS_TARGET(features) __attribute__((target(features)))
+#endif
+
+#pragma region Vector Helpers
+namespace
+{
+	RayVec3 operator+(const RayVec3& a, const RayVec3& b) { return RayVec3(a.x + b.x, a.y + b.y, a.z + b.z); }
+	RayVec3 operator-(const RayVec3& a, const RayVec3& b) { return RayVec3(a.x - b.x, a.y - b.y, a.z - b.z); }
+	RayVec3 operator*(const RayVec3& a, float s) { return RayVec3(a.x * s, a.y * s, a.z * s); }
+	float Dot(const RayVec3& a, const RayVec3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+	RayVec3 Cross(const RayVec3& a, const RayVec3& b) { return RayVec3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x); }
+	float Saturate(float value) { return std::min(std::max(value, 0.0f), 1.0f); }
+
+	RayVec3 Normalize(const RayVec3& a)
+	{
+		float length = std::sqrt(Dot(a, a));
+		return length > 0.0f ? a * (1.0f / length) : a;
+	}
+
+	float Component(const RayVec3& a, int axis) { return axis == 0 ? a.x : axis == 1 ? a.y : a.z; }
+}
+#pragma endregion
+
+#pragma region Ray Constructors
+KernelRay::KernelRay(const RayVec3& originIn, const RayVec3& directionIn, float tMinIn, float tMaxIn)
+	: origin(originIn), direction(directionIn), tMin(tMinIn), tMax(tMaxIn)
+{
+	// A zero component gives infinity, which the slab tests are written to cope with.
+	inverseDirection = RayVec3(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+}
+
+WatertightRay::WatertightRay(const KernelRay& ray)
+{
+	origin = ray.origin;
+
+	// Line the ray up with whichever axis it's mostly along, and keep the winding the right way round.
+	RayVec3 absolute(std::fabs(ray.direction.x), std::fabs(ray.direction.y), std::fabs(ray.direction.z));
+	kz = absolute.x > absolute.y ? (absolute.x > absolute.z ? 0 : 2) : (absolute.y > absolute.z ? 1 : 2);
+	kx = (kz + 1) % 3;
+	ky = (kx + 1) % 3;
+	if (Component(ray.direction, kz) < 0.0f)
+	{
+		std::swap(kx, ky);
+	}
+
+	sx = Component(ray.direction, kx) / Component(ray.direction, kz);
+	sy = Component(ray.direction, ky) / Component(ray.direction, kz);
+	sz = 1.0f / Component(ray.direction, kz);
+}
+#pragma endregion
+
+#pragma region Intersection Kernels
+bool RayKernels::IntersectMollerTrumbore(const KernelRay& ray, const RayVec3& v0, const RayVec3& v1, const RayVec3& v2, float& t)
+{
+	RayVec3 edge1 = v1 - v0;
+	RayVec3 edge2 = v2 - v0;
+	RayVec3 p = Cross(ray.direction, edge2);
+	float determinant = Dot(edge1, p);
+
+	// No backface culling, the shaders trace with it off too.
+	if (std::fabs(determinant) < 1e-12f)
+	{
+		return false;
+	}
+
+	float inverseDeterminant = 1.0f / determinant;
+	RayVec3 s = ray.origin - v0;
+	float u = Dot(s, p) * inverseDeterminant;
+	if (u < 0.0f || u > 1.0f)
+	{
+		return false;
+	}
+
+	RayVec3 q = Cross(s, edge1);
+	float v = Dot(ray.direction, q) * inverseDeterminant;
+	if (v < 0.0f || u + v > 1.0f)
+	{
+		return false;
+	}
+
+	float hitT = Dot(edge2, q) * inverseDeterminant;
+	if (hitT < ray.tMin || hitT > ray.tMax)
+	{
+		return false;
+	}
+
+	t = hitT;
+	return true;
+}
+
+bool RayKernels::IntersectWatertight(const KernelRay& ray, const WatertightRay& shear, const RayVec3& v0, const RayVec3& v1, const RayVec3& v2, float& t)
+{
+	RayVec3 a = v0 - shear.origin;
+	RayVec3 b = v1 - shear.origin;
+	RayVec3 c = v2 - shear.origin;
+
+	float ax = Component(a, shear.kx) - shear.sx * Component(a, shear.kz);
+	float ay = Component(a, shear.ky) - shear.sy * Component(a, shear.kz);
+	float bx = Component(b, shear.kx) - shear.sx * Component(b, shear.kz);
+	float by = Component(b, shear.ky) - shear.sy * Component(b, shear.kz);
+	float cx = Component(c, shear.kx) - shear.sx * Component(c, shear.kz);
+	float cy = Component(c, shear.ky) - shear.sy * Component(c, shear.kz);
+
+	float u = cx * by - cy * bx;
+	float v = ax * cy - ay * cx;
+	float w = bx * ay - by * ax;
+
+	// Exactly on an edge in float, so do it again in double and let that decide.
+	if (u == 0.0f || v == 0.0f || w == 0.0f)
+	{
+		u = static_cast<float>(static_cast<double>(cx) * by - static_cast<double>(cy) * bx);
+		v = static_cast<float>(static_cast<double>(ax) * cy - static_cast<double>(ay) * cx);
+		w = static_cast<float>(static_cast<double>(bx) * ay - static_cast<double>(by) * ax);
+	}
+
+	if ((u < 0.0f || v < 0.0f || w < 0.0f) && (u > 0.0f || v > 0.0f || w > 0.0f))
+	{
+		return false;
+	}
+
+	float determinant = u + v + w;
+	if (determinant == 0.0f)
+	{
+		return false;
+	}
+
+	float az = shear.sz * Component(a, shear.kz);
+	float bz = shear.sz * Component(b, shear.kz);
+	float cz = shear.sz * Component(c, shear.kz);
+	float scaledT = u * az + v * bz + w * cz;
+
+	// Compare before dividing, t's only worked out if it's actually a hit.
+	float sign = determinant < 0.0f ? -1.0f : 1.0f;
+	float absoluteDeterminant = determinant * sign;
+	if (scaledT * sign < ray.tMin * absoluteDeterminant || scaledT * sign > ray.tMax * absoluteDeterminant)
+	{
+		return false;
+	}
+
+	t = scaledT / determinant;
+	return true;
+}
+
+bool RayKernels::IntersectBox(const KernelRay& ray, const KernelBox& box, float tMax)
+{
+	// Picking the near and far planes by the ray's direction means an empty box (minimum above maximum) always misses.
+	float nearX = ((ray.inverseDirection.x >= 0.0f ? box.minimum.x : box.maximum.x) - ray.origin.x) * ray.inverseDirection.x;
+	float farX = ((ray.inverseDirection.x >= 0.0f ? box.maximum.x : box.minimum.x) - ray.origin.x) * ray.inverseDirection.x;
+	float nearY = ((ray.inverseDirection.y >= 0.0f ? box.minimum.y : box.maximum.y) - ray.origin.y) * ray.inverseDirection.y;
+	float farY = ((ray.inverseDirection.y >= 0.0f ? box.maximum.y : box.minimum.y) - ray.origin.y) * ray.inverseDirection.y;
+	float nearZ = ((ray.inverseDirection.z >= 0.0f ? box.minimum.z : box.maximum.z) - ray.origin.z) * ray.inverseDirection.z;
+	float farZ = ((ray.inverseDirection.z >= 0.0f ? box.maximum.z : box.minimum.z) - ray.origin.z) * ray.inverseDirection.z;
+
+	float enter = std::max(std::max(nearX, nearY), std::max(nearZ, ray.tMin));
+	float exit = std::min(std::min(farX, farY), std::min(farZ, tMax));
+	return enter <= exit;
+}
+
+uint32_t RayKernels::IntersectBoxesSse(const KernelRay& ray, const BoxPacket& boxes, int firstBox, float tMax)
+{
+	const float* nearXs = ray.inverseDirection.x >= 0.0f ? boxes.minX : boxes.maxX;
+	const float* farXs = ray.inverseDirection.x >= 0.0f ? boxes.maxX : boxes.minX;
+	const float* nearYs = ray.inverseDirection.y >= 0.0f ? boxes.minY : boxes.maxY;
+	const float* farYs = ray.inverseDirection.y >= 0.0f ? boxes.maxY : boxes.minY;
+	const float* nearZs = ray.inverseDirection.z >= 0.0f ? boxes.minZ : boxes.maxZ;
+	const float* farZs = ray.inverseDirection.z >= 0.0f ? boxes.maxZ : boxes.minZ;
+
+	__m128 originX = _mm_set1_ps(ray.origin.x), inverseX = _mm_set1_ps(ray.inverseDirection.x);
+	__m128 originY = _mm_set1_ps(ray.origin.y), inverseY = _mm_set1_ps(ray.inverseDirection.y);
+	__m128 originZ = _mm_set1_ps(ray.origin.z), inverseZ = _mm_set1_ps(ray.inverseDirection.z);
+
+	__m128 nearX = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(nearXs + firstBox), originX), inverseX);
+	__m128 farX = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(farXs + firstBox), originX), inverseX);
+	__m128 nearY = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(nearYs + firstBox), originY), inverseY);
+	__m128 farY = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(farYs + firstBox), originY), inverseY);
+	__m128 nearZ = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(nearZs + firstBox), originZ), inverseZ);
+	__m128 farZ = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(farZs + firstBox), originZ), inverseZ);
+
+	__m128 enter = _mm_max_ps(_mm_max_ps(nearX, nearY), _mm_max_ps(nearZ, _mm_set1_ps(ray.tMin)));
+	__m128 exit = _mm_min_ps(_mm_min_ps(farX, farY), _mm_min_ps(farZ, _mm_set1_ps(tMax)));
+	return static_cast<uint32_t>(_mm_movemask_ps(_mm_cmple_ps(enter, exit)));
+}
+
+RAY_KERNELS_TARGET("avx2")
+uint32_t RayKernels::IntersectBoxesAvx2(const KernelRay& ray, const BoxPacket& boxes, int firstBox, float tMax)
+{
+	const float* nearXs = ray.inverseDirection.x >= 0.0f ? boxes.minX : boxes.maxX;
+	const float* farXs = ray.inverseDirection.x >= 0.0f ? boxes.maxX : boxes.minX;
+	const float* nearYs = ray.inverseDirection.y >= 0.0f ? boxes.minY : boxes.maxY;
+	const float* farYs = ray.inverseDirection.y >= 0.0f ? boxes.maxY : boxes.minY;
+	const float* nearZs = ray.inverseDirection.z >= 0.0f ? boxes.minZ : boxes.maxZ;
+	const float* farZs = ray.inverseDirection.z >= 0.0f ? boxes.maxZ : boxes.minZ;
+
+	__m256 originX = _mm256_set1_ps(ray.origin.x), inverseX = _mm256_set1_ps(ray.inverseDirection.x);
+	__m256 originY = _mm256_set1_ps(ray.origin.y), inverseY = _mm256_set1_ps(ray.inverseDirection.y);
+	__m256 originZ = _mm256_set1_ps(ray.origin.z), inverseZ = _mm256_set1_ps(ray.inverseDirection.z);
+
+	__m256 nearX = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(nearXs + firstBox), originX), inverseX);
+	__m256 farX = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(farXs + firstBox), originX), inverseX);
+	__m256 nearY = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(nearYs + firstBox), originY), inverseY);
+	__m256 farY = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(farYs + firstBox), originY), inverseY);
+	__m256 nearZ = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(nearZs + firstBox), originZ), inverseZ);
+	__m256 farZ = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(farZs + firstBox), originZ), inverseZ);
+
+	__m256 enter = _mm256_max_ps(_mm256_max_ps(nearX, nearY), _mm256_max_ps(nearZ, _mm256_set1_ps(ray.tMin)));
+	__m256 exit = _mm256_min_ps(_mm256_min_ps(farX, farY), _mm256_min_ps(farZ, _mm256_set1_ps(tMax)));
+	return static_cast<uint32_t>(_mm256_movemask_ps(_mm256_cmp_ps(enter, exit, _CMP_LE_OQ)));
+}
+
+RAY_KERNELS_TARGET("avx512f")
+uint32_t RayKernels::IntersectBoxesAvx512(const KernelRay& ray, const BoxPacket& boxes, float tMax)
+{
+	const float* nearXs = ray.inverseDirection.x >= 0.0f ? boxes.minX : boxes.maxX;
+	const float* farXs = ray.inverseDirection.x >= 0.0f ? boxes.maxX : boxes.minX;
+	const float* nearYs = ray.inverseDirection.y >= 0.0f ? boxes.minY : boxes.maxY;
+	const float* farYs = ray.inverseDirection.y >= 0.0f ? boxes.maxY : boxes.minY;
+	const float* nearZs = ray.inverseDirection.z >= 0.0f ? boxes.minZ : boxes.maxZ;
+	const float* farZs = ray.inverseDirection.z >= 0.0f ? boxes.maxZ : boxes.minZ;
+
+	__m512 originX = _mm512_set1_ps(ray.origin.x), inverseX = _mm512_set1_ps(ray.inverseDirection.x);
+	__m512 originY = _mm512_set1_ps(ray.origin.y), inverseY = _mm512_set1_ps(ray.inverseDirection.y);
+	__m512 originZ = _mm512_set1_ps(ray.origin.z), inverseZ = _mm512_set1_ps(ray.inverseDirection.z);
+
+	__m512 nearX = _mm512_mul_ps(_mm512_sub_ps(_mm512_loadu_ps(nearXs), originX), inverseX);
+	__m512 farX = _mm512_mul_ps(_mm512_sub_ps(_mm512_loadu_ps(farXs), originX), inverseX);
+	__m512 nearY = _mm512_mul_ps(_mm512_sub_ps(_mm512_loadu_ps(nearYs), originY), inverseY);
+	__m512 farY = _mm512_mul_ps(_mm512_sub_ps(_mm512_loadu_ps(farYs), originY), inverseY);
+	__m512 nearZ = _mm512_mul_ps(_mm512_sub_ps(_mm512_loadu_ps(nearZs), originZ), inverseZ);
+	__m512 farZ = _mm512_mul_ps(_mm512_sub_ps(_mm512_loadu_ps(farZs), originZ), inverseZ);
+
+	__m512 enter = _mm512_max_ps(_mm512_max_ps(nearX, nearY), _mm512_max_ps(nearZ, _mm512_set1_ps(ray.tMin)));
+	__m512 exit = _mm512_min_ps(_mm512_min_ps(farX, farY), _mm512_min_ps(farZ, _mm512_set1_ps(tMax)));
+	return static_cast<uint32_t>(_mm512_cmp_ps_mask(enter, exit, _CMP_LE_OQ));
+}
+
+BoxKernelLevel RayKernels::GetSupportedBoxKernel()
+{
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 1);
+	bool osSavesYmm = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 0x6) == 0x6;
+	bool osSavesZmm = osSavesYmm && (_xgetbv(0) & 0xE6) == 0xE6;
+
+	__cpuidex(info, 7, 0);
+	bool avx2 = (info[1] & (1 << 5)) != 0;
+	bool avx512 = (info[1] & (1 << 16)) != 0;
+
+	if (avx512 && osSavesZmm) return BOX_KERNEL_AVX512;
+	if (avx2 && osSavesYmm) return BOX_KERNEL_AVX2;
+#else
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f")) return BOX_KERNEL_AVX512;
+	if (__builtin_cpu_supports("avx2")) return BOX_KERNEL_AVX2;
+#endif
+	// Every x64 CPU has SSE.
+	return BOX_KERNEL_SSE;
+}
+#pragma endregion
+
+#pragma region Shading Kernels
+RayVec3 ShadingKernels::ShadeBlinnPhong(const RayVec3& albedo, const RayVec3& worldNormal, const RayVec3& lightDirection, const RayVec3& rayOrigin,
+	const RayVec3& rayDirection, const RayVec3& hitPosition, float specularPower)
+{
+	// DXRSetup's starting light.
+	const float ambientColour = 0.9f;
+	const float diffuseColour = 0.6f;
+	const float specularColour = 0.6f;
+
+	// CalculateDiffuseLighting
+	float diffuseAmount = Saturate(Dot(lightDirection, Normalize(worldNormal)));
+	float diffuseCoEfficent = Saturate(Dot(lightDirection, worldNormal));
+	RayVec3 diffuse = albedo * (diffuseAmount * diffuseCoEfficent * diffuseColour);
+
+	// CalculateAmbientLighting
+	float ambientColourMin = ambientColour - 0.1f;
+	float a = 1.0f - Saturate(Dot(worldNormal, RayVec3(0.0f, -1.0f, 0.0f)));
+	RayVec3 ambient = albedo * (ambientColourMin + (ambientColour - ambientColourMin) * a);
+
+	// CalculateSpecularLighting
+	RayVec3 viewDirection = Normalize(rayOrigin - hitPosition);
+	RayVec3 halfDirection = Normalize(lightDirection + viewDirection);
+	float specularFactor = std::pow(Saturate(Dot(worldNormal, halfDirection)), specularPower);
+	float specularCoEfficent = std::pow(Saturate(Dot(lightDirection, Normalize(rayDirection * -1.0f))), specularFactor);
+	float specular = specularFactor * specularCoEfficent * specularColour;
+
+	return diffuse + ambient + RayVec3(specular, specular, specular);
+}
+
+RayVec3 ShadingKernels::FresnelReflectanceSchlick(const RayVec3& rayDirection, const RayVec3& worldNormal, const RayVec3& albedo)
+{
+	float cosi = Saturate(Dot(rayDirection * -1.0f, worldNormal));
+	float weight = std::pow(1.0f - cosi, 5.0f);
+	return albedo + (RayVec3(1.0f, 1.0f, 1.0f) - albedo) * weight;
+}
+#pragma endregion
+
+#pragma region BVH Constructors
+TriangleBvh::TriangleBvh(const TriangleMesh& mesh, uint32_t maxLeafTriangles) : m_mesh(mesh)
+{
+	uint32_t triangleCount = static_cast<uint32_t>(mesh.GetTriangleCount());
+	m_triangles.resize(triangleCount);
+	m_centres.resize(triangleCount);
+
+	for (uint32_t i = 0; i < triangleCount; i++)
+	{
+		m_triangles[i] = i;
+		const RayVec3& v0 = mesh.positions[mesh.indices[i * 3 + 0]];
+		const RayVec3& v1 = mesh.positions[mesh.indices[i * 3 + 1]];
+		const RayVec3& v2 = mesh.positions[mesh.indices[i * 3 + 2]];
+		m_centres[i] = (v0 + v1 + v2) * (1.0f / 3.0f);
+	}
+
+	m_nodes.reserve(triangleCount > 0 ? triangleCount * 2 : 1);
+	m_nodes.resize(1);
+	BuildNode(0, 0, triangleCount, std::max(maxLeafTriangles, 1u));
+}
+#pragma endregion
+
+#pragma region BVH Traversal Methods
+bool TriangleBvh::Intersect(const KernelRay& ray, KernelHit& hit, bool watertight) const
+{
+	WatertightRay shear(ray);
+	KernelRay clipped = ray;
+
+	// Each level only leaves one node behind on the stack, so this is a tree 128 deep, far more than the shipped meshes make.
+	uint32_t stack[128];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize > 0)
+	{
+		const Node& node = m_nodes[stack[--stackSize]];
+		if (!RayKernels::IntersectBox(clipped, node.bounds, clipped.tMax))
+		{
+			continue;
+		}
+
+		if (node.count == 0)
+		{
+			stack[stackSize++] = node.first + 1;
+			stack[stackSize++] = node.first;
+			continue;
+		}
+
+		for (uint32_t i = node.first; i < node.first + node.count; i++)
+		{
+			uint32_t triangle = m_triangles[i];
+			const RayVec3& v0 = m_mesh.positions[m_mesh.indices[triangle * 3 + 0]];
+			const RayVec3& v1 = m_mesh.positions[m_mesh.indices[triangle * 3 + 1]];
+			const RayVec3& v2 = m_mesh.positions[m_mesh.indices[triangle * 3 + 2]];
+
+			float t;
+			bool hitTriangle = watertight ? RayKernels::IntersectWatertight(clipped, shear, v0, v1, v2, t) :
+				RayKernels::IntersectMollerTrumbore(clipped, v0, v1, v2, t);
+
+			// Anything further than this can be skipped from now on.
+			if (hitTriangle)
+			{
+				clipped.tMax = t;
+				hit.t = t;
+				hit.triangle = triangle;
+			}
+		}
+	}
+
+	return hit.triangle != UINT32_MAX;
+}
+#pragma endregion
+
+#pragma region BVH Loading Methods
+bool TriangleBvh::LoadObj(const std::string& path, TriangleMesh& mesh)
+{
+	std::ifstream file(path);
+	if (!file)
+	{
+		return false;
+	}
+
+	mesh.positions.clear();
+	mesh.indices.clear();
+
+	std::string line;
+	std::vector<uint32_t> face;
+	while (std::getline(file, line))
+	{
+		std::istringstream stream(line);
+		std::string type;
+		stream >> type;
+
+		if (type == "v")
+		{
+			RayVec3 position;
+			stream >> position.x >> position.y >> position.z;
+			mesh.positions.push_back(position);
+		}
+		else if (type == "f")
+		{
+			// Only the position index matters, so anything after a slash is ignored. Negative ones count back from the end.
+			face.clear();
+			std::string corner;
+			while (stream >> corner)
+			{
+				long index = std::strtol(corner.c_str(), nullptr, 10);
+				long resolved = index < 0 ? static_cast<long>(mesh.positions.size()) + index : index - 1;
+				if (resolved < 0 || resolved >= static_cast<long>(mesh.positions.size()))
+				{
+					return false;
+				}
+				face.push_back(static_cast<uint32_t>(resolved));
+			}
+
+			for (size_t i = 2; i < face.size(); i++)
+			{
+				mesh.indices.push_back(face[0]);
+				mesh.indices.push_back(face[i - 1]);
+				mesh.indices.push_back(face[i]);
+			}
+		}
+	}
+
+	return !mesh.indices.empty();
+}
+#pragma endregion
+
+#pragma region BVH Private Methods
+void TriangleBvh::BuildNode(uint32_t node, uint32_t first, uint32_t count, uint32_t maxLeafTriangles)
+{
+	KernelBox bounds;
+	KernelBox centreBounds;
+	bounds.minimum = centreBounds.minimum = RayVec3(1e30f, 1e30f, 1e30f);
+	bounds.maximum = centreBounds.maximum = RayVec3(-1e30f, -1e30f, -1e30f);
+
+	for (uint32_t i = first; i < first + count; i++)
+	{
+		uint32_t triangle = m_triangles[i];
+		for (int corner = 0; corner < 3; corner++)
+		{
+			const RayVec3& position = m_mesh.positions[m_mesh.indices[triangle * 3 + corner]];
+			bounds.minimum = RayVec3(std::min(bounds.minimum.x, position.x), std::min(bounds.minimum.y, position.y), std::min(bounds.minimum.z, position.z));
+			bounds.maximum = RayVec3(std::max(bounds.maximum.x, position.x), std::max(bounds.maximum.y, position.y), std::max(bounds.maximum.z, position.z));
+		}
+
+		const RayVec3& centre = m_centres[triangle];
+		centreBounds.minimum = RayVec3(std::min(centreBounds.minimum.x, centre.x), std::min(centreBounds.minimum.y, centre.y), std::min(centreBounds.minimum.z, centre.z));
+		centreBounds.maximum = RayVec3(std::max(centreBounds.maximum.x, centre.x), std::max(centreBounds.maximum.y, centre.y), std::max(centreBounds.maximum.z, centre.z));
+	}
+
+	m_nodes[node].bounds = bounds;
+	m_nodes[node].first = first;
+	m_nodes[node].count = count;
+
+	RayVec3 extent = centreBounds.maximum - centreBounds.minimum;
+	int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+	if (count <= maxLeafTriangles || Component(extent, axis) <= 0.0f)
+	{
+		return;
+	}
+
+	// Split down the middle of the centres, or by count if that would put everything on one side.
+	float split = Component(centreBounds.minimum, axis) + Component(extent, axis) * 0.5f;
+	uint32_t* begin = m_triangles.data() + first;
+	uint32_t* middle = std::partition(begin, begin + count, [&](uint32_t triangle) { return Component(m_centres[triangle], axis) < split; });
+
+	uint32_t leftCount = static_cast<uint32_t>(middle - begin);
+	if (leftCount == 0 || leftCount == count)
+	{
+		leftCount = count / 2;
+		std::nth_element(begin, begin + leftCount, begin + count,
+			[&](uint32_t a, uint32_t b) { return Component(m_centres[a], axis) < Component(m_centres[b], axis); });
+	}
+
+	uint32_t left = static_cast<uint32_t>(m_nodes.size());
+	m_nodes.resize(m_nodes.size() + 2);
+	m_nodes[node].first = left;
+	m_nodes[node].count = 0;
+
+	BuildNode(left, first, leftCount, maxLeafTriangles);
+	BuildNode(left + 1, first + leftCount, count - leftCount, maxLeafTriangles);
+}
+#pragma endregion
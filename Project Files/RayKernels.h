@@ -0,0 +1,220 @@
+#pragma once
+
+#pragma region Includes
+//Include{s}
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#pragma endregion
+
+// No Windows headers (or DirectXMath), these are CPU copies of what the GPU does so they can be timed on their own.
+
+#pragma region Data Structures
+/// <summary>
+/// A plain 3 float vector, laid out the same as an XMFLOAT3.
+/// </summary>
+struct RayVec3
+{
+	float x = 0.0f;
+	float y = 0.0f;
+	float z = 0.0f;
+
+	RayVec3() {}
+	RayVec3(float xIn, float yIn, float zIn) : x(xIn), y(yIn), z(zIn) {}
+};
+
+/// <summary>
+/// A ray, with its reciprocal direction worked out once for the box tests.
+/// </summary>
+struct KernelRay
+{
+	RayVec3 origin;
+	RayVec3 direction;
+	RayVec3 inverseDirection;
+	float tMin = 0.0f;
+	float tMax = 1e30f;
+
+	KernelRay() {}
+	KernelRay(const RayVec3& originIn, const RayVec3& directionIn, float tMinIn = 0.0f, float tMaxIn = 1e30f);
+};
+
+/// <summary>
+/// What the watertight test needs per ray, the axis the ray's mostly along and the shear that lines it up with it.
+/// </summary>
+struct WatertightRay
+{
+	RayVec3 origin;
+	int kx, ky, kz;
+	float sx, sy, sz;
+
+	explicit WatertightRay(const KernelRay& ray);
+};
+
+/// <summary>
+/// An axis aligned box.
+/// </summary>
+struct KernelBox
+{
+	RayVec3 minimum;
+	RayVec3 maximum;
+};
+
+/// <summary>
+/// Boxes laid out a component at a time, 16 of them so any of the SIMD widths can work through it. Unused lanes
+/// should be empty boxes (minimum above maximum), which never hit. The kernels load it unaligned, std::vector doesn't
+/// have to honour the alignas before C++17 and it makes no difference to the speed when it does.
+/// </summary>
+struct alignas(64) BoxPacket
+{
+	static const int kWidth = 16;
+	float minX[kWidth], minY[kWidth], minZ[kWidth];
+	float maxX[kWidth], maxY[kWidth], maxZ[kWidth];
+};
+
+/// <summary>
+/// Just the triangles of a mesh, positions and indices.
+/// </summary>
+struct TriangleMesh
+{
+	std::vector<RayVec3> positions;
+	std::vector<uint32_t> indices;
+
+	size_t GetTriangleCount() const { return indices.size() / 3; }
+};
+
+/// <summary>
+/// The closest thing a ray hit.
+/// </summary>
+struct KernelHit
+{
+	float t = 1e30f;
+	uint32_t triangle = UINT32_MAX;
+};
+
+/// <summary>
+/// Which SIMD box tests this CPU can run.
+/// </summary>
+enum BoxKernelLevel
+{
+	BOX_KERNEL_SCALAR,
+	BOX_KERNEL_SSE,
+	BOX_KERNEL_AVX2,
+	BOX_KERNEL_AVX512,
+};
+#pragma endregion
+
+#pragma region Intersection Kernels
+/// <summary>
+/// Ray against triangle tests, and slab tests against boxes at each SIMD width.
+/// </summary>
+namespace RayKernels
+{
+	/// <summary>
+	/// Moller-Trumbore. Quick, but a ray straight down a shared edge can slip through both triangles.
+	/// </summary>
+	bool IntersectMollerTrumbore(const KernelRay& ray, const RayVec3& v0, const RayVec3& v1, const RayVec3& v2, float& t);
+
+	/// <summary>
+	/// Woop, Benthin and Wald's watertight test. Shared edges always hit exactly one side, at the cost of a bit more maths.
+	/// </summary>
+	bool IntersectWatertight(const KernelRay& ray, const WatertightRay& shear, const RayVec3& v0, const RayVec3& v1, const RayVec3& v2, float& t);
+
+	/// <summary>
+	/// The slab test against one box.
+	/// </summary>
+	bool IntersectBox(const KernelRay& ray, const KernelBox& box, float tMax);
+
+	/// <summary>
+	/// The slab test against 4 or 8 boxes of a packet, starting at firstBox, which has to be a multiple of the width.
+	/// </summary>
+	/// <returns>A bit per box that was hit.</returns>
+	uint32_t IntersectBoxesSse(const KernelRay& ray, const BoxPacket& boxes, int firstBox, float tMax);
+	uint32_t IntersectBoxesAvx2(const KernelRay& ray, const BoxPacket& boxes, int firstBox, float tMax);
+
+	/// <summary>
+	/// The slab test against all 16 boxes of a packet at once.
+	/// </summary>
+	/// <returns>A bit per box that was hit.</returns>
+	uint32_t IntersectBoxesAvx512(const KernelRay& ray, const BoxPacket& boxes, float tMax);
+
+	/// <summary>
+	/// The widest box test the CPU (and the OS) supports.
+	/// </summary>
+	BoxKernelLevel GetSupportedBoxKernel();
+}
+#pragma endregion
+
+#pragma region Shading Kernels
+/// <summary>
+/// The lighting from Hit.hlsl, on the CPU. Same maths, one pixel at a time.
+/// </summary>
+namespace ShadingKernels
+{
+	/// <summary>
+	/// CalculateDiffuseLighting + CalculateAmbientLighting + CalculateSpecularLighting for one hit, with the default light colours.
+	/// </summary>
+	RayVec3 ShadeBlinnPhong(const RayVec3& albedo, const RayVec3& worldNormal, const RayVec3& lightDirection, const RayVec3& rayOrigin,
+		const RayVec3& rayDirection, const RayVec3& hitPosition, float specularPower);
+
+	/// <summary>
+	/// FresnelReflectanceSchlick.
+	/// </summary>
+	RayVec3 FresnelReflectanceSchlick(const RayVec3& rayDirection, const RayVec3& worldNormal, const RayVec3& albedo);
+}
+#pragma endregion
+
+/// <summary>
+/// The TriangleBvh class. A binary BVH over a mesh, split on the middle of the widest axis of the triangle centres, for timing
+/// traversal on the shipped meshes. It isn't anything the GPU uses, the driver builds its own.
+/// </summary>
+class TriangleBvh
+{
+public:
+#pragma region Constructors and Destructors
+	/// <summary>
+	/// Initializes a new instance of the TriangleBvh class and builds it.
+	/// </summary>
+	/// <param name="maxLeafTriangles">Nodes with this many triangles or fewer aren't split any further.</param>
+	TriangleBvh(const TriangleMesh& mesh, uint32_t maxLeafTriangles = 4);
+#pragma endregion
+
+#pragma region Traversal Methods
+	/// <summary>
+	/// Finds the closest triangle a ray hits.
+	/// </summary>
+	/// <param name="watertight">Use the watertight triangle test rather than Moller-Trumbore.</param>
+	/// <returns>False if it hit nothing.</returns>
+	bool Intersect(const KernelRay& ray, KernelHit& hit, bool watertight = false) const;
+
+	size_t GetNodeCount() const { return m_nodes.size(); }
+	const KernelBox& GetBounds() const { return m_nodes[0].bounds; }
+#pragma endregion
+
+#pragma region Loading Methods
+	/// <summary>
+	/// Reads the positions and faces out of an OBJ, anything with more than 3 sides gets fanned into triangles.
+	/// </summary>
+	/// <returns>False if the file couldn't be opened or had no faces.</returns>
+	static bool LoadObj(const std::string& path, TriangleMesh& mesh);
+#pragma endregion
+
+private:
+#pragma region Private Methods
+	void BuildNode(uint32_t node, uint32_t first, uint32_t count, uint32_t maxLeafTriangles);
+#pragma endregion
+
+#pragma region Private Variables
+	struct Node
+	{
+		KernelBox bounds;
+		uint32_t first; // The left child, or the first triangle in a leaf (the right child is always left + 1)
+		uint32_t count; // 0 for an inner node
+	};
+
+	const TriangleMesh& m_mesh;
+	std::vector<Node> m_nodes;
+	std::vector<uint32_t> m_triangles; // Triangle indices, reordered so each leaf's are next to each other
+	std::vector<RayVec3> m_centres;
+#pragma endregion
+};
@@ -0,0 +1,208 @@
+#pragma region Includes
+//Include{s}
+#include "ResourceTracker.h"
+#include <cstdio>
+#include <fstream>
+#include <set>
+#pragma endregion
+
+#pragma region Tracking Methods
+uint64_t ResourceTracker::Track(ResourceCategory category, const std::string& owner, const std::string& label, uint64_t bytes)
+{
+	TrackedResource resource;
+	resource.category = category;
+	resource.owner = owner;
+	resource.label = label;
+	resource.bytes = bytes;
+
+	uint64_t id = m_nextId++;
+	m_resources[id] = resource;
+
+	return id;
+}
+
+void ResourceTracker::Untrack(uint64_t id)
+{
+	m_resources.erase(id);
+}
+#pragma endregion
+
+#pragma region Getters
+uint64_t ResourceTracker::GetTotalBytes() const
+{
+	uint64_t total = 0;
+
+	for (auto& resource : m_resources)
+	{
+		total += resource.second.bytes;
+	}
+
+	return total;
+}
+
+uint64_t ResourceTracker::GetCategoryBytes(ResourceCategory category) const
+{
+	uint64_t total = 0;
+
+	for (auto& resource : m_resources)
+	{
+		if (resource.second.category == category)
+		{
+			total += resource.second.bytes;
+		}
+	}
+
+	return total;
+}
+
+uint64_t ResourceTracker::GetOwnerBytes(const std::string& owner) const
+{
+	uint64_t total = 0;
+
+	for (auto& resource : m_resources)
+	{
+		if (resource.second.owner == owner)
+		{
+			total += resource.second.bytes;
+		}
+	}
+
+	return total;
+}
+
+uint64_t ResourceTracker::GetOwnerCategoryBytes(const std::string& owner, ResourceCategory category) const
+{
+	uint64_t total = 0;
+
+	for (auto& resource : m_resources)
+	{
+		if (resource.second.owner == owner && resource.second.category == category)
+		{
+			total += resource.second.bytes;
+		}
+	}
+
+	return total;
+}
+
+std::vector<std::string> ResourceTracker::GetOwners() const
+{
+	std::set<std::string> owners;
+
+	for (auto& resource : m_resources)
+	{
+		owners.insert(resource.second.owner);
+	}
+
+	return std::vector<std::string>(owners.begin(), owners.end());
+}
+
+const char* ResourceTracker::GetCategoryName(ResourceCategory category)
+{
+	switch (category)
+	{
+	case RESOURCE_VERTICES: return "Vertices";
+	case RESOURCE_INDICES: return "Indices";
+	case RESOURCE_TEXTURE: return "Textures";
+	case RESOURCE_BLAS: return "BLAS";
+	case RESOURCE_AS_SCRATCH: return "AS Scratch";
+	case RESOURCE_TLAS: return "TLAS";
+	case RESOURCE_SBT: return "SBT";
+	default: return "Unknown";
+	}
+}
+#pragma endregion
+
+#pragma region Dump Methods
+/// <summary>
+/// Escapes a string for a JSON string literal. Object names and labels are ours, but a quote in one shouldn't break the dump.
+/// </summary>
+static std::string EscapeJson(const std::string& text)
+{
+	std::string escaped;
+
+	for (char c : text)
+	{
+		if (c == '"' || c == '\\')
+		{
+			escaped += '\\';
+			escaped += c;
+		}
+		else if (static_cast<unsigned char>(c) < 0x20)
+		{
+			char code[8];
+			snprintf(code, sizeof(code), "\\u%04x", c);
+			escaped += code;
+		}
+		else
+		{
+			escaped += c;
+		}
+	}
+
+	return escaped;
+}
+
+std::string ResourceTracker::ToJson() const
+{
+	std::string json = "{\n";
+	json += "  \"totalBytes\": " + std::to_string(GetTotalBytes()) + ",\n";
+
+	json += "  \"categories\": {";
+	for (int category = 0; category < RESOURCE_CATEGORY_COUNT; category++)
+	{
+		json += category == 0 ? "\n" : ",\n";
+		json += "    \"" + std::string(GetCategoryName(static_cast<ResourceCategory>(category))) + "\": " +
+			std::to_string(GetCategoryBytes(static_cast<ResourceCategory>(category)));
+	}
+	json += "\n  },\n";
+
+	json += "  \"owners\": {";
+	std::vector<std::string> owners = GetOwners();
+	for (size_t i = 0; i < owners.size(); i++)
+	{
+		json += i == 0 ? "\n" : ",\n";
+		json += "    \"" + EscapeJson(owners[i]) + "\": { \"totalBytes\": " + std::to_string(GetOwnerBytes(owners[i]));
+
+		for (int category = 0; category < RESOURCE_CATEGORY_COUNT; category++)
+		{
+			uint64_t bytes = GetOwnerCategoryBytes(owners[i], static_cast<ResourceCategory>(category));
+			if (bytes > 0)
+			{
+				json += ", \"" + std::string(GetCategoryName(static_cast<ResourceCategory>(category))) + "\": " + std::to_string(bytes);
+			}
+		}
+		json += " }";
+	}
+	json += "\n  },\n";
+
+	json += "  \"resources\": [";
+	bool first = true;
+	for (auto& resource : m_resources)
+	{
+		json += first ? "\n" : ",\n";
+		first = false;
+		json += "    { \"category\": \"" + std::string(GetCategoryName(resource.second.category)) +
+			"\", \"owner\": \"" + EscapeJson(resource.second.owner) +
+			"\", \"label\": \"" + EscapeJson(resource.second.label) +
+			"\", \"bytes\": " + std::to_string(resource.second.bytes) + " }";
+	}
+	json += "\n  ]\n}\n";
+
+	return json;
+}
+
+bool ResourceTracker::WriteJson(const std::string& path) const
+{
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file)
+	{
+		return false;
+	}
+
+	std::string json = ToJson();
+	file.write(json.data(), json.size());
+
+	return static_cast<bool>(file);
+}
+#pragma endregion
@@ -0,0 +1,100 @@
+#pragma once
+
+#pragma region Includes
+//Include{s}
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#pragma endregion
+
+// No Windows headers, the D3D12 side works the sizes out and this just adds them up, so the JSON dump works headless.
+
+#pragma region Data Structures
+/// <summary>
+/// What an allocation is for.
+/// </summary>
+enum ResourceCategory
+{
+	RESOURCE_VERTICES,
+	RESOURCE_INDICES,
+	RESOURCE_TEXTURE,
+	RESOURCE_BLAS,
+	RESOURCE_AS_SCRATCH,
+	RESOURCE_TLAS,
+	RESOURCE_SBT,
+	RESOURCE_CATEGORY_COUNT,
+};
+
+/// <summary>
+/// One tracked allocation.
+/// </summary>
+struct TrackedResource
+{
+	ResourceCategory category;
+	std::string owner; // The object it belongs to, or "Scene" for shared things
+	std::string label;
+	uint64_t bytes;
+};
+#pragma endregion
+
+/// <summary>
+/// The ResourceTracker class. Every allocation gets tagged with a category and an owner when it's made,
+/// and untracked when it's let go, so the totals per category and per object are always current.
+/// </summary>
+class ResourceTracker
+{
+public:
+#pragma region Tracking Methods
+	/// <summary>
+	/// Starts tracking an allocation.
+	/// </summary>
+	/// <param name="category">What the allocation is for.</param>
+	/// <param name="owner">The object it belongs to.</param>
+	/// <param name="label">A name for it in the dump.</param>
+	/// <param name="bytes">Its size in bytes.</param>
+	/// <returns>An id to untrack it with later, never 0.</returns>
+	uint64_t Track(ResourceCategory category, const std::string& owner, const std::string& label, uint64_t bytes);
+
+	/// <summary>
+	/// Stops tracking an allocation. 0 is ignored, so an id that was never set can be passed straight in.
+	/// </summary>
+	void Untrack(uint64_t id);
+#pragma endregion
+
+#pragma region Getters
+	uint64_t GetTotalBytes() const;
+	uint64_t GetCategoryBytes(ResourceCategory category) const;
+	uint64_t GetOwnerBytes(const std::string& owner) const;
+	uint64_t GetOwnerCategoryBytes(const std::string& owner, ResourceCategory category) const;
+
+	/// <summary>
+	/// Gets every owner with something tracked, sorted by name.
+	/// </summary>
+	std::vector<std::string> GetOwners() const;
+
+	const std::map<uint64_t, TrackedResource>& GetResources() const { return m_resources; }
+
+	static const char* GetCategoryName(ResourceCategory category);
+#pragma endregion
+
+#pragma region Dump Methods
+	/// <summary>
+	/// Formats everything as JSON: the totals per category, per owner, and every allocation.
+	/// </summary>
+	std::string ToJson() const;
+
+	/// <summary>
+	/// Writes the JSON to a file.
+	/// </summary>
+	/// <returns>False if the file couldn't be written.</returns>
+	bool WriteJson(const std::string& path) const;
+#pragma endregion
+
+private:
+#pragma region Private Variables
+	std::map<uint64_t, TrackedResource> m_resources;
+	uint64_t m_nextId = 1;
+#pragma endregion
+};
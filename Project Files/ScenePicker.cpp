@@ -0,0 +1,456 @@
+#pragma region Includes
+//Include{s}
+#include "ScenePicker.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#pragma endregion
+
+#pragma region Helpers
+namespace
+{
+	const uint32_t kMaxLeafInstances = 2;
+	const uint32_t kAllPlanes = 0xF;
+	const uint32_t kOutside = 0x10; // Wholly behind one of the planes, so nothing under it is in the frustum
+
+	float Component(const RayVec3& vector, int axis)
+	{
+		return axis == 0 ? vector.x : (axis == 1 ? vector.y : vector.z);
+	}
+
+	RayVec3 Subtract(const RayVec3& a, const RayVec3& b)
+	{
+		return RayVec3(a.x - b.x, a.y - b.y, a.z - b.z);
+	}
+
+	RayVec3 Cross(const RayVec3& a, const RayVec3& b)
+	{
+		return RayVec3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+	}
+
+	float Dot(const RayVec3& a, const RayVec3& b)
+	{
+		return a.x * b.x + a.y * b.y + a.z * b.z;
+	}
+
+	KernelBox EmptyBox()
+	{
+		KernelBox box;
+		box.minimum = RayVec3(1e30f, 1e30f, 1e30f);
+		box.maximum = RayVec3(-1e30f, -1e30f, -1e30f);
+		return box;
+	}
+
+	KernelBox Union(const KernelBox& a, const KernelBox& b)
+	{
+		KernelBox box;
+		box.minimum = RayVec3(std::min(a.minimum.x, b.minimum.x), std::min(a.minimum.y, b.minimum.y), std::min(a.minimum.z, b.minimum.z));
+		box.maximum = RayVec3(std::max(a.maximum.x, b.maximum.x), std::max(a.maximum.y, b.maximum.y), std::max(a.maximum.z, b.maximum.z));
+		return box;
+	}
+
+	// Arvo's trick, each row of the matrix pushes the box out by whichever end of each axis makes it smaller or bigger,
+	// which is the box around all 8 transformed corners without transforming any of them.
+	KernelBox TransformBox(const float* world, const KernelBox& box)
+	{
+		const float minimum[3] = { box.minimum.x, box.minimum.y, box.minimum.z };
+		const float maximum[3] = { box.maximum.x, box.maximum.y, box.maximum.z };
+		float outMinimum[3], outMaximum[3];
+
+		for (int row = 0; row < 3; row++)
+		{
+			outMinimum[row] = outMaximum[row] = world[row * 4 + 3];
+			for (int column = 0; column < 3; column++)
+			{
+				float a = world[row * 4 + column] * minimum[column];
+				float b = world[row * 4 + column] * maximum[column];
+				outMinimum[row] += std::min(a, b);
+				outMaximum[row] += std::max(a, b);
+			}
+		}
+
+		KernelBox result;
+		result.minimum = RayVec3(outMinimum[0], outMinimum[1], outMinimum[2]);
+		result.maximum = RayVec3(outMaximum[0], outMaximum[1], outMaximum[2]);
+		return result;
+	}
+
+	// Where the ray goes into the box, or false if it misses it (or only gets there past tMax).
+	bool EnterBox(const KernelRay& ray, const KernelBox& box, float tMax, float& enter)
+	{
+		float nearX = ((ray.inverseDirection.x >= 0.0f ? box.minimum.x : box.maximum.x) - ray.origin.x) * ray.inverseDirection.x;
+		float farX = ((ray.inverseDirection.x >= 0.0f ? box.maximum.x : box.minimum.x) - ray.origin.x) * ray.inverseDirection.x;
+		float nearY = ((ray.inverseDirection.y >= 0.0f ? box.minimum.y : box.maximum.y) - ray.origin.y) * ray.inverseDirection.y;
+		float farY = ((ray.inverseDirection.y >= 0.0f ? box.maximum.y : box.minimum.y) - ray.origin.y) * ray.inverseDirection.y;
+		float nearZ = ((ray.inverseDirection.z >= 0.0f ? box.minimum.z : box.maximum.z) - ray.origin.z) * ray.inverseDirection.z;
+		float farZ = ((ray.inverseDirection.z >= 0.0f ? box.maximum.z : box.minimum.z) - ray.origin.z) * ray.inverseDirection.z;
+
+		enter = std::max(std::max(nearX, nearY), std::max(nearZ, ray.tMin));
+		float exit = std::min(std::min(farX, farY), std::min(farZ, tMax));
+		return enter <= exit;
+	}
+
+	bool InRange(const CullVolume& volume, const KernelBox& box)
+	{
+		// The distance to the nearest point of the box, 0 along any axis the eye is already inside.
+		float dx = std::max(std::max(box.minimum.x - volume.eye.x, volume.eye.x - box.maximum.x), 0.0f);
+		float dy = std::max(std::max(box.minimum.y - volume.eye.y, volume.eye.y - box.maximum.y), 0.0f);
+		float dz = std::max(std::max(box.minimum.z - volume.eye.z, volume.eye.z - box.maximum.z), 0.0f);
+		return dx * dx + dy * dy + dz * dz <= volume.maxDistance * volume.maxDistance;
+	}
+
+	// Which planes the box still straddles, dropping the ones it's wholly in front of, or kOutside if it's wholly behind one.
+	uint32_t ClipPlanes(const CullVolume& volume, const KernelBox& box, uint32_t planeMask)
+	{
+		if (planeMask == kOutside)
+		{
+			return kOutside;
+		}
+
+		for (int plane = 0; plane < 4; plane++)
+		{
+			if ((planeMask & (1u << plane)) == 0)
+			{
+				continue;
+			}
+
+			// The corners furthest along and furthest against the plane's normal.
+			const float* p = volume.planes[plane];
+			float front = p[0] * (p[0] >= 0.0f ? box.maximum.x : box.minimum.x) + p[1] * (p[1] >= 0.0f ? box.maximum.y : box.minimum.y) +
+				p[2] * (p[2] >= 0.0f ? box.maximum.z : box.minimum.z) + p[3];
+			if (front < 0.0f)
+			{
+				return kOutside;
+			}
+
+			float back = p[0] * (p[0] >= 0.0f ? box.minimum.x : box.maximum.x) + p[1] * (p[1] >= 0.0f ? box.minimum.y : box.maximum.y) +
+				p[2] * (p[2] >= 0.0f ? box.minimum.z : box.maximum.z) + p[3];
+			if (back >= 0.0f)
+			{
+				planeMask &= ~(1u << plane);
+			}
+		}
+
+		return planeMask;
+	}
+
+	// The world ray in the instance's object space. The direction isn't normalised afterwards, so t means the same in both.
+	bool ToObjectSpace(const float* world, const RayVec3& origin, const RayVec3& direction, RayVec3& objectOrigin, RayVec3& objectDirection)
+	{
+		// The inverse of the 3x3 part from its cofactors.
+		float c00 = world[5] * world[10] - world[6] * world[9];
+		float c01 = world[6] * world[8] - world[4] * world[10];
+		float c02 = world[4] * world[9] - world[5] * world[8];
+		float determinant = world[0] * c00 + world[1] * c01 + world[2] * c02;
+
+		// Something scaled flat on an axis has nothing to hit.
+		if (std::fabs(determinant) < 1e-20f)
+		{
+			return false;
+		}
+
+		float scale = 1.0f / determinant;
+		float inverse[9] =
+		{
+			c00 * scale, (world[2] * world[9] - world[1] * world[10]) * scale, (world[1] * world[6] - world[2] * world[5]) * scale,
+			c01 * scale, (world[0] * world[10] - world[2] * world[8]) * scale, (world[2] * world[4] - world[0] * world[6]) * scale,
+			c02 * scale, (world[1] * world[8] - world[0] * world[9]) * scale, (world[0] * world[5] - world[1] * world[4]) * scale,
+		};
+
+		RayVec3 offset(origin.x - world[3], origin.y - world[7], origin.z - world[11]);
+		objectOrigin = RayVec3(inverse[0] * offset.x + inverse[1] * offset.y + inverse[2] * offset.z,
+			inverse[3] * offset.x + inverse[4] * offset.y + inverse[5] * offset.z,
+			inverse[6] * offset.x + inverse[7] * offset.y + inverse[8] * offset.z);
+		objectDirection = RayVec3(inverse[0] * direction.x + inverse[1] * direction.y + inverse[2] * direction.z,
+			inverse[3] * direction.x + inverse[4] * direction.y + inverse[5] * direction.z,
+			inverse[6] * direction.x + inverse[7] * direction.y + inverse[8] * direction.z);
+		return true;
+	}
+
+	// The BVH only says which triangle and how far, the barycentrics are worked out once for the one that won.
+	void Barycentrics(const KernelRay& ray, const RayVec3& v0, const RayVec3& v1, const RayVec3& v2, float& u, float& v)
+	{
+		RayVec3 edge1 = Subtract(v1, v0);
+		RayVec3 edge2 = Subtract(v2, v0);
+		RayVec3 p = Cross(ray.direction, edge2);
+		float determinant = Dot(edge1, p);
+		if (determinant == 0.0f)
+		{
+			u = v = 0.0f;
+			return;
+		}
+
+		RayVec3 s = Subtract(ray.origin, v0);
+		RayVec3 q = Cross(s, edge1);
+		u = Dot(s, p) / determinant;
+		v = Dot(ray.direction, q) / determinant;
+	}
+}
+#pragma endregion
+
+// Callers may well take these by reference, so they need somewhere to live.
+const uint8_t ScenePicker::kInRange;
+const uint8_t ScenePicker::kInFrustum;
+
+#pragma region Constructors and Destructors
+ScenePicker::ScenePicker() : m_rebuild(false)
+{
+}
+#pragma endregion
+
+#pragma region Scene Methods
+uint32_t ScenePicker::AddMesh(const TriangleMesh& mesh)
+{
+	std::unique_ptr<PickMesh> pickMesh(new PickMesh());
+	pickMesh->mesh = mesh;
+	pickMesh->bvh.reset(new TriangleBvh(pickMesh->mesh));
+	m_meshes.push_back(std::move(pickMesh));
+	return static_cast<uint32_t>(m_meshes.size() - 1);
+}
+
+uint32_t ScenePicker::AddInstance(uint32_t mesh, uint32_t transformIndex)
+{
+	Instance instance;
+	instance.mesh = mesh;
+	instance.transformIndex = transformIndex;
+	std::memset(instance.world, 0, sizeof(instance.world));
+	instance.bounds = EmptyBox();
+	instance.mask = 0xFF;
+	m_instances.push_back(instance);
+
+	m_rebuild = true;
+	return static_cast<uint32_t>(m_instances.size() - 1);
+}
+
+void ScenePicker::Update(const TransformBatch& transforms)
+{
+	for (Instance& instance : m_instances)
+	{
+		std::memcpy(instance.world, transforms.GetWorld(instance.transformIndex), sizeof(instance.world));
+
+		// A mesh with no triangles has an inside out box, which would turn into nonsense if it went through the matrix.
+		const PickMesh& mesh = *m_meshes[instance.mesh];
+		instance.bounds = mesh.mesh.GetTriangleCount() > 0 ? TransformBox(instance.world, mesh.bvh->GetBounds()) : EmptyBox();
+	}
+
+	if (!m_rebuild)
+	{
+		RefitNodes();
+		return;
+	}
+
+	uint32_t instanceCount = static_cast<uint32_t>(m_instances.size());
+	m_order.resize(instanceCount);
+	for (uint32_t i = 0; i < instanceCount; i++)
+	{
+		m_order[i] = i;
+	}
+
+	m_nodes.clear();
+	m_nodes.reserve(instanceCount > 0 ? instanceCount * 2 : 1);
+	m_nodes.resize(1);
+	BuildNode(0, 0, instanceCount);
+	m_rebuild = false;
+}
+#pragma endregion
+
+#pragma region Pick Methods
+bool ScenePicker::Pick(const RayVec3& origin, const RayVec3& direction, PickHit& hit, uint8_t rayMask) const
+{
+	hit = PickHit();
+
+	// An empty root would look like an inner node, with a count of 0.
+	if (m_nodes.empty() || m_order.empty())
+	{
+		return false;
+	}
+
+	KernelRay ray(origin, direction);
+
+	// Same depth as TriangleBvh's, each level leaves at most one node behind.
+	uint32_t stack[128];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+
+	float enter;
+	while (stackSize > 0)
+	{
+		const Node& node = m_nodes[stack[--stackSize]];
+
+		// Checked again, something closer might have turned up since it was pushed.
+		if (!EnterBox(ray, node.bounds, hit.t, enter))
+		{
+			continue;
+		}
+
+		if (node.count == 0)
+		{
+			// The nearer child goes on top, so it's done first and the further one can often be skipped.
+			float enterLeft, enterRight;
+			bool hitLeft = EnterBox(ray, m_nodes[node.first].bounds, hit.t, enterLeft);
+			bool hitRight = EnterBox(ray, m_nodes[node.first + 1].bounds, hit.t, enterRight);
+
+			if (hitLeft && hitRight)
+			{
+				bool leftFirst = enterLeft <= enterRight;
+				stack[stackSize++] = leftFirst ? node.first + 1 : node.first;
+				stack[stackSize++] = leftFirst ? node.first : node.first + 1;
+			}
+			else if (hitLeft || hitRight)
+			{
+				stack[stackSize++] = hitLeft ? node.first : node.first + 1;
+			}
+			continue;
+		}
+
+		for (uint32_t i = node.first; i < node.first + node.count; i++)
+		{
+			const Instance& instance = m_instances[m_order[i]];
+			if ((instance.mask & rayMask) == 0 || !EnterBox(ray, instance.bounds, hit.t, enter))
+			{
+				continue;
+			}
+
+			RayVec3 objectOrigin, objectDirection;
+			if (!ToObjectSpace(instance.world, origin, direction, objectOrigin, objectDirection))
+			{
+				continue;
+			}
+
+			// Watertight, so the cursor can't fall through the crack between two triangles.
+			KernelRay objectRay(objectOrigin, objectDirection, 0.0f, hit.t);
+			KernelHit meshHit;
+			const PickMesh& mesh = *m_meshes[instance.mesh];
+			if (!mesh.bvh->Intersect(objectRay, meshHit, true))
+			{
+				continue;
+			}
+
+			hit.instance = m_order[i];
+			hit.triangle = meshHit.triangle;
+			hit.t = meshHit.t;
+
+			const TriangleMesh& triangles = mesh.mesh;
+			Barycentrics(objectRay, triangles.positions[triangles.indices[meshHit.triangle * 3 + 0]],
+				triangles.positions[triangles.indices[meshHit.triangle * 3 + 1]],
+				triangles.positions[triangles.indices[meshHit.triangle * 3 + 2]], hit.u, hit.v);
+		}
+	}
+
+	return hit.instance != UINT32_MAX;
+}
+#pragma endregion
+
+#pragma region Culling Methods
+void ScenePicker::Cull(const CullVolume& volume, std::vector<uint8_t>& results) const
+{
+	results.assign(m_instances.size(), 0);
+
+	if (m_nodes.empty() || m_order.empty())
+	{
+		return;
+	}
+
+	CullNode(0, volume, kAllPlanes, results);
+}
+#pragma endregion
+
+#pragma region Private Methods
+void ScenePicker::BuildNode(uint32_t node, uint32_t first, uint32_t count)
+{
+	KernelBox bounds = EmptyBox();
+	KernelBox centreBounds = EmptyBox();
+
+	for (uint32_t i = first; i < first + count; i++)
+	{
+		const KernelBox& instanceBounds = m_instances[m_order[i]].bounds;
+		bounds = Union(bounds, instanceBounds);
+
+		KernelBox centre;
+		centre.minimum = centre.maximum = RayVec3((instanceBounds.minimum.x + instanceBounds.maximum.x) * 0.5f,
+			(instanceBounds.minimum.y + instanceBounds.maximum.y) * 0.5f, (instanceBounds.minimum.z + instanceBounds.maximum.z) * 0.5f);
+		centreBounds = Union(centreBounds, centre);
+	}
+
+	m_nodes[node].bounds = bounds;
+	m_nodes[node].first = first;
+	m_nodes[node].count = count;
+
+	if (count <= kMaxLeafInstances)
+	{
+		return;
+	}
+
+	// The middle of the widest axis by count. Instances overlap a lot more than triangles do, so an even split works out
+	// better here than splitting the space in half.
+	RayVec3 extent = Subtract(centreBounds.maximum, centreBounds.minimum);
+	int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+	uint32_t leftCount = count / 2;
+	uint32_t* begin = m_order.data() + first;
+	std::nth_element(begin, begin + leftCount, begin + count, [&](uint32_t a, uint32_t b)
+	{
+		const KernelBox& boundsA = m_instances[a].bounds;
+		const KernelBox& boundsB = m_instances[b].bounds;
+		return Component(boundsA.minimum, axis) + Component(boundsA.maximum, axis) < Component(boundsB.minimum, axis) + Component(boundsB.maximum, axis);
+	});
+
+	uint32_t left = static_cast<uint32_t>(m_nodes.size());
+	m_nodes.resize(m_nodes.size() + 2);
+	m_nodes[node].first = left;
+	m_nodes[node].count = 0;
+
+	BuildNode(left, first, leftCount);
+	BuildNode(left + 1, first + leftCount, count - leftCount);
+}
+
+void ScenePicker::RefitNodes()
+{
+	// Children always come after their parent, so going backwards does every child before the node it's in.
+	for (size_t node = m_nodes.size(); node-- > 0;)
+	{
+		Node& current = m_nodes[node];
+		if (current.count == 0)
+		{
+			current.bounds = Union(m_nodes[current.first].bounds, m_nodes[current.first + 1].bounds);
+			continue;
+		}
+
+		current.bounds = EmptyBox();
+		for (uint32_t i = current.first; i < current.first + current.count; i++)
+		{
+			current.bounds = Union(current.bounds, m_instances[m_order[i]].bounds);
+		}
+	}
+}
+
+void ScenePicker::CullNode(uint32_t node, const CullVolume& volume, uint32_t planeMask, std::vector<uint8_t>& results) const
+{
+	const Node& current = m_nodes[node];
+
+	// Out of range is the only thing that rules a whole subtree out, something out of view can still be in a reflection.
+	if (!InRange(volume, current.bounds))
+	{
+		return;
+	}
+
+	planeMask = ClipPlanes(volume, current.bounds, planeMask);
+
+	if (current.count == 0)
+	{
+		CullNode(current.first, volume, planeMask, results);
+		CullNode(current.first + 1, volume, planeMask, results);
+		return;
+	}
+
+	for (uint32_t i = current.first; i < current.first + current.count; i++)
+	{
+		const KernelBox& bounds = m_instances[m_order[i]].bounds;
+		if (!InRange(volume, bounds))
+		{
+			continue;
+		}
+
+		results[m_order[i]] = kInRange | (ClipPlanes(volume, bounds, planeMask) != kOutside ? kInFrustum : 0);
+	}
+}
+#pragma endregion
@@ -0,0 +1,142 @@
+#pragma once
+
+#pragma region Includes
+//Include{s}
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "RayKernels.h"
+#include "TransformBatch.h"
+#pragma endregion
+
+// No Windows headers, the camera ray is worked out by whoever calls Pick so this only deals in plain floats.
+
+#pragma region Data Structures
+/// <summary>
+/// What a pick ray hit.
+/// </summary>
+struct PickHit
+{
+	uint32_t instance = UINT32_MAX; // The order the instances were added in, which is the object's index in the scene
+	uint32_t triangle = UINT32_MAX;
+	float u = 0.0f; // The barycentrics of the triangle's second and third corners, the first one's is 1 - u - v
+	float v = 0.0f;
+	float t = 1e30f; // Along the ray as it was passed in, so a world space distance if the direction was normalised
+};
+
+/// <summary>
+/// Where a camera's primary rays can go: the 4 side planes of its frustum (ax + by + cz + d >= 0 is inside), and how far from
+/// the eye anything's allowed to be. There's no near or far plane, the rays start at the eye and go on past the projection's far plane.
+/// </summary>
+struct CullVolume
+{
+	float planes[4][4];
+	RayVec3 eye;
+	float maxDistance = 1e30f;
+};
+#pragma endregion
+
+/// <summary>
+/// The ScenePicker class. A CPU copy of the scene's acceleration structures for picking things with the mouse: a TriangleBvh per
+/// mesh, like the BLASes, and a BVH over the instances' world bounds on top, like the TLAS. Pick rays only go into the meshes
+/// whose boxes they pass through, in object space, so a pick is a few microseconds however many objects there are. The same
+/// instance BVH answers which instances are near enough or in view for the TLAS to need them.
+/// </summary>
+class ScenePicker
+{
+public:
+	// What Cull says about each instance.
+	static const uint8_t kInRange = 1;
+	static const uint8_t kInFrustum = 2;
+
+#pragma region Constructors and Destructors
+	/// <summary>
+	/// Initializes a new instance of the ScenePicker class, with nothing in it.
+	/// </summary>
+	ScenePicker();
+#pragma endregion
+
+#pragma region Scene Methods
+	/// <summary>
+	/// Takes a copy of a mesh and builds its BVH.
+	/// </summary>
+	/// <returns>The mesh's index, for AddInstance.</returns>
+	uint32_t AddMesh(const TriangleMesh& mesh);
+
+	/// <summary>
+	/// Adds a mesh placed by one of the transforms' world matrices. It can't be picked until the next Update.
+	/// </summary>
+	/// <returns>The instance's index, which is what PickHit::instance comes back as.</returns>
+	uint32_t AddInstance(uint32_t mesh, uint32_t transformIndex);
+
+	/// <summary>
+	/// Works out every instance's world bounds again and fits the instance BVH around them. The BVH is only built from scratch
+	/// after instances have been added, otherwise it's refitted, the same as the TLAS update. Call it whenever the transforms change.
+	/// </summary>
+	void Update(const TransformBatch& transforms);
+
+	/// <summary>
+	/// Which rays can hit an instance, anded with the ray's mask the same as the TLAS instance mask. Everything starts at 0xFF.
+	/// </summary>
+	void SetInstanceMask(uint32_t instance, uint8_t mask) { m_instances[instance].mask = mask; }
+
+	uint32_t GetInstanceCount() const { return static_cast<uint32_t>(m_instances.size()); }
+#pragma endregion
+
+#pragma region Pick Methods
+	/// <summary>
+	/// Finds the closest triangle a world space ray hits.
+	/// </summary>
+	/// <param name="rayMask">Only instances whose mask shares a bit with this can be hit.</param>
+	/// <returns>False if it hit nothing.</returns>
+	bool Pick(const RayVec3& origin, const RayVec3& direction, PickHit& hit, uint8_t rayMask = 0xFF) const;
+#pragma endregion
+
+#pragma region Culling Methods
+	/// <summary>
+	/// Works out, as of the last Update, which instances' bounds are in range of the eye and which are in the frustum.
+	/// Whole subtrees out of range are skipped, and ones wholly inside the frustum stop testing its planes.
+	/// </summary>
+	/// <param name="results">kInRange and kInFrustum bits for each instance.</param>
+	void Cull(const CullVolume& volume, std::vector<uint8_t>& results) const;
+#pragma endregion
+
+private:
+#pragma region Private Methods
+	void BuildNode(uint32_t node, uint32_t first, uint32_t count);
+	void RefitNodes();
+	void CullNode(uint32_t node, const CullVolume& volume, uint32_t planeMask, std::vector<uint8_t>& results) const;
+#pragma endregion
+
+#pragma region Private Variables
+	// The BVH holds onto the mesh it was built from, so they live together and never move.
+	struct PickMesh
+	{
+		TriangleMesh mesh;
+		std::unique_ptr<TriangleBvh> bvh;
+	};
+
+	struct Instance
+	{
+		uint32_t mesh;
+		uint32_t transformIndex;
+		float world[12]; // Copied out of the transforms at the last Update, so a pick doesn't need them
+		KernelBox bounds;
+		uint8_t mask;
+	};
+
+	struct Node
+	{
+		KernelBox bounds;
+		uint32_t first; // The left child, or the first instance in a leaf (the right child is always left + 1)
+		uint32_t count; // 0 for an inner node
+	};
+
+	std::vector<std::unique_ptr<PickMesh>> m_meshes;
+	std::vector<Instance> m_instances;
+	std::vector<Node> m_nodes;
+	std::vector<uint32_t> m_order; // Instance indices, reordered so each leaf's are next to each other
+	bool m_rebuild;
+#pragma endregion
+};
@@ -0,0 +1,331 @@
+#pragma region Includes
+//Include{s}
+#include "ShaderCache.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#pragma endregion
+
+#pragma region Hash Helpers
+namespace
+{
+	// FNV-1a, nothing fancy, it only has to tell shaders apart.
+	const uint64_t kFnvOffsetBasis = 14695981039346656037ull;
+	const uint64_t kFnvPrime = 1099511628211ull;
+
+	// Every entry starts with one of these, so a file cut short by a full disk or scribbled on by something else is
+	// recompiled instead of handed to the driver.
+	const uint32_t kEntryMagic = 0x45434853; // "SHCE"
+	const uint32_t kEntryVersion = 1;
+
+	struct EntryHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint64_t size;
+		uint64_t checksum;
+	};
+
+	void HashBytes(uint64_t& hash, const void* data, size_t size)
+	{
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= bytes[i];
+			hash *= kFnvPrime;
+		}
+	}
+
+	// Strings are hashed with their length first, so "ab" + "c" and "a" + "bc" don't collide.
+	void HashString(uint64_t& hash, const std::string& value)
+	{
+		uint64_t length = value.size();
+		HashBytes(hash, &length, sizeof(length));
+		HashBytes(hash, value.data(), value.size());
+	}
+
+	bool ReadFileFromDisk(const std::string& path, std::string& outContents)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file.good())
+		{
+			return false;
+		}
+
+		std::stringstream stream;
+		stream << file.rdbuf();
+		outContents = stream.str();
+		return true;
+	}
+
+	std::string GetDirectory(const std::string& path)
+	{
+		size_t slash = path.find_last_of("/\\");
+		return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+	}
+
+	// Pulls the "file" out of every #include "file" line. Angle bracket includes are left to the compiler.
+	std::vector<std::string> FindQuotedIncludes(const std::string& source)
+	{
+		std::vector<std::string> includes;
+		std::istringstream lines(source);
+		std::string line;
+
+		while (std::getline(lines, line))
+		{
+			size_t start = line.find_first_not_of(" \t");
+			if (start == std::string::npos || line[start] != '#')
+			{
+				continue;
+			}
+
+			size_t directive = line.find_first_not_of(" \t", start + 1);
+			if (directive == std::string::npos || line.compare(directive, 7, "include") != 0)
+			{
+				continue;
+			}
+
+			size_t openQuote = line.find('"', directive + 7);
+			if (openQuote == std::string::npos)
+			{
+				continue;
+			}
+
+			size_t closeQuote = line.find('"', openQuote + 1);
+			if (closeQuote == std::string::npos)
+			{
+				continue;
+			}
+
+			includes.push_back(line.substr(openQuote + 1, closeQuote - openQuote - 1));
+		}
+
+		return includes;
+	}
+
+	double MillisecondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+}
+#pragma endregion
+
+#pragma region Constructors and Destructors
+ShaderCache::ShaderCache(const std::string& cacheDirectory, ReadFileFunction readFile)
+{
+	m_cacheDirectory = cacheDirectory;
+
+	if (!m_cacheDirectory.empty() && m_cacheDirectory.back() != '/' && m_cacheDirectory.back() != '\\')
+	{
+		m_cacheDirectory += '/';
+	}
+
+	m_readFile = readFile ? readFile : ReadFileFromDisk;
+}
+#pragma endregion
+
+#pragma region Cache Methods
+std::vector<uint8_t> ShaderCache::GetOrCompile(const std::string& fileName, const std::vector<std::string>& arguments,
+	const std::string& compilerVersion, const CompileFunction& compile)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	// The main file's contents come back out of the hashing so it's only read once.
+	std::string source;
+	uint64_t key = HashInputs(fileName, arguments, compilerVersion, &source);
+
+	std::vector<uint8_t> bytes;
+
+	if (LoadEntry(key, bytes))
+	{
+		double milliseconds = MillisecondsSince(start);
+		m_stats.hits++;
+		m_stats.totalLoadMilliseconds += milliseconds;
+		Record(fileName, arguments, key, true, milliseconds);
+		return bytes;
+	}
+
+	bytes = compile(fileName, source);
+
+	double milliseconds = MillisecondsSince(start);
+	m_stats.misses++;
+	m_stats.totalCompileMilliseconds += milliseconds;
+	Record(fileName, arguments, key, false, milliseconds);
+
+	// A failed write only costs us a recompile next launch, so don't make a fuss.
+	if (!StoreEntry(key, bytes))
+	{
+		m_stats.failedWrites++;
+	}
+
+	return bytes;
+}
+
+uint64_t ShaderCache::ComputeKey(const std::string& fileName, const std::vector<std::string>& arguments, const std::string& compilerVersion)
+{
+	return HashInputs(fileName, arguments, compilerVersion, nullptr);
+}
+
+std::string ShaderCache::GetEntryPath(uint64_t key) const
+{
+	char name[17];
+	snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(key));
+	return m_cacheDirectory + name + ".dxil";
+}
+#pragma endregion
+
+#pragma region Private Methods
+uint64_t ShaderCache::HashInputs(const std::string& fileName, const std::vector<std::string>& arguments, const std::string& compilerVersion, std::string* outSource)
+{
+	// Everything that can change the output goes in here.
+	uint64_t key = kFnvOffsetBasis;
+	HashString(key, compilerVersion);
+
+	uint64_t argumentCount = arguments.size();
+	HashBytes(key, &argumentCount, sizeof(argumentCount));
+	for (const std::string& argument : arguments)
+	{
+		HashString(key, argument);
+	}
+
+	std::unordered_set<std::string> visited;
+	HashFileAndIncludes(fileName, key, visited, outSource);
+
+	return key;
+}
+
+void ShaderCache::HashFileAndIncludes(const std::string& path, uint64_t& hash, std::unordered_set<std::string>& visited, std::string* outContents)
+{
+	// Include guards (and #pragma once) mean a file only counts once.
+	if (!visited.insert(path).second)
+	{
+		return;
+	}
+
+	std::string contents;
+	bool found = m_readFile(path, contents);
+
+	if (!found && visited.size() == 1)
+	{
+		throw std::logic_error("Cannot find shader file");
+	}
+
+	// A missing include still goes into the key (by name), the compiler can complain about it properly.
+	HashString(hash, path);
+	HashBytes(hash, &found, sizeof(found));
+	HashString(hash, contents);
+
+	if (outContents)
+	{
+		*outContents = contents;
+	}
+
+	std::string directory = GetDirectory(path);
+
+	for (const std::string& include : FindQuotedIncludes(contents))
+	{
+		HashFileAndIncludes(directory + include, hash, visited, nullptr);
+	}
+}
+
+bool ShaderCache::LoadEntry(uint64_t key, std::vector<uint8_t>& outBytes)
+{
+	std::ifstream file(GetEntryPath(key), std::ios::binary);
+	if (!file.good())
+	{
+		return false;
+	}
+
+	std::vector<uint8_t> contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	if (contents.size() <= sizeof(EntryHeader))
+	{
+		return false;
+	}
+
+	EntryHeader header;
+	memcpy(&header, contents.data(), sizeof(header));
+
+	uint64_t checksum = kFnvOffsetBasis;
+	HashBytes(checksum, contents.data() + sizeof(header), contents.size() - sizeof(header));
+
+	if (header.magic != kEntryMagic || header.version != kEntryVersion || header.size != contents.size() - sizeof(header) ||
+		header.checksum != checksum)
+	{
+		return false;
+	}
+
+	outBytes.assign(contents.begin() + sizeof(header), contents.end());
+	return true;
+}
+
+bool ShaderCache::StoreEntry(uint64_t key, const std::vector<uint8_t>& bytes)
+{
+	if (bytes.empty())
+	{
+		return false;
+	}
+
+	std::string entryPath = GetEntryPath(key);
+	std::string tempPath = entryPath + ".tmp";
+
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		if (!file.good())
+		{
+			return false;
+		}
+
+		EntryHeader header;
+		header.magic = kEntryMagic;
+		header.version = kEntryVersion;
+		header.size = bytes.size();
+		header.checksum = kFnvOffsetBasis;
+		HashBytes(header.checksum, bytes.data(), bytes.size());
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+		if (!file.good())
+		{
+			return false;
+		}
+	}
+
+	// rename won't overwrite on Windows, and the old entry has the same key so it holds the same bytes anyway.
+	std::remove(entryPath.c_str());
+	if (std::rename(tempPath.c_str(), entryPath.c_str()) != 0)
+	{
+		std::remove(tempPath.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+void ShaderCache::Record(const std::string& fileName, const std::vector<std::string>& arguments, uint64_t key, bool hit, double milliseconds)
+{
+	m_lastRecord.fileName = fileName;
+	m_lastRecord.arguments.clear();
+	for (const std::string& argument : arguments)
+	{
+		m_lastRecord.arguments += (m_lastRecord.arguments.empty() ? "" : " ") + argument;
+	}
+	m_lastRecord.key = key;
+	m_lastRecord.hit = hit;
+	m_lastRecord.milliseconds = milliseconds;
+
+	for (ShaderCacheRecord& record : m_records)
+	{
+		if (record.fileName == fileName && record.arguments == m_lastRecord.arguments)
+		{
+			record = m_lastRecord;
+			return;
+		}
+	}
+
+	m_records.push_back(m_lastRecord);
+}
+#pragma endregion
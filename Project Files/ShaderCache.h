@@ -0,0 +1,146 @@
+#pragma once
+
+#pragma region Includes
+//Include{s}
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#pragma endregion
+
+// No Windows headers in here on purpose, the cache only deals with bytes and strings so it can be poked at without DXC.
+
+#pragma region Data Structures
+/// <summary>
+/// Running totals for the shader cache.
+/// </summary>
+struct ShaderCacheStats
+{
+	uint32_t hits = 0;
+	uint32_t misses = 0;
+	uint32_t failedWrites = 0;
+	double totalCompileMilliseconds = 0.0;
+	double totalLoadMilliseconds = 0.0;
+};
+
+/// <summary>
+/// What happened the last time a shader was requested from the cache.
+/// </summary>
+struct ShaderCacheRecord
+{
+	std::string fileName;
+	std::string arguments; // Joined with spaces, Hit.hlsl is compiled once per set of defines and each gets its own record
+	uint64_t key = 0;
+	bool hit = false;
+	double milliseconds = 0.0;
+};
+#pragma endregion
+
+/// <summary>
+/// The ShaderCache class. A content addressed, on disk cache for compiled shader libraries.
+/// The key covers the shader source, every file it #includes, the compile arguments (target, defines) and the compiler version.
+/// </summary>
+class ShaderCache
+{
+public:
+#pragma region Types
+	/// <summary>
+	/// Compiles the given source and returns the compiled bytes. Should throw if compilation fails.
+	/// </summary>
+	typedef std::function<std::vector<uint8_t>(const std::string& fileName, const std::string& source)> CompileFunction;
+
+	/// <summary>
+	/// Reads a whole file into outContents, returns false if the file can't be read.
+	/// </summary>
+	typedef std::function<bool(const std::string& path, std::string& outContents)> ReadFileFunction;
+#pragma endregion
+
+#pragma region Constructors and Destructors
+	/// <summary>
+	/// Initializes a new instance of the ShaderCache class.
+	/// </summary>
+	/// <param name="cacheDirectory">The directory compiled shaders are stored in, it must already exist.</param>
+	/// <param name="readFile">Optional file reader, defaults to reading from disk.</param>
+	ShaderCache(const std::string& cacheDirectory, ReadFileFunction readFile = nullptr);
+#pragma endregion
+
+#pragma region Cache Methods
+	/// <summary>
+	/// Returns the compiled shader, from disk if the key matches a stored entry, otherwise by calling the compiler and storing the result.
+	/// </summary>
+	/// <param name="fileName">The shader file to compile.</param>
+	/// <param name="arguments">The compile arguments that change the output, such as the target profile and defines.</param>
+	/// <param name="compilerVersion">A string that changes whenever the compiler does.</param>
+	/// <param name="compile">The function used on a cache miss.</param>
+	/// <returns>The compiled shader bytes.</returns>
+	std::vector<uint8_t> GetOrCompile(const std::string& fileName, const std::vector<std::string>& arguments,
+		const std::string& compilerVersion, const CompileFunction& compile);
+
+	/// <summary>
+	/// Computes the cache key for a shader, without compiling anything.
+	/// </summary>
+	/// <param name="fileName">The shader file.</param>
+	/// <param name="arguments">The compile arguments.</param>
+	/// <param name="compilerVersion">The compiler version string.</param>
+	/// <returns>The 64 bit cache key.</returns>
+	uint64_t ComputeKey(const std::string& fileName, const std::vector<std::string>& arguments, const std::string& compilerVersion);
+
+	/// <summary>
+	/// Gets the path a key is stored at.
+	/// </summary>
+	/// <param name="key">The cache key.</param>
+	/// <returns>The file path of the cache entry.</returns>
+	std::string GetEntryPath(uint64_t key) const;
+#pragma endregion
+
+#pragma region Getters
+	const ShaderCacheStats& GetStats() const { return m_stats; }
+	const std::vector<ShaderCacheRecord>& GetRecords() const { return m_records; }
+	const ShaderCacheRecord& GetLastRecord() const { return m_lastRecord; }
+#pragma endregion
+
+private:
+#pragma region Private Methods
+	/// <summary>
+	/// Hashes the compiler version, the arguments and the shader with its includes into a cache key.
+	/// </summary>
+	/// <param name="outSource">Optional, receives the contents of the main shader file.</param>
+	/// <returns>The 64 bit cache key.</returns>
+	uint64_t HashInputs(const std::string& fileName, const std::vector<std::string>& arguments, const std::string& compilerVersion, std::string* outSource);
+
+	/// <summary>
+	/// Hashes a file and everything it includes (with quotes) into the running hash.
+	/// </summary>
+	/// <param name="path">The file to hash.</param>
+	/// <param name="hash">The running hash.</param>
+	/// <param name="visited">Files already hashed, so include loops don't go on forever.</param>
+	/// <param name="outContents">Optional, receives the contents of the file.</param>
+	void HashFileAndIncludes(const std::string& path, uint64_t& hash, std::unordered_set<std::string>& visited, std::string* outContents);
+
+	/// <summary>
+	/// Loads a cache entry from disk.
+	/// </summary>
+	/// <returns>True if the entry exists, isn't empty and its header's size and checksum match what follows it.</returns>
+	bool LoadEntry(uint64_t key, std::vector<uint8_t>& outBytes);
+
+	/// <summary>
+	/// Stores a cache entry on disk. Writes to a temp file first so a crash can't leave half a shader behind.
+	/// </summary>
+	/// <returns>True if the entry was written.</returns>
+	bool StoreEntry(uint64_t key, const std::vector<uint8_t>& bytes);
+
+	/// <summary>
+	/// Records the result of a request and keeps one record per shader and set of arguments.
+	/// </summary>
+	void Record(const std::string& fileName, const std::vector<std::string>& arguments, uint64_t key, bool hit, double milliseconds);
+#pragma endregion
+
+#pragma region Private Variables
+	std::string m_cacheDirectory;
+	ReadFileFunction m_readFile;
+	ShaderCacheStats m_stats;
+	std::vector<ShaderCacheRecord> m_records;
+	ShaderCacheRecord m_lastRecord;
+#pragma endregion
+};
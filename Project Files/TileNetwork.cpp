@@ -0,0 +1,613 @@
+#include "stdafx.h"
+
+#pragma region Includes
+//Include{s}
+#include "TileNetwork.h"
+#include <fstream>
+#include "OfflineRenderer.h"
+#pragma endregion
+
+#pragma region Socket Helpers
+namespace
+{
+	UINT64 AlignUp(UINT64 value, UINT64 alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	void SetupSocket(SOCKET socket)
+	{
+		// Nothing here should ever wait on a socket, the render loop has to keep going.
+		u_long nonBlocking = 1;
+		ioctlsocket(socket, FIONBIO, &nonBlocking);
+
+		// Requests are tiny, and holding them back for Nagle just leaves a worker sat idle.
+		BOOL noDelay = TRUE;
+		setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&noDelay), sizeof(noDelay));
+	}
+
+	bool SendTileMessage(SOCKET socket, const TileMessage& message)
+	{
+		std::vector<uint8_t> bytes;
+		TileProtocol::Encode(message, bytes);
+
+		size_t sent = 0;
+		while (sent < bytes.size())
+		{
+			int result = send(socket, reinterpret_cast<const char*>(bytes.data() + sent), static_cast<int>(bytes.size() - sent), 0);
+			if (result != SOCKET_ERROR)
+			{
+				sent += result;
+				continue;
+			}
+
+			if (WSAGetLastError() != WSAEWOULDBLOCK)
+			{
+				return false;
+			}
+
+			// The other end's not keeping up, wait for room. If there's none for this long it's not coming back.
+			fd_set writeSet;
+			FD_ZERO(&writeSet);
+			FD_SET(socket, &writeSet);
+			timeval timeout = { 5, 0 };
+			if (select(0, nullptr, &writeSet, nullptr, &timeout) <= 0)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	// Reads everything waiting on the socket into the decoder. False if the socket's closed or broken.
+	bool ReceiveAvailable(SOCKET socket, TileMessageDecoder& decoder)
+	{
+		char buffer[64 * 1024];
+		for (;;)
+		{
+			int result = recv(socket, buffer, sizeof(buffer), 0);
+			if (result > 0)
+			{
+				decoder.Feed(reinterpret_cast<const uint8_t*>(buffer), static_cast<size_t>(result));
+			}
+			else if (result == 0)
+			{
+				return false;
+			}
+			else
+			{
+				return WSAGetLastError() == WSAEWOULDBLOCK;
+			}
+		}
+	}
+}
+#pragma endregion
+
+#pragma region Coordinator Constructors and Destructors
+TileCoordinator::TileCoordinator(uint32_t workerCount, uint32_t frameCount, uint32_t width, uint32_t height, uint32_t tileSize,
+	const std::wstring& workerArgs, const std::string& outputPrefix)
+	: m_scheduler(width, height, tileSize, workerCount), m_writer(&OfflineRenderer::EncodePng, 4)
+{
+	m_width = width;
+	m_height = height;
+	m_frameCount = frameCount;
+	m_outputPrefix = outputPrefix;
+	m_startTime = std::chrono::steady_clock::now();
+
+	WSADATA wsaData;
+	if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0)
+	{
+		throw std::runtime_error("WSAStartup failed");
+	}
+
+	// Port 0 gets any free one, the workers are told which on their command line.
+	sockaddr_in address = {};
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	address.sin_port = 0;
+	int addressLength = sizeof(address);
+
+	m_listenSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (m_listenSocket == INVALID_SOCKET ||
+		bind(m_listenSocket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == SOCKET_ERROR ||
+		listen(m_listenSocket, SOMAXCONN) == SOCKET_ERROR ||
+		getsockname(m_listenSocket, reinterpret_cast<sockaddr*>(&address), &addressLength) == SOCKET_ERROR)
+	{
+		if (m_listenSocket != INVALID_SOCKET) closesocket(m_listenSocket);
+		WSACleanup();
+		throw std::runtime_error("Couldn't open the tile coordinator's socket");
+	}
+	SetupSocket(m_listenSocket);
+
+	// The workers are just this exe again, they load the same scene and pick the shaders up from the shader cache.
+	WCHAR exePath[MAX_PATH];
+	GetModuleFileNameW(nullptr, exePath, MAX_PATH);
+
+	m_workers.resize(workerCount);
+	for (uint32_t i = 0; i < workerCount; i++)
+	{
+		std::wstring commandLine = L"\"" + std::wstring(exePath) + L"\" -worker " + std::to_wstring(ntohs(address.sin_port)) +
+			L" -workerid " + std::to_wstring(i) + L" " + workerArgs;
+
+		// CreateProcessW can write to the command line, so it gets a copy it's allowed to.
+		std::vector<WCHAR> commandLineBuffer(commandLine.begin(), commandLine.end());
+		commandLineBuffer.push_back(L'\0');
+
+		STARTUPINFOW startupInfo = {};
+		startupInfo.cb = sizeof(startupInfo);
+		if (!CreateProcessW(nullptr, commandLineBuffer.data(), nullptr, nullptr, FALSE, 0, nullptr, nullptr, &startupInfo, &m_workers[i].process))
+		{
+			OutputDebugStringA("Couldn't start a tile worker\n");
+			LoseWorker(i);
+		}
+	}
+}
+
+TileCoordinator::~TileCoordinator()
+{
+	TileMessage shutdown;
+	shutdown.type = TILE_MESSAGE_SHUTDOWN;
+
+	for (WorkerProcess& worker : m_workers)
+	{
+		if (worker.socket != INVALID_SOCKET)
+		{
+			SendTileMessage(worker.socket, shutdown);
+			closesocket(worker.socket);
+		}
+	}
+
+	for (PendingConnection& connection : m_pending)
+	{
+		closesocket(connection.socket);
+	}
+
+	// Give them a moment to tidy up, but a stuck one doesn't get to outlive the render.
+	for (WorkerProcess& worker : m_workers)
+	{
+		if (worker.process.hProcess != nullptr)
+		{
+			if (WaitForSingleObject(worker.process.hProcess, 5000) == WAIT_TIMEOUT)
+			{
+				TerminateProcess(worker.process.hProcess, 1);
+			}
+			CloseHandle(worker.process.hThread);
+			CloseHandle(worker.process.hProcess);
+		}
+	}
+
+	closesocket(m_listenSocket);
+	WSACleanup();
+}
+#pragma endregion
+
+#pragma region Coordinator Frame Methods
+bool TileCoordinator::Pump()
+{
+	double now = Seconds();
+
+	AcceptWorkers();
+
+	// One that dies before connecting never shows up as a closed socket, so keep an eye on the processes too.
+	for (uint32_t i = 0; i < m_workers.size(); i++)
+	{
+		WorkerProcess& worker = m_workers[i];
+		if (!worker.lost && worker.socket == INVALID_SOCKET && WaitForSingleObject(worker.process.hProcess, 0) == WAIT_OBJECT_0)
+		{
+			LoseWorker(i);
+		}
+	}
+
+	// Keep a few frames split up, so a worker that runs out at the end of one has the next to start on.
+	while (m_framesAdded < m_frameCount && m_frames.size() < kFramesInFlight && !HasFailed())
+	{
+		FrameAssembly& assembly = m_frames[m_framesAdded];
+		assembly.pixels.assign(static_cast<size_t>(m_width) * m_height * 4, 0);
+		assembly.startSeconds = now;
+		assembly.tilesLeft = m_scheduler.AddFrame(m_framesAdded);
+		m_framesAdded++;
+	}
+
+	for (uint32_t i = 0; i < m_workers.size(); i++)
+	{
+		if (!m_workers[i].lost && m_workers[i].socket != INVALID_SOCKET)
+		{
+			ReceiveFrom(i, now);
+		}
+	}
+
+	for (uint32_t i = 0; i < m_workers.size(); i++)
+	{
+		TileJob job;
+		while (!m_workers[i].lost && m_workers[i].socket != INVALID_SOCKET && m_scheduler.GetInFlight(i) < kTilesPerWorker &&
+			m_scheduler.NextTile(i, now, job))
+		{
+			TileMessage request;
+			request.type = TILE_MESSAGE_REQUEST;
+			request.tileId = job.tileId;
+			request.frame = job.frame;
+			request.frameCount = m_frameCount;
+			request.rect = job.rect;
+
+			if (!SendTileMessage(m_workers[i].socket, request))
+			{
+				LoseWorker(i);
+			}
+		}
+	}
+
+	return m_framesWritten >= m_frameCount;
+}
+
+bool TileCoordinator::Finish(const std::string& timingsPath)
+{
+	m_writer.Flush();
+
+	std::vector<ImageWriteResult> results = m_writer.TakeResults();
+	m_results.insert(m_results.end(), results.begin(), results.end());
+
+	const TileSchedulerStats& stats = m_scheduler.GetStats();
+	char summary[256];
+	snprintf(summary, sizeof(summary), "Tile render: %llu tiles, %llu stolen, %llu speculative, %llu duplicates, %llu requeued\n",
+		stats.completed, stats.stolen, stats.speculative, stats.duplicates, stats.requeued);
+	OutputDebugStringA(summary);
+
+	for (size_t i = 0; i < m_workers.size(); i++)
+	{
+		snprintf(summary, sizeof(summary), "  Worker %zu: %llu tiles%s\n", i, m_workers[i].tilesDone, m_workers[i].lost ? " (lost)" : "");
+		OutputDebugStringA(summary);
+	}
+
+	std::ofstream file(timingsPath, std::ios::trunc);
+	if (!file)
+	{
+		return false;
+	}
+
+	bool allWritten = true;
+	file << "frame,path,render_ms,encode_ms,written\n";
+	for (const ImageWriteResult& result : m_results)
+	{
+		file << result.frame << ',' << result.path << ',' << result.renderMs << ',' << result.encodeMs << ',' << (result.succeeded ? 1 : 0) << '\n';
+		allWritten = allWritten && result.succeeded;
+	}
+
+	return allWritten && static_cast<bool>(file);
+}
+#pragma endregion
+
+#pragma region Coordinator Private Methods
+void TileCoordinator::AcceptWorkers()
+{
+	for (;;)
+	{
+		SOCKET socket = accept(m_listenSocket, nullptr, nullptr);
+		if (socket == INVALID_SOCKET)
+		{
+			break;
+		}
+
+		SetupSocket(socket);
+		PendingConnection connection;
+		connection.socket = socket;
+		m_pending.push_back(connection);
+	}
+
+	// A connection's only a worker once it's said which one it is.
+	for (size_t i = 0; i < m_pending.size();)
+	{
+		PendingConnection& connection = m_pending[i];
+		bool open = ReceiveAvailable(connection.socket, connection.decoder);
+
+		TileMessage hello;
+		if (connection.decoder.Next(hello))
+		{
+			if (hello.type == TILE_MESSAGE_HELLO && hello.tileId < m_workers.size() && !m_workers[hello.tileId].lost &&
+				m_workers[hello.tileId].socket == INVALID_SOCKET)
+			{
+				m_workers[hello.tileId].socket = connection.socket;
+				m_workers[hello.tileId].decoder = connection.decoder;
+			}
+			else
+			{
+				closesocket(connection.socket);
+			}
+			m_pending.erase(m_pending.begin() + i);
+		}
+		else if (!open || connection.decoder.HasError())
+		{
+			closesocket(connection.socket);
+			m_pending.erase(m_pending.begin() + i);
+		}
+		else
+		{
+			i++;
+		}
+	}
+}
+
+void TileCoordinator::ReceiveFrom(uint32_t worker, double nowSeconds)
+{
+	bool open = ReceiveAvailable(m_workers[worker].socket, m_workers[worker].decoder);
+
+	TileMessage message;
+	while (!m_workers[worker].lost && m_workers[worker].decoder.Next(message))
+	{
+		if (message.type == TILE_MESSAGE_RESULT)
+		{
+			HandleResult(worker, message, nowSeconds);
+		}
+	}
+
+	if (!m_workers[worker].lost && (!open || m_workers[worker].decoder.HasError()))
+	{
+		LoseWorker(worker);
+	}
+}
+
+void TileCoordinator::HandleResult(uint32_t worker, const TileMessage& message, double nowSeconds)
+{
+	// Where the tile goes comes from the scheduler, the rect on the wire only has to agree with it. A tile it no longer
+	// knows about is a late duplicate, the scheduler still gets told so it's counted.
+	uint64_t scheduledFrame = 0;
+	TileRect rect;
+	if (!m_scheduler.GetTile(message.tileId, scheduledFrame, rect))
+	{
+		m_scheduler.CompleteTile(worker, message.tileId, nowSeconds);
+		return;
+	}
+
+	// Check it before the scheduler counts it done, a tile that isn't the one asked for has to be rendered again by someone else.
+	if (message.frame != scheduledFrame || message.rect.x != rect.x || message.rect.y != rect.y ||
+		message.rect.width != rect.width || message.rect.height != rect.height ||
+		message.pixels.size() != static_cast<size_t>(rect.width) * rect.height * 4)
+	{
+		OutputDebugStringA("A tile worker sent back a broken tile\n");
+		LoseWorker(worker);
+		return;
+	}
+
+	if (!m_scheduler.CompleteTile(worker, message.tileId, nowSeconds))
+	{
+		return;
+	}
+
+	m_workers[worker].tilesDone++;
+
+	auto frame = m_frames.find(scheduledFrame);
+	if (frame == m_frames.end())
+	{
+		return;
+	}
+
+	FrameAssembly& assembly = frame->second;
+	TileScheduler::BlitTile(assembly.pixels.data(), m_width, rect, message.pixels.data());
+	assembly.tilesLeft--;
+
+	if (assembly.tilesLeft == 0)
+	{
+		ImageWriteJob job;
+		job.frame = static_cast<uint32_t>(scheduledFrame);
+		job.width = m_width;
+		job.height = m_height;
+		job.renderMs = (nowSeconds - assembly.startSeconds) * 1000.0;
+		job.pixels = std::move(assembly.pixels);
+
+		char frameName[32];
+		snprintf(frameName, sizeof(frameName), "_%05u.png", job.frame);
+		job.path = m_outputPrefix + frameName;
+
+		m_frames.erase(frame);
+		m_framesWritten++;
+		m_writer.Submit(std::move(job));
+	}
+}
+
+void TileCoordinator::LoseWorker(uint32_t worker)
+{
+	if (m_workers[worker].lost)
+	{
+		return;
+	}
+
+	m_workers[worker].lost = true;
+	if (m_workers[worker].socket != INVALID_SOCKET)
+	{
+		closesocket(m_workers[worker].socket);
+		m_workers[worker].socket = INVALID_SOCKET;
+	}
+
+	m_scheduler.RemoveWorker(worker);
+}
+
+double TileCoordinator::Seconds() const
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - m_startTime).count();
+}
+#pragma endregion
+
+#pragma region Worker Constructors and Destructors
+TileWorker::TileWorker(ComPtr<ID3D12Device5> device, ComPtr<ID3D12Resource> outputResource, uint32_t frameSlots, uint16_t port, uint32_t workerId)
+{
+	m_outputResource = outputResource;
+
+	WSADATA wsaData;
+	if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0)
+	{
+		throw std::runtime_error("WSAStartup failed");
+	}
+
+	sockaddr_in address = {};
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	address.sin_port = htons(port);
+
+	// The coordinator's listening before it starts anyone, so this either works first time or isn't going to.
+	m_socket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (m_socket == INVALID_SOCKET || connect(m_socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == SOCKET_ERROR)
+	{
+		if (m_socket != INVALID_SOCKET) closesocket(m_socket);
+		WSACleanup();
+		throw std::runtime_error("Couldn't connect to the tile coordinator");
+	}
+	SetupSocket(m_socket);
+
+	TileMessage hello;
+	hello.type = TILE_MESSAGE_HELLO;
+	hello.tileId = workerId;
+	m_shutdown = !SendTileMessage(m_socket, hello);
+
+	// Each slot has room for the whole output, a tile's never bigger than that.
+	D3D12_RESOURCE_DESC outputDesc = m_outputResource->GetDesc();
+	m_format = outputDesc.Format;
+	UINT64 rowPitch = AlignUp(outputDesc.Width * 4, D3D12_TEXTURE_DATA_PITCH_ALIGNMENT);
+	m_slotBytes = AlignUp(rowPitch * outputDesc.Height, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+
+	CD3DX12_HEAP_PROPERTIES readbackHeap(D3D12_HEAP_TYPE_READBACK);
+	CD3DX12_RESOURCE_DESC readbackDesc = CD3DX12_RESOURCE_DESC::Buffer(m_slotBytes * frameSlots);
+	ThrowIfFailed(device->CreateCommittedResource(&readbackHeap, D3D12_HEAP_FLAG_NONE, &readbackDesc,
+		D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&m_readback)));
+	m_readback->SetName(L"Tile Worker Readback");
+
+	m_pending.assign(frameSlots, false);
+	m_pendingJobs.resize(frameSlots);
+}
+
+TileWorker::~TileWorker()
+{
+	closesocket(m_socket);
+	WSACleanup();
+}
+#pragma endregion
+
+#pragma region Worker Tile Methods
+void TileWorker::Poll()
+{
+	if (m_shutdown)
+	{
+		return;
+	}
+
+	bool open = ReceiveAvailable(m_socket, m_decoder);
+
+	TileMessage message;
+	while (m_decoder.Next(message))
+	{
+		if (message.type == TILE_MESSAGE_REQUEST)
+		{
+			// The capture copies the rect straight out of the output, one that hangs off the edge is a broken coordinator.
+			D3D12_RESOURCE_DESC outputDesc = m_outputResource->GetDesc();
+			if (!TileScheduler::RectFits(message.rect, static_cast<uint32_t>(outputDesc.Width), outputDesc.Height))
+			{
+				m_shutdown = true;
+				break;
+			}
+			m_jobs.push_back(std::move(message));
+		}
+		else if (message.type == TILE_MESSAGE_SHUTDOWN)
+		{
+			m_shutdown = true;
+		}
+	}
+
+	if (!open || m_decoder.HasError())
+	{
+		m_shutdown = true;
+	}
+}
+
+bool TileWorker::TakeJob(TileMessage& job)
+{
+	if (m_jobs.empty())
+	{
+		return false;
+	}
+
+	job = std::move(m_jobs.front());
+	m_jobs.pop_front();
+	return true;
+}
+
+void TileWorker::RecordCapture(ID3D12GraphicsCommandList* commandList, uint32_t slot, const TileMessage& job, double renderMs)
+{
+	const TileRect& rect = job.rect;
+
+	D3D12_TEXTURE_COPY_LOCATION source = {};
+	source.pResource = m_outputResource.Get();
+	source.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+	source.SubresourceIndex = 0;
+
+	D3D12_TEXTURE_COPY_LOCATION destination = {};
+	destination.pResource = m_readback.Get();
+	destination.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
+	destination.PlacedFootprint.Offset = slot * m_slotBytes;
+	destination.PlacedFootprint.Footprint.Format = m_format;
+	destination.PlacedFootprint.Footprint.Width = rect.width;
+	destination.PlacedFootprint.Footprint.Height = rect.height;
+	destination.PlacedFootprint.Footprint.Depth = 1;
+	destination.PlacedFootprint.Footprint.RowPitch = static_cast<UINT>(AlignUp(rect.width * 4, D3D12_TEXTURE_DATA_PITCH_ALIGNMENT));
+
+	// Only the tile, the rest of the output is whatever the last tile left there.
+	D3D12_BOX box = { rect.x, rect.y, 0, rect.x + rect.width, rect.y + rect.height, 1 };
+	commandList->CopyTextureRegion(&destination, 0, 0, 0, &source, &box);
+
+	m_pending[slot] = true;
+	m_pendingJobs[slot] = job;
+	m_pendingJobs[slot].renderMs = renderMs;
+}
+
+void TileWorker::CollectFrame(uint32_t slot)
+{
+	if (!m_pending[slot])
+	{
+		return;
+	}
+
+	TileMessage& result = m_pendingJobs[slot];
+	const TileRect& rect = result.rect;
+	UINT64 rowPitch = AlignUp(rect.width * 4, D3D12_TEXTURE_DATA_PITCH_ALIGNMENT);
+
+	D3D12_RANGE readRange = { slot * m_slotBytes, slot * m_slotBytes + rowPitch * rect.height };
+	D3D12_RANGE writtenRange = { 0, 0 };
+
+	uint8_t* pData;
+	ThrowIfFailed(m_readback->Map(0, &readRange, reinterpret_cast<void**>(&pData)));
+
+	// Same as a whole frame, the row padding comes out and alpha's set, since nothing writes a meaningful one.
+	uint32_t rowBytes = rect.width * 4;
+	result.pixels.resize(static_cast<size_t>(rowBytes) * rect.height);
+	for (uint32_t row = 0; row < rect.height; row++)
+	{
+		uint8_t* destination = result.pixels.data() + static_cast<size_t>(row) * rowBytes;
+		memcpy(destination, pData + readRange.Begin + row * rowPitch, rowBytes);
+
+		for (uint32_t x = 0; x < rect.width; x++)
+		{
+			destination[x * 4 + 3] = 255;
+		}
+	}
+
+	m_readback->Unmap(0, &writtenRange);
+	m_pending[slot] = false;
+
+	result.type = TILE_MESSAGE_RESULT;
+	if (!SendTileMessage(m_socket, result))
+	{
+		m_shutdown = true;
+	}
+	result.pixels.clear();
+}
+
+bool TileWorker::HasPendingCaptures() const
+{
+	for (bool pending : m_pending)
+	{
+		if (pending)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+#pragma endregion
@@ -0,0 +1,195 @@
+#pragma once
+
+#pragma region Includes
+//Include{s}
+#include <winsock2.h>
+#include <chrono>
+#include <deque>
+#include <map>
+#include "AsyncImageWriter.h"
+#include "DXRApp.h"
+#include "TileProtocol.h"
+#include "TileScheduler.h"
+#pragma endregion
+
+/// <summary>
+/// The TileCoordinator class. Runs a -render across worker processes, each one a copy of this exe started with -worker.
+/// Frames get split into tiles by the scheduler, handed out over loopback sockets, and the results are put back together
+/// and written out as they arrive. It doesn't render any tiles itself.
+/// </summary>
+class TileCoordinator
+{
+public:
+#pragma region Constructors and Destructors
+	/// <summary>
+	/// Initializes a new instance of the TileCoordinator class, opens the socket and starts the workers.
+	/// </summary>
+	/// <param name="workerCount">How many worker processes to start.</param>
+	/// <param name="frameCount">How many frames to render.</param>
+	/// <param name="width">The frame width.</param>
+	/// <param name="height">The frame height.</param>
+	/// <param name="tileSize">How big the tiles are.</param>
+	/// <param name="workerArgs">Anything else to pass the workers, like the camera path.</param>
+	/// <param name="outputPrefix">What the files are called, the frame number and .png go on the end.</param>
+	TileCoordinator(uint32_t workerCount, uint32_t frameCount, uint32_t width, uint32_t height, uint32_t tileSize,
+		const std::wstring& workerArgs, const std::string& outputPrefix);
+
+	/// <summary>
+	/// Tells the workers to stop, and makes sure they have.
+	/// </summary>
+	~TileCoordinator();
+
+	TileCoordinator(const TileCoordinator&) = delete;
+	TileCoordinator& operator=(const TileCoordinator&) = delete;
+#pragma endregion
+
+#pragma region Frame Methods
+	/// <summary>
+	/// Does whatever there is to do without waiting, takes connections and results in and sends tiles out.
+	/// </summary>
+	/// <returns>True once every frame has been handed to the writer.</returns>
+	bool Pump();
+
+	/// <summary>
+	/// Whether every worker has gone, there's no finishing the render after that.
+	/// </summary>
+	bool HasFailed() const { return m_scheduler.GetAliveWorkers() == 0; }
+
+	/// <summary>
+	/// Waits for the writer, then writes every frame's times to a CSV, with how the tiles were shared out at the bottom.
+	/// </summary>
+	/// <returns>False if a frame or the CSV couldn't be written.</returns>
+	bool Finish(const std::string& timingsPath);
+#pragma endregion
+
+private:
+#pragma region Private Methods
+	void AcceptWorkers();
+	void ReceiveFrom(uint32_t worker, double nowSeconds);
+	void HandleResult(uint32_t worker, const TileMessage& message, double nowSeconds);
+	void LoseWorker(uint32_t worker);
+	double Seconds() const;
+#pragma endregion
+
+#pragma region Private Variables
+	struct WorkerProcess
+	{
+		PROCESS_INFORMATION process = {};
+		SOCKET socket = INVALID_SOCKET;
+		TileMessageDecoder decoder;
+		uint64_t tilesDone = 0;
+		bool lost = false;
+	};
+
+	struct PendingConnection
+	{
+		SOCKET socket;
+		TileMessageDecoder decoder;
+	};
+
+	// A frame being put back together, it's written out as soon as its last tile comes in.
+	struct FrameAssembly
+	{
+		std::vector<uint8_t> pixels;
+		uint32_t tilesLeft;
+		double startSeconds;
+	};
+
+	static const uint32_t kFramesInFlight = 3; // Enough that there's always something to steal at the end of a frame
+	static const uint32_t kTilesPerWorker = 2; // One rendering, one waiting, any more and slow tiles look slower than they are
+
+	SOCKET m_listenSocket = INVALID_SOCKET;
+	std::vector<WorkerProcess> m_workers;
+	std::vector<PendingConnection> m_pending; // Connected, but haven't said which worker they are yet
+
+	TileScheduler m_scheduler;
+	std::map<uint64_t, FrameAssembly> m_frames;
+	uint32_t m_width;
+	uint32_t m_height;
+	uint32_t m_frameCount;
+	uint32_t m_framesAdded = 0;
+	uint32_t m_framesWritten = 0;
+	std::string m_outputPrefix;
+	std::chrono::steady_clock::time_point m_startTime;
+
+	AsyncImageWriter m_writer;
+	std::vector<ImageWriteResult> m_results;
+#pragma endregion
+};
+
+/// <summary>
+/// The TileWorker class. The worker side of a distributed render, takes tiles from the coordinator, and once they've been
+/// rendered copies just the tile out of the output and sends it back. Readback works like the OfflineRenderer, a part of the
+/// buffer per frame slot, collected when the pacer hands the slot back.
+/// </summary>
+class TileWorker
+{
+public:
+#pragma region Constructors and Destructors
+	/// <summary>
+	/// Initializes a new instance of the TileWorker class and connects to the coordinator.
+	/// </summary>
+	/// <param name="device">The device to make the readback buffer on.</param>
+	/// <param name="outputResource">The raytracing output, tiles are copied out of it.</param>
+	/// <param name="frameSlots">How many frames can be in flight.</param>
+	/// <param name="port">The coordinator's port on 127.0.0.1.</param>
+	/// <param name="workerId">Which worker this is, so the coordinator can match it to its process.</param>
+	TileWorker(ComPtr<ID3D12Device5> device, ComPtr<ID3D12Resource> outputResource, uint32_t frameSlots, uint16_t port, uint32_t workerId);
+
+	~TileWorker();
+
+	TileWorker(const TileWorker&) = delete;
+	TileWorker& operator=(const TileWorker&) = delete;
+#pragma endregion
+
+#pragma region Tile Methods
+	/// <summary>
+	/// Reads anything the coordinator has sent without waiting.
+	/// </summary>
+	void Poll();
+
+	bool HasJob() const { return !m_jobs.empty(); }
+
+	/// <summary>
+	/// Takes the next tile to render.
+	/// </summary>
+	/// <returns>False if there isn't one.</returns>
+	bool TakeJob(TileMessage& job);
+
+	/// <summary>
+	/// Copies the job's tile out of the output into the slot's part of the readback buffer. The output has to be a copy source already.
+	/// </summary>
+	void RecordCapture(ID3D12GraphicsCommandList* commandList, uint32_t slot, const TileMessage& job, double renderMs);
+
+	/// <summary>
+	/// Sends back the tile the slot copied out last time round, if it did. Call it once the pacer has the slot.
+	/// </summary>
+	void CollectFrame(uint32_t slot);
+
+	/// <summary>
+	/// Whether any slot has a tile waiting to be collected.
+	/// </summary>
+	bool HasPendingCaptures() const;
+
+	/// <summary>
+	/// Whether the coordinator's said to stop, or gone away.
+	/// </summary>
+	bool IsShutdown() const { return m_shutdown; }
+#pragma endregion
+
+private:
+#pragma region Private Variables
+	SOCKET m_socket = INVALID_SOCKET;
+	TileMessageDecoder m_decoder;
+	std::deque<TileMessage> m_jobs;
+	bool m_shutdown = false;
+
+	ComPtr<ID3D12Resource> m_outputResource;
+	ComPtr<ID3D12Resource> m_readback;
+	DXGI_FORMAT m_format;
+	UINT64 m_slotBytes = 0;
+
+	std::vector<bool> m_pending;
+	std::vector<TileMessage> m_pendingJobs;
+#pragma endregion
+};
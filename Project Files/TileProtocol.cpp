@@ -0,0 +1,122 @@
+#pragma region Includes
+//Include{s}
+#include "TileProtocol.h"
+#include <cstring>
+#pragma endregion
+
+#pragma region Byte Helpers
+namespace
+{
+	// Byte at a time, so it comes out little endian whatever the machine is.
+	void Write(std::vector<uint8_t>& buffer, uint64_t value, size_t bytes)
+	{
+		for (size_t i = 0; i < bytes; i++)
+		{
+			buffer.push_back(static_cast<uint8_t>(value >> (8 * i)));
+		}
+	}
+
+	uint64_t Read(const uint8_t*& data, size_t bytes)
+	{
+		uint64_t value = 0;
+		for (size_t i = 0; i < bytes; i++)
+		{
+			value |= static_cast<uint64_t>(data[i]) << (8 * i);
+		}
+		data += bytes;
+		return value;
+	}
+
+	// Everything in the payload before the pixels.
+	const size_t kFixedPayloadBytes = 4 + 8 + 4 + 16 + 8 + 4;
+}
+#pragma endregion
+
+#pragma region Protocol Methods
+void TileProtocol::Encode(const TileMessage& message, std::vector<uint8_t>& buffer)
+{
+	uint64_t renderMsBits;
+	memcpy(&renderMsBits, &message.renderMs, sizeof(renderMsBits));
+
+	buffer.reserve(buffer.size() + kHeaderBytes + kFixedPayloadBytes + message.pixels.size());
+
+	Write(buffer, kMagic, 4);
+	Write(buffer, kVersion, 2);
+	Write(buffer, message.type, 2);
+	Write(buffer, kFixedPayloadBytes + message.pixels.size(), 4);
+
+	Write(buffer, message.tileId, 4);
+	Write(buffer, message.frame, 8);
+	Write(buffer, message.frameCount, 4);
+	Write(buffer, message.rect.x, 4);
+	Write(buffer, message.rect.y, 4);
+	Write(buffer, message.rect.width, 4);
+	Write(buffer, message.rect.height, 4);
+	Write(buffer, renderMsBits, 8);
+	Write(buffer, message.pixels.size(), 4);
+	buffer.insert(buffer.end(), message.pixels.begin(), message.pixels.end());
+}
+#pragma endregion
+
+#pragma region Decoder Methods
+void TileMessageDecoder::Feed(const uint8_t* data, size_t size)
+{
+	// Drop what's been read once it's most of the buffer, rather than shuffling on every message.
+	if (m_readOffset > 0 && m_readOffset * 2 >= m_buffer.size())
+	{
+		m_buffer.erase(m_buffer.begin(), m_buffer.begin() + m_readOffset);
+		m_readOffset = 0;
+	}
+
+	m_buffer.insert(m_buffer.end(), data, data + size);
+}
+
+bool TileMessageDecoder::Next(TileMessage& message)
+{
+	if (m_error || GetBufferedBytes() < TileProtocol::kHeaderBytes)
+	{
+		return false;
+	}
+
+	const uint8_t* data = m_buffer.data() + m_readOffset;
+	uint32_t magic = static_cast<uint32_t>(Read(data, 4));
+	uint16_t version = static_cast<uint16_t>(Read(data, 2));
+	uint16_t type = static_cast<uint16_t>(Read(data, 2));
+	uint32_t payloadBytes = static_cast<uint32_t>(Read(data, 4));
+
+	if (magic != TileProtocol::kMagic || version != TileProtocol::kVersion || type < TILE_MESSAGE_HELLO || type > TILE_MESSAGE_SHUTDOWN ||
+		payloadBytes < kFixedPayloadBytes || payloadBytes > TileProtocol::kMaxPayloadBytes)
+	{
+		m_error = true;
+		return false;
+	}
+
+	if (GetBufferedBytes() < TileProtocol::kHeaderBytes + payloadBytes)
+	{
+		return false;
+	}
+
+	message.type = static_cast<TileMessageType>(type);
+	message.tileId = static_cast<uint32_t>(Read(data, 4));
+	message.frame = Read(data, 8);
+	message.frameCount = static_cast<uint32_t>(Read(data, 4));
+	message.rect.x = static_cast<uint32_t>(Read(data, 4));
+	message.rect.y = static_cast<uint32_t>(Read(data, 4));
+	message.rect.width = static_cast<uint32_t>(Read(data, 4));
+	message.rect.height = static_cast<uint32_t>(Read(data, 4));
+
+	uint64_t renderMsBits = Read(data, 8);
+	memcpy(&message.renderMs, &renderMsBits, sizeof(renderMsBits));
+
+	uint32_t pixelBytes = static_cast<uint32_t>(Read(data, 4));
+	if (pixelBytes != payloadBytes - kFixedPayloadBytes)
+	{
+		m_error = true;
+		return false;
+	}
+
+	message.pixels.assign(data, data + pixelBytes);
+	m_readOffset += TileProtocol::kHeaderBytes + payloadBytes;
+	return true;
+}
+#pragma endregion
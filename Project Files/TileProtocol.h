@@ -0,0 +1,85 @@
+#pragma once
+
+#pragma region Includes
+//Include{s}
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "TileScheduler.h"
+#pragma endregion
+
+// No Windows headers, this only turns messages into bytes and back, the sockets live with the coordinator and worker.
+
+#pragma region Data Structures
+/// <summary>
+/// What a tile message is.
+/// </summary>
+enum TileMessageType : uint16_t
+{
+	TILE_MESSAGE_HELLO = 1, // Worker to coordinator, first thing after connecting
+	TILE_MESSAGE_REQUEST, // Coordinator to worker, render this tile
+	TILE_MESSAGE_RESULT, // Worker to coordinator, the tile's pixels
+	TILE_MESSAGE_SHUTDOWN, // Coordinator to worker, all done
+};
+
+/// <summary>
+/// One message. Every type has the same fields, the ones a type doesn't use are left at zero.
+/// </summary>
+struct TileMessage
+{
+	TileMessageType type = TILE_MESSAGE_HELLO;
+	uint32_t tileId = 0;
+	uint64_t frame = 0;
+	uint32_t frameCount = 0; // How many frames the whole render is, so a worker knows where on the camera path the frame is
+	TileRect rect;
+	double renderMs = 0.0;
+	std::vector<uint8_t> pixels; // Tightly packed RGBA8, results only
+};
+#pragma endregion
+
+/// <summary>
+/// The TileProtocol class. Messages are a 12 byte header (magic, version, type, payload size) then the payload, all little endian.
+/// </summary>
+class TileProtocol
+{
+public:
+	static const uint32_t kMagic = 0x50544C52; // "RLTP"
+	static const uint16_t kVersion = 1;
+	static const size_t kHeaderBytes = 12;
+	static const uint32_t kMaxPayloadBytes = 64u * 1024u * 1024u; // Anything bigger is garbage, not a tile
+
+	/// <summary>
+	/// Adds a message onto the end of a buffer.
+	/// </summary>
+	static void Encode(const TileMessage& message, std::vector<uint8_t>& buffer);
+};
+
+/// <summary>
+/// The TileMessageDecoder class. Takes bytes as they come off a socket, in whatever sized bits, and hands back whole messages.
+/// </summary>
+class TileMessageDecoder
+{
+public:
+	/// <summary>
+	/// Adds bytes that have arrived.
+	/// </summary>
+	void Feed(const uint8_t* data, size_t size);
+
+	/// <summary>
+	/// Takes the next whole message.
+	/// </summary>
+	/// <returns>False if there isn't one yet, or the stream's broken.</returns>
+	bool Next(TileMessage& message);
+
+	/// <summary>
+	/// Whether the stream had something in it that wasn't a message, there's no recovering from that.
+	/// </summary>
+	bool HasError() const { return m_error; }
+
+	size_t GetBufferedBytes() const { return m_buffer.size() - m_readOffset; }
+
+private:
+	std::vector<uint8_t> m_buffer;
+	size_t m_readOffset = 0;
+	bool m_error = false;
+};
@@ -0,0 +1,304 @@
+#pragma region Includes
+//Include{s}
+#include "TileScheduler.h"
+#include <cstring>
+#include <stdexcept>
+#pragma endregion
+
+#pragma region Constructors and Destructors
+TileScheduler::TileScheduler(uint32_t width, uint32_t height, uint32_t tileSize, uint32_t workerCount, double slowTileFactor)
+{
+	if (workerCount == 0 || tileSize == 0)
+	{
+		throw std::logic_error("TileScheduler needs at least one worker and a tile size");
+	}
+
+	m_frameTiles = SplitFrame(width, height, tileSize);
+	m_slowTileFactor = slowTileFactor;
+	m_queues.resize(workerCount);
+	m_workerAlive.assign(workerCount, true);
+}
+#pragma endregion
+
+#pragma region Scheduling Methods
+uint32_t TileScheduler::AddFrame(uint64_t frame)
+{
+	if (GetAliveWorkers() == 0)
+	{
+		return 0;
+	}
+
+	for (const TileRect& rect : m_frameTiles)
+	{
+		uint32_t tileId = m_nextTileId++;
+
+		TileState& tile = m_tiles[tileId];
+		tile.frame = frame;
+		tile.rect = rect;
+
+		// Deal them out one each, so every worker starts on the same frame.
+		while (!m_workerAlive[m_nextWorker])
+		{
+			m_nextWorker = (m_nextWorker + 1) % m_queues.size();
+		}
+		m_queues[m_nextWorker].push_back(tileId);
+		m_nextWorker = (m_nextWorker + 1) % m_queues.size();
+	}
+
+	return static_cast<uint32_t>(m_frameTiles.size());
+}
+
+bool TileScheduler::NextTile(uint32_t worker, double nowSeconds, TileJob& job)
+{
+	if (worker >= m_queues.size() || !m_workerAlive[worker])
+	{
+		return false;
+	}
+
+	// Its own work first, oldest first.
+	if (!m_queues[worker].empty())
+	{
+		uint32_t tileId = m_queues[worker].front();
+		m_queues[worker].pop_front();
+		Issue(worker, tileId, nowSeconds, false, job);
+		return true;
+	}
+
+	// Then steal off the back of whoever has the most left, that's the work they'd get to last anyway.
+	size_t victim = m_queues.size();
+	size_t victimLength = 0;
+	for (size_t other = 0; other < m_queues.size(); other++)
+	{
+		if (m_queues[other].size() > victimLength)
+		{
+			victim = other;
+			victimLength = m_queues[other].size();
+		}
+	}
+
+	if (victim < m_queues.size())
+	{
+		uint32_t tileId = m_queues[victim].back();
+		m_queues[victim].pop_back();
+		m_stats.stolen++;
+		Issue(worker, tileId, nowSeconds, false, job);
+		return true;
+	}
+
+	// Nothing queued anywhere, so help with the slowest tile still out, if it's slow enough to be worth doing twice.
+	if (m_timedTiles == 0)
+	{
+		return false;
+	}
+
+	double slowSeconds = GetAverageTileSeconds() * m_slowTileFactor;
+	const InFlightTile* slowest = nullptr;
+	for (const InFlightTile& inFlight : m_inFlight)
+	{
+		if (inFlight.worker == worker || m_tiles[inFlight.tileId].copiesOut > 1 || nowSeconds - inFlight.startSeconds < slowSeconds)
+		{
+			continue;
+		}
+
+		if (slowest == nullptr || inFlight.startSeconds < slowest->startSeconds)
+		{
+			slowest = &inFlight;
+		}
+	}
+
+	if (slowest == nullptr)
+	{
+		return false;
+	}
+
+	m_stats.speculative++;
+	Issue(worker, slowest->tileId, nowSeconds, true, job);
+	return true;
+}
+
+bool TileScheduler::CompleteTile(uint32_t worker, uint32_t tileId, double nowSeconds)
+{
+	// Whatever happens this worker isn't on the tile anymore.
+	double startSeconds = nowSeconds;
+	bool wasInFlight = false;
+	for (size_t i = 0; i < m_inFlight.size(); i++)
+	{
+		if (m_inFlight[i].tileId == tileId && m_inFlight[i].worker == worker)
+		{
+			startSeconds = m_inFlight[i].startSeconds;
+			wasInFlight = true;
+			m_inFlight.erase(m_inFlight.begin() + i);
+			break;
+		}
+	}
+
+	auto tile = m_tiles.find(tileId);
+	if (tile == m_tiles.end() || !wasInFlight)
+	{
+		m_stats.duplicates++;
+		return false;
+	}
+
+	m_tiles.erase(tile);
+	m_totalTileSeconds += nowSeconds - startSeconds;
+	m_timedTiles++;
+	m_stats.completed++;
+
+	// A speculative copy might still be out, it'll come back as a duplicate but nothing should wait on it.
+	for (size_t i = 0; i < m_inFlight.size();)
+	{
+		if (m_inFlight[i].tileId == tileId)
+		{
+			m_inFlight.erase(m_inFlight.begin() + i);
+		}
+		else
+		{
+			i++;
+		}
+	}
+
+	return true;
+}
+
+void TileScheduler::RemoveWorker(uint32_t worker)
+{
+	if (worker >= m_queues.size() || !m_workerAlive[worker])
+	{
+		return;
+	}
+
+	m_workerAlive[worker] = false;
+	std::deque<uint32_t> orphaned;
+	orphaned.swap(m_queues[worker]);
+
+	// Anything it had out goes to the front, it's the oldest work there is. Unless someone else has a copy already.
+	for (size_t i = 0; i < m_inFlight.size();)
+	{
+		if (m_inFlight[i].worker != worker)
+		{
+			i++;
+			continue;
+		}
+
+		uint32_t tileId = m_inFlight[i].tileId;
+		m_inFlight.erase(m_inFlight.begin() + i);
+
+		TileState& tile = m_tiles[tileId];
+		tile.copiesOut--;
+		if (tile.copiesOut == 0)
+		{
+			orphaned.push_front(tileId);
+			m_stats.requeued++;
+		}
+	}
+
+	if (GetAliveWorkers() == 0)
+	{
+		// Keep them queued on a dead worker, stealing won't find them but they're still counted as outstanding.
+		m_queues[worker].swap(orphaned);
+		return;
+	}
+
+	uint32_t next = 0;
+	for (uint32_t tileId : orphaned)
+	{
+		while (!m_workerAlive[next])
+		{
+			next = (next + 1) % m_queues.size();
+		}
+		m_queues[next].push_back(tileId);
+		next = (next + 1) % m_queues.size();
+	}
+}
+#pragma endregion
+
+#pragma region Getters
+uint32_t TileScheduler::GetInFlight(uint32_t worker) const
+{
+	uint32_t count = 0;
+	for (const InFlightTile& inFlight : m_inFlight)
+	{
+		count += inFlight.worker == worker ? 1 : 0;
+	}
+	return count;
+}
+
+bool TileScheduler::GetTile(uint32_t tileId, uint64_t& frame, TileRect& rect) const
+{
+	auto tile = m_tiles.find(tileId);
+	if (tile == m_tiles.end())
+	{
+		return false;
+	}
+
+	frame = tile->second.frame;
+	rect = tile->second.rect;
+	return true;
+}
+
+uint32_t TileScheduler::GetAliveWorkers() const
+{
+	uint32_t count = 0;
+	for (bool alive : m_workerAlive)
+	{
+		count += alive ? 1 : 0;
+	}
+	return count;
+}
+
+std::vector<TileRect> TileScheduler::SplitFrame(uint32_t width, uint32_t height, uint32_t tileSize)
+{
+	std::vector<TileRect> tiles;
+
+	for (uint32_t y = 0; y < height; y += tileSize)
+	{
+		for (uint32_t x = 0; x < width; x += tileSize)
+		{
+			TileRect rect;
+			rect.x = x;
+			rect.y = y;
+			rect.width = width - x < tileSize ? width - x : tileSize;
+			rect.height = height - y < tileSize ? height - y : tileSize;
+			tiles.push_back(rect);
+		}
+	}
+
+	return tiles;
+}
+
+bool TileScheduler::RectFits(const TileRect& rect, uint32_t width, uint32_t height)
+{
+	return rect.width <= width && rect.x <= width - rect.width && rect.height <= height && rect.y <= height - rect.height;
+}
+
+void TileScheduler::BlitTile(uint8_t* frame, uint32_t frameWidth, const TileRect& rect, const uint8_t* tilePixels)
+{
+	size_t tileRowBytes = static_cast<size_t>(rect.width) * 4;
+
+	for (uint32_t row = 0; row < rect.height; row++)
+	{
+		uint8_t* destination = frame + (static_cast<size_t>(rect.y + row) * frameWidth + rect.x) * 4;
+		memcpy(destination, tilePixels + row * tileRowBytes, tileRowBytes);
+	}
+}
+#pragma endregion
+
+#pragma region Private Methods
+void TileScheduler::Issue(uint32_t worker, uint32_t tileId, double nowSeconds, bool speculative, TileJob& job)
+{
+	TileState& tile = m_tiles[tileId];
+	tile.copiesOut++;
+
+	InFlightTile inFlight;
+	inFlight.tileId = tileId;
+	inFlight.worker = worker;
+	inFlight.startSeconds = nowSeconds;
+	m_inFlight.push_back(inFlight);
+
+	job.tileId = tileId;
+	job.frame = tile.frame;
+	job.rect = tile.rect;
+	job.speculative = speculative;
+	m_stats.issued++;
+}
+#pragma endregion
@@ -0,0 +1,171 @@
+#pragma once
+
+#pragma region Includes
+//Include{s}
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <vector>
+#pragma endregion
+
+// No Windows headers, the coordinator does the sockets and just asks this who should render what.
+
+#pragma region Data Structures
+/// <summary>
+/// A rectangle of pixels.
+/// </summary>
+struct TileRect
+{
+	uint32_t x = 0;
+	uint32_t y = 0;
+	uint32_t width = 0;
+	uint32_t height = 0;
+};
+
+/// <summary>
+/// One tile handed to a worker.
+/// </summary>
+struct TileJob
+{
+	uint32_t tileId = 0;
+	uint64_t frame = 0;
+	TileRect rect;
+	bool speculative = false; // A second copy of a tile someone else is being slow with
+};
+
+/// <summary>
+/// What the scheduler's been up to.
+/// </summary>
+struct TileSchedulerStats
+{
+	uint64_t issued = 0;
+	uint64_t completed = 0;
+	uint64_t stolen = 0; // Taken off another worker's queue
+	uint64_t speculative = 0; // Slow tiles issued again
+	uint64_t duplicates = 0; // Results that lost the race to a speculative copy, or the other way round
+	uint64_t requeued = 0; // Tiles a lost worker never finished
+};
+#pragma endregion
+
+/// <summary>
+/// The TileScheduler class. Splits frames into tiles and deals them out to workers, each worker has its own queue.
+/// A worker that runs dry steals from the back of the longest queue, and once there's nothing left to steal it takes
+/// a second copy of whichever tile has been out far longer than tiles usually take. The first result back wins.
+/// </summary>
+class TileScheduler
+{
+public:
+#pragma region Constructors and Destructors
+	/// <summary>
+	/// Initializes a new instance of the TileScheduler class.
+	/// </summary>
+	/// <param name="width">The frame width in pixels.</param>
+	/// <param name="height">The frame height in pixels.</param>
+	/// <param name="tileSize">The tile width and height, edge tiles are smaller.</param>
+	/// <param name="workerCount">How many workers there are.</param>
+	/// <param name="slowTileFactor">How many times the average tile time a tile can be out before it's issued again.</param>
+	TileScheduler(uint32_t width, uint32_t height, uint32_t tileSize, uint32_t workerCount, double slowTileFactor = 3.0);
+#pragma endregion
+
+#pragma region Scheduling Methods
+	/// <summary>
+	/// Splits a frame into tiles and deals them out between the workers that are still around.
+	/// </summary>
+	/// <returns>How many tiles it was split into.</returns>
+	uint32_t AddFrame(uint64_t frame);
+
+	/// <summary>
+	/// Gets the next tile for a worker, from its own queue, then stolen, then a speculative copy of a slow one.
+	/// </summary>
+	/// <param name="worker">The worker asking.</param>
+	/// <param name="nowSeconds">The time now, from any clock as long as it's always the same one.</param>
+	/// <param name="job">The tile, if there was one.</param>
+	/// <returns>False if there's nothing for it to do.</returns>
+	bool NextTile(uint32_t worker, double nowSeconds, TileJob& job);
+
+	/// <summary>
+	/// Marks a tile done.
+	/// </summary>
+	/// <returns>True if this is the first result for the tile, false if it's a late duplicate that should be thrown away.</returns>
+	bool CompleteTile(uint32_t worker, uint32_t tileId, double nowSeconds);
+
+	/// <summary>
+	/// Takes a worker out, its queue and anything it was in the middle of go back to the others.
+	/// </summary>
+	void RemoveWorker(uint32_t worker);
+#pragma endregion
+
+#pragma region Getters
+	/// <summary>
+	/// Gets how many tiles are queued or out, not counting speculative copies twice.
+	/// </summary>
+	size_t GetOutstandingTiles() const { return m_tiles.size(); }
+
+	/// <summary>
+	/// Gets how many tiles a worker has been given and not finished.
+	/// </summary>
+	uint32_t GetInFlight(uint32_t worker) const;
+
+	/// <summary>
+	/// Gets the frame and rect a tile was handed out with, so a result can be checked against what was asked for.
+	/// </summary>
+	/// <returns>False if the tile's already finished or was never issued.</returns>
+	bool GetTile(uint32_t tileId, uint64_t& frame, TileRect& rect) const;
+
+	uint32_t GetTilesPerFrame() const { return static_cast<uint32_t>(m_frameTiles.size()); }
+	uint32_t GetAliveWorkers() const;
+	double GetAverageTileSeconds() const { return m_timedTiles > 0 ? m_totalTileSeconds / m_timedTiles : 0.0; }
+	const TileSchedulerStats& GetStats() const { return m_stats; }
+
+	/// <summary>
+	/// Splits a frame into rows of tiles, left to right, top to bottom.
+	/// </summary>
+	static std::vector<TileRect> SplitFrame(uint32_t width, uint32_t height, uint32_t tileSize);
+
+	/// <summary>
+	/// Whether a rectangle lies inside a frame. Rects come off the network, so it's written so that adding one up can't wrap.
+	/// </summary>
+	static bool RectFits(const TileRect& rect, uint32_t width, uint32_t height);
+
+	/// <summary>
+	/// Copies a tightly packed RGBA8 tile into its place in a frame.
+	/// </summary>
+	static void BlitTile(uint8_t* frame, uint32_t frameWidth, const TileRect& rect, const uint8_t* tilePixels);
+#pragma endregion
+
+private:
+#pragma region Private Methods
+	void Issue(uint32_t worker, uint32_t tileId, double nowSeconds, bool speculative, TileJob& job);
+#pragma endregion
+
+#pragma region Private Variables
+	struct TileState
+	{
+		uint64_t frame = 0;
+		TileRect rect;
+		uint32_t copiesOut = 0;
+	};
+
+	struct InFlightTile
+	{
+		uint32_t tileId;
+		uint32_t worker;
+		double startSeconds;
+	};
+
+	std::vector<TileRect> m_frameTiles;
+	double m_slowTileFactor;
+
+	std::map<uint32_t, TileState> m_tiles; // Every tile not finished yet, so a result for one that isn't here is a duplicate
+	std::vector<std::deque<uint32_t>> m_queues;
+	std::vector<bool> m_workerAlive;
+	std::vector<InFlightTile> m_inFlight;
+	uint32_t m_nextTileId = 0;
+	uint32_t m_nextWorker = 0;
+
+	double m_totalTileSeconds = 0.0;
+	uint64_t m_timedTiles = 0;
+	TileSchedulerStats m_stats;
+#pragma endregion
+};
@@ -0,0 +1,479 @@
+#pragma region Includes
+//Include{s}
+#include "TransformBatch.h"
+#include <algorithm>
+#include <cstring>
+#include <emmintrin.h>
+#pragma endregion
+
+#pragma region SIMD Helpers
+namespace
+{
+	// The same split XMVectorSinCos does: wrap into -pi to pi, fold into -pi/2 to pi/2 (which flips cos), then the polynomials.
+	void SinCos(__m128 angle, __m128& sine, __m128& cosine)
+	{
+		const __m128 twoPi = _mm_set1_ps(6.283185307f);
+		const __m128 inverseTwoPi = _mm_set1_ps(0.159154943f);
+		const __m128 pi = _mm_set1_ps(3.141592654f);
+		const __m128 halfPi = _mm_set1_ps(1.570796327f);
+		const __m128 signBit = _mm_set1_ps(-0.0f);
+
+		__m128 turns = _mm_cvtepi32_ps(_mm_cvtps_epi32(_mm_mul_ps(angle, inverseTwoPi)));
+		__m128 x = _mm_sub_ps(angle, _mm_mul_ps(turns, twoPi));
+
+		// pi - x on the positive side, -pi - x on the negative.
+		__m128 sign = _mm_and_ps(x, signBit);
+		__m128 folded = _mm_sub_ps(_mm_or_ps(pi, sign), x);
+		__m128 fold = _mm_cmpgt_ps(_mm_andnot_ps(signBit, x), halfPi);
+		x = _mm_or_ps(_mm_and_ps(fold, folded), _mm_andnot_ps(fold, x));
+		__m128 cosineSign = _mm_or_ps(_mm_and_ps(fold, _mm_set1_ps(-1.0f)), _mm_andnot_ps(fold, _mm_set1_ps(1.0f)));
+
+		__m128 x2 = _mm_mul_ps(x, x);
+
+		__m128 s = _mm_set1_ps(-2.3889859e-08f);
+		s = _mm_add_ps(_mm_mul_ps(s, x2), _mm_set1_ps(2.7525562e-06f));
+		s = _mm_add_ps(_mm_mul_ps(s, x2), _mm_set1_ps(-0.00019840874f));
+		s = _mm_add_ps(_mm_mul_ps(s, x2), _mm_set1_ps(0.0083333310f));
+		s = _mm_add_ps(_mm_mul_ps(s, x2), _mm_set1_ps(-0.16666667f));
+		s = _mm_add_ps(_mm_mul_ps(s, x2), _mm_set1_ps(1.0f));
+		sine = _mm_mul_ps(s, x);
+
+		__m128 c = _mm_set1_ps(-2.6051615e-07f);
+		c = _mm_add_ps(_mm_mul_ps(c, x2), _mm_set1_ps(2.4760495e-05f));
+		c = _mm_add_ps(_mm_mul_ps(c, x2), _mm_set1_ps(-0.0013888378f));
+		c = _mm_add_ps(_mm_mul_ps(c, x2), _mm_set1_ps(0.041666638f));
+		c = _mm_add_ps(_mm_mul_ps(c, x2), _mm_set1_ps(-0.5f));
+		c = _mm_add_ps(_mm_mul_ps(c, x2), _mm_set1_ps(1.0f));
+		cosine = _mm_mul_ps(c, cosineSign);
+	}
+
+	// The group's 4 flag bytes in one go.
+	uint32_t GroupFlags(const std::vector<uint8_t>& flags, size_t first)
+	{
+		uint32_t groupFlags;
+		std::memcpy(&groupFlags, &flags[first], sizeof(groupFlags));
+		return groupFlags;
+	}
+
+	uint32_t Replicate(uint8_t flag)
+	{
+		return flag * 0x01010101u;
+	}
+
+	// A 4 bit lane mask (from _mm_movemask_ps) turned into a flag in the bytes of those lanes.
+	uint32_t LaneFlags(int laneMask, uint8_t flag)
+	{
+		uint32_t laneFlags = 0;
+		for (int lane = 0; lane < 4; lane++)
+		{
+			if (laneMask & (1 << lane))
+			{
+				laneFlags |= static_cast<uint32_t>(flag) << (lane * 8);
+			}
+		}
+		return laneFlags;
+	}
+
+	// Which lanes differ between two sets of rotations.
+	int DifferentLanes(__m128 aX, __m128 aY, __m128 aZ, __m128 bX, __m128 bY, __m128 bZ)
+	{
+		return _mm_movemask_ps(_mm_or_ps(_mm_or_ps(_mm_cmpneq_ps(aX, bX), _mm_cmpneq_ps(aY, bY)), _mm_cmpneq_ps(aZ, bZ)));
+	}
+
+	// Parent * local, both 3x4 with an unwritten 0 0 0 1 row. Each world row is the local rows mixed by the parent's row,
+	// plus the parent's translation.
+	void Compose(const float* parent, const float* local, float* world)
+	{
+		const __m128 translation = _mm_set_ps(1.0f, 0.0f, 0.0f, 0.0f);
+		__m128 local0 = _mm_loadu_ps(local + 0);
+		__m128 local1 = _mm_loadu_ps(local + 4);
+		__m128 local2 = _mm_loadu_ps(local + 8);
+
+		for (int row = 0; row < 3; row++)
+		{
+			const float* p = parent + row * 4;
+			__m128 result = _mm_mul_ps(_mm_set1_ps(p[0]), local0);
+			result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(p[1]), local1));
+			result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(p[2]), local2));
+			result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(p[3]), translation));
+			_mm_storeu_ps(world + row * 4, result);
+		}
+	}
+}
+#pragma endregion
+
+// The vectors take it by reference, so it needs somewhere to live.
+const uint32_t TransformBatch::kNoParent;
+
+#pragma region Constructors and Destructors
+TransformBatch::TransformBatch() : m_count(0), m_updatedCount(0), m_orderDirty(false), m_anyChanged(false)
+{
+}
+#pragma endregion
+
+#pragma region Object Methods
+uint32_t TransformBatch::Add(const TransformVec3& position, const TransformVec3& rotation, const TransformVec3& scale)
+{
+	// Grow a whole group at a time, so the SIMD loops never have to deal with a partial one.
+	if (m_count == m_flags.size())
+	{
+		size_t size = m_flags.size() + 4;
+		m_positionX.resize(size, 0.0f);
+		m_positionY.resize(size, 0.0f);
+		m_positionZ.resize(size, 0.0f);
+		m_rotationX.resize(size, 0.0f);
+		m_rotationY.resize(size, 0.0f);
+		m_rotationZ.resize(size, 0.0f);
+		m_previousRotationX.resize(size, 0.0f);
+		m_previousRotationY.resize(size, 0.0f);
+		m_previousRotationZ.resize(size, 0.0f);
+		m_scaleX.resize(size, 1.0f);
+		m_scaleY.resize(size, 1.0f);
+		m_scaleZ.resize(size, 1.0f);
+		m_autoRotationSpeed.resize(size, 0.0f);
+		m_flags.resize(size, 0);
+		m_groupMoving.resize(size / 4, 0);
+		m_local.resize(size * 12, 0.0f);
+		m_world.resize(size * 12, 0.0f);
+	}
+
+	uint32_t index = m_count++;
+	m_parent.push_back(kNoParent);
+	m_order.push_back(index); // A new root goes on the end, which is still in order
+	m_changed.push_back(0);
+	SetPosition(index, position);
+	SetRotation(index, rotation);
+	SetScale(index, scale);
+
+	// What DrawableGameObject always started with.
+	m_autoRotationSpeed[index] = 50.0f;
+	return index;
+}
+
+TransformVec3 TransformBatch::GetPosition(uint32_t index) const
+{
+	return TransformVec3(m_positionX[index], m_positionY[index], m_positionZ[index]);
+}
+
+TransformVec3 TransformBatch::GetRotation(uint32_t index) const
+{
+	return TransformVec3(m_rotationX[index], m_rotationY[index], m_rotationZ[index]);
+}
+
+TransformVec3 TransformBatch::GetScale(uint32_t index) const
+{
+	return TransformVec3(m_scaleX[index], m_scaleY[index], m_scaleZ[index]);
+}
+
+void TransformBatch::SetPosition(uint32_t index, const TransformVec3& position)
+{
+	m_positionX[index] = position.x;
+	m_positionY[index] = position.y;
+	m_positionZ[index] = position.z;
+	m_flags[index] |= kDirty;
+}
+
+void TransformBatch::SetRotation(uint32_t index, const TransformVec3& rotation)
+{
+	// Set rotations snap there rather than being interpolated to.
+	m_rotationX[index] = m_previousRotationX[index] = rotation.x;
+	m_rotationY[index] = m_previousRotationY[index] = rotation.y;
+	m_rotationZ[index] = m_previousRotationZ[index] = rotation.z;
+	m_flags[index] |= kDirty;
+}
+
+void TransformBatch::SetScale(uint32_t index, const TransformVec3& scale)
+{
+	m_scaleX[index] = scale.x;
+	m_scaleY[index] = scale.y;
+	m_scaleZ[index] = scale.z;
+	m_flags[index] |= kDirty;
+}
+
+bool TransformBatch::GetAutoRotate(uint32_t index, int axis) const
+{
+	return (m_flags[index] & (kAutoRotateX << axis)) != 0;
+}
+
+void TransformBatch::SetAutoRotate(uint32_t index, int axis, bool autoRotate)
+{
+	uint8_t bit = static_cast<uint8_t>(kAutoRotateX << axis);
+	m_flags[index] = static_cast<uint8_t>(autoRotate ? m_flags[index] | bit : m_flags[index] & ~bit);
+}
+#pragma endregion
+
+#pragma region Hierarchy Methods
+bool TransformBatch::SetParent(uint32_t index, uint32_t parent)
+{
+	if (parent != kNoParent)
+	{
+		if (parent >= m_count)
+		{
+			return false;
+		}
+
+		// Walk up from the new parent, if the object is up there it'd end up being its own parent.
+		for (uint32_t ancestor = parent; ancestor != kNoParent; ancestor = m_parent[ancestor])
+		{
+			if (ancestor == index)
+			{
+				return false;
+			}
+		}
+	}
+
+	if (m_parent[index] != parent)
+	{
+		m_parent[index] = parent;
+		m_changed[index] = 1;
+		m_anyChanged = true;
+		m_orderDirty = true;
+	}
+
+	return true;
+}
+
+void TransformBatch::BuildOrder()
+{
+	// The children of each object, laid out one after another.
+	std::vector<uint32_t> childStart(m_count + 1, 0);
+	for (uint32_t index = 0; index < m_count; index++)
+	{
+		if (m_parent[index] != kNoParent)
+		{
+			childStart[m_parent[index] + 1]++;
+		}
+	}
+
+	for (uint32_t index = 0; index < m_count; index++)
+	{
+		childStart[index + 1] += childStart[index];
+	}
+
+	std::vector<uint32_t> children(childStart[m_count]);
+	std::vector<uint32_t> next(childStart.begin(), childStart.end() - 1);
+	for (uint32_t index = 0; index < m_count; index++)
+	{
+		if (m_parent[index] != kNoParent)
+		{
+			children[next[m_parent[index]]++] = index;
+		}
+	}
+
+	// Depth first from each root, so a whole subtree ends up in one run.
+	m_order.clear();
+	std::vector<uint32_t> stack;
+	for (uint32_t root = 0; root < m_count; root++)
+	{
+		if (m_parent[root] != kNoParent)
+		{
+			continue;
+		}
+
+		stack.push_back(root);
+		while (!stack.empty())
+		{
+			uint32_t index = stack.back();
+			stack.pop_back();
+			m_order.push_back(index);
+
+			// Backwards, so they come off the stack in the order they were parented.
+			for (uint32_t child = childStart[index + 1]; child > childStart[index]; child--)
+			{
+				stack.push_back(children[child - 1]);
+			}
+		}
+	}
+
+	m_orderDirty = false;
+}
+#pragma endregion
+
+#pragma region Update Methods
+void TransformBatch::Step(float deltaSeconds)
+{
+	const __m128 fullTurn = _mm_set1_ps(360.0f);
+	const __m128 signBit = _mm_set1_ps(-0.0f);
+	const __m128i autoX = _mm_set1_epi32(kAutoRotateX);
+	const __m128i autoY = _mm_set1_epi32(kAutoRotateX << 1);
+	const __m128i autoZ = _mm_set1_epi32(kAutoRotateX << 2);
+	const uint32_t autoRotateBits = Replicate(kAutoRotateX | kAutoRotateX << 1 | kAutoRotateX << 2);
+	__m128 delta = _mm_set1_ps(deltaSeconds);
+
+	for (size_t first = 0; first < m_flags.size(); first += 4)
+	{
+		uint32_t groupFlags = GroupFlags(m_flags, first);
+		uint8_t& moving = m_groupMoving[first / 4];
+		if (groupFlags == 0 && !moving)
+		{
+			continue;
+		}
+
+		__m128 oldRotationX = _mm_loadu_ps(&m_rotationX[first]);
+		__m128 oldRotationY = _mm_loadu_ps(&m_rotationY[first]);
+		__m128 oldRotationZ = _mm_loadu_ps(&m_rotationZ[first]);
+		__m128 rotationX = oldRotationX, rotationY = oldRotationY, rotationZ = oldRotationZ;
+		int changedLanes = DifferentLanes(_mm_loadu_ps(&m_previousRotationX[first]), _mm_loadu_ps(&m_previousRotationY[first]),
+			_mm_loadu_ps(&m_previousRotationZ[first]), rotationX, rotationY, rotationZ);
+
+		// Don't overflow the rotation, anything past a full turn either way goes back to 0.
+		rotationX = _mm_andnot_ps(_mm_cmpgt_ps(_mm_andnot_ps(signBit, rotationX), fullTurn), rotationX);
+		rotationY = _mm_andnot_ps(_mm_cmpgt_ps(_mm_andnot_ps(signBit, rotationY), fullTurn), rotationY);
+		rotationZ = _mm_andnot_ps(_mm_cmpgt_ps(_mm_andnot_ps(signBit, rotationZ), fullTurn), rotationZ);
+
+		// The wrap happens before this, so interpolating never spins the long way round.
+		_mm_storeu_ps(&m_previousRotationX[first], rotationX);
+		_mm_storeu_ps(&m_previousRotationY[first], rotationY);
+		_mm_storeu_ps(&m_previousRotationZ[first], rotationZ);
+
+		// Each lane's flag byte widened out to 32 bits, so the auto rotate bits can be turned into lane masks.
+		__m128i laneFlags = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(static_cast<int>(groupFlags)), _mm_setzero_si128()), _mm_setzero_si128());
+		__m128 turn = _mm_mul_ps(_mm_loadu_ps(&m_autoRotationSpeed[first]), delta);
+		rotationX = _mm_add_ps(rotationX, _mm_and_ps(turn, _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(laneFlags, autoX), autoX))));
+		rotationY = _mm_add_ps(rotationY, _mm_and_ps(turn, _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(laneFlags, autoY), autoY))));
+		rotationZ = _mm_add_ps(rotationZ, _mm_and_ps(turn, _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(laneFlags, autoZ), autoZ))));
+
+		_mm_storeu_ps(&m_rotationX[first], rotationX);
+		_mm_storeu_ps(&m_rotationY[first], rotationY);
+		_mm_storeu_ps(&m_rotationZ[first], rotationZ);
+
+		// Anything that was between two rotations or has turned needs its matrix building again. That's everything turning,
+		// plus one more time for anything that's just stopped.
+		changedLanes |= DifferentLanes(oldRotationX, oldRotationY, oldRotationZ, rotationX, rotationY, rotationZ);
+		groupFlags |= LaneFlags(changedLanes, kDirty);
+		std::memcpy(&m_flags[first], &groupFlags, sizeof(groupFlags));
+		moving = (groupFlags & autoRotateBits) != 0 && deltaSeconds != 0.0f;
+	}
+}
+
+void TransformBatch::UpdateWorld(float alpha)
+{
+	const __m128 degreesToRadians = _mm_set1_ps(0.0174532925f);
+	const uint32_t dirtyBits = Replicate(kDirty);
+	__m128 blend = _mm_set1_ps(alpha);
+
+	m_updatedCount = 0;
+
+	for (size_t first = 0; first < m_flags.size(); first += 4)
+	{
+		uint32_t groupFlags = GroupFlags(m_flags, first);
+		if ((groupFlags & dirtyBits) == 0 && !m_groupMoving[first / 4])
+		{
+			continue;
+		}
+
+		// Somewhere between the last two steps. The translation and scale only change when they're set, so they're never in between.
+		__m128 previousX = _mm_loadu_ps(&m_previousRotationX[first]);
+		__m128 previousY = _mm_loadu_ps(&m_previousRotationY[first]);
+		__m128 previousZ = _mm_loadu_ps(&m_previousRotationZ[first]);
+		__m128 currentX = _mm_loadu_ps(&m_rotationX[first]);
+		__m128 currentY = _mm_loadu_ps(&m_rotationY[first]);
+		__m128 currentZ = _mm_loadu_ps(&m_rotationZ[first]);
+		__m128 angleX = _mm_mul_ps(_mm_add_ps(previousX, _mm_mul_ps(_mm_sub_ps(currentX, previousX), blend)), degreesToRadians);
+		__m128 angleY = _mm_mul_ps(_mm_add_ps(previousY, _mm_mul_ps(_mm_sub_ps(currentY, previousY), blend)), degreesToRadians);
+		__m128 angleZ = _mm_mul_ps(_mm_add_ps(previousZ, _mm_mul_ps(_mm_sub_ps(currentZ, previousZ), blend)), degreesToRadians);
+
+		// The whole group gets rebuilt, but only the dirty objects and the ones part way through turning actually changed.
+		uint32_t changedFlags = (groupFlags & dirtyBits) | LaneFlags(DifferentLanes(previousX, previousY, previousZ, currentX, currentY, currentZ), kDirty);
+
+		__m128 sx, cx, sy, cy, sz, cz;
+		SinCos(angleX, sx, cx);
+		SinCos(angleY, sy, cy);
+		SinCos(angleZ, sz, cz);
+
+		// Scaling * RotationX * RotationY * RotationZ * Translation, multiplied out by hand. Row r of the rotation is scaled by
+		// the scale's r component, and these are the columns of that matrix, since the descriptor wants it transposed.
+		__m128 scaleX = _mm_loadu_ps(&m_scaleX[first]);
+		__m128 scaleY = _mm_loadu_ps(&m_scaleY[first]);
+		__m128 scaleZ = _mm_loadu_ps(&m_scaleZ[first]);
+		__m128 sxsy = _mm_mul_ps(sx, sy);
+		__m128 cxsy = _mm_mul_ps(cx, sy);
+
+		__m128 m00 = _mm_mul_ps(scaleX, _mm_mul_ps(cy, cz));
+		__m128 m01 = _mm_mul_ps(scaleX, _mm_mul_ps(cy, sz));
+		__m128 m02 = _mm_sub_ps(_mm_setzero_ps(), _mm_mul_ps(scaleX, sy));
+		__m128 m10 = _mm_mul_ps(scaleY, _mm_sub_ps(_mm_mul_ps(sxsy, cz), _mm_mul_ps(cx, sz)));
+		__m128 m11 = _mm_mul_ps(scaleY, _mm_add_ps(_mm_mul_ps(sxsy, sz), _mm_mul_ps(cx, cz)));
+		__m128 m12 = _mm_mul_ps(scaleY, _mm_mul_ps(sx, cy));
+		__m128 m20 = _mm_mul_ps(scaleZ, _mm_add_ps(_mm_mul_ps(cxsy, cz), _mm_mul_ps(sx, sz)));
+		__m128 m21 = _mm_mul_ps(scaleZ, _mm_sub_ps(_mm_mul_ps(cxsy, sz), _mm_mul_ps(sx, cz)));
+		__m128 m22 = _mm_mul_ps(scaleZ, _mm_mul_ps(cx, cy));
+
+		__m128 row0 = m00, row1 = m10, row2 = m20, row3 = _mm_loadu_ps(&m_positionX[first]);
+		_MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+		__m128 row4 = m01, row5 = m11, row6 = m21, row7 = _mm_loadu_ps(&m_positionY[first]);
+		_MM_TRANSPOSE4_PS(row4, row5, row6, row7);
+		__m128 row8 = m02, row9 = m12, row10 = m22, row11 = _mm_loadu_ps(&m_positionZ[first]);
+		_MM_TRANSPOSE4_PS(row8, row9, row10, row11);
+
+		// Now each register is one object's row, so the 3 rows of each object go out next to each other.
+		float* local = &m_local[first * 12];
+		_mm_storeu_ps(local + 0, row0);
+		_mm_storeu_ps(local + 4, row4);
+		_mm_storeu_ps(local + 8, row8);
+		_mm_storeu_ps(local + 12, row1);
+		_mm_storeu_ps(local + 16, row5);
+		_mm_storeu_ps(local + 20, row9);
+		_mm_storeu_ps(local + 24, row2);
+		_mm_storeu_ps(local + 28, row6);
+		_mm_storeu_ps(local + 32, row10);
+		_mm_storeu_ps(local + 36, row3);
+		_mm_storeu_ps(local + 40, row7);
+		_mm_storeu_ps(local + 44, row11);
+
+		groupFlags &= ~dirtyBits;
+		std::memcpy(&m_flags[first], &groupFlags, sizeof(groupFlags));
+
+		size_t end = first + 4 <= m_count ? first + 4 : m_count;
+		for (size_t index = first; index < end; index++)
+		{
+			if (changedFlags & (kDirty << ((index - first) * 8)))
+			{
+				m_changed[index] = 1;
+				m_anyChanged = true;
+			}
+		}
+	}
+
+	if (!m_anyChanged)
+	{
+		return;
+	}
+
+	if (m_orderDirty)
+	{
+		BuildOrder();
+	}
+
+	// Parents come first, so by the time an object's reached its parent has already decided whether it changed.
+	for (uint32_t index : m_order)
+	{
+		uint32_t parent = m_parent[index];
+		if (parent != kNoParent && m_changed[parent])
+		{
+			m_changed[index] = 1;
+		}
+
+		if (!m_changed[index])
+		{
+			continue;
+		}
+
+		float* world = &m_world[static_cast<size_t>(index) * 12];
+		const float* local = &m_local[static_cast<size_t>(index) * 12];
+		if (parent == kNoParent)
+		{
+			std::memcpy(world, local, sizeof(float) * 12);
+		}
+		else
+		{
+			Compose(&m_world[static_cast<size_t>(parent) * 12], local, world);
+		}
+
+		m_updatedCount++;
+	}
+
+	std::fill(m_changed.begin(), m_changed.end(), static_cast<uint8_t>(0));
+	m_anyChanged = false;
+}
+#pragma endregion
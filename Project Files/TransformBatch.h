@@ -0,0 +1,144 @@
+#pragma once
+
+#pragma region Includes
+//Include{s}
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#pragma endregion
+
+// No Windows headers (or DirectXMath), the maths is plain SSE so it can be timed and checked anywhere.
+
+#pragma region Data Structures
+/// <summary>
+/// A position, rotation or scale, laid out the same as an XMFLOAT3.
+/// </summary>
+struct TransformVec3
+{
+	float x = 0.0f;
+	float y = 0.0f;
+	float z = 0.0f;
+
+	TransformVec3() {}
+	TransformVec3(float xIn, float yIn, float zIn) : x(xIn), y(yIn), z(zIn) {}
+};
+#pragma endregion
+
+/// <summary>
+/// The TransformBatch class. Every object's position, rotation (in degrees) and scale, a component to an array, with the
+/// local matrices rebuilt 4 objects at a time. Only groups of 4 with something dirty or auto rotating in them get touched,
+/// the rest keep the matrices they had. Objects can have a parent, in which case their transform is relative to it. The
+/// world matrices are then worked out in an order where parents always come first, and only for objects whose own local
+/// matrix or some parent's changed, so moving a parent only touches the objects under it. The matrices come out already
+/// laid out the way the TLAS instance descriptors want them.
+/// </summary>
+class TransformBatch
+{
+public:
+	static const uint32_t kNoParent = 0xFFFFFFFF;
+
+#pragma region Constructors and Destructors
+	/// <summary>
+	/// Initializes a new instance of the TransformBatch class, with nothing in it.
+	/// </summary>
+	TransformBatch();
+#pragma endregion
+
+#pragma region Object Methods
+	/// <summary>
+	/// Adds an object. Its matrix is built on the next UpdateWorld.
+	/// </summary>
+	/// <returns>The object's index, which never changes.</returns>
+	uint32_t Add(const TransformVec3& position, const TransformVec3& rotation, const TransformVec3& scale);
+
+	TransformVec3 GetPosition(uint32_t index) const;
+	TransformVec3 GetRotation(uint32_t index) const;
+	TransformVec3 GetScale(uint32_t index) const;
+	void SetPosition(uint32_t index, const TransformVec3& position);
+	void SetRotation(uint32_t index, const TransformVec3& rotation);
+	void SetScale(uint32_t index, const TransformVec3& scale);
+
+	/// <summary>
+	/// Whether the object spins around an axis (0 is X, 1 is Y, 2 is Z) on its own.
+	/// </summary>
+	bool GetAutoRotate(uint32_t index, int axis) const;
+	void SetAutoRotate(uint32_t index, int axis, bool autoRotate);
+
+	/// <summary>
+	/// How fast the auto rotation goes, in degrees a second.
+	/// </summary>
+	float GetAutoRotationSpeed(uint32_t index) const { return m_autoRotationSpeed[index]; }
+	void SetAutoRotationSpeed(uint32_t index, float speed) { m_autoRotationSpeed[index] = speed; }
+
+	uint32_t GetCount() const { return m_count; }
+#pragma endregion
+
+#pragma region Hierarchy Methods
+	/// <summary>
+	/// Makes an object a child of another one, or a root again with kNoParent. Its position, rotation and scale are kept as
+	/// they are, so they're relative to the new parent from here on and it'll move if the parent isn't at the origin.
+	/// </summary>
+	/// <returns>False (and nothing changes) if the parent doesn't exist or is the object itself or one of its children.</returns>
+	bool SetParent(uint32_t index, uint32_t parent);
+
+	uint32_t GetParent(uint32_t index) const { return m_parent[index]; }
+#pragma endregion
+
+#pragma region Update Methods
+	/// <summary>
+	/// One simulation step. Rotations past a full turn go back to 0, then the auto rotating objects spin.
+	/// </summary>
+	void Step(float deltaSeconds);
+
+	/// <summary>
+	/// Rebuilds the local matrices that are out of date, then the world matrices of those objects and everything under them.
+	/// </summary>
+	/// <param name="alpha">How far between the last two steps to put the rotations, 1 is the newest step.</param>
+	void UpdateWorld(float alpha);
+
+	/// <summary>
+	/// An object's world matrix, as the 3x4 row major matrix D3D12_RAYTRACING_INSTANCE_DESC::Transform holds
+	/// (the transpose of a DirectXMath world matrix, minus the last row).
+	/// </summary>
+	const float* GetWorld(uint32_t index) const { return &m_world[static_cast<size_t>(index) * 12]; }
+
+	/// <summary>
+	/// How many world matrices the last UpdateWorld wrote. A changed object counts, and so does everything under it.
+	/// </summary>
+	uint32_t GetUpdatedCount() const { return m_updatedCount; }
+#pragma endregion
+
+private:
+#pragma region Private Methods
+	/// <summary>
+	/// Works out m_order again, a depth first walk from each root so every parent comes before its children.
+	/// </summary>
+	void BuildOrder();
+#pragma endregion
+
+#pragma region Private Variables
+	static const uint8_t kDirty = 1;
+	static const uint8_t kAutoRotateX = 2; // The Y and Z bits follow on from this one
+
+	uint32_t m_count;
+	uint32_t m_updatedCount;
+
+	// Everything's padded out to a multiple of 4, the spare lanes are identity transforms nothing reads.
+	std::vector<float> m_positionX, m_positionY, m_positionZ;
+	std::vector<float> m_rotationX, m_rotationY, m_rotationZ;
+	std::vector<float> m_previousRotationX, m_previousRotationY, m_previousRotationZ; // Before the last step, to interpolate from
+	std::vector<float> m_scaleX, m_scaleY, m_scaleZ;
+	std::vector<float> m_autoRotationSpeed;
+	std::vector<uint8_t> m_flags;
+	std::vector<uint8_t> m_groupMoving; // Per group of 4, whether the last step actually turned anything in it
+	std::vector<float> m_local; // 12 floats an object, relative to the parent
+	std::vector<float> m_world; // 12 floats an object
+
+	// The hierarchy, these aren't padded.
+	std::vector<uint32_t> m_parent;
+	std::vector<uint32_t> m_order; // Every object, parents before children
+	std::vector<uint8_t> m_changed; // The world matrix needs working out again
+	bool m_orderDirty;
+	bool m_anyChanged;
+#pragma endregion
+};
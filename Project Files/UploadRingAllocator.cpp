@@ -0,0 +1,133 @@
+#pragma region Includes
+//Include{s}
+#include "UploadRingAllocator.h"
+#include <stdexcept>
+#pragma endregion
+
+#pragma region Constructors and Destructors
+UploadRingAllocator::UploadRingAllocator(uint64_t capacity)
+{
+	if (capacity == 0)
+	{
+		throw std::logic_error("The upload ring needs some bytes to work with");
+	}
+
+	m_capacity = capacity;
+}
+#pragma endregion
+
+#pragma region Allocation Methods
+bool UploadRingAllocator::Allocate(uint64_t size, uint64_t alignment, uint64_t& outOffset)
+{
+	if (alignment == 0 || (alignment & (alignment - 1)) != 0)
+	{
+		throw std::logic_error("Upload ring alignment has to be a power of two");
+	}
+
+	// Nothing in flight, so start again from the beginning rather than wrapping later on.
+	if (m_bytesInUse == 0)
+	{
+		m_head = 0;
+		m_tail = 0;
+	}
+
+	uint64_t alignedHead = (m_head + alignment - 1) & ~(alignment - 1);
+
+	if (size > 0 && size <= m_capacity && m_bytesInUse < m_capacity)
+	{
+		if (m_head >= m_tail)
+		{
+			// Free space is [head, capacity) and then [0, tail).
+			if (alignedHead + size <= m_capacity)
+			{
+				Take(alignedHead, size, alignedHead - m_head);
+				outOffset = alignedHead;
+				return true;
+			}
+
+			// Doesn't fit at the end, skip the rest of the ring and go round. Offset 0 is aligned to anything.
+			if (size <= m_tail)
+			{
+				uint64_t skipped = m_capacity - m_head;
+				Take(0, size, skipped);
+				outOffset = 0;
+
+				m_stats.wraps++;
+				if (skipped > m_stats.largestWrapWaste)
+				{
+					m_stats.largestWrapWaste = skipped;
+				}
+				return true;
+			}
+		}
+		else if (alignedHead + size <= m_tail)
+		{
+			// Already wrapped, free space is [head, tail).
+			Take(alignedHead, size, alignedHead - m_head);
+			outOffset = alignedHead;
+			return true;
+		}
+	}
+
+	m_stats.failedAllocations++;
+	return false;
+}
+
+void UploadRingAllocator::FinishFrame(uint64_t fenceValue)
+{
+	if (fenceValue <= m_lastFenceValue)
+	{
+		throw std::logic_error("Upload ring fence values have to go up");
+	}
+
+	m_lastFenceValue = fenceValue;
+
+	// A frame that didn't allocate anything has nothing to give back.
+	if (m_pendingBytes == 0)
+	{
+		return;
+	}
+
+	FrameMark mark;
+	mark.fenceValue = fenceValue;
+	mark.end = m_head;
+	mark.bytes = m_pendingBytes;
+	m_frames.push_back(mark);
+
+	m_pendingBytes = 0;
+}
+
+void UploadRingAllocator::Reclaim(uint64_t completedFenceValue)
+{
+	while (!m_frames.empty() && m_frames.front().fenceValue <= completedFenceValue)
+	{
+		m_tail = m_frames.front().end;
+		m_bytesInUse -= m_frames.front().bytes;
+		m_frames.pop_front();
+		m_stats.framesReclaimed++;
+	}
+}
+#pragma endregion
+
+#pragma region Private Methods
+void UploadRingAllocator::Take(uint64_t offset, uint64_t size, uint64_t padding)
+{
+	m_head = offset + size;
+	if (m_head == m_capacity)
+	{
+		m_head = 0;
+	}
+
+	m_bytesInUse += size + padding;
+	m_pendingBytes += size + padding;
+
+	m_stats.allocations++;
+	m_stats.bytesAllocated += size;
+	m_stats.bytesWasted += padding;
+
+	if (m_bytesInUse > m_stats.peakBytesInUse)
+	{
+		m_stats.peakBytesInUse = m_bytesInUse;
+	}
+}
+#pragma endregion
@@ -0,0 +1,100 @@
+#pragma once
+
+#pragma region Includes
+//Include{s}
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#pragma endregion
+
+// Bookkeeping only, no Windows headers. The D3D12 side owns the actual upload buffer and maps offsets into it.
+
+/// <summary>
+/// Running totals for the upload ring.
+/// </summary>
+struct UploadRingStats
+{
+	uint64_t allocations = 0;
+	uint64_t failedAllocations = 0; // Didn't fit, the caller had to go somewhere else
+	uint64_t bytesAllocated = 0; // What was asked for
+	uint64_t bytesWasted = 0; // Alignment padding plus the tail skipped when wrapping, i.e. fragmentation
+	uint64_t wraps = 0;
+	uint64_t largestWrapWaste = 0; // The most skipped at the end of the ring in one go
+	uint64_t peakBytesInUse = 0;
+	uint64_t framesReclaimed = 0;
+};
+
+/// <summary>
+/// The UploadRingAllocator class. Hands out linear chunks of a fixed size ring buffer, and takes them back a frame
+/// at a time once the fence value that frame was submitted with has completed. Allocating is a pointer bump,
+/// freeing is just moving the tail, so there's nothing to fragment apart from the bit skipped at the end when it wraps.
+/// </summary>
+class UploadRingAllocator
+{
+public:
+#pragma region Constructors and Destructors
+	/// <summary>
+	/// Initializes a new instance of the UploadRingAllocator class.
+	/// </summary>
+	/// <param name="capacity">The size of the ring in bytes.</param>
+	UploadRingAllocator(uint64_t capacity);
+#pragma endregion
+
+#pragma region Allocation Methods
+	/// <summary>
+	/// Allocates a chunk of the ring. Never blocks, if there isn't room it says so and the caller decides what to do.
+	/// </summary>
+	/// <param name="size">The number of bytes wanted.</param>
+	/// <param name="alignment">The alignment of the offset, has to be a power of two.</param>
+	/// <param name="outOffset">Receives the offset of the chunk in the ring.</param>
+	/// <returns>True if the chunk was allocated.</returns>
+	bool Allocate(uint64_t size, uint64_t alignment, uint64_t& outOffset);
+
+	/// <summary>
+	/// Tags everything allocated since the last call with the fence value the GPU will signal once it's done with it.
+	/// </summary>
+	/// <param name="fenceValue">The fence value, has to be higher than the last one.</param>
+	void FinishFrame(uint64_t fenceValue);
+
+	/// <summary>
+	/// Gives back every frame whose fence value has completed.
+	/// </summary>
+	/// <param name="completedFenceValue">The fence value the GPU has got through.</param>
+	void Reclaim(uint64_t completedFenceValue);
+#pragma endregion
+
+#pragma region Getters
+	uint64_t GetCapacity() const { return m_capacity; }
+	uint64_t GetBytesInUse() const { return m_bytesInUse; }
+	size_t GetFramesInFlight() const { return m_frames.size(); }
+	const UploadRingStats& GetStats() const { return m_stats; }
+#pragma endregion
+
+private:
+#pragma region Private Types
+	struct FrameMark
+	{
+		uint64_t fenceValue;
+		uint64_t end; // Where the head was when the frame finished, the tail moves here once it completes
+		uint64_t bytes; // Everything the frame took, padding included
+	};
+#pragma endregion
+
+#pragma region Private Methods
+	/// <summary>
+	/// Takes bytes off the ring, the padding in front of the chunk counts as used until the frame is reclaimed.
+	/// </summary>
+	void Take(uint64_t offset, uint64_t size, uint64_t padding);
+#pragma endregion
+
+#pragma region Private Variables
+	uint64_t m_capacity;
+	uint64_t m_head = 0; // Next free byte
+	uint64_t m_tail = 0; // Oldest byte still in use
+	uint64_t m_bytesInUse = 0; // Tells a full ring apart from an empty one when head == tail
+	uint64_t m_pendingBytes = 0; // Taken since the last FinishFrame
+	uint64_t m_lastFenceValue = 0;
+	std::deque<FrameMark> m_frames;
+	UploadRingStats m_stats;
+#pragma endregion
+};
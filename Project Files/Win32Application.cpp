@@ -17,6 +17,7 @@
 //Include{s}
 #include "Win32Application.h"
 #include "DXRApp.h"
+#include "KernelBenchmark.h"
 #include "resource.h"
 #pragma endregion
 
@@ -30,6 +31,33 @@ int Win32Application::Run(DXSample* pSample, HINSTANCE hInstance,
 	pSample->ParseCommandLineArgs(argv, argc);
 	LocalFree(argv);
 
+	// The kernel benchmark is all CPU, so it's done before there's a window or a device and the exit code says if anything got
+	// slower or any of its checks failed.
+	if (pSample->GetKernelBenchmark()) {
+		KernelBenchmark benchmark;
+		benchmark.LoadBaseline("KernelBaseline.csv");
+		benchmark.Run("Objects");
+
+		for (const KernelBenchmarkResult& result : benchmark.GetResults()) {
+			OutputDebugStringA((KernelBenchmark::FormatResult(result) + "\n").c_str());
+		}
+		for (const KernelCheckResult& check : benchmark.GetChecks()) {
+			OutputDebugStringA((KernelBenchmark::FormatCheck(check) + "\n").c_str());
+		}
+
+		// A CSV that couldn't be written fails the run too, otherwise the next baseline comparison is against stale numbers.
+		bool written = true;
+		if (!benchmark.WriteCsv("KernelBenchmark.csv")) {
+			OutputDebugStringA("Couldn't write KernelBenchmark.csv\n");
+			written = false;
+		}
+		if (!benchmark.WriteChecksCsv("KernelChecks.csv")) {
+			OutputDebugStringA("Couldn't write KernelChecks.csv\n");
+			written = false;
+		}
+		return benchmark.HasRegressions() || benchmark.HasFailedChecks() || !written ? 1 : 0;
+	}
+
 	// Initialize the window class.
 	WNDCLASSEX windowClass = { 0 };
 	windowClass.cbSize = sizeof(WNDCLASSEX);
@@ -58,7 +86,9 @@ int Win32Application::Run(DXSample* pSample, HINSTANCE hInstance,
 	// DXSample.
 	pSample->OnInit();
 
-	ShowWindow(m_hwnd, nCmdShow);
+	// Offline renders and tile workers never show the window, so there's no WM_PAINT to drive the frames either.
+	bool headless = pSample->IsHeadless();
+	ShowWindow(m_hwnd, headless ? SW_HIDE : nCmdShow);
 
 	// Main sample loop.
 	MSG msg = {};
@@ -68,6 +98,10 @@ int Win32Application::Run(DXSample* pSample, HINSTANCE hInstance,
 			TranslateMessage(&msg);
 			DispatchMessage(&msg);
 		}
+		else if (headless) {
+			pSample->OnUpdate();
+			pSample->OnRender();
+		}
 	}
 
 	pSample->OnDestroy();
@@ -112,16 +146,48 @@ LRESULT CALLBACK Win32Application::WindowProc(HWND hWnd, UINT message,
 	case WM_RBUTTONDOWN:
 		mouseDown = true;
 		ShowCursor(false);
+		if (pSample)
+		{
+			reinterpret_cast<DXRApp*>(pSample)->OnMouseLook(true);
+		}
 		break;
 	case WM_RBUTTONUP:
 		ShowCursor(true);
 		mouseDown = false;
+		if (pSample)
+		{
+			reinterpret_cast<DXRApp*>(pSample)->OnMouseLook(false);
+		}
+		break;
+
+	case WM_MOUSELEAVE:
+		if (pSample)
+		{
+			reinterpret_cast<DXRApp*>(pSample)->OnMouseLeave();
+		}
+		break;
+
+	case WM_LBUTTONDOWN:
+		if (pSample)
+		{
+			POINTS mousePos = MAKEPOINTS(lParam);
+			reinterpret_cast<DXRApp*>(pSample)->OnMouseClick(mousePos.x, mousePos.y);
+		}
 		break;
 
 	case WM_MOUSEMOVE:
 	{
 		if (!mouseDown)
 		{
+			// Not looking around, so the cursor's free to point at things. Ask to be told when it leaves, so the hover goes with it.
+			if (pSample)
+			{
+				TRACKMOUSEEVENT trackLeave = { sizeof(TRACKMOUSEEVENT), TME_LEAVE, hWnd, 0 };
+				TrackMouseEvent(&trackLeave);
+
+				POINTS mousePos = MAKEPOINTS(lParam);
+				reinterpret_cast<DXRApp*>(pSample)->OnMouseMove(mousePos.x, mousePos.y);
+			}
 			break;
 		}
 
@@ -148,7 +214,6 @@ LRESULT CALLBACK Win32Application::WindowProc(HWND hWnd, UINT message,
 		delta.y = cursorPos.y - windowCenter.y;
 
 		reinterpret_cast<DXRApp*>(pSample)->OnMouseMoveDelta(delta);
-		reinterpret_cast<DXRApp*>(pSample)->OnMouseMove(cursorPos.x, cursorPos.y);
 
 		// Recenter the cursor
 		SetCursorPos(windowCenter.x, windowCenter.y);
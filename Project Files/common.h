@@ -26,6 +26,16 @@ struct AccelerationStructureBuffers {
 	ComPtr<ID3D12Resource> pInstanceDesc; // Hold the matrices of the instances
 };
 
+/// <summary>
+/// A chunk of upload memory, either out of the upload ring or a one off buffer when the ring is full.
+/// </summary>
+struct UploadAllocation
+{
+	ID3D12Resource* resource = nullptr;
+	UINT64 offset = 0;
+	uint8_t* cpuAddress = nullptr;
+};
+
 /// <summary>
 /// Represents a texture resource and its associated metadata.
 /// </summary>
@@ -33,7 +43,6 @@ struct Texture
 {
 	ComPtr<ID3D12Resource> textureResource;
 	D3D12_RESOURCE_DESC textureDesc;
-	ComPtr<ID3D12Resource> textureUploadHeap;
 	wstring textureFile;
 	int heapTextureNumber = -1;
 };
@@ -47,9 +56,10 @@ struct CameraBuffer
 	XMMATRIX invProj;
 	float rX;
 	float rY;
-	XMFLOAT2 padding;
+	XMFLOAT2 tileOffset; // Where DispatchRays starts in the output, 0 unless only a tile is being rendered
 	float transBackgroundMode;
-	XMFLOAT3 morePadding;
+	XMFLOAT2 frameSize; // The whole output's size, the rays are spread over this rather than the dispatch
+	float pixelSpreadAngle; // How fast a primary ray's cone widens, one pixel's worth of angle
 };
 
 /// <summary>
@@ -72,7 +82,7 @@ struct LightParams
 /// Contains material properties such as reflection, shininess, and color.
 /// </summary>
 struct MaterialBuffer
-{
+{ // IMPORTANT - the hlsl version of this is MaterialData in Hit.hlsl
 	UINT reflection = 0;
 	float shininess = 0.2f;
 	int maxRecursionDepth = 20;
@@ -82,7 +92,50 @@ struct MaterialBuffer
 	XMFLOAT4 objectColour = { 1,1,1,1 };
 	float roughness = 0.0f;
 	UINT texture = 0;
-	XMFLOAT2 padding = { 0,0 };
+	UINT textureIndex = 0; // Index into the shader's texture array (relative to the first texture slot in the heap)
+	float padding = 0.0f;
+};
+
+/// <summary>
+/// Describes where an object's mesh lives inside the global vertex and index pools.
+/// </summary>
+struct MeshInfo
+{ // IMPORTANT - the hlsl version of this is MeshInfo in Hit.hlsl
+	UINT vertexOffset = 0;
+	UINT indexOffset = 0;
+	UINT vertexCount = 0;
+	UINT indexCount = 0;
+	UINT materialIndex = 0; // The object it belongs to, an object's LOD levels all share its material
+};
+
+/// <summary>
+/// Feature bits used to pick a specialised hit shader variant for an object.
+/// </summary>
+enum HitShaderFeature : UINT
+{ // IMPORTANT - the hlsl version of these are the HIT_FEATURE_ defines in Hit.hlsl
+	HIT_FEATURE_NONE = 0,
+	HIT_FEATURE_REFLECTION = 1 << 0,
+	HIT_FEATURE_TRI_OUTLINE = 1 << 1,
+	HIT_FEATURE_TEXTURE = 1 << 2,
+	HIT_FEATURE_SHADOWS = 1 << 3,
+	HIT_FEATURE_ALL = (1 << 4) - 1,
+};
+
+/// <summary>
+/// Which kinds of ray can hit an object, used as its TLAS instance mask. Shadow and reflection rays with wide cones use
+/// the LOD bits instead, and only the instance for the level they should see has that bit set.
+/// </summary>
+enum InstanceMask : UINT
+{ // IMPORTANT - the hlsl version of these are the INSTANCE_MASK_ defines in Common.hlsl
+	INSTANCE_MASK_NONE = 0,
+	INSTANCE_MASK_CAMERA = 1 << 0,
+	INSTANCE_MASK_SHADOW = 1 << 1,
+	INSTANCE_MASK_REFLECTION = 1 << 2,
+	INSTANCE_MASK_ALL = (1 << 3) - 1,
+	INSTANCE_MASK_SHADOW_LOD1 = 1 << 3,
+	INSTANCE_MASK_SHADOW_LOD2 = 1 << 4,
+	INSTANCE_MASK_REFLECTION_LOD1 = 1 << 5,
+	INSTANCE_MASK_REFLECTION_LOD2 = 1 << 6,
 };
 
 /// <summary>
@@ -133,10 +133,31 @@ void BottomLevelASGenerator::ComputeASBufferSizes(
   // The generated AS can support iterative updates. This may change the final
   // size of the AS as well as the temporary memory requirements, and hence has
   // to be set before the actual build
-  m_flags =
+  ComputeASBufferSizes(
+      device,
       allowUpdate
           ? D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_UPDATE
-          : D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_NONE;
+          : D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_NONE,
+      scratchSizeInBytes, resultSizeInBytes);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Compute the buffer sizes for an explicit set of build flags. Compaction and
+// the trace/build preferences change the memory requirements too
+void BottomLevelASGenerator::ComputeASBufferSizes(
+    ID3D12Device5 *device, // Device on which the build will be performed
+    D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAGS
+        flags, // Build flags, without PERFORM_UPDATE
+    UINT64 *scratchSizeInBytes, // Required scratch memory on the GPU to build
+                                // the acceleration structure
+    UINT64 *resultSizeInBytes   // Required GPU memory to store the acceleration
+                                // structure
+) {
+  if (flags & D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PERFORM_UPDATE) {
+    throw std::logic_error(
+        "PERFORM_UPDATE is requested at build time, not when sizing the AS");
+  }
+  m_flags = flags;
 
   // Describe the work being requested, in this case the construction of a
   // (possibly dynamic) bottom-level hierarchy, with the given vertex buffers
@@ -188,25 +209,83 @@ void BottomLevelASGenerator::Generate(
                                    // structure, used if an iterative update
                                    // is requested
 ) {
+  Generate(commandList, scratchBuffer->GetGPUVirtualAddress(),
+           resultBuffer->GetGPUVirtualAddress(), updateOnly,
+           previousResult ? previousResult->GetGPUVirtualAddress() : 0);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Enqueue the construction of the acceleration structure from GPU addresses,
+// so several structures can share one buffer. Optionally emits post-build
+// information, such as the compacted size
+void BottomLevelASGenerator::Generate(
+    ID3D12GraphicsCommandList4
+        *commandList, // Command list on which the build will be enqueued
+    D3D12_GPU_VIRTUAL_ADDRESS
+        scratchAddress, // Scratch memory used by the builder
+    D3D12_GPU_VIRTUAL_ADDRESS
+        resultAddress, // Where the acceleration structure is stored
+    bool updateOnly,   // If true, simply refit the existing
+                       // acceleration structure
+    D3D12_GPU_VIRTUAL_ADDRESS
+        previousResult, // Optional previous acceleration structure
+    const D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_DESC
+        *postbuildInfo // Optional post-build information to emit
+) {
+
+  D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC buildDesc =
+      GetBuildDesc(scratchAddress, resultAddress, updateOnly, previousResult);
+
+  // Build the AS
+  commandList->BuildRaytracingAccelerationStructure(
+      &buildDesc, postbuildInfo ? 1 : 0, postbuildInfo);
+
+  // Wait for the builder to complete by setting a barrier. This is
+  // particularly important as the construction of the top-level hierarchy may
+  // be called right afterwards, before executing the command list. Only the
+  // address is known here, so the barrier covers all UAV accesses
+  D3D12_RESOURCE_BARRIER uavBarrier;
+  uavBarrier.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
+  uavBarrier.UAV.pResource = nullptr;
+  uavBarrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+  commandList->ResourceBarrier(1, &uavBarrier);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Fill in the description of the build without recording it or any barrier,
+// so the application can record several builds back to back and synchronize
+// them all at once. The description points into this generator's geometry, so
+// the generator has to outlive the recording
+D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC
+BottomLevelASGenerator::GetBuildDesc(
+    D3D12_GPU_VIRTUAL_ADDRESS
+        scratchAddress, // Scratch memory used by the builder
+    D3D12_GPU_VIRTUAL_ADDRESS
+        resultAddress, // Where the acceleration structure is stored
+    bool updateOnly,   // If true, simply refit the existing
+                       // acceleration structure
+    D3D12_GPU_VIRTUAL_ADDRESS
+        previousResult // Optional previous acceleration structure
+) {
 
   D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAGS flags = m_flags;
   // The stored flags represent whether the AS has been built for updates or
   // not. If yes and an update is requested, the builder is told to only update
-  // the AS instead of fully rebuilding it
-  if (flags ==
-          D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_UPDATE &&
-      updateOnly) {
-    flags = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PERFORM_UPDATE;
+  // the AS instead of fully rebuilding it. The other flags have to match the
+  // original build, so the update flag is added to them
+  bool allowUpdate =
+      (m_flags &
+       D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_UPDATE) != 0;
+  if (allowUpdate && updateOnly) {
+    flags |= D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PERFORM_UPDATE;
   }
 
   // Sanity checks
-  if (m_flags !=
-          D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_UPDATE &&
-      updateOnly) {
+  if (!allowUpdate && updateOnly) {
     throw std::logic_error(
         "Cannot update a bottom-level AS not originally built for updates");
   }
-  if (updateOnly && previousResult == nullptr) {
+  if (updateOnly && previousResult == 0) {
     throw std::logic_error(
         "Bottom-level hierarchy update requires the previous hierarchy");
   }
@@ -223,25 +302,11 @@ void BottomLevelASGenerator::Generate(
   buildDesc.Inputs.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
   buildDesc.Inputs.NumDescs = static_cast<UINT>(m_vertexBuffers.size());
   buildDesc.Inputs.pGeometryDescs = m_vertexBuffers.data();
-  buildDesc.DestAccelerationStructureData = {
-      resultBuffer->GetGPUVirtualAddress()};
-  buildDesc.ScratchAccelerationStructureData = {
-      scratchBuffer->GetGPUVirtualAddress()};
-  buildDesc.SourceAccelerationStructureData =
-      previousResult ? previousResult->GetGPUVirtualAddress() : 0;
+  buildDesc.DestAccelerationStructureData = resultAddress;
+  buildDesc.ScratchAccelerationStructureData = scratchAddress;
+  buildDesc.SourceAccelerationStructureData = previousResult;
   buildDesc.Inputs.Flags = flags;
 
-  // Build the AS
-  commandList->BuildRaytracingAccelerationStructure(&buildDesc, 0, nullptr);
-
-  // Wait for the builder to complete by setting a barrier on the resulting
-  // buffer. This is particularly important as the construction of the top-level
-  // hierarchy may be called right afterwards, before executing the command
-  // list.
-  D3D12_RESOURCE_BARRIER uavBarrier;
-  uavBarrier.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
-  uavBarrier.UAV.pResource = resultBuffer;
-  uavBarrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
-  commandList->ResourceBarrier(1, &uavBarrier);
+  return buildDesc;
 }
 } // namespace nv_helpers_dx12
@@ -140,6 +140,17 @@ public:
                                   /// acceleration structure
   );
 
+  /// Same as above, but with the build flags spelled out, so compaction and the
+  /// fast trace/fast build preferences can be asked for as well as updates
+  void ComputeASBufferSizes(
+      ID3D12Device5* device, /// Device on which the build will be performed
+      D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAGS flags, /// Build flags, without PERFORM_UPDATE
+      UINT64* scratchSizeInBytes, /// Required scratch memory on the GPU to
+                                  /// build the acceleration structure
+      UINT64* resultSizeInBytes   /// Required GPU memory to store the
+                                  /// acceleration structure
+  );
+
   /// Enqueue the construction of the acceleration structure on a command list, using
   /// application-provided buffers and possibly a pointer to the previous acceleration structure in
   /// case of iterative updates. Note that the update can be done in place: the result and
@@ -154,6 +165,38 @@ public:
                                                /// if an iterative update is requested
   );
 
+  /// Same as above, but taking GPU addresses instead of resources, so the scratch
+  /// and result can live anywhere inside larger buffers. Both addresses have to be
+  /// 256-byte aligned. The build can also write post-build information, such as
+  /// the compacted size, which requires the matching build flag
+  void Generate(
+      ID3D12GraphicsCommandList4* commandList, /// Command list on which the build will be enqueued
+      D3D12_GPU_VIRTUAL_ADDRESS scratchAddress, /// Scratch memory used by the builder
+      D3D12_GPU_VIRTUAL_ADDRESS resultAddress,  /// Where the acceleration structure is stored
+      bool updateOnly = false, /// If true, simply refit the existing acceleration structure
+      D3D12_GPU_VIRTUAL_ADDRESS previousResult = 0, /// Optional previous acceleration structure
+      const D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_DESC* postbuildInfo =
+          nullptr /// Optional post-build information to emit, the destination has to be
+                  /// in the unordered access state
+  );
+
+  /// Fill in the build description without recording anything, not even a
+  /// barrier, so several builds can be recorded back to back and synchronized
+  /// once. The description points into the generator's geometry, which has to
+  /// stay alive until the build is recorded
+  D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC GetBuildDesc(
+      D3D12_GPU_VIRTUAL_ADDRESS scratchAddress, /// Scratch memory used by the builder
+      D3D12_GPU_VIRTUAL_ADDRESS resultAddress,  /// Where the acceleration structure is stored
+      bool updateOnly = false, /// If true, simply refit the existing acceleration structure
+      D3D12_GPU_VIRTUAL_ADDRESS previousResult = 0 /// Optional previous acceleration structure
+  );
+
+  /// Scratch memory the build needs, as computed by ComputeASBufferSizes
+  UINT64 GetScratchSizeInBytes() const { return m_scratchSizeInBytes; }
+
+  /// Flags the sizes were computed with
+  D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAGS GetFlags() const { return m_flags; }
+
 private:
   /// Vertex buffer descriptors used to generate the AS
   std::vector<D3D12_RAYTRACING_GEOMETRY_DESC> m_vertexBuffers = {};
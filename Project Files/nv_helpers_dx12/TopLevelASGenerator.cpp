@@ -75,7 +75,36 @@ void TopLevelASGenerator::AddInstance(
                                         // invocated upon hitting the geometry
 )
 {
-  m_instances.emplace_back(Instance(bottomLevelAS, transform, instanceID, hitGroupIndex));
+  AddInstance(bottomLevelAS->GetGPUVirtualAddress(), transform, instanceID, hitGroupIndex);
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Add an instance from the GPU address of its bottom-level AS, which does not
+// have to sit at the start of a resource
+void TopLevelASGenerator::AddInstance(
+    D3D12_GPU_VIRTUAL_ADDRESS bottomLevelAS, // Address of the bottom-level acceleration structure
+    const DirectX::XMMATRIX& transform,      // Transform matrix to apply to the instance
+    UINT instanceID,                         // Instance ID visible in the shaders
+    UINT hitGroupIndex                       // Hit group index in the Shader Binding Table
+)
+{
+  m_instances.emplace_back(Instance(bottomLevelAS, &transform, nullptr, instanceID, hitGroupIndex, 0xFF));
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+// Add an instance whose transform is already laid out the way the instance
+// descriptor stores it
+void TopLevelASGenerator::AddInstance(
+    D3D12_GPU_VIRTUAL_ADDRESS bottomLevelAS, // Address of the bottom-level acceleration structure
+    const float* transform,                  // 3x4 row major transform, 12 floats
+    UINT instanceID,                         // Instance ID visible in the shaders
+    UINT hitGroupIndex,                      // Hit group index in the Shader Binding Table
+    UINT instanceMask                        // Visibility mask, anded with the ray's
+)
+{
+  m_instances.emplace_back(Instance(bottomLevelAS, nullptr, transform, instanceID, hitGroupIndex, instanceMask));
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -188,14 +217,20 @@ void TopLevelASGenerator::Generate(
     // be accessible from outside
     instanceDescs[i].Flags = D3D12_RAYTRACING_INSTANCE_FLAG_NONE;
     // Instance transform matrix
-    DirectX::XMMATRIX m = XMMatrixTranspose(
-        m_instances[i].transform); // GLM is column major, the INSTANCE_DESC is row major
-    memcpy(instanceDescs[i].Transform, &m, sizeof(instanceDescs[i].Transform));
+    if (m_instances[i].transformRows != nullptr)
+    {
+      memcpy(instanceDescs[i].Transform, m_instances[i].transformRows, sizeof(instanceDescs[i].Transform));
+    }
+    else
+    {
+      DirectX::XMMATRIX m = XMMatrixTranspose(
+          *m_instances[i].transform); // GLM is column major, the INSTANCE_DESC is row major
+      memcpy(instanceDescs[i].Transform, &m, sizeof(instanceDescs[i].Transform));
+    }
     // Get access to the bottom level
-    instanceDescs[i].AccelerationStructure = m_instances[i].bottomLevelAS->GetGPUVirtualAddress();
-    // Visibility mask, always visible here - TODO: should be accessible from
-    // outside
-    instanceDescs[i].InstanceMask = 0xFF;
+    instanceDescs[i].AccelerationStructure = m_instances[i].bottomLevelAS;
+    // Visibility mask, which kinds of ray can hit the instance
+    instanceDescs[i].InstanceMask = m_instances[i].instanceMask;
   }
 
   descriptorsBuffer->Unmap(0, nullptr);
@@ -252,9 +287,10 @@ void TopLevelASGenerator::Generate(
 //--------------------------------------------------------------------------------------------------
 //
 //
-TopLevelASGenerator::Instance::Instance(ID3D12Resource* blAS, const DirectX::XMMATRIX& tr, UINT iID,
-                                        UINT hgId)
-    : bottomLevelAS(blAS), transform(tr), instanceID(iID), hitGroupIndex(hgId)
+TopLevelASGenerator::Instance::Instance(D3D12_GPU_VIRTUAL_ADDRESS blAS, const DirectX::XMMATRIX* tr,
+                                        const float* rows, UINT iID, UINT hgId, UINT mask)
+    : bottomLevelAS(blAS), transform(tr), transformRows(rows), instanceID(iID), hitGroupIndex(hgId),
+      instanceMask(mask)
 {
 }
 } // namespace nv_helpers_dx12
@@ -95,6 +95,27 @@ namespace nv_helpers_dx12
 				/// invocated upon hitting the geometry
 			);
 
+		/// Same as above, but taking the GPU address of the bottom-level AS directly,
+		/// for acceleration structures suballocated inside a larger buffer
+		void
+			AddInstance(D3D12_GPU_VIRTUAL_ADDRESS bottomLevelAS, /// Address of the bottom-level acceleration
+				/// structure, 256-byte aligned
+				const DirectX::XMMATRIX& transform, /// Transform matrix to apply to the instance
+				UINT instanceID,   /// Instance ID visible in the shaders
+				UINT hitGroupIndex /// Hit group index in the Shader Binding Table
+			);
+
+		/// Same again, but with the transform already as the 3x4 row major matrix the
+		/// instance descriptor holds, so Generate copies it straight in
+		void
+			AddInstance(D3D12_GPU_VIRTUAL_ADDRESS bottomLevelAS, /// Address of the bottom-level acceleration
+				/// structure, 256-byte aligned
+				const float* transform, /// 12 floats, which have to stay put until Generate
+				UINT instanceID,   /// Instance ID visible in the shaders
+				UINT hitGroupIndex, /// Hit group index in the Shader Binding Table
+				UINT instanceMask = 0xFF /// Anded with a ray's InstanceInclusionMask, the instance is skipped if it comes to 0
+			);
+
 		void RemoveAllInstances() { m_instances.clear(); }
 
 		/// Compute the size of the scratch space required to build the acceleration
@@ -134,15 +155,18 @@ namespace nv_helpers_dx12
 		/// Helper struct storing the instance data
 		struct Instance
 		{
-			Instance(ID3D12Resource* blAS, const DirectX::XMMATRIX& tr, UINT iID, UINT hgId);
-			/// Bottom-level AS
-			ID3D12Resource* bottomLevelAS;
-			/// Transform matrix
-			const DirectX::XMMATRIX& transform;
+			Instance(D3D12_GPU_VIRTUAL_ADDRESS blAS, const DirectX::XMMATRIX* tr, const float* rows, UINT iID, UINT hgId, UINT mask);
+			/// Address of the bottom-level AS
+			D3D12_GPU_VIRTUAL_ADDRESS bottomLevelAS;
+			/// Transform matrix, or the descriptor's 3x4 rows if that's null
+			const DirectX::XMMATRIX* transform;
+			const float* transformRows;
 			/// Instance ID visible in the shader
 			UINT instanceID;
 			/// Hit group index used to fetch the shaders from the SBT
 			UINT hitGroupIndex;
+			/// Visibility mask, which kinds of ray can hit the instance
+			UINT instanceMask;
 		};
 
 		/// Construction flags, indicating whether the AS supports iterative updates